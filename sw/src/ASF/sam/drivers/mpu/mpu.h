@@ -140,7 +140,7 @@
 #define SRAM_START_ADDRESS                  0x20400000UL
 #define SRAM_END_ADDRESS                    0x2045FFFFUL
 
-#if defined MPU_HAS_NOCACHE_REGION
+#if defined MPU_HAS_NOCACHE_REGION && !defined NOCACHE_SRAM_REGION_SIZE
 #define NOCACHE_SRAM_REGION_SIZE            0x1000
 #endif
 
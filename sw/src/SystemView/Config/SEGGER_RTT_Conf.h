@@ -74,6 +74,12 @@ Revision: $Rev: 21386 $
 //#define SEGGER_RTT_CPU_CACHE_LINE_SIZE            (32)          // Largest cache line size (in bytes) in the current system
 //#define SEGGER_RTT_UNCACHED_OFF                   (0xFB000000)  // Address alias where RTT CB and buffers can be accessed uncached
 //
+// The J-Link reads the control block and buffers straight from memory, keep them out of the D-cache.
+//
+#ifndef   SEGGER_RTT_SECTION
+  #define SEGGER_RTT_SECTION                        ".nocache"
+#endif
+//
 // Most common case:
 // Up-channel 0: RTT
 // Up-channel 1: SystemView
@@ -328,6 +328,7 @@ static void _setup_memory_region()
 
 #if defined(__GNUC__)
 extern char _itcm_lma, _sitcm, _eitcm;
+extern uint32_t _snocache, _enocache;
 #endif
 
 /** \brief  TCM memory enable
@@ -374,6 +375,14 @@ void board_init()
         _setup_memory_region();
     }
 
+#   if defined(__GNUC__)
+    /* The non-cacheable section is left out of .bss by the linker script, zero it before anything uses it. */
+    for (uint32_t* word = &_snocache; word < &_enocache; word++)
+    {
+        *word = 0U;
+    }
+#   endif
+
     if constexpr (board::kEnableCacheAtInit)
     {
         /* Enabling the Cache */
@@ -467,6 +476,9 @@ void board_init()
         /* Configure the transiver0 RS & EN pins. */
         ioport_set_pin_dir(PIN_CAN0_TR_RS_IDX, IOPORT_DIR_OUTPUT);
         ioport_set_pin_dir(PIN_CAN0_TR_EN_IDX, IOPORT_DIR_OUTPUT);
+        /* Put the transceiver in normal mode. */
+        ioport_set_pin_level(PIN_CAN0_TR_RS_IDX, IOPORT_PIN_LEVEL_LOW);
+        ioport_set_pin_level(PIN_CAN0_TR_EN_IDX, IOPORT_PIN_LEVEL_HIGH);
     }
 
     if constexpr (board::kEnableCan1)
@@ -474,6 +486,12 @@ void board_init()
         /* Configure the CAN1 TX and RX pin. */
         ioport_set_pin_peripheral_mode(PIN_CAN1_RX_IDX, PIN_CAN1_RX_FLAGS);
         ioport_set_pin_peripheral_mode(PIN_CAN1_TX_IDX, PIN_CAN1_TX_FLAGS);
+        /* Configure the transiver1 RS & EN pins. */
+        ioport_set_pin_dir(PIN_CAN1_TR_RS_IDX, IOPORT_DIR_OUTPUT);
+        ioport_set_pin_dir(PIN_CAN1_TR_EN_IDX, IOPORT_DIR_OUTPUT);
+        /* Put the transceiver in normal mode. */
+        ioport_set_pin_level(PIN_CAN1_TR_RS_IDX, IOPORT_PIN_LEVEL_LOW);
+        ioport_set_pin_level(PIN_CAN1_TR_EN_IDX, IOPORT_PIN_LEVEL_HIGH);
     }
 
     if constexpr (board::kEnableSpi)
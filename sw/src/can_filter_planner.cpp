@@ -0,0 +1,435 @@
+#include "can_filter_planner.h"
+
+#include <algorithm>
+
+// Largest group of identifiers covered by a single mask element, bounds the search below.
+constexpr uint32_t kMaxMaskBits = 8U;
+
+/**
+ * Identifiers first..last, of which wanted were subscribed.  Runs start out exact and only grow unwanted identifiers
+ * when merged.
+ */
+struct CanIdRun
+{
+    uint32_t first;
+    uint32_t last;
+    uint32_t wanted;
+};
+
+// Scratch space, the planner only runs while channels are set up.
+static std::array<CanIdRun, kMaxCanFilterIds> planner_runs = {};
+static std::array<uint32_t, kMaxCanFilterIds> planner_singles = {};
+static std::array<bool, kMaxCanFilterIds> planner_single_covered = {};
+static std::array<CanFilter, kMaxCanFilterIds> planner_exact = {};
+
+static bool is_single(const CanIdRun& run)
+{
+    return run.first == run.last;
+}
+
+/**
+ * Index of the identifier among the singles not covered yet, or size if there is none.
+ */
+static size_t find_single(uint32_t id, size_t size)
+{
+    const auto end = planner_singles.begin() + static_cast<ptrdiff_t>(size);
+    const auto it = std::lower_bound(planner_singles.begin(), end, id);
+    const auto index = static_cast<size_t>(it - planner_singles.begin());
+
+    if ((it == end) || (*it != id) || planner_single_covered[index])
+    {
+        return size;
+    }
+
+    return index;
+}
+
+/**
+ * Grow a group around the single at index from, one bit at a time, as long as flipping the bit in every member of
+ * the group lands on singles not covered yet.
+ *
+ * \return the bits that vary within the group.
+ */
+static uint32_t grow_mask_group(size_t from, size_t size, uint32_t id_mask)
+{
+    const uint32_t base = planner_singles[from];
+    uint32_t free_bits = 0U;
+    uint32_t free_count = 0U;
+
+    for (uint32_t bit = 1U; (bit & id_mask) != 0U; bit <<= 1U)
+    {
+        if (free_count == kMaxMaskBits)
+        {
+            break;
+        }
+
+        bool complete = true;
+        uint32_t subset = free_bits;
+
+        while (true)
+        {
+            if (find_single((base ^ subset) ^ bit, size) == size)
+            {
+                complete = false;
+                break;
+            }
+
+            if (subset == 0U)
+            {
+                break;
+            }
+
+            subset = (subset - 1U) & free_bits;
+        }
+
+        if (complete)
+        {
+            free_bits |= bit;
+            free_count++;
+        }
+    }
+
+    return (free_count >= 2U) ? free_bits : 0U;
+}
+
+/**
+ * Cover the runs exactly into planner_exact.
+ *
+ * \return the number of filter elements needed.
+ */
+static size_t plan_exact(size_t run_count, uint32_t id_mask)
+{
+    size_t count = 0U;
+    size_t single_count = 0U;
+
+    for (size_t i = 0U; i < run_count; i++)
+    {
+        const CanIdRun& run = planner_runs[i];
+
+        if (is_single(run))
+        {
+            planner_singles[single_count] = run.first;
+            planner_single_covered[single_count] = false;
+            single_count++;
+        }
+        else
+        {
+            planner_exact[count++] = {CanFilterType::kRange, run.first, run.last};
+        }
+    }
+
+    // Singles are never adjacent, but may still form bit patterns a single mask element covers.
+    for (size_t i = 0U; i < single_count; i++)
+    {
+        if (planner_single_covered[i])
+        {
+            continue;
+        }
+
+        const uint32_t free_bits = grow_mask_group(i, single_count, id_mask);
+        if (free_bits == 0U)
+        {
+            continue;
+        }
+
+        const uint32_t base = planner_singles[i];
+        uint32_t subset = free_bits;
+
+        while (true)
+        {
+            planner_single_covered[find_single(base ^ subset, single_count)] = true;
+
+            if (subset == 0U)
+            {
+                break;
+            }
+
+            subset = (subset - 1U) & free_bits;
+        }
+
+        planner_exact[count++] = {CanFilterType::kMask, base & ~free_bits & id_mask, id_mask & ~free_bits};
+    }
+
+    // Pair up whatever is left, an odd one out takes a dual element of its own.
+    size_t pending = single_count;
+    for (size_t i = 0U; i < single_count; i++)
+    {
+        if (planner_single_covered[i])
+        {
+            continue;
+        }
+
+        if (pending == single_count)
+        {
+            pending = i;
+            continue;
+        }
+
+        planner_exact[count++] = {CanFilterType::kDual, planner_singles[pending], planner_singles[i]};
+        pending = single_count;
+    }
+
+    if (pending != single_count)
+    {
+        planner_exact[count++] = {CanFilterType::kDual, planner_singles[pending], planner_singles[pending]};
+    }
+
+    return count;
+}
+
+static size_t merged_cost(size_t multi, size_t singles)
+{
+    return multi + ((singles + 1U) / 2U);
+}
+
+/**
+ * Merge neighbouring runs until they fit the budget, always picking the merge that saves an element while letting in
+ * the fewest unwanted identifiers.
+ *
+ * \return the number of runs left.
+ */
+static size_t merge_runs(size_t run_count, size_t budget)
+{
+    size_t multi = 0U;
+    size_t singles = 0U;
+
+    for (size_t i = 0U; i < run_count; i++)
+    {
+        if (is_single(planner_runs[i]))
+        {
+            singles++;
+        }
+        else
+        {
+            multi++;
+        }
+    }
+
+    while ((merged_cost(multi, singles) > budget) && (run_count > 1U))
+    {
+        const size_t cost = merged_cost(multi, singles);
+        size_t best = 0U;
+        uint32_t best_gap = UINT32_MAX;
+        bool best_saves = false;
+
+        for (size_t i = 0U; (i + 1U) < run_count; i++)
+        {
+            const CanIdRun& a = planner_runs[i];
+            const CanIdRun& b = planner_runs[i + 1U];
+            const uint32_t gap = b.first - a.last - 1U;
+
+            size_t new_multi = multi;
+            size_t new_singles = singles;
+            if (is_single(a) && is_single(b))
+            {
+                new_multi++;
+                new_singles -= 2U;
+            }
+            else if (is_single(a) || is_single(b))
+            {
+                new_singles--;
+            }
+            else
+            {
+                new_multi--;
+            }
+
+            const bool saves = merged_cost(new_multi, new_singles) < cost;
+            if ((saves && !best_saves) || ((saves == best_saves) && (gap < best_gap)))
+            {
+                best = i;
+                best_gap = gap;
+                best_saves = saves;
+            }
+        }
+
+        CanIdRun& a = planner_runs[best];
+        const CanIdRun& b = planner_runs[best + 1U];
+
+        if (is_single(a) && is_single(b))
+        {
+            multi++;
+            singles -= 2U;
+        }
+        else if (is_single(a) || is_single(b))
+        {
+            singles--;
+        }
+        else
+        {
+            multi--;
+        }
+
+        a.last = b.last;
+        a.wanted += b.wanted;
+
+        for (size_t i = best + 1U; (i + 1U) < run_count; i++)
+        {
+            planner_runs[i] = planner_runs[i + 1U];
+        }
+        run_count--;
+    }
+
+    return run_count;
+}
+
+static void add_filter(CanFilterPlan& plan, CanFilterType type, uint32_t id1, uint32_t id2)
+{
+    plan.filters[plan.count] = {type, id1, id2};
+    plan.count++;
+}
+
+bool can_filter_plan(const CanFilterRequest& request, CanFilterPlan& plan)
+{
+    plan = {};
+
+    if ((request.id_count > kMaxCanFilterIds) || (request.max_filters > kMaxCanFilters))
+    {
+        return false;
+    }
+
+    uint32_t* ids = request.ids;
+    for (size_t i = 0U; i < request.id_count; i++)
+    {
+        if ((ids[i] & ~request.id_mask) != 0U)
+        {
+            return false;
+        }
+    }
+
+    std::sort(ids, ids + request.id_count);
+    size_t id_count = static_cast<size_t>(std::unique(ids, ids + request.id_count) - ids);
+
+    // Priority identifiers get an element and an RX buffer each, keeping one element for the rest.
+    for (size_t i = 0U; i < request.priority_count; i++)
+    {
+        const uint32_t id = request.priority_ids[i];
+        auto* it = std::lower_bound(ids, ids + id_count, id);
+
+        if ((it == (ids + id_count)) || (*it != id))
+        {
+            continue;
+        }
+
+        const bool last = (id_count == 1U);
+        if ((plan.rx_buffers == request.max_rx_buffers) || ((plan.count + (last ? 1U : 2U)) > request.max_filters))
+        {
+            break;
+        }
+
+        const auto buffer = static_cast<uint32_t>(request.first_rx_buffer + plan.rx_buffers);
+        add_filter(plan, CanFilterType::kRxBuffer, id, buffer);
+        plan.rx_buffers++;
+
+        std::copy(it + 1, ids + id_count, it);
+        id_count--;
+    }
+
+    size_t run_count = 0U;
+    for (size_t i = 0U; i < id_count; i++)
+    {
+        if ((run_count > 0U) && (planner_runs[run_count - 1U].last == (ids[i] - 1U)))
+        {
+            planner_runs[run_count - 1U].last = ids[i];
+            planner_runs[run_count - 1U].wanted++;
+        }
+        else
+        {
+            planner_runs[run_count] = {ids[i], ids[i], 1U};
+            run_count++;
+        }
+    }
+
+    const size_t budget = request.max_filters - plan.count;
+
+    const size_t exact_count = plan_exact(run_count, request.id_mask);
+    if (exact_count <= budget)
+    {
+        for (size_t i = 0U; i < exact_count; i++)
+        {
+            add_filter(plan, planner_exact[i].type, planner_exact[i].id1, planner_exact[i].id2);
+        }
+
+        return true;
+    }
+
+    run_count = merge_runs(run_count, budget);
+
+    size_t pending = run_count;
+    for (size_t i = 0U; i < run_count; i++)
+    {
+        const CanIdRun& run = planner_runs[i];
+        plan.extra_ids += (run.last - run.first + 1U) - run.wanted;
+
+        // Priority identifiers merged over still match their own element first.
+        for (size_t j = 0U; j < plan.rx_buffers; j++)
+        {
+            if ((plan.filters[j].id1 > run.first) && (plan.filters[j].id1 < run.last))
+            {
+                plan.extra_ids--;
+            }
+        }
+
+        if (!is_single(run))
+        {
+            add_filter(plan, CanFilterType::kRange, run.first, run.last);
+        }
+        else if (pending == run_count)
+        {
+            pending = i;
+        }
+        else
+        {
+            add_filter(plan, CanFilterType::kDual, planner_runs[pending].first, run.first);
+            pending = run_count;
+        }
+    }
+
+    if (pending != run_count)
+    {
+        add_filter(plan, CanFilterType::kDual, planner_runs[pending].first, planner_runs[pending].first);
+    }
+
+    return true;
+}
+
+bool can_filter_accepts(const CanFilterPlan& plan, uint32_t id)
+{
+    for (size_t i = 0U; i < plan.count; i++)
+    {
+        const CanFilter& filter = plan.filters[i];
+
+        switch (filter.type)
+        {
+            case CanFilterType::kRange:
+                if ((id >= filter.id1) && (id <= filter.id2))
+                {
+                    return true;
+                }
+                break;
+
+            case CanFilterType::kDual:
+                if ((id == filter.id1) || (id == filter.id2))
+                {
+                    return true;
+                }
+                break;
+
+            case CanFilterType::kMask:
+                if ((id & filter.id2) == filter.id1)
+                {
+                    return true;
+                }
+                break;
+
+            case CanFilterType::kRxBuffer:
+                if (id == filter.id1)
+                {
+                    return true;
+                }
+                break;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,115 @@
+#include "can_gateway.h"
+
+#include "can_filter_planner.h"
+
+#include <algorithm>
+#include <cstring>
+
+template <size_t N>
+static constexpr bool can_gateway_valid(const std::array<logic::CanRouteDefinition, N>& definitions)
+{
+    for (const auto& definition : definitions)
+    {
+        const uint32_t id_mask = definition.extended ? kCanExtendedIdMask : kCanStandardIdMask;
+
+        if (((definition.id & ~id_mask) != 0U) ||
+            ((definition.new_id != logic::kCanKeepId) && ((definition.new_id & ~id_mask) != 0U)))
+        {
+            return false;
+        }
+
+        bool unused = false;
+        for (const auto& remap : definition.remaps)
+        {
+            // Unused entries only ever follow the used ones.
+            if (remap.length == 0U)
+            {
+                unused = true;
+            }
+            else if (unused || ((remap.from_bit + remap.length) > 64U) || ((remap.to_bit + remap.length) > 64U))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <size_t N>
+static constexpr std::array<CanRoute, N> can_gateway_compile(
+    const std::array<logic::CanRouteDefinition, N>& definitions)
+{
+    std::array<CanRoute, N> routes = {};
+
+    for (size_t i = 0U; i < N; i++)
+    {
+        const auto& definition = definitions[i];
+
+        routes[i].key = can_route_key(definition.source, definition.id, definition.extended);
+        routes[i].destination = definition.destination;
+        routes[i].new_id = definition.new_id;
+        routes[i].remaps = definition.remaps;
+
+        for (const auto& remap : definition.remaps)
+        {
+            if (remap.length != 0U)
+            {
+                routes[i].remap_count++;
+            }
+        }
+    }
+
+    std::sort(routes.begin(), routes.end(), [](const CanRoute& a, const CanRoute& b) { return a.key < b.key; });
+
+    return routes;
+}
+
+static_assert(can_gateway_valid(logic::kCanRoutes), "A CAN route does not fit its identifier format or payload.");
+
+static constexpr auto kCanRoutes = can_gateway_compile(logic::kCanRoutes);
+
+CanRouteRange can_gateway_find(CanChannel source, uint32_t id, bool extended)
+{
+    const uint32_t key = can_route_key(source, id, extended);
+
+    const auto* first = std::lower_bound(kCanRoutes.begin(), kCanRoutes.end(), key,
+        [](const CanRoute& route, uint32_t value) { return route.key < value; });
+
+    const auto* last = first;
+    while ((last != kCanRoutes.end()) && (last->key == key))
+    {
+        last++;
+    }
+
+    return {first, last};
+}
+
+void can_gateway_payload(const CanRoute& route, const uint8_t* in, uint8_t* out, size_t length)
+{
+    if (route.remap_count == 0U)
+    {
+        memcpy(out, in, length);
+        return;
+    }
+
+    // The remapped fields fit a 64-bit word, little endian like the core.
+    uint64_t from = 0U;
+    uint64_t to = 0U;
+    memcpy(&from, in, (length < sizeof(from)) ? length : sizeof(from));
+
+    for (size_t i = 0U; i < route.remap_count; i++)
+    {
+        const auto& remap = route.remaps[i];
+        const uint64_t mask = (remap.length == 64U) ? UINT64_MAX : ((1ULL << remap.length) - 1U);
+
+        to |= ((from >> remap.from_bit) & mask) << remap.to_bit;
+    }
+
+    memcpy(out, &to, (length < sizeof(to)) ? length : sizeof(to));
+
+    if (length > sizeof(to))
+    {
+        memset(out + sizeof(to), 0, length - sizeof(to));
+    }
+}
@@ -0,0 +1,153 @@
+#include "can_stats.h"
+
+#include "cycle_timer.h"
+#include "mcan_clock.h"
+#include "mcan_rx.h"
+
+#include "conf_board.h"
+#include "conf_can.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+// Counters at the last sample, the rates are taken over the time since.
+struct CanStatsBaseline
+{
+    CanTraffic received;
+    CanTraffic sent;
+};
+
+static std::array<bool, kCanChannels> can_stats_enabled = {{board::kEnableCan0, board::kEnableCan1}};
+
+static std::array<std::array<uint32_t, kCanLatencyBuckets>, kCanChannels> can_latency_histograms = {};
+static std::array<uint32_t, kCanChannels> can_latency_max_cycles = {};
+
+static std::array<CanStatsBaseline, kCanChannels> can_stats_baselines = {};
+static TickType_t can_stats_sampled = 0U;
+
+// Written by the CAN task, copied out by the diagnostics task.
+static CanStatsSnapshot can_stats_snapshot = {};
+
+static CanTraffic can_stats_delta(const CanTraffic& now, const CanTraffic& then)
+{
+    return {now.frames - then.frames, now.nominal_bits - then.nominal_bits, now.data_bits - then.data_bits};
+}
+
+/**
+ * Time the traffic kept the bus busy, over the period, in per mille.
+ */
+static uint32_t can_stats_load_permille(size_t channel, const CanTraffic& traffic, uint32_t period_ms)
+{
+    const uint32_t data_bitrate = can::kChannels[channel].data_bitrate;
+
+    uint64_t busy_ns = (traffic.nominal_bits * 1000000000ULL) / kCanNominalBitrate;
+    if (data_bitrate != 0U)
+    {
+        busy_ns += (traffic.data_bits * 1000000000ULL) / data_bitrate;
+    }
+
+    return static_cast<uint32_t>(busy_ns / (period_ms * 1000ULL));
+}
+
+void can_stats_record_latency(CanChannel channel, uint32_t latency_cycles)
+{
+    const auto index = static_cast<size_t>(channel);
+    const uint32_t latency_us = cycles_to_us(latency_cycles);
+
+    // 0 to 7 us land in bucket 0, 8 to 15 us in bucket 1, and so on by powers of two.
+    const auto bucket = std::min<size_t>(std::bit_width(latency_us >> 3U), kCanLatencyBuckets - 1U);
+    can_latency_histograms[index][bucket]++;
+
+    can_latency_max_cycles[index] = std::max(can_latency_max_cycles[index], latency_cycles);
+}
+
+void can_stats_sample()
+{
+    const TickType_t now = xTaskGetTickCount();
+    const uint32_t period_ms = (now - can_stats_sampled) * portTICK_PERIOD_MS;
+    can_stats_sampled = now;
+
+    CanStatsSnapshot snapshot = can_stats_snapshot;
+    snapshot.magic = kCanStatsMagic;
+    snapshot.version = kCanStatsVersion;
+    snapshot.uptime_ms = now * portTICK_PERIOD_MS;
+    snapshot.channels = kCanChannels;
+
+    for (size_t i = 0U; i < kCanChannels; i++)
+    {
+        if (false == can_stats_enabled[i])
+        {
+            continue;
+        }
+
+        const auto channel = static_cast<CanChannel>(i);
+        const CanRxStats stats = mcan_rx_get_stats(channel);
+        const CanBusStatus bus = mcan_read_bus_status(channel);
+
+        CanTraffic sent = stats.sent_fifo;
+        sent.frames += stats.sent_buffers.frames;
+        sent.nominal_bits += stats.sent_buffers.nominal_bits;
+        sent.data_bits += stats.sent_buffers.data_bits;
+
+        CanStatsBaseline& baseline = can_stats_baselines[i];
+        const CanTraffic received_delta = can_stats_delta(stats.received, baseline.received);
+        const CanTraffic sent_delta = can_stats_delta(sent, baseline.sent);
+        baseline = {stats.received, sent};
+
+        CanChannelSnapshot& record = snapshot.channel[i];
+        record.frames_received = stats.received.frames;
+        record.frames_sent = sent.frames;
+
+        if (period_ms > 0U)
+        {
+            record.received_per_second = (received_delta.frames * 1000U) / period_ms;
+            record.sent_per_second = (sent_delta.frames * 1000U) / period_ms;
+            record.bus_load_permille = can_stats_load_permille(i, received_delta, period_ms) +
+                can_stats_load_permille(i, sent_delta, period_ms);
+            record.bus_load_peak_permille = std::max(record.bus_load_peak_permille, record.bus_load_permille);
+        }
+
+        record.transmit_errors = bus.transmit_errors;
+        record.receive_errors = bus.receive_errors;
+        record.protocol_status = bus.protocol_status;
+
+        // mcan_read_bus_status() above has counted the errors up to now.
+        const CanRxStats errors = mcan_rx_get_stats(channel);
+        record.errors = errors.errors;
+        record.warnings = errors.warnings;
+        record.error_passives = errors.error_passives;
+        record.bus_offs = errors.bus_offs;
+        record.last_error_code = errors.last_error_code;
+
+        record.fifo_high_water = stats.fifo_high_water;
+        record.fifo_lost = stats.fifo_lost;
+        record.ring_high_water = stats.ring_high_water;
+        record.ring_overflows = stats.ring_overflows;
+
+        record.latency_max_us = cycles_to_us(can_latency_max_cycles[i]);
+        record.latency_histogram = can_latency_histograms[i];
+    }
+
+    taskENTER_CRITICAL();
+    can_stats_snapshot = snapshot;
+    taskEXIT_CRITICAL();
+}
+
+size_t can_stats_format_snapshot(char* buffer, size_t size)
+{
+    if (size < sizeof(CanStatsSnapshot))
+    {
+        return 0U;
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(buffer, &can_stats_snapshot, sizeof(CanStatsSnapshot));
+    taskEXIT_CRITICAL();
+
+    return sizeof(CanStatsSnapshot);
+}
@@ -0,0 +1,379 @@
+#include "can_tx_scheduler.h"
+
+#include "can_frame.h"
+#include "cycle_timer.h"
+#include "mcan_clock.h"
+#include "mcan_rx.h"
+#include "signal_db.h"
+
+#include "conf_can.h"
+#include "conf_clock.h"
+#include "conf_logic.h"
+
+#include "pmc.h"
+#include "tc.h"
+
+#include <algorithm>
+#include <array>
+
+// TC0 channel 0 counts MCK / 8, MCK runs at the core clock divided by CONFIG_SYSCLK_DIV.
+constexpr uint32_t kCanTxTimerChannel = 0U;
+constexpr uint32_t kCanTxTimerHz = configCPU_CLOCK_HZ / CONFIG_SYSCLK_DIV / 8U;
+constexpr uint32_t kCanTxTimerCountsPerSlot =
+    static_cast<uint32_t>((static_cast<uint64_t>(kCanTxTimerHz) * kCanTxSlotUs) / 1000000U);
+constexpr uint32_t kCyclesPerTimerCount = configCPU_CLOCK_HZ / kCanTxTimerHz;
+
+static_assert((kCanTxTimerCountsPerSlot * 1000000ULL == static_cast<uint64_t>(kCanTxTimerHz) * kCanTxSlotUs) &&
+    (kCanTxTimerCountsPerSlot <= 0xFFFFU), "The CAN TX slot is not a whole number of timer counts.");
+
+// Longest hyperperiod of the cycle times the offsets are planned over, in slots.
+constexpr uint32_t kCanTxMaxHyperperiod = 10000U;
+
+constexpr const can::ChannelConfig& kCanTxChannel = can::kChannels[static_cast<size_t>(logic::kCanTransmitChannel)];
+
+struct CanTxEntry
+{
+    uint16_t message;   // Index into can_dbc::kTxMessages.
+    uint32_t period;    // In slots.
+    uint32_t offset;    // Slot of the first transmission, below the period.
+};
+
+constexpr size_t can_tx_entry_count()
+{
+    size_t count = 0U;
+
+    for (const auto& message : can_dbc::kTxMessages)
+    {
+        if (message.cycle_time_ms != 0U)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+constexpr size_t kCanTxEntryCount = can_tx_entry_count();
+
+struct CanTxSchedule
+{
+    std::array<CanTxEntry, kCanTxEntryCount> entries;
+    uint32_t hyperperiod;
+
+    uint32_t load_permille;
+    uint32_t peak_slot_load_permille;
+    uint32_t unplanned_peak_slot_permille;
+};
+
+/**
+ * Worst case time of the frame on the bus, in nanoseconds.  Frames longer than 8 bytes are CAN-FD frames, sent at the
+ * data bit rate from the bit rate switch to the CRC delimiter.
+ */
+constexpr uint32_t can_tx_frame_ns(const can_dbc::MessageDescriptor& message)
+{
+    const bool extended = (message.id & can_dbc::kExtendedIdFlag) != 0U;
+    const bool fd = (message.length > 8U) && (kCanTxChannel.data_bitrate != 0U);
+    const CanFrameBits bits = can_frame_bits(extended, message.length, fd, fd, kCanWorstStuffInterval);
+
+    return static_cast<uint32_t>(((bits.nominal * 1000000000ULL) / kCanNominalBitrate) +
+        (fd ? ((bits.data * 1000000000ULL) / kCanTxChannel.data_bitrate) : 0U));
+}
+
+constexpr uint32_t can_tx_gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0U)
+    {
+        const uint32_t rest = a % b;
+        a = b;
+        b = rest;
+    }
+
+    return a;
+}
+
+constexpr bool can_tx_valid()
+{
+    uint32_t hyperperiod = 1U;
+
+    for (const auto& message : can_dbc::kTxMessages)
+    {
+        if (message.cycle_time_ms == 0U)
+        {
+            continue;
+        }
+
+        if (((message.cycle_time_ms * 1000U) % kCanTxSlotUs) != 0U)
+        {
+            return false;
+        }
+
+        if ((message.length > 8U) &&
+            ((kCanTxChannel.data_bitrate == 0U) || (message.length > kCanTxChannel.element_data_bytes)))
+        {
+            return false;
+        }
+
+        const uint32_t period = (message.cycle_time_ms * 1000U) / kCanTxSlotUs;
+        hyperperiod = (hyperperiod / can_tx_gcd(hyperperiod, period)) * period;
+
+        if (hyperperiod > kCanTxMaxHyperperiod)
+        {
+            return false;
+        }
+    }
+
+    // One dedicated TX buffer per message, numbered by the 8-bit TX event marker.
+    return (kCanTxEntryCount <= kCanTxChannel.tx_buffers) && (kCanTxEntryCount <= 256U);
+}
+
+static_assert(can_tx_valid(), "The VCM messages in the DBC do not fit the CAN TX schedule or the transmit channel.");
+
+constexpr CanTxSchedule can_tx_plan()
+{
+    CanTxSchedule schedule = {};
+    schedule.hyperperiod = 1U;
+
+    size_t count = 0U;
+    for (size_t i = 0U; i < can_dbc::kTxMessages.size(); i++)
+    {
+        const uint32_t cycle_time_ms = can_dbc::kTxMessages[i].cycle_time_ms;
+
+        if (cycle_time_ms != 0U)
+        {
+            const uint32_t period = (cycle_time_ms * 1000U) / kCanTxSlotUs;
+            schedule.entries[count++] = {static_cast<uint16_t>(i), period, 0U};
+            schedule.hyperperiod = (schedule.hyperperiod / can_tx_gcd(schedule.hyperperiod, period)) * period;
+        }
+    }
+
+    // Shortest cycle times first, they have the fewest offsets to choose from.
+    std::sort(schedule.entries.begin(), schedule.entries.end(), [](const CanTxEntry& a, const CanTxEntry& b)
+    {
+        return (a.period != b.period) ? (a.period < b.period) : (a.message < b.message);
+    });
+
+    // Time on the bus within each slot of the hyperperiod, with the planned offsets and with every offset 0.
+    std::array<uint32_t, kCanTxMaxHyperperiod> load = {};
+    std::array<uint32_t, kCanTxMaxHyperperiod> unplanned = {};
+    uint64_t busy_ns = 0U;
+
+    for (auto& entry : schedule.entries)
+    {
+        const uint32_t frame_ns = can_tx_frame_ns(can_dbc::kTxMessages[entry.message]);
+        uint32_t best_peak = UINT32_MAX;
+
+        for (uint32_t offset = 0U; offset < entry.period; offset++)
+        {
+            uint32_t peak = 0U;
+
+            for (uint32_t slot = offset; slot < schedule.hyperperiod; slot += entry.period)
+            {
+                peak = std::max(peak, load[slot]);
+            }
+
+            if (peak < best_peak)
+            {
+                best_peak = peak;
+                entry.offset = offset;
+            }
+        }
+
+        for (uint32_t slot = 0U; slot < schedule.hyperperiod; slot += entry.period)
+        {
+            load[slot + entry.offset] += frame_ns;
+            unplanned[slot] += frame_ns;
+        }
+
+        busy_ns += static_cast<uint64_t>(frame_ns) * (schedule.hyperperiod / entry.period);
+    }
+
+    constexpr uint64_t kSlotNs = kCanTxSlotUs * 1000ULL;
+    uint32_t peak = 0U;
+    uint32_t unplanned_peak = 0U;
+
+    for (uint32_t slot = 0U; slot < schedule.hyperperiod; slot++)
+    {
+        peak = std::max(peak, load[slot]);
+        unplanned_peak = std::max(unplanned_peak, unplanned[slot]);
+    }
+
+    schedule.load_permille = static_cast<uint32_t>((busy_ns * 1000U) / (schedule.hyperperiod * kSlotNs));
+    schedule.peak_slot_load_permille = static_cast<uint32_t>((peak * 1000ULL) / kSlotNs);
+    schedule.unplanned_peak_slot_permille = static_cast<uint32_t>((unplanned_peak * 1000ULL) / kSlotNs);
+
+    return schedule;
+}
+
+static constexpr CanTxSchedule kCanTxSchedule = can_tx_plan();
+
+struct CanTxState
+{
+    uint32_t countdown;         // Slots until the message is due.
+    uint32_t last_sof_cycles;   // Start of frame of the frame sent last.
+    bool has_last;              // Whether last_sof_cycles is one cycle time before the next frame.
+};
+
+static std::array<CanTxState, kCanTxEntryCount> can_tx_states = {};
+static std::array<CanTxMessageStats, can_dbc::kTxMessages.size()> can_tx_message_stats = {};
+static CanTxStats can_tx_stats = {};
+
+static const can_dbc::SlotTable* can_tx_slots = nullptr;
+
+/**
+ * Account every frame sent since the last slot against its cycle time.
+ */
+static void can_tx_collect_events()
+{
+    CanTxEvent event = {};
+
+    while (mcan_tx_pop_event(logic::kCanTransmitChannel, event))
+    {
+        if (event.marker >= kCanTxEntryCount)
+        {
+            continue;
+        }
+
+        const CanTxEntry& entry = kCanTxSchedule.entries[event.marker];
+        CanTxState& state = can_tx_states[event.marker];
+        CanTxMessageStats& stats = can_tx_message_stats[entry.message];
+
+        stats.sent++;
+
+        if (state.has_last)
+        {
+            const uint32_t period_cycles = us_to_cycles(entry.period * kCanTxSlotUs);
+            const uint32_t interval_cycles = event.timestamp_cycles - state.last_sof_cycles;
+            const uint32_t jitter_cycles = (interval_cycles > period_cycles) ? (interval_cycles - period_cycles) :
+                (period_cycles - interval_cycles);
+
+            stats.jitter_max_cycles = std::max(stats.jitter_max_cycles, jitter_cycles);
+        }
+
+        state.last_sof_cycles = event.timestamp_cycles;
+        state.has_last = true;
+    }
+}
+
+static void can_tx_send(size_t index)
+{
+    const CanTxEntry& entry = kCanTxSchedule.entries[index];
+    const can_dbc::MessageDescriptor& message = can_dbc::kTxMessages[entry.message];
+
+    CanFrame frame = {};
+    frame.channel = logic::kCanTransmitChannel;
+    frame.length = message.length;
+
+    if ((message.id & can_dbc::kExtendedIdFlag) != 0U)
+    {
+        frame.id = message.id & ~can_dbc::kExtendedIdFlag;
+        frame.flags |= can_flags::kExtended;
+    }
+    else
+    {
+        frame.id = message.id;
+    }
+
+    if (message.length > 8U)
+    {
+        frame.flags |= can_flags::kFd | can_flags::kBitRateSwitch;
+    }
+
+    can_dbc::encode(entry.message, signal_db_values(), *can_tx_slots, &frame.data[0]);
+
+    if (false == mcan_tx_buffer_send(logic::kCanTransmitChannel, static_cast<uint32_t>(index), frame,
+        static_cast<uint8_t>(index)))
+    {
+        can_tx_message_stats[entry.message].skipped++;
+        can_tx_states[index].has_last = false;
+    }
+}
+
+void TC0_Handler()
+{
+    traceISR_ENTER();
+
+    // The counter restarted from 0 at the compare match, reading the status clears the interrupt.
+    const uint32_t latency_cycles = tc_read_cv(TC0, kCanTxTimerChannel) * kCyclesPerTimerCount;
+    (void)tc_get_status(TC0, kCanTxTimerChannel);
+
+    can_tx_stats.slots++;
+    can_tx_stats.slot_latency_max_cycles = std::max(can_tx_stats.slot_latency_max_cycles, latency_cycles);
+
+    can_tx_collect_events();
+
+    for (size_t i = 0U; i < kCanTxEntryCount; i++)
+    {
+        CanTxState& state = can_tx_states[i];
+
+        if (state.countdown > 0U)
+        {
+            state.countdown--;
+            continue;
+        }
+
+        state.countdown = kCanTxSchedule.entries[i].period - 1U;
+        can_tx_send(i);
+    }
+
+    traceISR_EXIT();
+}
+
+void can_tx_scheduler_start(const can_dbc::SlotTable& slots)
+{
+    can_tx_slots = &slots;
+
+    can_tx_stats.messages = kCanTxEntryCount;
+    can_tx_stats.load_permille = kCanTxSchedule.load_permille;
+    can_tx_stats.peak_slot_load_permille = kCanTxSchedule.peak_slot_load_permille;
+    can_tx_stats.unplanned_peak_slot_permille = kCanTxSchedule.unplanned_peak_slot_permille;
+
+    if constexpr (kCanTxEntryCount == 0U)
+    {
+        return;
+    }
+
+    for (size_t i = 0U; i < kCanTxEntryCount; i++)
+    {
+        can_tx_states[i].countdown = kCanTxSchedule.entries[i].offset;
+    }
+
+    pmc_enable_periph_clk(ID_TC0);
+
+    tc_init(TC0, kCanTxTimerChannel, TC_CMR_TCCLKS_TIMER_CLOCK2 | TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC);
+    tc_write_rc(TC0, kCanTxTimerChannel, kCanTxTimerCountsPerSlot);
+    tc_enable_interrupt(TC0, kCanTxTimerChannel, TC_IER_CPCS);
+
+    NVIC_ClearPendingIRQ(TC0_IRQn);
+    NVIC_SetPriority(TC0_IRQn, configCAN_TX_TIMER_INTERRUPT_PRIORITY);
+    NVIC_EnableIRQ(TC0_IRQn);
+
+    tc_start(TC0, kCanTxTimerChannel);
+}
+
+/**
+ * Copy statistics TC0_Handler updates.  It runs above configMAX_SYSCALL_INTERRUPT_PRIORITY, out of reach of a critical
+ * section, so every interrupt is masked for the few words of the copy.
+ */
+template <typename T>
+static T can_tx_copy_stats(const T& stats)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    const T copy = stats;
+
+    __set_PRIMASK(primask);
+
+    return copy;
+}
+
+CanTxStats can_tx_scheduler_get_stats()
+{
+    return can_tx_copy_stats(can_tx_stats);
+}
+
+CanTxMessageStats can_tx_scheduler_get_message_stats(size_t index)
+{
+    return (index < can_tx_message_stats.size()) ? can_tx_copy_stats(can_tx_message_stats[index]) :
+        CanTxMessageStats{};
+}
@@ -47,7 +47,7 @@
 #define configUSE_IDLE_HOOK						0
 #define configUSE_TICK_HOOK						0
 #define configCPU_CLOCK_HZ						(300000000UL)
-#define configTICK_RATE_HZ						(100U)
+#define configTICK_RATE_HZ						(1000U)
 #define configMAX_PRIORITIES					(5U)
 #define configMINIMAL_STACK_SIZE				(130U)
 #define configMAX_TASK_NAME_LEN					(10U)
@@ -133,6 +133,9 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 
 #define configMAC_INTERRUPT_PRIORITY            (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY)
 #define configAFEC_INTERRUPT_PRIORITY           (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY)
+#define configMCAN_INTERRUPT_PRIORITY           (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY)
+/* Above the kernel, critical sections never delay it.  It must not call the FreeRTOS API. */
+#define configCAN_TX_TIMER_INTERRUPT_PRIORITY   (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY - 1)
 
 /* Normal assert() semantics without relying on the provision of an assert.h
 header file. */
@@ -78,6 +78,9 @@
 #ifndef FREERTOS_IP_CONFIG_H
 #define FREERTOS_IP_CONFIG_H
 
+/* GMAC ring depths, the network buffers are sized from them. */
+#include "conf_eth.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -104,6 +107,9 @@ end. */
 #define ipconfigZERO_COPY_RX_DRIVER         ( 1 )
 #define ipconfigZERO_COPY_TX_DRIVER         ( 1 )
 
+/* The GMAC driver hands the frames received to the IP task in chains, one event per batch. */
+#define ipconfigUSE_LINKED_RX_MESSAGES      ( 1 )
+
 /* Include support for LLMNR: Link-local Multicast Name Resolution
 (non-Microsoft).  This allows "ping [hostname]", "ftp [hostname]", etc. when the
 IP address is not know. */
@@ -230,8 +236,8 @@ are available to the IP stack.  The total number of network buffers is limited
 to ensure the total amount of RAM that can be consumed by the IP stack is capped
 to a pre-determinable value. */
 #if( ipconfigZERO_COPY_RX_DRIVER != 0 )
-    /* _HT_ Actually we should know the value of 'configNUM_RX_DESCRIPTORS' here. */
-    #define ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS      ( 6 + 6 )
+    /* One per RX descriptor, a batch on its way to the IP task, and the frames being sent from every TX queue. */
+    #define ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS      ( GMAC_RX_BUFFERS + GMAC_RX_BATCH + GMAC_TX_DESCRIPTORS )
 #else
     #define ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS      6
 #endif
@@ -289,6 +295,18 @@ FreeRTOS_SendPingRequest() API function is available. */
 (and associated) API function is available. */
 #define ipconfigSUPPORT_SELECT_FUNCTION             0
 
+/* If ipconfigSOCKET_HAS_USER_SEMAPHORE is set to 1 then a semaphore can be
+given to a socket with FREERTOS_SO_SET_SEMAPHORE, the IP task gives it whenever
+a packet is queued for the socket.  The CAN bridge task waits for both of its
+UDP sockets and for received CAN frames on a single semaphore. */
+#define ipconfigSOCKET_HAS_USER_SEMAPHORE           1
+
+/* Maximum number of packets queued on a UDP socket before new ones are
+dropped.  No socket can queue more than all the network buffers, so by default
+nothing is dropped as without a limit, but FREERTOS_SO_UDP_MAX_RX_PACKETS is
+compiled in: the CAN bridge sets a depth of its own on its sockets. */
+#define ipconfigUDP_MAX_RX_PACKETS                  ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS
+
 /* If ipconfigFILTER_OUT_NON_ETHERNET_II_FRAMES is set to 1 then Ethernet frames
 that are not in Ethernet II format will be dropped.  This option is included for
 potential future IP stack developments. */
@@ -304,6 +322,10 @@ Ethernet driver does all the necessary filtering in hardware then software
 filtering can be removed by using a value other than 1 or 0. */
 #define ipconfigETHERNET_DRIVER_FILTERS_FRAME_TYPES 1
 
+/* Frames of an EtherType the stack does not handle go to eApplicationProcessCustomFrameHook(), the gPTP frames to
+the PTP task and the others back to the stack to be released. */
+#define ipconfigPROCESS_CUSTOM_ETHERNET_FRAMES      1
+
 /* Advanced only: in order to access 32-bit fields in the IP packets with
 32-bit memory instructions, all packets will be stored 32-bit-aligned, plus
 16-bits.  This has to do with the contents of the IP-packets: all 32-bit fields
@@ -9,7 +9,8 @@ namespace board
 /* Configure UART pins */
 constexpr bool kEnableUartConsole = true;
 constexpr bool kDisableWatchdogAtInit = true;
-constexpr bool kConfigureMpuAtInit = false;
+// Maps the non-cacheable region of the memory shared with bus masters, needed by features::kEnableDCache.
+constexpr bool kConfigureMpuAtInit = true;
 constexpr bool kEnableCacheAtInit = false;
 constexpr bool kEnableTcmAtInit = false;
 
@@ -17,8 +18,8 @@ constexpr bool kEnableTwi = true;
 
 constexpr bool kEnableEthernet = true;
 
-constexpr bool kEnableCan0 = false;
-constexpr bool kEnableCan1 = false;
+constexpr bool kEnableCan0 = true;
+constexpr bool kEnableCan1 = true;
 
 constexpr bool kEnableSpi = false;
 constexpr bool kEnableQspi = false;
@@ -0,0 +1,43 @@
+#ifndef CONF_CAN_H_
+#define CONF_CAN_H_
+
+#include <array>
+#include <cstdint>
+
+namespace can
+{
+
+struct ChannelConfig
+{
+    // Data phase bit rate of CAN-FD frames sent with bit rate switching, 0 to stay on classic CAN.  The nominal bit
+    // rate is set in conf_mcan.h.
+    uint32_t data_bitrate;
+
+    // Data field of every RX and TX element of the message RAM: 8, 12, 16, 20, 24, 32, 48 or 64 bytes.  Longer frames
+    // are truncated.
+    uint8_t element_data_bytes;
+
+    // Number of elements of every section of the message RAM.
+    uint8_t standard_filters;   // Up to 128.
+    uint8_t extended_filters;   // Up to 64.
+    uint8_t rx_fifo_0;          // Up to 64.
+    uint8_t rx_fifo_1;          // Up to 64.
+    uint8_t rx_buffers;         // Up to 32, NDAT1 only.
+    uint8_t tx_buffers;         // Dedicated TX buffers, up to 32 together with the TX FIFO.
+    uint8_t tx_fifo;            // Shared by the gateway, the CAN bridge and ISO-TP.
+    uint8_t tx_events;          // Up to 32.
+};
+
+constexpr uint32_t kCanFdDataBitrate2M = 2000000U;
+constexpr uint32_t kCanFdDataBitrate5M = 5000000U;
+
+// Message RAM of MCAN0 and MCAN1, laid out at build time by mcan_ram.h.
+constexpr std::array<ChannelConfig, 2U> kChannels = {{
+    // data bitrate         data  std  ext  fifo0 fifo1 rxbuf txbuf txfifo txevt
+    {kCanFdDataBitrate5M,   64U,  32U, 16U, 16U,  16U,  16U,  4U,   16U,   8U},
+    {kCanFdDataBitrate2M,   64U,  32U, 16U, 16U,  16U,  16U,  4U,   16U,   8U},
+}};
+
+}  // namespace can
+
+#endif  // CONF_CAN_H_
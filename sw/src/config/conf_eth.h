@@ -34,11 +34,35 @@
 #ifndef CONF_EMAC_H_INCLUDED
 #define CONF_EMAC_H_INCLUDED
 
-/** Number of buffer for RX */
-#define GMAC_RX_BUFFERS                               6
+/** Number of buffer for RX, each descriptor holds a network buffer at all times.  Override with -DGMAC_RX_BUFFERS. */
+#ifndef GMAC_RX_BUFFERS
+#define GMAC_RX_BUFFERS                               12
+#endif
 
-/** Number of buffer for TX */
-#define GMAC_TX_BUFFERS                               6
+/** Number of buffer for TX.  Override with -DGMAC_TX_BUFFERS. */
+#ifndef GMAC_TX_BUFFERS
+#define GMAC_TX_BUFFERS                               8
+#endif
+
+/** Number of buffer of each TX priority queue, see conf_gmac_tx.h for the traffic sent from them.  Override with
+ *  -DGMAC_TX_PRIORITY_BUFFERS. */
+#ifndef GMAC_TX_PRIORITY_BUFFERS
+#define GMAC_TX_PRIORITY_BUFFERS                      4
+#endif
+
+/** Longest frame sent from a TX priority queue, longer ones go to queue 0.  The priority queues get a smaller share of
+ *  the TX packet buffer than queue 0, which holds a full size frame. */
+#ifndef GMAC_TX_PRIORITY_FRAME_MAX
+#define GMAC_TX_PRIORITY_FRAME_MAX                    512
+#endif
+
+/** TX descriptors of queue 0 and the two priority queues. */
+#define GMAC_TX_DESCRIPTORS                           ( GMAC_TX_BUFFERS + ( 2 * GMAC_TX_PRIORITY_BUFFERS ) )
+
+/** Frames handed to the IP task in one event at most, chained through pxNextBuffer. */
+#ifndef GMAC_RX_BATCH
+#define GMAC_RX_BATCH                                 8
+#endif
 
 /** MAC PHY operation max retry count */
 #define MAC_PHY_RETRY_MAX                             1000000
@@ -8,14 +8,39 @@ namespace features
 
 // Enable the Lua interpreter.
 constexpr bool kEnableLua = true;
+
+// Keep the Lua collector out of the control scripts and step it in the slack after each cycle instead.
+constexpr bool kLuaGcInSlack = true;
+
 constexpr bool kEnableEthernet = true;
 
+// Receive frames on MCAN0 and MCAN1, the channels are enabled in conf_board.h.
+constexpr bool kEnableCan = true;
+
+// Bridge both CAN channels to UDP for the laptop tools, needs kEnableEthernet and kEnableCan.
+constexpr bool kEnableCanBridge = true;
+
+// ISO-TP transport to the downstream ECUs, see task_iso_tp.h, needs kEnableCan.
+constexpr bool kEnableIsoTp = true;
+
+// Measure the ISO-TP throughput from CAN0 to CAN1, both wired to the same bus.  Bench use only, see iso_tp_benchmark.h.
+constexpr bool kEnableIsoTpBenchmark = false;
+
+// gPTP on the Ethernet port, the CAN and ADC timestamps are then PTP time, see task_ptp.h.  Needs kEnableEthernet.
+constexpr bool kEnablePtp = true;
+
+// Publish the signal groups of conf_telemetry.h over UDP, see task_telemetry.h.  Needs kEnableEthernet.
+constexpr bool kEnableTelemetry = true;
+
 // Enable reading the unique ID from Flash.
 constexpr bool kReadFlashUniqueId = true;
 constexpr bool kReadMacFromEeprom = true;
 
 constexpr bool kEnableICache = true;
-constexpr bool kEnableDCache = false;
+
+// Write-back D-cache.  The memory polled by bus masters lives in the non-cacheable region mapped at board init, the
+// buffers they read or write are maintained by address range, see dcache.h.
+constexpr bool kEnableDCache = true;
 
 }  // namespace features
 
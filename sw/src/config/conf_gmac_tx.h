@@ -0,0 +1,42 @@
+#ifndef CONF_GMAC_TX_H_
+#define CONF_GMAC_TX_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace gmac
+{
+
+// Traffic classes of the frames sent, each on its own TX queue of the same index.  The GMAC sends from the highest
+// queue holding a frame first, a frame of a lower class waits until the higher ones are empty.  Frames longer than
+// GMAC_TX_PRIORITY_FRAME_MAX go to kBulk whatever their class, a flow mixing both lengths may be reordered.
+enum class TxClass : uint8_t
+{
+    kBulk = 0U,         // Queue 0, anything not listed below: TCP, Lua uploads, log downloads.
+    kTelemetry = 1U,
+    kControl = 2U,      // ARP, ICMP, PTP, the CAN bridge.
+};
+
+constexpr size_t kTxClasses = 3U;
+
+struct TxPortRange
+{
+    uint16_t first;
+    uint16_t last;
+    TxClass tx_class;
+};
+
+// UDP ports, source or destination, of the frames sent from the priority queues.  PTP over Ethernet, EtherType
+// 0x88F7, goes to kControl as well.
+constexpr std::array<TxPortRange, 4U> kTxUdpPorts = {{
+    // first    last     class
+    {319U,      320U,    TxClass::kControl},     // PTP event and general messages.
+    {20000U,    20001U,  TxClass::kControl},     // CAN bridge, kCanBridgeFirstPort and one per channel.
+    {5002U,     5002U,   TxClass::kTelemetry},   // Diagnostics service.
+    {5004U,     5004U,   TxClass::kTelemetry},   // Telemetry, telemetry::kPort.
+}};
+
+}  // namespace gmac
+
+#endif  // CONF_GMAC_TX_H_
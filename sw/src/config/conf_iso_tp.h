@@ -0,0 +1,70 @@
+#ifndef CONF_ISO_TP_H_
+#define CONF_ISO_TP_H_
+
+#include <can_frame.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace iso_tp
+{
+
+struct SessionConfig
+{
+    const char* name;
+    CanChannel channel;
+    uint32_t tx_id;         // Frames sent to the ECU.
+    uint32_t rx_id;         // Frames received from the ECU, flow control included.
+    bool extended;
+
+    // CAN-FD frames of up to 64 bytes with bit rate switching, else classic frames of 8 bytes.  Frames received are
+    // accepted in either format.
+    bool fd;
+
+    // Flow control sent to the ECU: consecutive frames per block, 0 for no limit, and separation time, 0 to 127 ms or
+    // 0xF1 to 0xF9 for 100 to 900 us.
+    uint8_t block_size;
+    uint8_t st_min;
+};
+
+// Longest message received, longer ones are refused with an overflow flow control.  4095 bytes is the longest without
+// the escape sequence of ISO 15765-2:2016.
+constexpr size_t kMaxMessageBytes = 4095U;
+
+// Messages being reassembled or waiting for the application, across all sessions.
+constexpr size_t kBuffers = 4U;
+
+// Messages received and not yet taken by the application, per session.
+constexpr size_t kReceiveQueueLength = 2U;
+
+// N_Bs, N_Cr: longest wait for a flow control, and for the next consecutive frame.
+constexpr uint32_t kTimeoutMs = 1000U;
+
+// N_As, N_Cs: longest a frame to send waits for room in the TX FIFO, which never drains while no node acknowledges or
+// the channel is bus-off.
+constexpr uint32_t kTxTimeoutMs = 1000U;
+
+// Flow control frames asking to wait accepted in a row before giving up.
+constexpr uint8_t kMaxWaits = 10U;
+
+// Fills classic frames up to 8 bytes and CAN-FD frames up to their next valid length.
+constexpr uint8_t kPadding = 0xCCU;
+
+constexpr std::array<SessionConfig, 5U> kSessions = {{
+    // name         channel             tx_id           rx_id           ext     fd      bs  st_min
+    {"engine",      CanChannel::kCan0,  0x7E0U,         0x7E8U,         false,  false,  0U, 0U},
+    {"gearbox",     CanChannel::kCan0,  0x7E1U,         0x7E9U,         false,  false,  0U, 0U},
+    {"inverter",    CanChannel::kCan1,  0x18DA10F1U,    0x18DAF110U,    true,   true,   0U, 0U},
+
+    // Both ends of the benchmark, see iso_tp_benchmark.h.
+    {"bench_tx",    CanChannel::kCan0,  0x6F0U,         0x6F1U,         false,  false,  0U, 0U},
+    {"bench_rx",    CanChannel::kCan1,  0x6F1U,         0x6F0U,         false,  false,  0U, 0U},
+}};
+
+constexpr size_t kBenchmarkSender = 3U;
+constexpr size_t kBenchmarkReceiver = 4U;
+
+}  // namespace iso_tp
+
+#endif  // CONF_ISO_TP_H_
@@ -0,0 +1,76 @@
+#ifndef CONF_LOGIC_H_
+#define CONF_LOGIC_H_
+
+#include <can_frame.h>
+
+#include <array>
+#include <cstdint>
+
+namespace logic
+{
+
+// Signals known to the signal database at boot.
+constexpr std::array<const char*, 6U> kSignals = {{
+    "engine_temp_c",
+    "engine_speed_rpm",
+    "vehicle_speed_mps",
+    "battery_voltage_v",
+    "cooling_fan_request",
+    "water_pump_request",
+}};
+
+struct RuleDefinition
+{
+    const char* output;
+    const char* expression;
+};
+
+// Output control rules, evaluated natively every control cycle.  Anything more involved belongs in a Lua script.
+constexpr std::array<RuleDefinition, 2U> kRules = {{
+    // output                   expression
+    {"cooling_fan_request",     "(engine_temp_c > 70.0f) && (vehicle_speed_mps < 5.0f)"},
+    {"water_pump_request",      "(engine_speed_rpm > 0.0f) || (engine_temp_c > 90.0f)"},
+}};
+
+// Channel the messages the VCM sends in the DBC are broadcast on, every GenMsgCycleTime, see can_tx_scheduler.h.
+constexpr CanChannel kCanTransmitChannel = CanChannel::kCan0;
+
+// CAN identifiers received into dedicated RX buffers and handled ahead of any other frame, in order of priority.
+// Matched against both standard and extended identifiers.
+constexpr std::array<uint32_t, 1U> kCanPriorityIds = {{
+    0x100U,     // ECU_Engine
+}};
+
+// Bit field moved from the received payload into the forwarded one, bits are numbered little endian (Intel).
+struct CanSignalRemap
+{
+    uint8_t from_bit;
+    uint8_t to_bit;
+    uint8_t length;     // 0 for an unused entry.
+};
+
+struct CanRouteDefinition
+{
+    CanChannel source;
+    uint32_t id;
+    bool extended;
+    CanChannel destination;
+    uint32_t new_id;    // Same format as id, kCanKeepId forwards the frame under its own identifier.
+
+    // Without any remap the payload is forwarded as is, otherwise only the remapped fields are, the rest is zero.
+    std::array<CanSignalRemap, 4U> remaps;
+};
+
+constexpr uint32_t kCanKeepId = UINT32_MAX;
+
+// Frames forwarded from one channel to another straight from the receive interrupt, see can_gateway.h.
+constexpr std::array<CanRouteDefinition, 2U> kCanRoutes = {{
+    // source           id      ext     destination         new_id      remaps
+    {CanChannel::kCan0, 0x100U, false,  CanChannel::kCan1,  kCanKeepId, {}},    // ECU_Engine to the dash.
+    {CanChannel::kCan0, 0x101U, false,  CanChannel::kCan1,  0x201U,             // vehicle_speed_mps and gear only.
+        {{{0U, 0U, 16U}, {16U, 16U, 4U}}}},
+}};
+
+}  // namespace logic
+
+#endif  // CONF_LOGIC_H_
@@ -0,0 +1,47 @@
+#ifndef CONF_PTP_H_
+#define CONF_PTP_H_
+
+#include <cstdint>
+
+namespace ptp
+{
+
+enum class Role : uint8_t
+{
+    kMaster,    // Grandmaster of the link, the TSU runs free.
+    kSlave,     // The TSU is disciplined to the master.
+};
+
+// Roles are fixed at build time, there is no best master clock algorithm and no Announce message, as in the
+// automotive profile of IEEE 802.1AS.
+constexpr Role kRole = Role::kSlave;
+
+constexpr uint8_t kDomain = 0U;
+
+// Sync every 125 ms from the master, peer delay measured every second by both ends, as log2 of the interval in s.
+constexpr int8_t kLogSyncInterval = -3;
+constexpr int8_t kLogPdelayInterval = 0;
+
+// A slave without a Sync for this many intervals falls back to unlocked.
+constexpr uint32_t kSyncReceiptTimeout = 3U;
+
+// Mean link delay above which the link is not considered capable of gPTP and Sync messages are ignored, 800 ns by
+// the standard for 100BASE-TX.
+constexpr int64_t kNeighborPropDelayThreshNs = 800;
+
+// Pdelay_Resp messages in a row lost or late before the link delay is forgotten.
+constexpr uint32_t kAllowedLostResponses = 3U;
+
+// PI servo of the slave, the linuxptp defaults for a 125 ms Sync interval.  The clock is stepped rather than slewed
+// past kStepThresholdNs, and the frequency offset is clamped to kMaxFrequencyPpb.
+constexpr double kServoKp = 1.306;
+constexpr double kServoKi = 0.1306;
+constexpr int64_t kStepThresholdNs = 100000;
+constexpr double kMaxFrequencyPpb = 200000.0;
+
+// Interval of the phase slews that make up for the part of the frequency offset finer than the TSU increment.
+constexpr uint32_t kSlewIntervalMs = 10U;
+
+}  // namespace ptp
+
+#endif  // CONF_PTP_H_
@@ -0,0 +1,51 @@
+#ifndef CONF_TELEMETRY_H_
+#define CONF_TELEMETRY_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace telemetry
+{
+
+// Signals of a group at most, names of the signal database, nullptr past the last one.
+constexpr size_t kMaxGroupSignals = 16U;
+
+struct GroupConfig
+{
+    const char* name;
+    uint32_t period_ms;     // 1 ms at the fastest, the tick.
+    std::array<const char*, kMaxGroupSignals> signals;
+};
+
+// Source and destination port of the datagrams.
+constexpr uint16_t kPort = 5004U;
+
+// Destination, a unicast host or a multicast group (224.0.0.0 to 239.255.255.255).
+constexpr std::array<uint8_t, 4U> kDestination = {{239U, 255U, 0U, 1U}};
+
+// Longest a sample waits in a datagram being filled before it is sent, full datagrams are sent right away.  Every
+// datagram costs the IP task and the GMAC about the same, whatever its length.
+constexpr uint32_t kFlushPeriodMs = 5U;
+
+// Length of a datagram, so its frame fits GMAC_TX_PRIORITY_FRAME_MAX (512 bytes less the Ethernet, IP and UDP
+// headers) and leaves from the telemetry queue.  Longer datagrams would be sent from the bulk queue.
+constexpr size_t kDatagramBytes = 470U;
+
+constexpr std::array<GroupConfig, 4U> kGroups = {{
+    // name             period  signals
+    {"currents",        1U,     {{"output_1_current_a", "output_2_current_a", "output_3_current_a",
+                                  "output_4_current_a", "output_5_current_a", "output_6_current_a",
+                                  "output_7_current_a", "output_8_current_a", "pdm_total_current_a",
+                                  "pdm_current_a", "fan_current_a", "pump_current_a"}}},
+    {"dynamics",        10U,    {{"vehicle_speed_mps", "engine_speed_rpm", "throttle_position_pct",
+                                  "brake_pressure_bar", "lateral_accel_g", "longitudinal_accel_g", "gear"}}},
+    {"temperatures",    100U,   {{"engine_temp_c", "oil_temp_c", "pdm_temp_c", "board_temp_c", "battery_voltage_v",
+                                  "supply_voltage_v"}}},
+    {"state",           1000U,  {{"vcm_state", "vcm_fault_mask", "output_fault_mask", "pdm_fault_count",
+                                  "vcm_uptime_s"}}},
+}};
+
+}  // namespace telemetry
+
+#endif  // CONF_TELEMETRY_H_
@@ -0,0 +1,23 @@
+#include "diag_format.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+void diag_append(char* buffer, size_t size, size_t& length, const char* format, ...)
+{
+    if (length >= size)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    const int written = vsnprintf(&buffer[length], size - length, format, args);
+    va_end(args);
+
+    if (written > 0)
+    {
+        length += static_cast<size_t>(written);
+        length = (length < size) ? length : (size - 1U);
+    }
+}
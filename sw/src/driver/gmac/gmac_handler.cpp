@@ -72,10 +72,9 @@
 #include "pmc.h"
 
 #include "conf_eth.h"
+#include "dcache.h"
 #include "gmac_handler.h"
 
-/* This file is included to see if 'CONF_BOARD_ENABLE_CACHE' is defined. */
-//#include "conf_board.h"
 #include "core_cm7.h"
 
 #ifndef ARRAY_SIZE
@@ -90,6 +89,10 @@
     #error Configuration error
 #endif
 
+#if ( GMAC_TX_PRIORITY_BUFFERS <= 1 )
+    #error Configuration error
+#endif
+
 /**
  * \defgroup gmac_group Ethernet Media Access Controller
  *
@@ -105,20 +108,30 @@
  * @{
  */
 
-/** TX descriptor lists */
-//__attribute__( ( section( ".first_data" ) ) )
+/* The descriptors are polled by both the CPU and the GMAC, they live in non-cacheable memory. */
+
+/** TX descriptor lists, of queue 0 and of the priority queues */
+DMA_NOCACHE
 COMPILER_ALIGNED( 8 )
 static gmac_tx_descriptor_t gs_tx_desc[ GMAC_TX_BUFFERS ] = {};
 
-//__attribute__( ( section( ".first_data" ) ) )
+DMA_NOCACHE
+COMPILER_ALIGNED( 8 )
+static gmac_tx_descriptor_t gs_tx_desc_priority[ GMAC_TX_QUEUES - 1 ][ GMAC_TX_PRIORITY_BUFFERS ] = {};
+
+/** Descriptor of the TX queues not in use, owned by the CPU for good */
+DMA_NOCACHE
 COMPILER_ALIGNED( 8 )
 static gmac_tx_descriptor_t gs_tx_desc_null = {};
 
 /** RX descriptors lists */
-//__attribute__( ( section( ".first_data" ) ) )
+DMA_NOCACHE
 COMPILER_ALIGNED( 8 )
 static gmac_rx_descriptor_t gs_rx_desc[ GMAC_RX_BUFFERS ];
 
+/* Bytes the GMAC may write to a network buffer, from the descriptor address, past the filler, to the end. */
+#define GMAC_RX_DMA_SIZE    ( NETWORK_BUFFER_SIZE - ( ipBUFFER_PADDING - ipconfigPACKET_FILLER_SIZE ) )
+
 /** Return count in buffer */
 #define CIRC_CNT( head, tail, size )      ( ( ( head ) - ( tail ) ) % ( size ) )
 
@@ -134,12 +147,38 @@ static gmac_rx_descriptor_t gs_rx_desc[ GMAC_RX_BUFFERS ];
 /** Clear circular buffer */
 #define CIRC_CLEAR(head, tail )          do { ( head ) = 0; ( tail ) = 0; } while( 0 )
 
-/* Two call-back functions that should be defined in NetworkInterface.c */
+/* Call-back functions that should be defined in NetworkInterface.c */
 extern void xRxCallback(uint32_t ulStatus, BaseType_t* task_switch_required);
-extern void xTxCallback(uint8_t * puc_buffer, BaseType_t* task_switch_required);
-extern void returnTxBuffer(uint8_t * puc_buffer);
+extern void xTxCallback(uint8_t * puc_buffer, uint32_t ul_queue, BaseType_t* task_switch_required);
+extern void returnTxBuffer(uint8_t * puc_buffer, uint32_t ul_queue);
+extern void xPtpCallback(uint32_t ul_isr);
+
+/**
+ * \brief Descriptor ring of a TX queue.
+ */
+static gmac_tx_descriptor_t * gmac_tx_ring(uint32_t ul_queue)
+{
+    return ( ul_queue == 0U ) ? gs_tx_desc : gs_tx_desc_priority[ ul_queue - 1U ];
+}
+
+/**
+ * \brief Number of descriptors of a TX queue.
+ */
+uint32_t gmac_tx_queue_size(uint32_t ul_queue)
+{
+    return ( ul_queue == 0U ) ? GMAC_TX_BUFFERS : GMAC_TX_PRIORITY_BUFFERS;
+}
 
 
+/**
+ * \brief Hand a network buffer over to the GMAC: no line the CPU left dirty may be written back over the frame
+ * received, and no line the CPU fetched may hide it.
+ */
+static void gmac_rx_buffer_to_dma(uint32_t ul_address)
+{
+    dcache_clean_invalidate(( void * ) ul_address, GMAC_RX_DMA_SIZE);
+}
+
 /** Increment head or tail */
 static __inline void circ_inc32(int32_t * lHeadOrTail, uint32_t ulSize)
 {
@@ -162,38 +201,51 @@ void gmac_reset_tx_mem(gmac_device_t* p_dev)
     /* Disable TX */
     gmac_enable_transmit(p_dev->p_hw, 0U);
 
-    for(uint32_t ul_index = 0; ul_index < ARRAY_SIZE( gs_tx_desc ); ul_index++ )
+    for (uint32_t ul_queue = 0U; ul_queue < GMAC_TX_QUEUES; ul_queue++)
     {
-        uint32_t ulAddr = gs_tx_desc[ul_index].addr;
+        gmac_tx_descriptor_t * p_ring = gmac_tx_ring(ul_queue);
+        const uint32_t ul_size = gmac_tx_queue_size(ul_queue);
 
-        if (ulAddr)
+        for (uint32_t ul_index = 0; ul_index < ul_size; ul_index++)
         {
-            returnTxBuffer((uint8_t *)ulAddr );
+            uint32_t ulAddr = p_ring[ul_index].addr;
+
+            if (ulAddr)
+            {
+                returnTxBuffer((uint8_t *)ulAddr, ul_queue);
+            }
         }
+
+        /* Set up the TX descriptors */
+        CIRC_CLEAR( p_dev->l_tx_head[ul_queue], p_dev->l_tx_tail[ul_queue] );
+
+        for (uint32_t ul_index = 0; ul_index < ul_size; ul_index++)
+        {
+            p_ring[ ul_index ].addr = 0U;
+            p_ring[ ul_index ].status.val = GMAC_TXD_USED;
+        }
+
+        /* Set the WRAP bit in the last descriptor. */
+        p_ring[ul_size - 1].status.val = GMAC_TXD_USED | GMAC_TXD_WRAP;
     }
 
-    /* Set up the TX descriptors */
-    CIRC_CLEAR( p_dev->l_tx_head, p_dev->l_tx_tail );
+    /* Set transmit buffer queues */
+    gmac_set_tx_queue(p_dev->p_hw, ( uint32_t ) gs_tx_desc );
 
-    for(uint32_t ul_index = 0; ul_index < GMAC_TX_BUFFERS; ul_index++ )
+    for (uint32_t ul_queue = 1U; ul_queue < GMAC_TX_QUEUES; ul_queue++)
     {
-        gs_tx_desc[ ul_index ].addr = 0U;
-        gs_tx_desc[ ul_index ].status.val = GMAC_TXD_USED;
+        gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t ) gmac_tx_ring(ul_queue), ( gmac_quelist_t ) ul_queue);
     }
 
-    /* Set the WRAP bit in the last descriptor. */
-    gs_tx_desc[GMAC_TX_BUFFERS - 1].status.val = GMAC_TXD_USED | GMAC_TXD_WRAP;
-
-    /* Set transmSAME70Sit buffer queue */
-    gmac_set_tx_queue(p_dev->p_hw, ( uint32_t ) gs_tx_desc );
+    /* The GMAC starts every queue on TSTART, the others find a descriptor it does not own. */
+    gs_tx_desc_null.addr = 0U;
+    gs_tx_desc_null.status.val = GMAC_TXD_USED | GMAC_TXD_WRAP;
 
-    gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t )&gs_tx_desc_null, GMAC_QUE_1);
-    gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t )&gs_tx_desc_null, GMAC_QUE_2);
     // Note that SAME70 REV B had 6 priority queues.
-    gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t )&gs_tx_desc_null, GMAC_QUE_3);
-    gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t )&gs_tx_desc_null, GMAC_QUE_4);
-    gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t )&gs_tx_desc_null, GMAC_QUE_5);
-
+    for (uint32_t ul_queue = GMAC_TX_QUEUES; ul_queue < GMAC_QUE_N; ul_queue++)
+    {
+        gmac_set_tx_priority_queue(p_dev->p_hw, ( uint32_t )&gs_tx_desc_null, ( gmac_quelist_t ) ul_queue);
+    }
 }
 
 /**
@@ -217,6 +269,7 @@ static void gmac_reset_rx_mem(gmac_device_t* p_dev)
         configASSERT(pxNextNetworkBufferDescriptor != nullptr);
         uint32_t ul_address = ( uint32_t ) (pxNextNetworkBufferDescriptor->pucEthernetBuffer);
 
+        gmac_rx_buffer_to_dma(ul_address & GMAC_RXD_ADDR_MASK);
         gs_rx_desc[ul_index].addr.val = ul_address & GMAC_RXD_ADDR_MASK;
         gs_rx_desc[ul_index].status.val = 0;
     }
@@ -266,6 +319,11 @@ static uint8_t gmac_init_mem(Gmac * p_gmac, gmac_device_t * p_gmac_dev )
                           GMAC_IER_PFNZ |   /* Enable pause frame received interrupt. */
                           GMAC_IER_PTZ);    /* Enable pause time zero interrupt. */
 
+    for (uint32_t ul_queue = 1U; ul_queue < GMAC_TX_QUEUES; ul_queue++)
+    {
+        gmac_enable_priority_interrupt(p_gmac, GMAC_TX_PRIORITY_INTERRUPTS, ( gmac_quelist_t ) ul_queue);
+    }
+
     return GMAC_OK;
 }
 
@@ -415,16 +473,17 @@ uint32_t gmac_dev_read(gmac_device_t * p_gmac_dev, uint8_t * p_frame, uint32_t u
     bytesLeft = min(bytesLeft + 2, (int32_t)ul_frame_size );
     #undef min
 
-    #if ( __DCACHE_PRESENT != 0 ) && defined( CONF_BOARD_ENABLE_CACHE )
-        SCB_InvalidateDCache();
-    #endif
-
     if( p_frame != NULL )
     {
+        uint8_t * pucDMABuffer = ( uint8_t * ) ( ( gs_rx_desc[ nextIdx ].addr.val ) & ~( 0x03ul ) );
+
+        /* Drop whatever the CPU fetched of the frame while the GMAC owned it. */
+        dcache_invalidate(pucDMABuffer, bytesLeft);
+
         /* Return a pointer to the earlier DMA buffer. */
-        *( pp_recv_frame ) = ( uint8_t * )
-                             ( ( ( gs_rx_desc[ nextIdx ].addr.val ) & ~( 0x03ul ) ) + 2 );
+        *( pp_recv_frame ) = pucDMABuffer + 2;
         /* Set the new DMA-buffer. */
+        gmac_rx_buffer_to_dma(( uint32_t ) p_frame);
         gs_rx_desc[ nextIdx ].addr.bm.addr_dw = ( ( uint32_t ) p_frame ) / 4;
     }
     else
@@ -448,6 +507,27 @@ uint32_t gmac_dev_read(gmac_device_t * p_gmac_dev, uint8_t * p_frame, uint32_t u
     return GMAC_OK;
 }
 
+/**
+ * \brief Unmask the RX interrupts masked by gmac_handler(), once the ring is drained.
+ *
+ * \param p_gmac_dev Pointer to the GMAC device instance.
+ *
+ * \return true if a frame completed meanwhile, the interrupts are masked again and the ring is to be drained.
+ */
+bool gmac_dev_rx_rearm(gmac_device_t * p_gmac_dev)
+{
+    gmac_enable_interrupt(p_gmac_dev->p_hw, GMAC_RX_INTERRUPTS);
+
+    if (gmac_dev_poll(p_gmac_dev) == 0)
+    {
+        return false;
+    }
+
+    gmac_disable_interrupt(p_gmac_dev->p_hw, GMAC_RX_INTERRUPTS);
+
+    return true;
+}
+
 /**
  * \brief Send ulLength bytes from pcFrom. This copies the buffer to one of the
  * GMAC Tx buffers, and then indicates to the GMAC that the buffer is ready.
@@ -457,10 +537,11 @@ uint32_t gmac_dev_read(gmac_device_t * p_gmac_dev, uint8_t * p_frame, uint32_t u
  * \param p_gmac_dev Pointer to the GMAC device instance.
  * \param p_buffer       Pointer to the data buffer.
  * \param ul_size    Length of the frame.
+ * \param ul_queue   TX queue to send it from, below GMAC_TX_QUEUES.
  *
  * \return Length sent.
  */
-uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul_size)
+uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul_size, uint32_t ul_queue)
 {
     /* Check parameter */
     if (ul_size > GMAC_TX_UNITSIZE)
@@ -468,8 +549,10 @@ uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul
         return GMAC_PARAM;
     }
 
+    const uint32_t ul_ring_size = gmac_tx_queue_size(ul_queue);
+
     /* Pointers to the current transmit descriptor */
-    volatile gmac_tx_descriptor_t* p_tx_td = &gs_tx_desc[p_gmac_dev->l_tx_head];
+    volatile gmac_tx_descriptor_t* p_tx_td = &gmac_tx_ring(ul_queue)[p_gmac_dev->l_tx_head[ul_queue]];
 
     /* If no free TxTd, buffer can't be sent, schedule the wakeup callback */
     if( ( p_tx_td->status.val & GMAC_TXD_USED ) == 0 )
@@ -491,7 +574,7 @@ uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul
 
     /* The buffer size defined is the length of ethernet frame,
      * so it's always the last buffer of the frame. */
-    if (p_gmac_dev->l_tx_head == (int32_t)(GMAC_TX_BUFFERS - 1 ))
+    if (p_gmac_dev->l_tx_head[ul_queue] == (int32_t)(ul_ring_size - 1 ))
     {
         /* No need to 'and' with GMAC_TXD_LEN_MASK because ul_size has been checked
          * GMAC_TXD_USED will now be cleared. */
@@ -503,7 +586,10 @@ uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul
         p_tx_td->status.val = (ul_size & GMAC_TXD_LEN_MASK) | GMAC_TXD_LAST;
     }
 
-    circ_inc32( &p_gmac_dev->l_tx_head, GMAC_TX_BUFFERS );
+    circ_inc32( &p_gmac_dev->l_tx_head[ul_queue], ul_ring_size );
+
+    /* The descriptor reaches memory before the GMAC is told to read it. */
+    __DSB();
 
     /* Now start to transmit if it is still not done */
     gmac_start_transmission(p_gmac_dev->p_hw);
@@ -515,15 +601,16 @@ uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul
  * \brief Get current load of transmit.
  *
  * \param p_gmac_dev Pointer to the GMAC device instance.
+ * \param ul_queue   TX queue, below GMAC_TX_QUEUES.
  *
  * \return Current load of transmit.
  */
-uint32_t gmac_dev_get_tx_load(gmac_device_t * p_gmac_dev)
+uint32_t gmac_dev_get_tx_load(gmac_device_t * p_gmac_dev, uint32_t ul_queue)
 {
-    uint16_t us_head = p_gmac_dev->l_tx_head;
-    uint16_t us_tail = p_gmac_dev->l_tx_tail;
+    uint16_t us_head = p_gmac_dev->l_tx_head[ul_queue];
+    uint16_t us_tail = p_gmac_dev->l_tx_tail[ul_queue];
 
-    return CIRC_CNT(us_head, us_tail, GMAC_TX_BUFFERS);
+    return CIRC_CNT(us_head, us_tail, gmac_tx_queue_size(ul_queue));
 }
 
 /**
@@ -563,12 +650,21 @@ void gmac_handler(gmac_device_t* p_gmac_dev, BaseType_t* task_switch_required)
     uint32_t ul_rsr = gmac_get_rx_status(p_hw);
     uint32_t ul_tsr = gmac_get_tx_status(p_hw);
 
+    /* The interrupt status clears on read, the PTP events are handed over with it. */
+    if (ul_isr & GMAC_PTP_INTERRUPTS)
+    {
+        xPtpCallback(ul_isr);
+    }
+
     /* RX packet */
     if ((ul_isr & GMAC_ISR_RCOMP) || (ul_rsr & (GMAC_RSR_REC | GMAC_RSR_RXOVR | GMAC_RSR_BNA)))
     {
         /* Clear status */
         gmac_clear_rx_status(p_hw, ul_rsr);
 
+        /* One interrupt per burst: the EMAC task drains the ring, then unmasks them with gmac_dev_rx_rearm(). */
+        gmac_disable_interrupt(p_hw, GMAC_RX_INTERRUPTS);
+
         if (ul_isr & GMAC_ISR_RCOMP)
         {
             ul_rsr |= GMAC_RSR_REC;
@@ -578,8 +674,17 @@ void gmac_handler(gmac_device_t* p_gmac_dev, BaseType_t* task_switch_required)
         xRxCallback(ul_rsr, task_switch_required);
     }
 
+    /* The priority queues signal their own TX interrupts, the TX status register is shared. */
+    uint32_t ul_isr_priority = 0U;
+
+    for (uint32_t ul_queue = 1U; ul_queue < GMAC_TX_QUEUES; ul_queue++)
+    {
+        ul_isr_priority |= gmac_get_priority_interrupt_status(p_hw, ( gmac_quelist_t ) ul_queue);
+    }
+
     /* TX packet */
-    if ((ul_isr & GMAC_ISR_TCOMP) || (ul_tsr & (GMAC_TSR_TXCOMP | GMAC_TSR_COL | GMAC_TSR_RLE)))
+    if ((ul_isr & GMAC_ISR_TCOMP) || (ul_isr_priority & GMAC_ISRPQ_TCOMP) ||
+        (ul_tsr & (GMAC_TSR_TXCOMP | GMAC_TSR_COL | GMAC_TSR_RLE)))
     {
         /* A frame transmitted */
 
@@ -594,12 +699,18 @@ void gmac_handler(gmac_device_t* p_gmac_dev, BaseType_t* task_switch_required)
         /* Clear status */
         gmac_clear_tx_status(p_hw, ul_tsr);
 
-        if (!CIRC_EMPTY(p_gmac_dev->l_tx_head, p_gmac_dev->l_tx_tail))
+        for (uint32_t ul_queue = 0U; ul_queue < GMAC_TX_QUEUES; ul_queue++)
         {
+            gmac_tx_descriptor_t * p_ring = gmac_tx_ring(ul_queue);
+            const uint32_t ul_ring_size = gmac_tx_queue_size(ul_queue);
+
+            int32_t * p_head = &p_gmac_dev->l_tx_head[ul_queue];
+            int32_t * p_tail = &p_gmac_dev->l_tx_tail[ul_queue];
+
             /* Check the buffers */
-            do
+            while (!CIRC_EMPTY(*p_head, *p_tail))
             {
-                p_tx_td = &gs_tx_desc[ p_gmac_dev->l_tx_tail ];
+                p_tx_td = &p_ring[ *p_tail ];
 
                 /* Any error? Exit if buffer has not been sent yet */
                 if( ( p_tx_td->status.val & GMAC_TXD_USED ) == 0 )
@@ -608,19 +719,19 @@ void gmac_handler(gmac_device_t* p_gmac_dev, BaseType_t* task_switch_required)
                 }
 
                 /* Notify upper layer that a packet has been sent */
-                xTxCallback((uint8_t *)p_tx_td->addr, task_switch_required); /* Function call prvTxCallback */
+                xTxCallback((uint8_t *)p_tx_td->addr, ul_queue, task_switch_required); /* Function call prvTxCallback */
 
                 p_tx_td->addr = 0ul;
 
-                circ_inc32( &p_gmac_dev->l_tx_tail, GMAC_TX_BUFFERS );
-            } while (CIRC_CNT(p_gmac_dev->l_tx_head, p_gmac_dev->l_tx_tail, GMAC_TX_BUFFERS));
+                circ_inc32( p_tail, ul_ring_size );
+            }
         }
 
         /*
         if (ul_tsr & GMAC_TSR_RLE)
         {
             // Notify upper layer RLE.
-            xTxCallback(nullptr, task_switch_required);
+            xTxCallback(nullptr, 0U, task_switch_required);
         }*/
     }
 }
@@ -56,6 +56,21 @@
 
 #define NETWORK_BUFFER_SIZE    1536
 
+/* Frame received and no RX buffer left, masked from the first frame of a burst until the ring is drained.  The GMAC
+ * of the SAMV71 has no interrupt moderation register. */
+#define GMAC_RX_INTERRUPTS    ( GMAC_IER_RCOMP | GMAC_IER_RXUBR )
+
+/* TX queues with a descriptor ring: queue 0 and the priority queues 1 and 2, the GMAC sends from the highest queue
+ * holding a frame first.  Queues 3 to 5 are parked on a descriptor that is never handed over. */
+#define GMAC_TX_QUEUES        3
+
+/* PTP event frames received and transmitted, their timestamps are latched before the next frame of the kind. */
+#define GMAC_PTP_INTERRUPTS    ( GMAC_IER_SFR | GMAC_IER_SFT | GMAC_IER_PDRQFR | GMAC_IER_PDRSFR | GMAC_IER_PDRQFT | \
+                                 GMAC_IER_PDRSFT )
+
+/* TX interrupts of the priority queues, signalled in their own status register. */
+#define GMAC_TX_PRIORITY_INTERRUPTS    ( GMAC_IERPQ_TCOMP | GMAC_IERPQ_RLEX | GMAC_IERPQ_TFC | GMAC_IERPQ_HRESP )
+
 /**
 * GMAC driver structure.
 */
@@ -73,10 +88,10 @@ typedef struct gmac_device
      */
     /** RX index for current processing TD */
     uint32_t ul_rx_idx;
-    /** Circular buffer head pointer by upper layer (buffer to be sent) */
-    int32_t l_tx_head;
-    /** Circular buffer tail pointer incremented by handlers (buffer sent) */
-    int32_t l_tx_tail;
+    /** Circular buffer head pointer by upper layer (buffer to be sent), per TX queue */
+    int32_t l_tx_head[GMAC_TX_QUEUES];
+    /** Circular buffer tail pointer incremented by handlers (buffer sent), per TX queue */
+    int32_t l_tx_tail[GMAC_TX_QUEUES];
 
     /** Number of free TD before wakeup callback is invoked */
     uint32_t ul_wakeup_threshold;
@@ -98,8 +113,10 @@ uint8_t gmac_wait_phy(Gmac * p_gmac, const uint32_t ul_retry);
 void gmac_dev_init(Gmac * p_gmac, gmac_device_t * p_gmac_dev);
 uint32_t gmac_dev_read(gmac_device_t* p_gmac_dev, uint8_t* p_frame, uint32_t ul_frame_size, uint32_t* p_rcv_size,
     uint8_t** pp_recv_frame );
-uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul_size);
-uint32_t gmac_dev_get_tx_load(gmac_device_t * p_gmac_dev);
+bool gmac_dev_rx_rearm(gmac_device_t * p_gmac_dev);
+uint32_t gmac_tx_queue_size(uint32_t ul_queue);
+uint32_t gmac_dev_write(gmac_device_t * p_gmac_dev, void * p_buffer, uint32_t ul_size, uint32_t ul_queue);
+uint32_t gmac_dev_get_tx_load(gmac_device_t * p_gmac_dev, uint32_t ul_queue);
 
 void gmac_dev_reset(gmac_device_t * p_gmac_dev);
 
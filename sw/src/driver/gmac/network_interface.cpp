@@ -50,12 +50,20 @@
 //#include "phyhandling.h"
 #include "ethernet_phy.h"
 
-/* This file is included to see if 'CONF_BOARD_ENABLE_CACHE' is defined. */
-//#include "conf_board.h"
 #include "conf_eth.h"
+#include "conf_features.h"
+#include "conf_gmac_tx.h"
+#include "dcache.h"
+#include "diag_format.h"
+#include "gmac_stats.h"
+#include "ptp.h"
+#include "ptp_clock.h"
 
 #include "ioport.h"
 
+#include <algorithm>
+#include <cstdio>
+
 
 /* Interrupt events to process.  Currently only the Rx event is processed
  * although code for other events is included to allow for possible future
@@ -90,55 +98,32 @@ __attribute__( ( aligned( 32 ) ) )
 //__attribute__( ( section( ".first_data" ) ) )
 uint8_t ucNetworkPackets[ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS * NETWORK_BUFFER_SIZE] = {};
 
+static_assert(gmac::kTxClasses == GMAC_TX_QUEUES, "Every traffic class needs a TX queue.");
+
+/* A frame sent, or dropped by a reset of the TX queues: the buffer is released and the descriptor of its queue given
+ * back. */
+struct TxDone
+{
+    uint8_t* buffer;
+    uint32_t queue;
+};
+
 // Queue Buffers
-uint8_t g_queue_buffers[GMAC_TX_BUFFERS * sizeof(void *)] = {};
+uint8_t g_queue_buffers[GMAC_TX_DESCRIPTORS * sizeof(TxDone)] = {};
 StaticQueue_t g_queue_buffer = {};
 
 StaticSemaphore_t g_buffer_semaphore = {};
 
+// Written by the EMAC task, and the GMAC interrupt for rx_interrupts.
+static GmacStats gmac_stats = {};
 
-#if ( __DCACHE_PRESENT != 0 ) && defined( CONF_BOARD_ENABLE_CACHE )
-    #include "core_cm7.h"
-    // #warning This driver assumes the presence of DCACHE
-    #define     NETWORK_BUFFERS_CACHED        1
-    #define     CACHE_LINE_SIZE               32
-    #define     NETWORK_BUFFER_HEADER_SIZE    (ipconfigPACKET_FILLER_SIZE + 8)
-
-    static void cache_clean_invalidate()
-    {
-        /* If you application crashes here, make sure that SCB_EnableDCache() has been called. */
-        SCB_CleanInvalidateDCache();
-    }
-    /*-----------------------------------------------------------*/
-
-    static void cache_clean_invalidate_by_addr(uint32_t /*addr*/, uint32_t /*size*/)
-    {
-        /* SAME70 does not have clean/invalidate per area. */
-        /* SCB_CleanInvalidateDCache_by_Addr( ( uint32_t * )addr, size); */
-        SCB_CleanInvalidateDCache();
-    }
-    /*-----------------------------------------------------------*/
-
-    static void cache_invalidate_by_addr(uint32_t /*addr*/, uint32_t /*size*/) \
-    {
-        /* SAME70 does not have clean/invalidate per area. */
-        /* SCB_InvalidateDCache_by_Addr( ( uint32_t * )addr, size); */
-        SCB_InvalidateDCache();
-    }
-    /*-----------------------------------------------------------*/
-
-#else /* if ( __DCACHE_PRESENT != 0 ) && defined( CONF_BOARD_ENABLE_CACHE ) */
-    //#warning Sure there is no caching?
-    #define     cache_clean_invalidate()                        do {} while( 0 )
-    #define     cache_clean_invalidate_by_addr( addr, size )    do {} while( 0 )
-    #define     cache_invalidate_by_addr( addr, size )          do {} while( 0 )
-#endif /* if ( __DCACHE_PRESENT != 0 ) && defined( CONF_BOARD_ENABLE_CACHE ) */
 
 /*
  * Called from the ASF GMAC driver.
  */
 void xRxCallback(uint32_t ulStatus);
-void xTxCallback(uint8_t* puc_buffer, BaseType_t* task_switch_required);
+void xTxCallback(uint8_t* puc_buffer, uint32_t ulQueue, BaseType_t* task_switch_required);
+void xPtpCallback(uint32_t ulStatus);
 
 /*
  * A deferred interrupt handler task that processes GMAC interrupts.
@@ -177,10 +162,9 @@ TaskHandle_t xEMACTaskHandle = nullptr;
 
 static QueueHandle_t xTxBufferQueue;
 
-/* xTXDescriptorSemaphore is a counting semaphore with
- * a maximum count of GMAC_TX_BUFFERS, which is the number of
- * DMA TX descriptors. */
-static SemaphoreHandle_t xTXDescriptorSemaphore = nullptr;
+/* xTXDescriptorSemaphores are counting semaphores with
+ * a maximum count of the number of DMA TX descriptors of their queue. */
+static SemaphoreHandle_t xTXDescriptorSemaphores[GMAC_TX_QUEUES] = {};
 
 /*-----------------------------------------------------------*/
 
@@ -203,8 +187,11 @@ void GMAC_Handler()
 
 void xRxCallback(uint32_t ulStatus, BaseType_t* task_switch_required)
 {
-    if (((ulStatus & GMAC_RSR_REC) != 0U) && (xEMACTaskHandle != nullptr))
+    /* The RX interrupts are masked until the task drained the ring, whatever woke it up. */
+    if (((ulStatus & (GMAC_RSR_REC | GMAC_RSR_BNA | GMAC_RSR_RXOVR)) != 0U) && (xEMACTaskHandle != nullptr))
     {
+        gmac_stats.rx_interrupts++;
+
         /* let the prvEMACHandlerTask know that there was an RX event. */
         ulISREvents |= EMAC_IF_RX_EVENT;
         /* Only an RX interrupt can wakeup prvEMACHandlerTask. */
@@ -213,18 +200,19 @@ void xRxCallback(uint32_t ulStatus, BaseType_t* task_switch_required)
 }
 /*-----------------------------------------------------------*/
 
-void returnTxBuffer(uint8_t* puc_buffer)
+void returnTxBuffer(uint8_t* puc_buffer, uint32_t ulQueue)
 {
     /* Called from a non-ISR context. */
     if (xTxBufferQueue != nullptr)
     {
-        xQueueSend(xTxBufferQueue, &puc_buffer, 0U);
+        const TxDone xDone = { puc_buffer, ulQueue };
+        xQueueSend(xTxBufferQueue, &xDone, 0U);
         xTaskNotifyGive(xEMACTaskHandle);
         ulISREvents |= EMAC_IF_TX_EVENT;
     }
 }
 
-void xTxCallback(uint8_t* puc_buffer, BaseType_t* task_switch_required)
+void xTxCallback(uint8_t* puc_buffer, uint32_t ulQueue, BaseType_t* task_switch_required)
 {
     if ((xTxBufferQueue != nullptr) && (xEMACTaskHandle != nullptr))
     {
@@ -232,10 +220,18 @@ void xTxCallback(uint8_t* puc_buffer, BaseType_t* task_switch_required)
         ulISREvents |= EMAC_IF_TX_EVENT;
         /* Wakeup prvEMACHandlerTask. */
         vTaskNotifyGiveFromISR(xEMACTaskHandle, task_switch_required);
-        xQueueSendFromISR(xTxBufferQueue, &puc_buffer, task_switch_required);
+        const TxDone xDone = { puc_buffer, ulQueue };
+        xQueueSendFromISR(xTxBufferQueue, &xDone, task_switch_required);
         //tx_release_count[2]++;
     }
 }
+void xPtpCallback(uint32_t ulStatus)
+{
+    if constexpr (features::kEnablePtp)
+    {
+        ptp_clock_capture_events(ulStatus);
+    }
+}
 /*-----------------------------------------------------------*/
 
 BaseType_t xNetworkInterfaceInitialise()
@@ -246,8 +242,6 @@ BaseType_t xNetworkInterfaceInitialise()
     {
         prvGMACInit();
 
-        cache_clean_invalidate();
-
         /* The handler task is created at the highest possible priority to
          * ensure the interrupt handler can return directly to it. */
         xTaskCreate(prvEMACHandlerTask, "EMAC", kEMACTaskStackSize, nullptr, kEMACTaskPriority,
@@ -257,14 +251,18 @@ BaseType_t xNetworkInterfaceInitialise()
 
     if (xTxBufferQueue == nullptr)
     {
-        xTxBufferQueue = xQueueCreate(GMAC_TX_BUFFERS, sizeof(void *));
+        xTxBufferQueue = xQueueCreate(GMAC_TX_DESCRIPTORS, sizeof(TxDone));
         configASSERT(xTxBufferQueue);
     }
 
-    if (xTXDescriptorSemaphore == nullptr)
+    for (uint32_t ulQueue = 0U; ulQueue < GMAC_TX_QUEUES; ulQueue++)
     {
-        xTXDescriptorSemaphore = xSemaphoreCreateCounting((UBaseType_t)GMAC_TX_BUFFERS, (UBaseType_t)GMAC_TX_BUFFERS);
-        configASSERT(xTXDescriptorSemaphore);
+        if (xTXDescriptorSemaphores[ulQueue] == nullptr)
+        {
+            const UBaseType_t uxDescriptors = gmac_tx_queue_size(ulQueue);
+            xTXDescriptorSemaphores[ulQueue] = xSemaphoreCreateCounting(uxDescriptors, uxDescriptors);
+            configASSERT(xTXDescriptorSemaphores[ulQueue]);
+        }
     }
 
     /* When returning non-zero, the stack will become active and
@@ -301,22 +299,88 @@ static void hand_tx_errors()
     }
 }
 
+/*
+ * Pick the TX queue of a frame from its EtherType and UDP ports, see conf_gmac_tx.h.
+ */
+static uint32_t prvTxClassify(const uint8_t* pucFrame, size_t uxLength)
+{
+    constexpr size_t kEtherTypeOffset = 12U;
+    constexpr size_t kIPHeaderOffset = 14U;
+    constexpr uint16_t kEtherTypePTP = 0x88F7U;
+
+    if ((uxLength > GMAC_TX_PRIORITY_FRAME_MAX) || (uxLength < (kIPHeaderOffset + ipSIZE_OF_IPv4_HEADER)))
+    {
+        return static_cast<uint32_t>(gmac::TxClass::kBulk);
+    }
+
+    auto read16 = [pucFrame](size_t offset)
+    {
+        return static_cast<uint16_t>((pucFrame[offset] << 8) | pucFrame[offset + 1U]);
+    };
+
+    const uint16_t usEtherType = read16(kEtherTypeOffset);
+
+    if ((usEtherType == kEtherTypePTP) || (usEtherType == FreeRTOS_ntohs(ipARP_FRAME_TYPE)))
+    {
+        return static_cast<uint32_t>(gmac::TxClass::kControl);
+    }
+
+    if (usEtherType != FreeRTOS_ntohs(ipIPv4_FRAME_TYPE))
+    {
+        return static_cast<uint32_t>(gmac::TxClass::kBulk);
+    }
+
+    const uint8_t* pucIPHeader = &pucFrame[kIPHeaderOffset];
+    const size_t uxIPHeaderLength = (pucIPHeader[0] & 0x0FU) * 4U;
+    const uint8_t ucProtocol = pucIPHeader[9];
+    const bool xFragment = (read16(kIPHeaderOffset + 6U) & 0x1FFFU) != 0U;
+
+    if (ucProtocol == ipPROTOCOL_ICMP)
+    {
+        return static_cast<uint32_t>(gmac::TxClass::kControl);
+    }
+
+    // Only the first fragment of a datagram carries the ports, the others stay behind it on queue 0.
+    if ((ucProtocol != ipPROTOCOL_UDP) || xFragment || (uxLength < (kIPHeaderOffset + uxIPHeaderLength + 4U)))
+    {
+        return static_cast<uint32_t>(gmac::TxClass::kBulk);
+    }
+
+    const uint16_t usSourcePort = read16(kIPHeaderOffset + uxIPHeaderLength);
+    const uint16_t usDestinationPort = read16(kIPHeaderOffset + uxIPHeaderLength + 2U);
+
+    for (const auto& range : gmac::kTxUdpPorts)
+    {
+        if (((usSourcePort >= range.first) && (usSourcePort <= range.last)) ||
+            ((usDestinationPort >= range.first) && (usDestinationPort <= range.last)))
+        {
+            return static_cast<uint32_t>(range.tx_class);
+        }
+    }
+
+    return static_cast<uint32_t>(gmac::TxClass::kBulk);
+}
+/*-----------------------------------------------------------*/
+
 BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t* const pxDescriptor, BaseType_t bReleaseAfterSend)
 {
 /* Do not wait too long for a free TX DMA buffer. */
     constexpr TickType_t xBlockTimeTicks = pdMS_TO_TICKS(50u);
     uint32_t ulTransmitSize = pxDescriptor->xDataLength;
+    bool xSent = false;
 
     if( ulTransmitSize > NETWORK_BUFFER_SIZE)
     {
         ulTransmitSize = NETWORK_BUFFER_SIZE;
     }
 
+    const uint32_t ulQueue = prvTxClassify(pxDescriptor->pucEthernetBuffer, ulTransmitSize);
+
     /* A do{}while(0) loop is introduced to allow the use of multiple break
      * statement. */
     do
     {
-        if( xTXDescriptorSemaphore == nullptr )
+        if( xTXDescriptorSemaphores[ulQueue] == nullptr )
         {
             /* Semaphore has not been created yet? */
             break;
@@ -324,27 +388,30 @@ BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t* const pxDescriptor
 
         hand_tx_errors();
 
-        if (xSemaphoreTake(xTXDescriptorSemaphore, xBlockTimeTicks) != pdPASS)
+        if (xSemaphoreTake(xTXDescriptorSemaphores[ulQueue], xBlockTimeTicks) != pdPASS)
         {
             /* Time-out waiting for a free TX descriptor. */
-            //tx_release_count[ 3 ]++;
+            gmac_stats.tx_timeouts[ulQueue]++;
             break;
         }
 
-        #if ( NETWORK_BUFFERS_CACHED != 0 )
-            {
-                uint32_t xlength = CACHE_LINE_SIZE * ( ( ulTransmitSize + NETWORK_BUFFER_HEADER_SIZE + CACHE_LINE_SIZE - 1 ) / CACHE_LINE_SIZE );
-                uint32_t xAddress = ( uint32_t ) ( pxDescriptor->pucEthernetBuffer - NETWORK_BUFFER_HEADER_SIZE );
-                cache_clean_invalidate_by_addr( xAddress, xlength );
-            }
-        #endif
+        // The GMAC reads the frame from memory.
+        dcache_clean(pxDescriptor->pucEthernetBuffer, ulTransmitSize);
 
-        gmac_dev_write(&gs_gmac_dev, ( void * )pxDescriptor->pucEthernetBuffer, pxDescriptor->xDataLength);
+        gmac_dev_write(&gs_gmac_dev, ( void * )pxDescriptor->pucEthernetBuffer, pxDescriptor->xDataLength, ulQueue);
+        gmac_stats.tx_frames[ulQueue]++;
+        xSent = true;
 
         /* Not interested in a call-back after TX. */
         iptraceNETWORK_INTERFACE_TRANSMIT();
     } while(ipFALSE_BOOL);
 
+    /* Sent frames are released from the EMAC task once the GMAC is done with them. */
+    if (false == xSent)
+    {
+        vReleaseNetworkBufferAndDescriptor( pxDescriptor );
+    }
+
     configASSERT( bReleaseAfterSend != pdFALSE );
     /*
     if( bReleaseAfterSend != pdFALSE )
@@ -360,9 +427,21 @@ static BaseType_t prvGMACInit()
 {
     gmac_enable_management(GMAC, true);
 
+    if constexpr (features::kEnablePtp)
+    {
+        ptp_clock_init();
+    }
+
     gs_gmac_dev.p_hw = GMAC;
     gmac_dev_init(GMAC, &gs_gmac_dev);
 
+    if constexpr (features::kEnablePtp)
+    {
+        /* gPTP frames go to the peer delay multicast address, the TSU stamps the event frames among them. */
+        gmac_set_address(GMAC, 1, const_cast<uint8_t*>(kPtpMulticastMac.data()));
+        gmac_enable_interrupt(GMAC, GMAC_PTP_INTERRUPTS);
+    }
+
     NVIC_SetPriority(GMAC_IRQn, configMAC_INTERRUPT_PRIORITY);
     NVIC_EnableIRQ(GMAC_IRQn);
 
@@ -399,6 +478,36 @@ static BaseType_t prvGMACInit()
     return 1;
 }
 
+/*
+ * Hand a chain of received frames over to the IP task, in one event.
+ */
+static void prvEMACRxDeliver(NetworkBufferDescriptor_t* pxChain, uint32_t ulFrames)
+{
+    const TickType_t xBlockTime = pdMS_TO_TICKS( 100UL );
+    IPStackEvent_t xRxEvent = { eNetworkRxEvent, ( void * ) pxChain };
+
+    if (xSendEventStructToIPTask( &xRxEvent, xBlockTime ) == pdTRUE)
+    {
+        gmac_stats.frames_received += ulFrames;
+        gmac_stats.batches++;
+        gmac_stats.largest_batch = std::max(gmac_stats.largest_batch, ulFrames);
+        return;
+    }
+
+    /* The chain could not be sent to the stack so must be released again. */
+    while (pxChain != nullptr)
+    {
+        NetworkBufferDescriptor_t* pxNext = pxChain->pxNextBuffer;
+        vReleaseNetworkBufferAndDescriptor( pxChain );
+        iptraceETHERNET_RX_EVENT_LOST();
+        pxChain = pxNext;
+    }
+
+    gmac_stats.frames_dropped += ulFrames;
+    FreeRTOS_printf( ( "prvEMACRxPoll: Can not queue return packet!\n" ) );
+}
+/*-----------------------------------------------------------*/
+
 static uint32_t prvEMACRxPoll()
 {
     unsigned char * pucUseBuffer;
@@ -406,9 +515,13 @@ static uint32_t prvEMACRxPoll()
     static NetworkBufferDescriptor_t * pxNextNetworkBufferDescriptor = nullptr;
     const UBaseType_t xMinDescriptorsToLeave = 2UL;
     const TickType_t xBlockTime = pdMS_TO_TICKS( 100UL );
-    static IPStackEvent_t xRxEvent = { eNetworkRxEvent, nullptr };
     uint8_t * pucDMABuffer = nullptr;
 
+    /* Frames received and not handed to the IP task yet, oldest first. */
+    NetworkBufferDescriptor_t * pxChainHead = nullptr;
+    NetworkBufferDescriptor_t * pxChainTail = nullptr;
+    uint32_t ulChainLength = 0U;
+
     while (true)
     {
         /* If pxNextNetworkBufferDescriptor was not left pointing at a valid
@@ -435,7 +548,20 @@ static uint32_t prvEMACRxPoll()
 
         if( ( ulResult != GMAC_OK ) || ( ulReceiveCount == 0 ) )
         {
-            /* No data from the hardware. */
+            /* No data from the hardware: hand the batch over, and let the next frame interrupt again. */
+            if (pxChainHead != nullptr)
+            {
+                prvEMACRxDeliver(pxChainHead, ulChainLength);
+                pxChainHead = nullptr;
+                pxChainTail = nullptr;
+                ulChainLength = 0U;
+            }
+
+            if (gmac_dev_rx_rearm(&gs_gmac_dev))
+            {
+                continue;
+            }
+
             break;
         }
 
@@ -444,6 +570,7 @@ static uint32_t prvEMACRxPoll()
             /* Data was read from the hardware, but no descriptor was available
              * for it, so it will be dropped. */
             iptraceETHERNET_RX_EVENT_LOST();
+            gmac_stats.frames_dropped++;
             continue;
         }
 
@@ -454,24 +581,34 @@ static uint32_t prvEMACRxPoll()
         if( pxNextNetworkBufferDescriptor == nullptr)
         {
             /* STrange: can not translate from a DMA buffer to a Network Buffer. */
-            break;
+            continue;
         }
 
         pxNextNetworkBufferDescriptor->xDataLength = ( size_t ) ulReceiveCount;
-        xRxEvent.pvData = ( void * ) pxNextNetworkBufferDescriptor;
+        pxNextNetworkBufferDescriptor->pxNextBuffer = nullptr;
 
-        /* Send the descriptor to the IP task for processing. */
-        if (xSendEventStructToIPTask( &xRxEvent, xBlockTime ) != pdTRUE)
+        /* Chain the frame behind the others received in this burst. */
+        if (pxChainTail == nullptr)
         {
-            /* The buffer could not be sent to the stack so must be released
-             * again. */
-            vReleaseNetworkBufferAndDescriptor( pxNextNetworkBufferDescriptor );
-            iptraceETHERNET_RX_EVENT_LOST();
-            FreeRTOS_printf( ( "prvEMACRxPoll: Can not queue return packet!\n" ) );
+            pxChainHead = pxNextNetworkBufferDescriptor;
         }
+        else
+        {
+            pxChainTail->pxNextBuffer = pxNextNetworkBufferDescriptor;
+        }
+
+        pxChainTail = pxNextNetworkBufferDescriptor;
+        ulChainLength++;
 
-        /* Now the buffer has either been passed to the IP-task,
-         * or it has been released in the code above. */
+        if (ulChainLength >= GMAC_RX_BATCH)
+        {
+            prvEMACRxDeliver(pxChainHead, ulChainLength);
+            pxChainHead = nullptr;
+            pxChainTail = nullptr;
+            ulChainLength = 0U;
+        }
+
+        /* Now the buffer is either chained or has been passed to the IP-task. */
         pxNextNetworkBufferDescriptor = nullptr;
         ulReturnValue++;
     }
@@ -484,8 +621,8 @@ volatile UBaseType_t uxLastMinBufferCount = 0;
 #if ( ipconfigCHECK_IP_QUEUE_SPACE != 0 )
     volatile UBaseType_t uxLastMinQueueSpace;
 #endif
-volatile UBaseType_t uxCurrentSemCount;
-volatile UBaseType_t uxLowestSemCount;
+volatile UBaseType_t uxCurrentSemCount[GMAC_TX_QUEUES];
+volatile UBaseType_t uxLowestSemCount[GMAC_TX_QUEUES];
 
 void vCheckBuffersAndQueue()
 {
@@ -514,14 +651,17 @@ void vCheckBuffersAndQueue()
         //FreeRTOS_printf( ( "Network buffers: %lu lowest %lu\n", uxGetNumberOfFreeNetworkBuffers(), uxCurrentCount ) );
     }
 
-    if( xTXDescriptorSemaphore != nullptr )
+    for (uint32_t ulQueue = 0U; ulQueue < GMAC_TX_QUEUES; ulQueue++)
     {
-        uxCurrentSemCount = uxSemaphoreGetCount( xTXDescriptorSemaphore );
-
-        if( uxLowestSemCount > uxCurrentSemCount )
+        if( xTXDescriptorSemaphores[ulQueue] != nullptr )
         {
-            uxLowestSemCount = uxCurrentSemCount;
-            //FreeRTOS_printf( ( "TX DMA buffers: lowest %lu\n", uxLowestSemCount ) );
+            uxCurrentSemCount[ulQueue] = uxSemaphoreGetCount( xTXDescriptorSemaphores[ulQueue] );
+
+            if( uxLowestSemCount[ulQueue] > uxCurrentSemCount[ulQueue] )
+            {
+                uxLowestSemCount[ulQueue] = uxCurrentSemCount[ulQueue];
+                //FreeRTOS_printf( ( "TX DMA buffers: lowest %lu\n", uxLowestSemCount[ulQueue] ) );
+            }
         }
     }
 }
@@ -538,7 +678,8 @@ void vNetworkInterfaceAllocateRAMToBuffers(NetworkBufferDescriptor_t pxNetworkBu
         ucRAMBuffer += NETWORK_BUFFER_SIZE;
     }
 
-    cache_clean_invalidate();
+    // Network buffers stay cacheable for the IP stack, only the lines shared with the GMAC are maintained.
+    dcache_clean_invalidate(ucNetworkPackets, sizeof(ucNetworkPackets));
 }
 /*-----------------------------------------------------------*/
 
@@ -548,7 +689,7 @@ static void prvEMACHandlerTask(void* /*pvParameters*/)
 
     NetworkBufferDescriptor_t* pxBuffer = nullptr;
 
-    uint8_t* pucBuffer = nullptr;
+    TxDone xDone = {};
 
     configASSERT(xEMACTaskHandle);
 
@@ -576,9 +717,9 @@ static void prvEMACHandlerTask(void* /*pvParameters*/)
             /* Future extension: code to release TX buffers if zero-copy is used. */
             ulISREvents &= ~EMAC_IF_TX_EVENT;
 
-            while (xQueueReceive(xTxBufferQueue, &pucBuffer, 0) != pdFALSE)
+            while (xQueueReceive(xTxBufferQueue, &xDone, 0) != pdFALSE)
             {
-                pxBuffer = pxPacketBuffer_to_NetworkBuffer(pucBuffer);
+                pxBuffer = pxPacketBuffer_to_NetworkBuffer(xDone.buffer);
 
                 if( pxBuffer != nullptr )
                 {
@@ -590,12 +731,12 @@ static void prvEMACHandlerTask(void* /*pvParameters*/)
                     //tx_release_count[ 1 ]++;
                 }
 
-                uxCount = uxQueueMessagesWaiting( ( QueueHandle_t ) xTXDescriptorSemaphore );
+                uxCount = uxQueueMessagesWaiting( ( QueueHandle_t ) xTXDescriptorSemaphores[xDone.queue] );
 
-                if(uxCount < GMAC_TX_BUFFERS)
+                if(uxCount < gmac_tx_queue_size(xDone.queue))
                 {
-                    /* Tell the counting semaphore that one more TX descriptor is available. */
-                    xSemaphoreGive( xTXDescriptorSemaphore );
+                    /* Tell the counting semaphore that one more TX descriptor of the queue is available. */
+                    xSemaphoreGive( xTXDescriptorSemaphores[xDone.queue] );
                 }
             }
         }
@@ -608,3 +749,39 @@ static void prvEMACHandlerTask(void* /*pvParameters*/)
     }
 }
 /*-----------------------------------------------------------*/
+
+GmacStats gmac_get_stats()
+{
+    taskENTER_CRITICAL();
+    const GmacStats stats = gmac_stats;
+    taskEXIT_CRITICAL();
+
+    return stats;
+}
+
+size_t gmac_format_stats(char* buffer, size_t size)
+{
+    size_t length = 0U;
+
+    const GmacStats stats = gmac_get_stats();
+    const uint32_t mean_batch_x10 = (stats.batches > 0U) ? ((stats.frames_received * 10U) / stats.batches) : 0U;
+
+    diag_append(buffer, size, length, "%8s %8s %8s %10s %10s %10s %8s %8s %10s\n", "rx_ring", "tx_ring", "batch",
+        "interrupts", "frames", "batches", "mean", "largest", "dropped");
+    diag_append(buffer, size, length, "%8u %8u %8u %10lu %10lu %10lu %6lu.%1lu %8lu %10lu\n",
+        static_cast<unsigned>(GMAC_RX_BUFFERS), static_cast<unsigned>(GMAC_TX_BUFFERS),
+        static_cast<unsigned>(GMAC_RX_BATCH), static_cast<unsigned long>(stats.rx_interrupts),
+        static_cast<unsigned long>(stats.frames_received), static_cast<unsigned long>(stats.batches),
+        static_cast<unsigned long>(mean_batch_x10 / 10U), static_cast<unsigned long>(mean_batch_x10 % 10U),
+        static_cast<unsigned long>(stats.largest_batch), static_cast<unsigned long>(stats.frames_dropped));
+
+    diag_append(buffer, size, length, "%8s %10s %10s\n", "tx_queue", "frames", "timeouts");
+
+    for (size_t queue = 0U; queue < gmac::kTxClasses; queue++)
+    {
+        diag_append(buffer, size, length, "%8u %10lu %10lu\n", static_cast<unsigned>(queue),
+            static_cast<unsigned long>(stats.tx_frames[queue]), static_cast<unsigned long>(stats.tx_timeouts[queue]));
+    }
+
+    return length;
+}
@@ -0,0 +1,64 @@
+#ifndef MCAN_CLOCK_H_
+#define MCAN_CLOCK_H_
+
+#include "board.h"
+#include "conf_clock.h"
+#include "conf_mcan.h"
+
+#include <cstdint>
+
+/**
+ * CAN clock and nominal bit timing of both channels, as set up by mcan_init() from conf_clock.h and conf_mcan.h.
+ */
+
+// mcan_init() runs PCK5 from PLLA / 10, PLLA also clocks the core.
+constexpr uint32_t kCanClockDivider = 10U;
+constexpr uint32_t kCanClockHz = BOARD_FREQ_MAINCK_XTAL * CONFIG_PLL0_MUL / CONFIG_PLL0_DIV / kCanClockDivider;
+
+constexpr uint32_t kCanBitQuanta = 3U + CONF_MCAN_NBTP_NTSEG1_VALUE + CONF_MCAN_NBTP_NTSEG2_VALUE;
+constexpr uint32_t kCanNominalBitrate = kCanClockHz / ((CONF_MCAN_NBTP_NBRP_VALUE + 1U) * kCanBitQuanta);
+constexpr uint32_t kCyclesPerCanBit = kCanClockDivider * (CONF_MCAN_NBTP_NBRP_VALUE + 1U) * kCanBitQuanta;
+
+// A stuff bit after every 4 bits, the worst case, or after about every 10 bits of a typical frame.
+constexpr uint32_t kCanWorstStuffInterval = 4U;
+constexpr uint32_t kCanTypicalStuffInterval = 10U;
+
+struct CanFrameBits
+{
+    uint32_t nominal;   // Sent at the nominal bit rate.
+    uint32_t data;      // Sent at the data bit rate, only for CAN-FD frames with bit rate switching.
+};
+
+/**
+ * Length of a frame on the bus, from start of frame to the end of the intermission, with a stuff bit every
+ * stuff_interval bits where the stuffing is dynamic.
+ */
+constexpr CanFrameBits can_frame_bits(bool extended, uint32_t length, bool fd, bool bit_rate_switch,
+    uint32_t stuff_interval)
+{
+    const uint32_t data_bits = 8U * length;
+
+    // CRC delimiter, ACK slot and delimiter, end of frame and intermission.
+    constexpr uint32_t kTrailerBits = 13U;
+
+    if (false == fd)
+    {
+        // Start of frame to CRC, exposed to stuffing.
+        const uint32_t stuffed = (extended ? 54U : 34U) + data_bits;
+
+        return {stuffed + ((stuffed - 1U) / stuff_interval) + kTrailerBits, 0U};
+    }
+
+    // Start of frame to the bit rate switch.
+    const uint32_t arbitration = extended ? 36U : 17U;
+    const uint32_t nominal_bits = arbitration + ((arbitration - 1U) / stuff_interval) + kTrailerBits;
+
+    // ESI and DLC then the data with dynamic stuffing, then the stuff count and CRC with fixed stuff bits.
+    const uint32_t dynamic = 5U + data_bits;
+    const uint32_t crc = 4U + ((length <= 16U) ? 17U : 21U);
+    const uint32_t fast_bits = dynamic + ((dynamic - 1U) / stuff_interval) + crc + (crc / 4U) + 1U;
+
+    return bit_rate_switch ? CanFrameBits{nominal_bits, fast_bits} : CanFrameBits{nominal_bits + fast_bits, 0U};
+}
+
+#endif  // MCAN_CLOCK_H_
@@ -0,0 +1,155 @@
+#ifndef MCAN_RAM_H_
+#define MCAN_RAM_H_
+
+#include "conf_can.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Message RAM layout of a MCAN channel, computed at build time from its can::ChannelConfig.
+ *
+ * The sections follow each other in the order below, all offsets counted in 32-bit words from the start of the
+ * channel's message RAM.  RX and TX elements share one size: a two word header then the data field.
+ */
+
+struct McanRamLayout
+{
+    uint32_t standard_filters;
+    uint32_t extended_filters;
+    uint32_t rx_fifo_0;
+    uint32_t rx_fifo_1;
+    uint32_t rx_buffers;
+    uint32_t tx_events;
+    uint32_t tx_buffers;    // Dedicated TX buffers, then the TX FIFO.
+
+    uint32_t element_words;
+    uint32_t words;
+};
+
+// Bytes carried by each DLC value, CAN-FD above 8.
+constexpr std::array<uint8_t, 16U> kCanDlcBytes = {{0U, 1U, 2U, 3U, 4U, 5U, 6U, 7U, 8U, 12U, 16U, 20U, 24U, 32U, 48U,
+    64U}};
+
+/**
+ * Smallest DLC carrying the bytes, the data past them is padding.
+ */
+constexpr uint32_t mcan_dlc(uint32_t bytes)
+{
+    uint32_t dlc = 0U;
+
+    while ((kCanDlcBytes[dlc] < bytes) && ((dlc + 1U) < kCanDlcBytes.size()))
+    {
+        dlc++;
+    }
+
+    return dlc;
+}
+
+constexpr bool mcan_valid_data_size(uint32_t bytes)
+{
+    for (size_t dlc = 8U; dlc < kCanDlcBytes.size(); dlc++)
+    {
+        if (kCanDlcBytes[dlc] == bytes)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Value of the RXESC and TXESC data field size fields.
+ */
+constexpr uint32_t mcan_data_size_code(uint32_t bytes)
+{
+    return (bytes <= 24U) ? ((bytes - 8U) / 4U) : (((bytes - 32U) / 16U) + 5U);
+}
+
+constexpr McanRamLayout mcan_ram_layout(const can::ChannelConfig& config)
+{
+    McanRamLayout layout = {};
+
+    layout.element_words = 2U + (config.element_data_bytes / 4U);
+
+    uint32_t offset = 0U;
+
+    layout.standard_filters = offset;
+    offset += config.standard_filters;
+
+    layout.extended_filters = offset;
+    offset += 2U * config.extended_filters;
+
+    layout.rx_fifo_0 = offset;
+    offset += layout.element_words * config.rx_fifo_0;
+
+    layout.rx_fifo_1 = offset;
+    offset += layout.element_words * config.rx_fifo_1;
+
+    layout.rx_buffers = offset;
+    offset += layout.element_words * config.rx_buffers;
+
+    layout.tx_events = offset;
+    offset += 2U * config.tx_events;
+
+    layout.tx_buffers = offset;
+    offset += layout.element_words * (config.tx_buffers + config.tx_fifo);
+
+    layout.words = offset;
+
+    return layout;
+}
+
+constexpr bool mcan_valid_config(const can::ChannelConfig& config)
+{
+    return mcan_valid_data_size(config.element_data_bytes) && (config.standard_filters <= 128U) &&
+        (config.extended_filters <= 64U) && (config.rx_fifo_0 <= 64U) && (config.rx_fifo_1 <= 64U) &&
+        (config.rx_buffers <= 32U) && ((config.tx_buffers + config.tx_fifo) <= 32U) && (config.tx_events <= 32U) &&
+        // The start addresses are 14-bit word offsets into a 64 kB window.
+        (mcan_ram_layout(config).words <= (0x10000U / 4U));
+}
+
+struct McanDataTiming
+{
+    uint32_t prescaler;     // DBRP
+    uint32_t segment_1;     // DTSEG1
+    uint32_t segment_2;     // DTSEG2, also the resynchronisation jump width.
+    uint32_t tdc_offset;    // Secondary sample point, in CAN clock periods from the start of the bit.
+};
+
+/**
+ * Data phase timing for the bit rate, with the sample point close to 75 %.  Every field holds the value written to
+ * the register, one less than the actual count of time quanta.
+ */
+constexpr McanDataTiming mcan_data_timing(uint32_t clock_hz, uint32_t bitrate)
+{
+    McanDataTiming timing = {};
+
+    // As many time quanta per bit as the DTSEG1 and DTSEG2 fields hold, for the finest sample point.
+    uint32_t quanta = clock_hz / bitrate;
+    while (quanta > 25U)
+    {
+        timing.prescaler++;
+        quanta = clock_hz / bitrate / (timing.prescaler + 1U);
+    }
+
+    const uint32_t phase_2 = (quanta + 2U) / 4U;
+    timing.segment_2 = phase_2 - 1U;
+    timing.segment_1 = quanta - phase_2 - 2U;
+    timing.tdc_offset = (timing.prescaler + 1U) * (timing.segment_1 + 2U);
+
+    return timing;
+}
+
+constexpr bool mcan_valid_data_timing(uint32_t clock_hz, uint32_t bitrate)
+{
+    const McanDataTiming timing = mcan_data_timing(clock_hz, bitrate);
+    const uint32_t quanta = timing.segment_1 + timing.segment_2 + 3U;
+
+    return ((timing.prescaler + 1U) * quanta * bitrate == clock_hz) && (timing.prescaler <= 31U) &&
+        (timing.segment_1 <= 31U) && (timing.segment_2 <= 15U) && (timing.tdc_offset <= 127U);
+}
+
+#endif  // MCAN_RAM_H_
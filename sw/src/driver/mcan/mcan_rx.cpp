@@ -0,0 +1,844 @@
+#include "mcan_rx.h"
+
+#include "can_gateway.h"
+#include "cycle_timer.h"
+#include "dcache.h"
+#include "mcan_clock.h"
+#include "mcan_ram.h"
+#include "spsc_ring.h"
+
+#include "mcan.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+// The timestamp counter counts nominal bit times, scaled by the prescaler set up here.
+constexpr uint8_t kCanTimestampPrescaler = 0U;
+constexpr uint32_t kCyclesPerCanTimestamp = kCyclesPerCanBit * (kCanTimestampPrescaler + 1U);
+
+constexpr uint32_t kCanRxInterrupts = MCAN_IR_RF0N | MCAN_IR_RF1N | MCAN_IR_RF0L | MCAN_IR_RF1L | MCAN_IR_DRX;
+
+// Changes of the error state, and the error logging counter about to saturate.
+constexpr uint32_t kCanStatusInterrupts = MCAN_IR_EW | MCAN_IR_EP | MCAN_IR_BO | MCAN_IR_ELO;
+
+// PSR.LEC values telling there is no error to record.
+constexpr uint32_t kCanNoError = 0U;
+constexpr uint32_t kCanNoChange = 7U;
+
+constexpr std::array<McanRamLayout, kCanChannels> kMcanRamLayouts = {{
+    mcan_ram_layout(can::kChannels[0]),
+    mcan_ram_layout(can::kChannels[1]),
+}};
+
+constexpr bool mcan_valid_channel(const can::ChannelConfig& config)
+{
+    return mcan_valid_config(config) &&
+        ((config.data_bitrate == 0U) || mcan_valid_data_timing(kCanClockHz, config.data_bitrate));
+}
+
+static_assert(mcan_valid_channel(can::kChannels[0]) && mcan_valid_channel(can::kChannels[1]),
+    "A CAN channel does not fit the message RAM, or its data bit rate the CAN clock.");
+
+// Message RAM, the MCAN masters it through the bus matrix, out of the D-cache.  Zeroed filter elements are disabled.
+DMA_NOCACHE alignas(4) static std::array<uint32_t, kMcanRamLayouts[0].words> mcan0_ram = {};
+DMA_NOCACHE alignas(4) static std::array<uint32_t, kMcanRamLayouts[1].words> mcan1_ram = {};
+
+struct McanChannel
+{
+    Mcan* hw;
+    IRQn_Type irq;
+    const can::ChannelConfig* config;
+    McanRamLayout layout;
+    volatile uint32_t* ram;
+    mcan_module module;
+    SpscRing<CanFrame, kCanRxRingSize> ring;
+    SpscRing<CanFrame, kCanPriorityRingSize> priority_ring;
+    CanRxStats stats;
+    std::array<SemaphoreHandle_t, kCanTxFifoWaiters> tx_fifo_semaphores;    // nullptr for a free entry.
+    uint32_t protocol_status;   // PSR when last read, for the error states entered since.
+    bool started;
+};
+
+static std::array<McanChannel, kCanChannels> mcan_channels = {{
+    {MCAN0, MCAN0_INT0_IRQn, &can::kChannels[0], kMcanRamLayouts[0], mcan0_ram.data(), {}, {}, {}, {}, {}, 0U, false},
+    {MCAN1, MCAN1_INT0_IRQn, &can::kChannels[1], kMcanRamLayouts[1], mcan1_ram.data(), {}, {}, {}, {}, {}, 0U, false},
+}};
+
+static TaskHandle_t mcan_rx_task = nullptr;
+
+static volatile uint32_t* mcan_element(const McanChannel& channel, uint32_t section, uint32_t index)
+{
+    return channel.ram + section + (index * channel.layout.element_words);
+}
+
+/**
+ * Count a frame with its length on the bus, estimated for a typical payload.  Remote frames carry no data.
+ */
+static void mcan_count(CanTraffic& traffic, bool extended, bool remote, uint32_t length, bool fd, bool bit_rate_switch)
+{
+    const CanFrameBits bits =
+        can_frame_bits(extended, remote ? 0U : length, fd, bit_rate_switch, kCanTypicalStuffInterval);
+
+    traffic.frames++;
+    traffic.nominal_bits += bits.nominal;
+    traffic.data_bits += bits.data;
+}
+
+/**
+ * Count a TX element, the identifier, XTD and RTR bits, the DLC and the FDF and BRS bits are at the same place in RX
+ * elements.
+ */
+static void mcan_count_element(CanTraffic& traffic, uint32_t t0, uint32_t t1)
+{
+    const bool fd = (t1 & MCAN_TX_ELEMENT_T1_FDF) != 0U;
+    const uint32_t length = kCanDlcBytes[(t1 & MCAN_TX_ELEMENT_T1_DLC_Msk) >> MCAN_TX_ELEMENT_T1_DLC_Pos];
+
+    mcan_count(traffic, (t0 & MCAN_TX_ELEMENT_T0_XTD) != 0U, (t0 & MCAN_TX_ELEMENT_T0_RTR) != 0U,
+        (fd || (length <= 8U)) ? length : 8U, fd, (t1 & MCAN_TX_ELEMENT_T1_BRS) != 0U);
+}
+
+/**
+ * Read the error counters and protocol status, which clears the error logging counter and the last error codes.
+ * Only ever called from the receive interrupt or with it masked.
+ */
+static CanBusStatus mcan_update_bus_status(McanChannel& channel)
+{
+    const uint32_t counters = mcan_read_error_count(&channel.module);
+    const uint32_t status = mcan_read_protocal_status(&channel.module);
+
+    channel.stats.errors += (counters & MCAN_ECR_CEL_Msk) >> MCAN_ECR_CEL_Pos;
+
+    const uint32_t error_code = (status & MCAN_PSR_LEC_Msk) >> MCAN_PSR_LEC_Pos;
+    if ((error_code != kCanNoError) && (error_code != kCanNoChange))
+    {
+        channel.stats.last_error_code = error_code;
+    }
+
+    const uint32_t entered = status & ~channel.protocol_status;
+    channel.protocol_status = status;
+
+    if ((entered & MCAN_PSR_EW) != 0U)
+    {
+        channel.stats.warnings++;
+    }
+
+    if ((entered & MCAN_PSR_EP) != 0U)
+    {
+        channel.stats.error_passives++;
+    }
+
+    if ((entered & MCAN_PSR_BO) != 0U)
+    {
+        channel.stats.bus_offs++;
+    }
+
+    CanBusStatus bus = {};
+    bus.transmit_errors = (counters & MCAN_ECR_TEC_Msk) >> MCAN_ECR_TEC_Pos;
+    bus.receive_errors = ((counters & MCAN_ECR_RP) != 0U) ? 128U : ((counters & MCAN_ECR_REC_Msk) >> MCAN_ECR_REC_Pos);
+    bus.protocol_status = status;
+
+    return bus;
+}
+
+/**
+ * Convert a RX element.  RXTS is the timestamp counter at the start of frame, its age against the counter read
+ * now is moved onto the cycle counter.  The 16-bit counter covers over 100 ms, far longer than a frame waits.
+ */
+static void mcan_rx_convert(const McanChannel& channel, const volatile uint32_t* element, CanFrame& frame,
+    uint32_t now_cycles, uint16_t now_timestamp)
+{
+    const uint32_t r0 = element[0];
+    const uint32_t r1 = element[1];
+
+    const auto rx_timestamp = static_cast<uint16_t>((r1 & MCAN_RX_ELEMENT_R1_RXTS_Msk) >> MCAN_RX_ELEMENT_R1_RXTS_Pos);
+    const auto age = static_cast<uint16_t>(now_timestamp - rx_timestamp);
+    frame.timestamp_cycles = now_cycles - (age * kCyclesPerCanTimestamp);
+
+    frame.flags = 0U;
+    if ((r0 & MCAN_RX_ELEMENT_R0_XTD) != 0U)
+    {
+        frame.id = r0 & MCAN_RX_ELEMENT_R0_ID_Msk;
+        frame.flags |= can_flags::kExtended;
+    }
+    else
+    {
+        // Standard identifiers are stored in the upper 11 bits of the field.
+        frame.id = (r0 & MCAN_RX_ELEMENT_R0_ID_Msk) >> 18U;
+    }
+
+    if ((r0 & MCAN_RX_ELEMENT_R0_RTR) != 0U)
+    {
+        frame.flags |= can_flags::kRemote;
+    }
+
+    uint8_t length = kCanDlcBytes[(r1 & MCAN_RX_ELEMENT_R1_DLC_Msk) >> MCAN_RX_ELEMENT_R1_DLC_Pos];
+
+    if ((r1 & MCAN_RX_ELEMENT_R1_FDF) != 0U)
+    {
+        frame.flags |= can_flags::kFd;
+
+        if ((r1 & MCAN_RX_ELEMENT_R1_BRS) != 0U)
+        {
+            frame.flags |= can_flags::kBitRateSwitch;
+        }
+    }
+    else if (length > 8U)
+    {
+        // Classic frames carry 8 bytes for any DLC above 8.
+        length = 8U;
+    }
+
+    // The element only holds as much data as it was sized for.
+    frame.length = (length > channel.config->element_data_bytes) ? channel.config->element_data_bytes : length;
+
+    for (uint32_t i = 0U; (i * 4U) < frame.length; i++)
+    {
+        const uint32_t word = element[2U + i];
+        memcpy(&frame.data[i * 4U], &word, sizeof(word));
+    }
+}
+
+/**
+ * Write a TX element into the next free element of the TX FIFO and request it.  The gateway calls this from both
+ * receive interrupts, which run at the same priority, and tasks call it with the interrupts masked, so nothing ever
+ * races for the put index.
+ *
+ * \return false if the TX FIFO is full.
+ */
+static bool mcan_tx_fifo_put(McanChannel& channel, uint32_t t0, uint32_t t1, const uint8_t* data, uint32_t length)
+{
+    const uint32_t status = mcan_tx_get_fifo_queue_status(&channel.module);
+    if ((status & MCAN_TXFQS_TFQF) != 0U)
+    {
+        return false;
+    }
+
+    const uint32_t put_index = (status & MCAN_TXFQS_TFQPI_Msk) >> MCAN_TXFQS_TFQPI_Pos;
+
+    volatile uint32_t* element = mcan_element(channel, channel.layout.tx_buffers, put_index);
+    element[0] = t0;
+    element[1] = t1;
+
+    for (uint32_t i = 0U; (i * 4U) < length; i++)
+    {
+        uint32_t word = 0U;
+        memcpy(&word, &data[i * 4U], sizeof(word));
+        element[2U + i] = word;
+    }
+
+    // The element must be in the message RAM before the request reaches the peripheral.
+    __DMB();
+    channel.hw->MCAN_TXBAR = 1UL << put_index;
+
+    mcan_count_element(channel.stats.sent_fifo, t0, t1);
+
+    return true;
+}
+
+/**
+ * Forward a received frame along its routes, writing it straight into the TX FIFO of every destination.
+ */
+static void mcan_rx_forward(McanChannel& channel, uint32_t r0, uint32_t r1, const CanFrame& frame)
+{
+    const bool extended = (frame.flags & can_flags::kExtended) != 0U;
+    const CanRouteRange routes = can_gateway_find(frame.channel, frame.id, extended);
+
+    for (const CanRoute* route = routes.first; route != routes.last; route++)
+    {
+        McanChannel& destination = mcan_channels[static_cast<size_t>(route->destination)];
+
+        // CAN-FD frames only go to channels sending CAN-FD, with elements large enough.
+        const bool fits = ((frame.flags & can_flags::kFd) == 0U) ||
+            ((destination.config->data_bitrate != 0U) && (frame.length <= destination.config->element_data_bytes));
+
+        // The identifier, XTD and RTR bits, the DLC and the FDF and BRS bits sit at the same place in RX and TX
+        // elements.
+        uint32_t t0 = r0 & (MCAN_RX_ELEMENT_R0_ID_Msk | MCAN_RX_ELEMENT_R0_XTD | MCAN_RX_ELEMENT_R0_RTR);
+        if (route->new_id != logic::kCanKeepId)
+        {
+            t0 &= ~MCAN_RX_ELEMENT_R0_ID_Msk;
+            t0 |= extended ? route->new_id : (route->new_id << 18U);
+        }
+
+        const uint32_t t1 = r1 & (MCAN_RX_ELEMENT_R1_DLC_Msk | MCAN_RX_ELEMENT_R1_FDF | MCAN_RX_ELEMENT_R1_BRS);
+
+        std::array<uint8_t, kCanMaxDataBytes> payload = {};
+        can_gateway_payload(*route, &frame.data[0], &payload[0], frame.length);
+
+        if ((false == destination.started) || (false == fits) ||
+            (false == mcan_tx_fifo_put(destination, t0, t1, &payload[0], frame.length)))
+        {
+            channel.stats.forward_drops++;
+            continue;
+        }
+
+        channel.stats.forwarded++;
+
+        const uint32_t latency_cycles = cycle_timer_elapsed(frame.timestamp_cycles);
+        if (latency_cycles > channel.stats.forward_latency_max_cycles)
+        {
+            channel.stats.forward_latency_max_cycles = latency_cycles;
+        }
+    }
+}
+
+template <size_t N>
+static void mcan_rx_push(McanChannel& channel, SpscRing<CanFrame, N>& ring, const CanFrame& frame)
+{
+    if (ring.push(frame))
+    {
+        channel.stats.frames++;
+    }
+    else
+    {
+        channel.stats.ring_overflows++;
+    }
+}
+
+/**
+ * Convert and forward the element, then push it into the ring.
+ */
+template <size_t N>
+static void mcan_rx_receive(McanChannel& channel, CanChannel id, const volatile uint32_t* element,
+    SpscRing<CanFrame, N>& ring, uint32_t now_cycles, uint16_t now_timestamp)
+{
+    CanFrame frame = {};
+    frame.channel = id;
+
+    mcan_rx_convert(channel, element, frame, now_cycles, now_timestamp);
+    mcan_count(channel.stats.received, (frame.flags & can_flags::kExtended) != 0U,
+        (frame.flags & can_flags::kRemote) != 0U, frame.length, (frame.flags & can_flags::kFd) != 0U,
+        (frame.flags & can_flags::kBitRateSwitch) != 0U);
+    mcan_rx_forward(channel, element[0], element[1], frame);
+    mcan_rx_push(channel, ring, frame);
+}
+
+/**
+ * Move every frame waiting in the dedicated RX buffers into the priority ring, then release the buffers.
+ */
+static uint32_t mcan_rx_drain_buffers(McanChannel& channel, CanChannel id, uint32_t now_cycles,
+    uint16_t now_timestamp)
+{
+    const uint32_t pending = channel.hw->MCAN_NDAT1;
+    uint32_t frames = 0U;
+
+    for (uint32_t index = 0U; index < channel.config->rx_buffers; index++)
+    {
+        if ((pending & (1UL << index)) == 0U)
+        {
+            continue;
+        }
+
+        mcan_rx_receive(channel, id, mcan_element(channel, channel.layout.rx_buffers, index), channel.priority_ring,
+            now_cycles, now_timestamp);
+        frames++;
+    }
+
+    // Only the buffers read are released, a buffer filled since waits for the next interrupt.
+    channel.hw->MCAN_NDAT1 = pending;
+
+    return frames;
+}
+
+/**
+ * Move every frame waiting in the FIFO into the ring, then release them all back to the hardware at once.
+ */
+static uint32_t mcan_rx_drain_fifo(McanChannel& channel, CanChannel id, bool fifo, uint32_t now_cycles,
+    uint16_t now_timestamp)
+{
+    // Both FIFO status registers share the same layout.
+    const uint32_t status = mcan_rx_get_fifo_status(&channel.module, fifo);
+    const uint32_t fill = (status & MCAN_RXF0S_F0FL_Msk) >> MCAN_RXF0S_F0FL_Pos;
+    uint32_t index = (status & MCAN_RXF0S_F0GI_Msk) >> MCAN_RXF0S_F0GI_Pos;
+
+    const uint32_t section = fifo ? channel.layout.rx_fifo_1 : channel.layout.rx_fifo_0;
+    const uint32_t size = fifo ? channel.config->rx_fifo_1 : channel.config->rx_fifo_0;
+
+    uint32_t& high_water = channel.stats.fifo_high_water[fifo ? 1U : 0U];
+    if (fill > high_water)
+    {
+        high_water = fill;
+    }
+
+    for (uint32_t i = 0U; i < fill; i++)
+    {
+        mcan_rx_receive(channel, id, mcan_element(channel, section, index), channel.ring, now_cycles, now_timestamp);
+
+        if ((i + 1U) < fill)
+        {
+            index = ((index + 1U) < size) ? (index + 1U) : 0U;
+        }
+    }
+
+    if (fill > 0U)
+    {
+        // Acknowledging the last element read releases every element before it.
+        mcan_rx_fifo_acknowledge(&channel.module, fifo, index);
+    }
+
+    return fill;
+}
+
+static void mcan_rx_handler(CanChannel id)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    // Clear first, a frame arriving while draining raises the interrupt again.  TX FIFO empty only counts while a
+    // task waits for it.
+    const uint32_t status = mcan_read_interrupt_status(&channel.module) &
+        (kCanRxInterrupts | kCanStatusInterrupts | (channel.hw->MCAN_IE & MCAN_IE_TFEE));
+    channel.hw->MCAN_IR = status;
+
+    if ((status & MCAN_IR_RF0L) != 0U)
+    {
+        channel.stats.fifo_lost[0]++;
+    }
+
+    if ((status & MCAN_IR_RF1L) != 0U)
+    {
+        channel.stats.fifo_lost[1]++;
+    }
+
+    if ((status & kCanStatusInterrupts) != 0U)
+    {
+        (void)mcan_update_bus_status(channel);
+    }
+
+    const uint32_t now_cycles = cycle_timer_now();
+    const uint16_t now_timestamp = mcan_read_timestamp_count_value(&channel.module);
+
+    const uint32_t frames = mcan_rx_drain_buffers(channel, id, now_cycles, now_timestamp) +
+        mcan_rx_drain_fifo(channel, id, false, now_cycles, now_timestamp) +
+        mcan_rx_drain_fifo(channel, id, true, now_cycles, now_timestamp);
+
+    const uint32_t waiting = channel.ring.size();
+    if (waiting > channel.stats.ring_high_water)
+    {
+        channel.stats.ring_high_water = waiting;
+    }
+
+    BaseType_t task_switch_required = pdFALSE;
+
+    if ((frames > 0U) && (mcan_rx_task != nullptr))
+    {
+        channel.stats.batches++;
+        vTaskNotifyGiveFromISR(mcan_rx_task, &task_switch_required);
+    }
+
+    if ((status & MCAN_IR_TFE) != 0U)
+    {
+        // One shot, armed again by the next mcan_tx_fifo_wait_empty().
+        mcan_disable_interrupt(&channel.module, MCAN_TX_FIFO_EMPTY);
+
+        for (auto& semaphore : channel.tx_fifo_semaphores)
+        {
+            if (semaphore != nullptr)
+            {
+                (void)xSemaphoreGiveFromISR(semaphore, &task_switch_required);
+                semaphore = nullptr;
+            }
+        }
+    }
+
+    portEND_SWITCHING_ISR(task_switch_required);
+}
+
+void MCAN0_INT0_Handler()
+{
+    traceISR_ENTER();
+
+    mcan_rx_handler(CanChannel::kCan0);
+}
+
+void MCAN1_INT0_Handler()
+{
+    traceISR_ENTER();
+
+    mcan_rx_handler(CanChannel::kCan1);
+}
+
+static void mcan_rx_set_standard_filter(McanChannel& channel, const CanFilter& filter, uint32_t index)
+{
+    uint32_t type = MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFT_CLASSIC;
+    uint32_t action = MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFEC_STF0M_Val;
+
+    switch (filter.type)
+    {
+        case CanFilterType::kRange:
+            type = MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFT_RANGE;
+            break;
+
+        case CanFilterType::kDual:
+            type = MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFT_DUAL;
+            break;
+
+        case CanFilterType::kMask:
+            break;
+
+        case CanFilterType::kRxBuffer:
+            // SFID2 holds the buffer index, the filter type is ignored.
+            action = MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFEC_STRXBUF_Val;
+            break;
+    }
+
+    channel.ram[channel.layout.standard_filters + index] = type | MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFEC(action) |
+        MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFID1(filter.id1) |
+        MCAN_STANDARD_MESSAGE_FILTER_ELEMENT_S0_SFID2(filter.id2);
+}
+
+static void mcan_rx_set_extended_filter(McanChannel& channel, const CanFilter& filter, uint32_t index)
+{
+    uint32_t type = MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F1_EFT_CLASSIC;
+    uint32_t action = MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F0_EFEC_STF1M_Val;
+
+    switch (filter.type)
+    {
+        case CanFilterType::kRange:
+            // Plain range, the extended ID AND mask is left out.
+            type = MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F1_EFT_RANGE;
+            break;
+
+        case CanFilterType::kDual:
+            type = MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F1_EFT_DUAL;
+            break;
+
+        case CanFilterType::kMask:
+            break;
+
+        case CanFilterType::kRxBuffer:
+            // EFID2 holds the buffer index, the filter type is ignored.
+            action = MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F0_EFEC_STRXBUF_Val;
+            break;
+    }
+
+    volatile uint32_t* element = channel.ram + channel.layout.extended_filters + (2U * index);
+    element[0] = MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F0_EFEC(action) |
+        MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F0_EFID1(filter.id1);
+    element[1] = type | MCAN_EXTENDED_MESSAGE_FILTER_ELEMENT_F1_EFID2(filter.id2);
+}
+
+/**
+ * Point the channel at its own message RAM, replacing the layout set up by mcan_init().  Only valid while the
+ * configuration can be changed.
+ */
+static bool mcan_rx_set_message_ram(McanChannel& channel)
+{
+    const auto base = reinterpret_cast<uint32_t>(channel.ram);
+    const uint32_t last = base + (channel.layout.words * sizeof(uint32_t)) - 1U;
+
+    // Every start address is an offset into the 64 kB window set in the bus matrix.
+    if ((base >> 16U) != (last >> 16U))
+    {
+        return false;
+    }
+
+    if (channel.hw == MCAN0)
+    {
+        MATRIX->CCFG_CAN0 = (MATRIX->CCFG_CAN0 & ~CCFG_CAN0_CAN0DMABA_Msk) | (base & CCFG_CAN0_CAN0DMABA_Msk);
+    }
+    else
+    {
+        MATRIX->CCFG_SYSIO = (MATRIX->CCFG_SYSIO & ~CCFG_SYSIO_CAN1DMABA_Msk) | (base & CCFG_SYSIO_CAN1DMABA_Msk);
+    }
+
+    const uint32_t offset = (base & 0xFFFFU) / sizeof(uint32_t);
+    const McanRamLayout& layout = channel.layout;
+    const can::ChannelConfig& config = *channel.config;
+    Mcan* hw = channel.hw;
+
+    hw->MCAN_SIDFC = MCAN_SIDFC_FLSSA(offset + layout.standard_filters) | MCAN_SIDFC_LSS(config.standard_filters);
+    hw->MCAN_XIDFC = MCAN_XIDFC_FLESA(offset + layout.extended_filters) | MCAN_XIDFC_LSE(config.extended_filters);
+    hw->MCAN_RXF0C = MCAN_RXF0C_F0SA(offset + layout.rx_fifo_0) | MCAN_RXF0C_F0S(config.rx_fifo_0);
+    hw->MCAN_RXF1C = MCAN_RXF1C_F1SA(offset + layout.rx_fifo_1) | MCAN_RXF1C_F1S(config.rx_fifo_1);
+    hw->MCAN_RXBC = MCAN_RXBC_RBSA(offset + layout.rx_buffers);
+    hw->MCAN_TXEFC = MCAN_TXEFC_EFSA(offset + layout.tx_events) | MCAN_TXEFC_EFS(config.tx_events);
+    hw->MCAN_TXBC = MCAN_TXBC_TBSA(offset + layout.tx_buffers) | MCAN_TXBC_NDTB(config.tx_buffers) |
+        MCAN_TXBC_TFQS(config.tx_fifo);
+
+    const uint32_t data_size = mcan_data_size_code(config.element_data_bytes);
+    hw->MCAN_RXESC = MCAN_RXESC_F0DS(data_size) | MCAN_RXESC_F1DS(data_size) | MCAN_RXESC_RBDS(data_size);
+    hw->MCAN_TXESC = MCAN_TXESC_TBDS(data_size);
+
+    return true;
+}
+
+/**
+ * Switch to CAN-FD with bit rate switching, at the data bit rate of the channel.  Transmitter delay compensation
+ * places the secondary sample point where the primary one is, as the delay of the transceiver loop is a large part
+ * of a bit at these rates.
+ */
+static void mcan_rx_enable_fd(McanChannel& channel)
+{
+    const McanDataTiming timing = mcan_data_timing(kCanClockHz, channel.config->data_bitrate);
+
+    mcan_enable_fd_mode(&channel.module);
+
+    channel.hw->MCAN_DBTP = MCAN_DBTP_DBRP(timing.prescaler) | MCAN_DBTP_DSJW(timing.segment_2) |
+        MCAN_DBTP_DTSEG1(timing.segment_1) | MCAN_DBTP_DTSEG2(timing.segment_2) | MCAN_DBTP_TDC_ENABLED;
+    channel.hw->MCAN_TDCR = MCAN_TDCR_TDCO(timing.tdc_offset);
+}
+
+bool mcan_rx_init(CanChannel id, TaskHandle_t task, const CanFilterPlan& standard, const CanFilterPlan& extended)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    mcan_rx_task = task;
+
+    mcan_config config = {};
+    mcan_get_config_defaults(&config);
+
+    // Only frames passing the filters ever reach the CPU.
+    config.nonmatching_frames_action_standard = MCAN_NONMATCHING_FRAMES_REJECT;
+    config.nonmatching_frames_action_extended = MCAN_NONMATCHING_FRAMES_REJECT;
+
+    // Keep the oldest frames when a FIFO is full, the loss is flagged and counted.
+    config.rx_fifo_0_overwrite = false;
+    config.rx_fifo_1_overwrite = false;
+
+    config.timestamp_prescaler = kCanTimestampPrescaler;
+
+    mcan_init(&channel.module, channel.hw, &config);
+
+    if (false == mcan_rx_set_message_ram(channel))
+    {
+        return false;
+    }
+
+    if (channel.config->data_bitrate != 0U)
+    {
+        mcan_rx_enable_fd(channel);
+    }
+
+    // Elements past the plans stay zeroed, which disables them.
+    for (size_t i = 0U; (i < standard.count) && (i < channel.config->standard_filters); i++)
+    {
+        mcan_rx_set_standard_filter(channel, standard.filters[i], static_cast<uint32_t>(i));
+    }
+
+    for (size_t i = 0U; (i < extended.count) && (i < channel.config->extended_filters); i++)
+    {
+        mcan_rx_set_extended_filter(channel, extended.filters[i], static_cast<uint32_t>(i));
+    }
+
+    mcan_enable_interrupt(&channel.module, MCAN_RX_FIFO_0_NEW_MESSAGE);
+    mcan_enable_interrupt(&channel.module, MCAN_RX_FIFO_1_NEW_MESSAGE);
+    mcan_enable_interrupt(&channel.module, MCAN_RX_FIFO_0_LOST_MESSAGE);
+    mcan_enable_interrupt(&channel.module, MCAN_RX_FIFO_1_MESSAGE_LOST);
+    mcan_enable_interrupt(&channel.module, MCAN_RX_BUFFER_NEW_MESSAGE);
+
+    mcan_enable_interrupt(&channel.module, MCAN_WARNING_STATUS);
+    mcan_enable_interrupt(&channel.module, MCAN_ERROR_PASSIVE);
+    mcan_enable_interrupt(&channel.module, MCAN_BUS_OFF);
+    mcan_enable_interrupt(&channel.module, MCAN_ERROR_LOGGING_OVERFLOW);
+
+    NVIC_ClearPendingIRQ(channel.irq);
+    NVIC_SetPriority(channel.irq, configMCAN_INTERRUPT_PRIORITY);
+    NVIC_EnableIRQ(channel.irq);
+
+    mcan_start(&channel.module);
+
+    channel.started = true;
+
+    return true;
+}
+
+bool mcan_rx_pop(CanChannel id, CanFrame& frame)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    return channel.priority_ring.pop(frame) || channel.ring.pop(frame);
+}
+
+CanRxStats mcan_rx_get_stats(CanChannel id)
+{
+    return mcan_channels[static_cast<size_t>(id)].stats;
+}
+
+CanBusStatus mcan_read_bus_status(CanChannel id)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    if (false == channel.started)
+    {
+        return {};
+    }
+
+    taskENTER_CRITICAL();
+    const CanBusStatus bus = mcan_update_bus_status(channel);
+    taskEXIT_CRITICAL();
+
+    return bus;
+}
+
+static bool mcan_tx_can_send(const McanChannel& channel, const CanFrame& frame)
+{
+    const bool fd = (frame.flags & can_flags::kFd) != 0U;
+
+    return channel.started && (frame.length <= (fd ? channel.config->element_data_bytes : 8U)) &&
+        ((false == fd) || (channel.config->data_bitrate != 0U));
+}
+
+static uint32_t mcan_tx_t0(const CanFrame& frame)
+{
+    const bool extended = (frame.flags & can_flags::kExtended) != 0U;
+    uint32_t t0 = extended ? (frame.id | MCAN_TX_ELEMENT_T0_XTD) : (frame.id << 18U);
+    if ((frame.flags & can_flags::kRemote) != 0U)
+    {
+        t0 |= MCAN_TX_ELEMENT_T0_RTR;
+    }
+
+    return t0;
+}
+
+static uint32_t mcan_tx_t1(const CanFrame& frame, uint32_t dlc)
+{
+    uint32_t t1 = MCAN_TX_ELEMENT_T1_DLC(dlc);
+    if ((frame.flags & can_flags::kFd) != 0U)
+    {
+        t1 |= MCAN_TX_ELEMENT_T1_FDF;
+
+        if ((frame.flags & can_flags::kBitRateSwitch) != 0U)
+        {
+            t1 |= MCAN_TX_ELEMENT_T1_BRS;
+        }
+    }
+
+    return t1;
+}
+
+bool mcan_tx_buffer_send(CanChannel id, uint32_t index, const CanFrame& frame, uint8_t marker)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    if ((index >= channel.config->tx_buffers) || (false == mcan_tx_can_send(channel, frame)) ||
+        ((channel.hw->MCAN_TXBRP & (1UL << index)) != 0U))
+    {
+        return false;
+    }
+
+    const uint32_t dlc = mcan_dlc(frame.length);
+
+    const uint32_t t0 = mcan_tx_t0(frame);
+    const uint32_t t1 = mcan_tx_t1(frame, dlc);
+
+    volatile uint32_t* element = mcan_element(channel, channel.layout.tx_buffers, index);
+    element[0] = t0;
+    element[1] = t1 | MCAN_TX_ELEMENT_T1_EFC | MCAN_TX_ELEMENT_T1_MM(marker);
+
+    // Up to the length of the DLC, the padding is whatever follows the data in the frame.
+    for (uint32_t i = 0U; (i * 4U) < kCanDlcBytes[dlc]; i++)
+    {
+        uint32_t word = 0U;
+        memcpy(&word, &frame.data[i * 4U], sizeof(word));
+        element[2U + i] = word;
+    }
+
+    // The element must be in the message RAM before the request reaches the peripheral.
+    __DMB();
+    channel.hw->MCAN_TXBAR = 1UL << index;
+
+    mcan_count_element(channel.stats.sent_buffers, t0, t1);
+
+    return true;
+}
+
+bool mcan_tx_can_send(CanChannel id, const CanFrame& frame)
+{
+    return mcan_tx_can_send(mcan_channels[static_cast<size_t>(id)], frame);
+}
+
+bool mcan_tx_fifo_send(CanChannel id, const CanFrame& frame)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    if (false == mcan_tx_can_send(channel, frame))
+    {
+        return false;
+    }
+
+    const uint32_t dlc = mcan_dlc(frame.length);
+
+    // Masks the receive interrupts, the gateway writes into the same TX FIFO.
+    taskENTER_CRITICAL();
+    const bool queued = mcan_tx_fifo_put(channel, mcan_tx_t0(frame), mcan_tx_t1(frame, dlc), &frame.data[0],
+        kCanDlcBytes[dlc]);
+    taskEXIT_CRITICAL();
+
+    return queued;
+}
+
+bool mcan_tx_fifo_wait_empty(CanChannel id, SemaphoreHandle_t semaphore)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+    auto& waiters = channel.tx_fifo_semaphores;
+
+    taskENTER_CRITICAL();
+
+    // With another task waiting already, the interrupt is enabled and any flag set is not stale.
+    const bool armed = std::any_of(waiters.begin(), waiters.end(), [](SemaphoreHandle_t waiter)
+    {
+        return waiter != nullptr;
+    });
+
+    auto slot = std::find(waiters.begin(), waiters.end(), semaphore);
+    if (slot == waiters.end())
+    {
+        slot = std::find(waiters.begin(), waiters.end(), nullptr);
+    }
+
+    configASSERT(slot != waiters.end());
+    *slot = semaphore;
+
+    if (false == armed)
+    {
+        // A stale flag from the last time the FIFO ran empty must not fire right away.
+        channel.hw->MCAN_IR = MCAN_IR_TFE;
+        mcan_enable_interrupt(&channel.module, MCAN_TX_FIFO_EMPTY);
+    }
+
+    // The FIFO may have drained before the interrupt was enabled, the flag is then set again and fires anyway.
+    const bool waiting = (mcan_tx_get_fifo_queue_status(&channel.module) & MCAN_TXFQS_TFFL_Msk) == 0U;
+    if (false == waiting)
+    {
+        *slot = nullptr;
+
+        if (false == armed)
+        {
+            mcan_disable_interrupt(&channel.module, MCAN_TX_FIFO_EMPTY);
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    return waiting;
+}
+
+bool mcan_tx_pop_event(CanChannel id, CanTxEvent& event)
+{
+    McanChannel& channel = mcan_channels[static_cast<size_t>(id)];
+
+    const uint32_t status = channel.hw->MCAN_TXEFS;
+    if ((status & MCAN_TXEFS_EFFL_Msk) == 0U)
+    {
+        return false;
+    }
+
+    const uint32_t now_cycles = cycle_timer_now();
+    const uint16_t now_timestamp = mcan_read_timestamp_count_value(&channel.module);
+
+    const uint32_t index = (status & MCAN_TXEFS_EFGI_Msk) >> MCAN_TXEFS_EFGI_Pos;
+    const uint32_t e1 = channel.ram[channel.layout.tx_events + (2U * index) + 1U];
+
+    // TXTS is the timestamp counter at the start of frame, moved onto the cycle counter as for received frames.
+    const auto tx_timestamp =
+        static_cast<uint16_t>((e1 & MCAN_TX_EVENT_ELEMENT_E1_TXTS_Msk) >> MCAN_TX_EVENT_ELEMENT_E1_TXTS_Pos);
+    const auto age = static_cast<uint16_t>(now_timestamp - tx_timestamp);
+
+    event.timestamp_cycles = now_cycles - (age * kCyclesPerCanTimestamp);
+    event.marker = static_cast<uint8_t>((e1 & MCAN_TX_EVENT_ELEMENT_E1_MM_Msk) >> MCAN_TX_EVENT_ELEMENT_E1_MM_Pos);
+
+    channel.hw->MCAN_TXEFA = MCAN_TXEFA_EFAI(index);
+
+    return true;
+}
@@ -0,0 +1,154 @@
+#ifndef MCAN_RX_H_
+#define MCAN_RX_H_
+
+#include "can_filter_planner.h"
+#include "can_frame.h"
+#include "mcan_clock.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Interrupt driven receive path for MCAN0 and MCAN1.
+ *
+ * The message RAM of each channel is laid out from its can::ChannelConfig (see mcan_ram.h), for classic CAN or CAN-FD
+ * with bit rate switching.  The acceptance filters are set up from a plan (see can_filter_planner.h) and reject every
+ * other frame.  Priority frames are stored into dedicated RX buffers, the other standard frames into RX FIFO 0 and
+ * extended frames into RX FIFO 1.  The interrupt handler drains the buffers and both FIFOs into lock-free rings per
+ * channel, stamping every frame with the cycle counter value at its start of frame, and notifies the receiving task
+ * once per batch.  The task pops the frames at its own pace, priority frames first.  Frames with a gateway route are
+ * also written into the TX FIFO of their destination channel from the interrupt handler.  Tasks queue their own
+ * frames behind them in the same TX FIFO, the put index is only ever read and advanced with the interrupt masked.
+ *
+ * The dedicated TX buffers are written one frame at a time by their single owner.  When several frames are pending,
+ * the MCAN sends the lowest identifier first, whichever buffer or FIFO it is in.  Frames sent from a TX buffer are
+ * reported back through the TX event FIFO, stamped with their start of frame.
+ *
+ * Every frame read or queued is also counted with its estimated length on the bus, for the bus load, and the error
+ * counters and states are read on every change of the error state, see can_stats.h.
+ */
+
+// 256 frames is over 25 ms of back to back frames at 500 kbit/s.
+constexpr size_t kCanRxRingSize = 256U;
+constexpr size_t kCanPriorityRingSize = 32U;
+
+// Tasks waiting at once for the TX FIFO of a channel to drain: the CAN bridge and ISO-TP.
+constexpr size_t kCanTxFifoWaiters = 2U;
+
+// Frames and their estimated length on the bus, see can_frame_bits().
+struct CanTraffic
+{
+    uint32_t frames;
+    uint32_t nominal_bits;
+    uint32_t data_bits;
+};
+
+struct CanRxStats
+{
+    uint32_t frames;            // Frames moved from the hardware FIFOs and RX buffers into the rings.
+    uint32_t batches;           // Interrupts that moved at least one frame, one task notification each.
+    uint32_t ring_overflows;    // Frames dropped because a ring was full.
+    uint32_t ring_high_water;   // Most frames ever left waiting in the RX ring by the interrupt handler.
+
+    // RX FIFO 0 and 1.
+    std::array<uint32_t, 2U> fifo_lost;         // Times the FIFO was full and lost a frame.
+    std::array<uint32_t, 2U> fifo_high_water;   // Most elements ever found in the FIFO.
+
+    // Frames sent are counted when requested, apart for each writer.
+    CanTraffic received;        // Every frame read from the message RAM, dropped or not.
+    CanTraffic sent_fifo;       // Queued into the TX FIFO, by the gateway and by tasks.
+    CanTraffic sent_buffers;    // Written into dedicated TX buffers, all from the same context.
+
+    // Error handling, see mcan_read_bus_status().
+    uint32_t errors;            // Increments of the transmit or receive error counter, from the error logging counter.
+    uint32_t warnings;          // Times either error counter reached the warning limit of 96.
+    uint32_t error_passives;    // Times the channel went error passive.
+    uint32_t bus_offs;          // Times the channel went bus off.
+    uint32_t last_error_code;   // Last protocol error, as the PSR.LEC field, 0 if none yet.
+
+    // Gateway, see can_gateway.h.
+    uint32_t forwarded;                     // Frames written into the TX FIFO of another channel.
+    uint32_t forward_drops;                 // Frames not forwarded because the destination TX FIFO was full.
+    uint32_t forward_latency_max_cycles;    // Longest time from start of frame to transmit request.
+};
+
+struct CanBusStatus
+{
+    uint32_t transmit_errors;   // TEC.
+    uint32_t receive_errors;    // REC, 128 once receive error passive.
+    uint32_t protocol_status;   // PSR, the error codes since the last read.
+};
+
+/**
+ * Initialise and start the channel, notifying the task whenever new frames are in its rings.  The plans must fit the
+ * filter elements and RX buffers of the channel configuration.
+ *
+ * \return false if the message RAM of the channel is not within a single 64 kB window.
+ */
+bool mcan_rx_init(CanChannel channel, TaskHandle_t task, const CanFilterPlan& standard, const CanFilterPlan& extended);
+
+/**
+ * Take the oldest priority frame received on the channel, or else the oldest other frame.  Only ever called from
+ * the notified task.
+ */
+bool mcan_rx_pop(CanChannel channel, CanFrame& frame);
+
+CanRxStats mcan_rx_get_stats(CanChannel channel);
+
+/**
+ * Read the error counters and protocol status of the channel, counting the errors logged and the error states entered
+ * since they were last read.  Called from tasks only.
+ */
+CanBusStatus mcan_read_bus_status(CanChannel channel);
+
+struct CanTxEvent
+{
+    // Cycle counter value at the start of frame on the bus, see cycle_timer.h.
+    uint32_t timestamp_cycles;
+
+    // Marker the frame was sent with.
+    uint8_t marker;
+};
+
+/**
+ * Write the frame into dedicated TX buffer index of the channel and request it, recording a TX event with the marker
+ * once it is sent.
+ *
+ * \return false if the channel cannot send the frame, see mcan_tx_can_send(), or the frame written last into the
+ * buffer is still pending.
+ */
+bool mcan_tx_buffer_send(CanChannel channel, uint32_t index, const CanFrame& frame, uint8_t marker);
+
+/**
+ * Whether the channel is started and can send the frame: CAN-FD frames need a channel with a data bit rate and
+ * elements large enough.
+ */
+bool mcan_tx_can_send(CanChannel channel, const CanFrame& frame);
+
+/**
+ * Queue the frame into the TX FIFO of the channel, behind the frames forwarded by the gateway.  Called from tasks
+ * only.
+ *
+ * \return false if the channel cannot send the frame, see mcan_tx_can_send(), or the TX FIFO is full.
+ */
+bool mcan_tx_fifo_send(CanChannel channel, const CanFrame& frame);
+
+/**
+ * Have the interrupt handler give the semaphore once, as soon as the TX FIFO of the channel has run empty.  Up to
+ * kCanTxFifoWaiters tasks may wait at once, each with its own semaphore.
+ *
+ * \return false, and nothing is given, if the TX FIFO has a free element already.
+ */
+bool mcan_tx_fifo_wait_empty(CanChannel channel, SemaphoreHandle_t semaphore);
+
+/**
+ * Take the oldest TX event of the channel.  Only ever called from a single context.
+ */
+bool mcan_tx_pop_event(CanChannel channel, CanTxEvent& event);
+
+#endif  // MCAN_RX_H_
@@ -0,0 +1,85 @@
+#ifndef CAN_FILTER_PLANNER_H_
+#define CAN_FILTER_PLANNER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Planner for the MCAN acceptance filters.
+ *
+ * Turns the set of identifiers a channel subscribes to into as few filter elements as possible, so the hardware
+ * rejects every other frame before it reaches a FIFO or the CPU.  Priority identifiers first get an element of their
+ * own storing them into a dedicated RX buffer.  The rest is covered exactly, with:
+ *
+ *  - one range element per run of consecutive identifiers,
+ *  - one mask element per group of 4 or more identifiers forming a bit pattern (e.g. 0x100, 0x110, 0x120, 0x130),
+ *  - one dual element per remaining pair of identifiers.
+ *
+ * When that still needs more elements than are available, the runs closest to each other are merged into ranges,
+ * accepting the fewest unwanted identifiers in between.
+ *
+ * The planner only depends on the standard library, it runs the same on the host.
+ */
+
+constexpr size_t kMaxCanFilters = 32U;
+constexpr size_t kMaxCanFilterIds = 256U;
+
+constexpr uint32_t kCanStandardIdMask = 0x7FFU;
+constexpr uint32_t kCanExtendedIdMask = 0x1FFFFFFFU;
+
+enum class CanFilterType : uint8_t
+{
+    kRange,     // id1 <= id <= id2.
+    kDual,      // id == id1 or id == id2.
+    kMask,      // (id & id2) == id1.
+    kRxBuffer,  // id == id1, stored into dedicated RX buffer id2.
+};
+
+struct CanFilter
+{
+    CanFilterType type;
+    uint32_t id1;
+    uint32_t id2;
+};
+
+struct CanFilterPlan
+{
+    std::array<CanFilter, kMaxCanFilters> filters;
+    size_t count;
+
+    // Dedicated RX buffers used, numbered from the first buffer given to the planner.
+    size_t rx_buffers;
+
+    // Identifiers accepted although nobody subscribed to them, non zero only when ranges had to be merged.
+    uint32_t extra_ids;
+};
+
+struct CanFilterRequest
+{
+    // Subscribed identifiers, in any order and possibly repeated.  Sorted in place by the planner.
+    uint32_t* ids;
+    size_t id_count;
+
+    // Subset of ids to store into dedicated RX buffers, in order of priority.
+    const uint32_t* priority_ids;
+    size_t priority_count;
+
+    uint32_t id_mask;           // kCanStandardIdMask or kCanExtendedIdMask.
+    size_t max_filters;         // Filter elements available, at most kMaxCanFilters.
+    size_t first_rx_buffer;     // First dedicated RX buffer to use.
+    size_t max_rx_buffers;      // Dedicated RX buffers available from first_rx_buffer.
+};
+
+/**
+ * \return false, with the plan left empty, if there are more than kMaxCanFilterIds identifiers or an identifier does
+ * not fit id_mask.
+ */
+bool can_filter_plan(const CanFilterRequest& request, CanFilterPlan& plan);
+
+/**
+ * Whether the plan accepts the identifier, as the hardware would.
+ */
+bool can_filter_accepts(const CanFilterPlan& plan, uint32_t id);
+
+#endif  // CAN_FILTER_PLANNER_H_
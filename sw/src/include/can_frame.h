@@ -0,0 +1,43 @@
+#ifndef CAN_FRAME_H_
+#define CAN_FRAME_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+constexpr size_t kCanChannels = 2U;
+constexpr size_t kCanMaxDataBytes = 64U;
+
+enum class CanChannel : uint8_t
+{
+    kCan0,
+    kCan1,
+};
+
+namespace can_flags
+{
+
+constexpr uint8_t kExtended = 0x01U;
+constexpr uint8_t kRemote = 0x02U;
+constexpr uint8_t kFd = 0x04U;             // CAN-FD frame format.
+constexpr uint8_t kBitRateSwitch = 0x08U;  // CAN-FD data phase sent at the data bit rate.
+
+}  // namespace can_flags
+
+struct CanFrame
+{
+    // Cycle counter value at the start of frame on the bus, see cycle_timer.h.
+    uint32_t timestamp_cycles;
+
+    // 11 or 29-bit identifier, depending on can_flags::kExtended.
+    uint32_t id;
+
+    // Bytes of data, up to 8 for classic frames.
+    uint8_t length;
+    uint8_t flags;
+    CanChannel channel;
+
+    std::array<uint8_t, kCanMaxDataBytes> data;
+};
+
+#endif  // CAN_FRAME_H_
@@ -0,0 +1,51 @@
+#ifndef CAN_GATEWAY_H_
+#define CAN_GATEWAY_H_
+
+#include "can_frame.h"
+
+#include "conf_logic.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CAN to CAN gateway.
+ *
+ * The routes of logic::kCanRoutes are compiled at build time into an array sorted by source channel and identifier,
+ * looked up with a binary search from the receive interrupt.  Matching frames are written from the received element
+ * straight into the TX FIFO of the destination channel (see mcan_rx.h), without going through any queue or task.
+ */
+
+struct CanRoute
+{
+    uint32_t key;       // See can_route_key().
+    CanChannel destination;
+    uint32_t new_id;    // logic::kCanKeepId to keep the received identifier.
+    uint8_t remap_count;
+    std::array<logic::CanSignalRemap, 4U> remaps;
+};
+
+struct CanRouteRange
+{
+    const CanRoute* first;
+    const CanRoute* last;
+};
+
+constexpr uint32_t can_route_key(CanChannel source, uint32_t id, bool extended)
+{
+    return (static_cast<uint32_t>(source) << 30U) | (extended ? (1UL << 29U) : 0U) | id;
+}
+
+/**
+ * Routes of a received frame, empty for frames that are not forwarded.
+ */
+CanRouteRange can_gateway_find(CanChannel source, uint32_t id, bool extended);
+
+/**
+ * Build the length bytes of the forwarded payload from the received one.  Remapped fields all lie in the first
+ * 8 bytes, anything after them is zero.
+ */
+void can_gateway_payload(const CanRoute& route, const uint8_t* in, uint8_t* out, size_t length);
+
+#endif  // CAN_GATEWAY_H_
@@ -0,0 +1,90 @@
+#ifndef CAN_STATS_H_
+#define CAN_STATS_H_
+
+#include "can_frame.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bus health of both CAN channels, as a compact binary snapshot served by the diagnostics service, e.g.
+ *
+ *     tools/can_stats/can_stats.py 192.168.0.100
+ *
+ * The MCAN interrupt handler counts the frames received and sent with their estimated length on the bus, the FIFO
+ * and ring high-water marks and lost frames, and reads the error counters on every change of the error state, see
+ * mcan_rx.h.  The CAN task records the latency of every frame and samples everything once per second into the
+ * snapshot, turning the counters into frames per second and bus load.  Frames rejected by the acceptance filters
+ * never reach the CPU, the bus load only counts the frames received and sent by the VCM.
+ *
+ * Every field is a 32-bit little endian integer, kCanStatsVersion changes with the layout.
+ */
+
+constexpr uint32_t kCanStatsMagic = 0x534E4143U;    // "CANS"
+constexpr uint32_t kCanStatsVersion = 1U;
+
+// Bucket 0 counts latencies below 8 us, bucket i from 2^(i + 2) us up to twice that, the last one has no bound.
+constexpr size_t kCanLatencyBuckets = 12U;
+
+struct CanChannelSnapshot
+{
+    uint32_t frames_received;
+    uint32_t frames_sent;
+
+    // Over the last second.
+    uint32_t received_per_second;
+    uint32_t sent_per_second;
+    uint32_t bus_load_permille;
+
+    uint32_t bus_load_peak_permille;
+
+    uint32_t transmit_errors;       // TEC.
+    uint32_t receive_errors;        // REC, 128 once receive error passive.
+    uint32_t protocol_status;       // PSR, with the error states in EW, EP and BO.
+    uint32_t errors;                // Increments of either error counter.
+    uint32_t warnings;              // Times the error warning state was entered.
+    uint32_t error_passives;        // Times the error passive state was entered.
+    uint32_t bus_offs;              // Times the bus off state was entered.
+    uint32_t last_error_code;       // PSR.LEC of the last protocol error.
+
+    std::array<uint32_t, 2U> fifo_high_water;   // RX FIFO 0 and 1, elements.
+    std::array<uint32_t, 2U> fifo_lost;         // RX FIFO 0 and 1, times a frame was lost.
+    uint32_t ring_high_water;
+    uint32_t ring_overflows;
+
+    // From the start of frame on the bus to the CAN task.
+    uint32_t latency_max_us;
+    std::array<uint32_t, kCanLatencyBuckets> latency_histogram;
+};
+
+struct CanStatsSnapshot
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t uptime_ms;     // When the snapshot was sampled.
+    uint32_t channels;
+    std::array<CanChannelSnapshot, kCanChannels> channel;
+};
+
+static_assert(sizeof(CanStatsSnapshot) == ((4U + (kCanChannels * (21U + kCanLatencyBuckets))) * sizeof(uint32_t)),
+    "The snapshot must not hold any padding.");
+
+/**
+ * Record the latency of a frame, from its start of frame to now.  Only ever called from the CAN task.
+ */
+void can_stats_record_latency(CanChannel channel, uint32_t latency_cycles);
+
+/**
+ * Take the snapshot, once per second.  Only ever called from the CAN task.
+ */
+void can_stats_sample();
+
+/**
+ * Copy the last snapshot into the buffer, for the diagnostics service.
+ *
+ * \return the size of the snapshot, 0 if the buffer is too small.
+ */
+size_t can_stats_format_snapshot(char* buffer, size_t size);
+
+#endif  // CAN_STATS_H_
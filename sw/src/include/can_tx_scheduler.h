@@ -0,0 +1,60 @@
+#ifndef CAN_TX_SCHEDULER_H_
+#define CAN_TX_SCHEDULER_H_
+
+#include "can_dbc.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Periodic transmission of the messages the VCM sends in the DBC, on logic::kCanTransmitChannel.
+ *
+ * TC0 interrupts every kCanTxSlotUs, independent of the FreeRTOS tick and above the kernel's interrupt priority.  Each
+ * message with a GenMsgCycleTime is encoded from the signal database and requested from the slot at its offset, then
+ * every cycle time.  The offsets are planned at build time over the hyperperiod of all cycle times: each message, the
+ * shortest cycle times first, goes where the busiest slot it lands in is the least loaded, so messages sharing a
+ * cycle time do not all go out together.
+ *
+ * Every message owns a dedicated TX buffer.  Pending buffers are sent lowest identifier first, the TX FIFO stays in
+ * FIFO mode for the gateway, the CAN bridge and ISO-TP.  A message still pending when it is due again is skipped rather
+ * than replaced.  Jitter is measured on the bus, from the start of frame timestamps of the TX event FIFO.
+ */
+
+constexpr uint32_t kCanTxSlotUs = 1000U;
+
+struct CanTxMessageStats
+{
+    uint32_t sent;                  // Frames reported sent by the TX event FIFO.
+    uint32_t skipped;               // Periods skipped because the previous frame was still pending.
+    uint32_t jitter_max_cycles;     // Largest deviation of the time between two frames from the cycle time.
+};
+
+struct CanTxStats
+{
+    uint32_t messages;                      // Messages with a cycle time.
+    uint32_t slots;                         // Timer interrupts.
+    uint32_t slot_latency_max_cycles;       // Longest time from the compare match to the interrupt handler.
+
+    // Bus load of the schedule on its own, in per mille, computed at build time from worst case frame lengths.
+    uint32_t load_permille;                 // Over the hyperperiod.
+    uint32_t peak_slot_load_permille;       // Within the busiest slot.
+    uint32_t unplanned_peak_slot_permille;  // Within the busiest slot, were every offset 0.
+};
+
+/**
+ * Start broadcasting, with the signals resolved by can_dbc::resolve_slots().  The transmit channel must be started.
+ */
+void can_tx_scheduler_start(const can_dbc::SlotTable& slots);
+
+/**
+ * Consistent snapshot of the statistics, taken with interrupts masked for a few cycles.
+ */
+CanTxStats can_tx_scheduler_get_stats();
+
+/**
+ * Consistent snapshot of the statistics of entry index of can_dbc::kTxMessages, all zero for a message without a cycle
+ * time.
+ */
+CanTxMessageStats can_tx_scheduler_get_message_stats(size_t index);
+
+#endif  // CAN_TX_SCHEDULER_H_
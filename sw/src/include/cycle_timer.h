@@ -0,0 +1,49 @@
+#ifndef CYCLE_TIMER_H_
+#define CYCLE_TIMER_H_
+
+#include "compiler.h"
+
+#include "FreeRTOSConfig.h"
+
+#include <cstdint>
+
+/**
+ * Core clock cycle timestamps from the DWT cycle counter.
+ *
+ * The counter wraps every 2^32 cycles (~14 s at 300 MHz), so only ever compare timestamps through their unsigned
+ * difference.
+ */
+
+constexpr uint32_t kCyclesPerMicrosecond = configCPU_CLOCK_HZ / 1000000UL;
+constexpr uint32_t kCyclesPerTick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+
+inline void cycle_timer_init()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+    // The Cortex-M7 DWT is locked after reset.
+    DWT->LAR = 0xC5ACCE55UL;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t cycle_timer_now()
+{
+    return DWT->CYCCNT;
+}
+
+inline uint32_t cycle_timer_elapsed(uint32_t since)
+{
+    return DWT->CYCCNT - since;
+}
+
+constexpr uint32_t cycles_to_us(uint32_t cycles)
+{
+    return cycles / kCyclesPerMicrosecond;
+}
+
+constexpr uint32_t us_to_cycles(uint32_t us)
+{
+    return us * kCyclesPerMicrosecond;
+}
+
+#endif  // CYCLE_TIMER_H_
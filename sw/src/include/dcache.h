@@ -0,0 +1,113 @@
+#ifndef DCACHE_H_
+#define DCACHE_H_
+
+#include "compiler.h"
+
+#include "conf_features.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * D-cache maintenance of the memory shared with bus masters, over the cache lines covering an address range.
+ *
+ * Memory the CPU hands to a bus master is cleaned first, so the master reads what the CPU wrote.  Memory a bus master
+ * wrote is invalidated before the CPU reads it, dropping the lines the CPU fetched, speculatively or not, while the
+ * master owned it.  Every call is a no-op while features::kEnableDCache is off.
+ *
+ * Descriptors and other structures polled by both sides belong in the non-cacheable section instead, see
+ * kDmaNoCacheSection.
+ */
+
+constexpr uint32_t kDCacheLineSize = 32U;
+
+// Linker section mapped by the MPU as normal non-cacheable memory, neither loaded nor zeroed by the startup code but
+// by board_init().  Sized by NOCACHE_SRAM_REGION_SIZE in the build options and the linker script.
+#define DMA_NOCACHE __attribute__((section(".nocache")))
+
+constexpr uintptr_t dcache_line_start(uintptr_t address)
+{
+    return address & ~static_cast<uintptr_t>(kDCacheLineSize - 1U);
+}
+
+constexpr uintptr_t dcache_line_end(uintptr_t address, size_t size)
+{
+    return dcache_line_start(address + size + kDCacheLineSize - 1U);
+}
+
+/**
+ * Write the dirty lines of the range back to memory, keeping them cached.
+ */
+inline void dcache_clean(const void* data, size_t size)
+{
+    if constexpr (features::kEnableDCache)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(data);
+
+        __DSB();
+
+        for (uintptr_t line = dcache_line_start(address); line < dcache_line_end(address, size);
+             line += kDCacheLineSize)
+        {
+            SCB->DCCMVAC = line;
+        }
+
+        __DSB();
+        __ISB();
+    }
+}
+
+/**
+ * Write the dirty lines of the range back to memory and drop them.
+ */
+inline void dcache_clean_invalidate(const void* data, size_t size)
+{
+    if constexpr (features::kEnableDCache)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(data);
+
+        __DSB();
+
+        for (uintptr_t line = dcache_line_start(address); line < dcache_line_end(address, size);
+             line += kDCacheLineSize)
+        {
+            SCB->DCCIMVAC = line;
+        }
+
+        __DSB();
+        __ISB();
+    }
+}
+
+/**
+ * Drop the lines of the range, for the next reads to come from memory.  Lines only partly covered by the range are
+ * cleaned first, the data around it survives.
+ */
+inline void dcache_invalidate(const void* data, size_t size)
+{
+    if constexpr (features::kEnableDCache)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(data);
+        const uintptr_t end = address + size;
+
+        __DSB();
+
+        for (uintptr_t line = dcache_line_start(address); line < dcache_line_end(address, size);
+             line += kDCacheLineSize)
+        {
+            if ((line < address) || ((line + kDCacheLineSize) > end))
+            {
+                SCB->DCCIMVAC = line;
+            }
+            else
+            {
+                SCB->DCIMVAC = line;
+            }
+        }
+
+        __DSB();
+        __ISB();
+    }
+}
+
+#endif  // DCACHE_H_
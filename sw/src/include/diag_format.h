@@ -0,0 +1,18 @@
+#ifndef DIAG_FORMAT_H_
+#define DIAG_FORMAT_H_
+
+#include <cstddef>
+
+/**
+ * Formatting of the plain text reports of the diagnostics service, see task_diag.h.
+ */
+
+/**
+ * Print at the end of the report of length bytes in the buffer, and move length past what was printed.  A report too
+ * long for the buffer is truncated, and length always leaves room for the terminator, so it stays 0 with an empty
+ * buffer.
+ */
+void diag_append(char* buffer, size_t size, size_t& length, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#endif  // DIAG_FORMAT_H_
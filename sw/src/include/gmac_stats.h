@@ -0,0 +1,37 @@
+#ifndef GMAC_STATS_H_
+#define GMAC_STATS_H_
+
+#include "conf_gmac_tx.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Receive and transmit paths of the GMAC driver.  The RX interrupts are masked from the first frame of a burst until
+ * the EMAC task drained the ring, which hands the frames over to the IP task in chains of up to GMAC_RX_BATCH, one
+ * event each.  Frames are sent from one TX queue per traffic class, see conf_gmac_tx.h.
+ */
+
+struct GmacStats
+{
+    uint32_t rx_interrupts;
+    uint32_t frames_received;
+    uint32_t batches;           // Events sent to the IP task.
+    uint32_t largest_batch;
+    uint32_t frames_dropped;    // No network buffer free, or the IP task queue full.
+
+    // Per TX queue, by gmac::TxClass.
+    uint32_t tx_frames[gmac::kTxClasses];
+    uint32_t tx_timeouts[gmac::kTxClasses];    // No descriptor free in time, the frame is dropped.
+};
+
+GmacStats gmac_get_stats();
+
+/**
+ * Print the statistics into the buffer, for the diagnostics service.
+ *
+ * \return the length of the report, without terminator.
+ */
+size_t gmac_format_stats(char* buffer, size_t size);
+
+#endif  // GMAC_STATS_H_
@@ -0,0 +1,17 @@
+#ifndef ISO_TP_BENCHMARK_H_
+#define ISO_TP_BENCHMARK_H_
+
+#include <cstdbool>
+
+/**
+ * ISO-TP throughput benchmark, for the bench only: CAN0 and CAN1 must be wired to the same bus.
+ *
+ * Messages of iso_tp::kMaxMessageBytes are sent back to back from session iso_tp::kBenchmarkSender on CAN0 to session
+ * iso_tp::kBenchmarkReceiver on CAN1, whose flow control sets the block size and separation time, 0 for the fastest
+ * transfer.  Every message received is checked against the one sent, and once per second the throughput is printed,
+ * from the request to send to the message received.  The sessions are classic CAN unless both channels have the same
+ * data bit rate in conf_can.h.
+ */
+bool create_task_iso_tp_benchmark();
+
+#endif  // ISO_TP_BENCHMARK_H_
@@ -0,0 +1,127 @@
+#ifndef ISO_TP_PCI_H_
+#define ISO_TP_PCI_H_
+
+#include "can_frame.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * ISO 15765-2 framing: the protocol control information of the frames of a message, and the reassembly of a message
+ * from its first and consecutive frames.
+ *
+ * Frames are encoded into and decoded from CanFrame data, classic frames of 8 bytes and CAN-FD frames of up to 64
+ * bytes alike.  There is no timing or I/O here, task_iso_tp.cpp drives it, and it runs the same on the host.
+ */
+
+constexpr size_t kIsoTpClassicFrameBytes = 8U;
+constexpr size_t kIsoTpFdFrameBytes = kCanMaxDataBytes;
+
+// Protocol control information, in the first byte of every frame.
+namespace pci
+{
+
+constexpr uint8_t kTypeMask = 0xF0U;
+constexpr uint8_t kSingleFrame = 0x00U;
+constexpr uint8_t kFirstFrame = 0x10U;
+constexpr uint8_t kConsecutiveFrame = 0x20U;
+constexpr uint8_t kFlowControl = 0x30U;
+
+// Flow status of a flow control frame.
+constexpr uint8_t kContinueToSend = 0U;
+constexpr uint8_t kWait = 1U;
+constexpr uint8_t kOverflow = 2U;
+
+// Single frames with their length in the second byte, and first frames with a 32-bit length, for CAN-FD frames and
+// messages over 4095 bytes.
+constexpr size_t kEscapeSingleFrameHeader = 2U;
+constexpr size_t kEscapeFirstFrameHeader = 6U;
+constexpr size_t kMaxFirstFrameLength = 0xFFFU;
+
+constexpr uint8_t kSequenceMask = 0x0FU;
+
+}  // namespace pci
+
+enum class IsoTpFrameType : uint8_t
+{
+    kSingle,
+    kFirst,
+    kConsecutive,
+    kFlowControl,
+    kUnknown,
+};
+
+/**
+ * The protocol control information of a received frame.
+ */
+struct IsoTpPci
+{
+    IsoTpFrameType type;
+    bool valid;             // Malformed frames are only typed.
+
+    size_t length;          // Single and first frames: length of the message.
+    size_t offset;          // Single, first and consecutive frames: first byte of the message in the frame.
+
+    uint8_t sequence;       // Consecutive frames.
+
+    uint8_t flow_status;    // Flow control frames.
+    uint8_t block_size;
+    uint8_t st_min;
+};
+
+/**
+ * A message being reassembled from its first and consecutive frames, straight into the buffer of the receiver.
+ */
+struct IsoTpReassembly
+{
+    uint8_t* data;
+    size_t length;          // Received so far.
+    size_t expected;
+    uint8_t sequence;       // Of the next consecutive frame.
+};
+
+enum class IsoTpReassemblyStatus : uint8_t
+{
+    kInProgress,
+    kComplete,
+    kSequenceError,         // A consecutive frame is missing, the message is lost.
+};
+
+IsoTpPci iso_tp_pci_decode(const CanFrame& frame);
+
+/**
+ * Encode the single frame of a message, or its first frame when it does not fit one, into a frame of frame_bytes at
+ * most.  The data past the frame length is left as it is, padding included.
+ *
+ * \return the bytes of the message carried by the frame, length when it is a single frame.
+ */
+size_t iso_tp_pci_encode_first(CanFrame& frame, size_t frame_bytes, const uint8_t* message, size_t length);
+
+/**
+ * Encode the next consecutive frame, carrying up to frame_bytes - 1 of the remaining bytes.
+ *
+ * \return the bytes of the message carried by the frame.
+ */
+size_t iso_tp_pci_encode_consecutive(CanFrame& frame, size_t frame_bytes, uint8_t sequence, const uint8_t* remaining,
+    size_t length);
+
+void iso_tp_pci_encode_flow_control(CanFrame& frame, uint8_t flow_status, uint8_t block_size, uint8_t st_min);
+
+/**
+ * Time between two consecutive frames asked by a flow control, reserved values stand for the longest.
+ */
+uint32_t iso_tp_st_min_us(uint8_t st_min);
+
+/**
+ * Start reassembling the message of a valid first frame into data, which must hold header.length bytes.
+ */
+void iso_tp_reassembly_begin(IsoTpReassembly& reassembly, uint8_t* data, const CanFrame& frame,
+    const IsoTpPci& header);
+
+/**
+ * Append the message bytes of a consecutive frame, the padding of the last one is dropped.
+ */
+IsoTpReassemblyStatus iso_tp_reassembly_add(IsoTpReassembly& reassembly, const CanFrame& frame,
+    const IsoTpPci& header);
+
+#endif  // ISO_TP_PCI_H_
@@ -0,0 +1,63 @@
+#ifndef LUA_ARENA_H_
+#define LUA_ARENA_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Deterministic allocator for the Lua VM, backed by a fixed, caller provided arena.
+ *
+ * Every request is rounded up to kLuaArenaGranularity bytes.  Blocks up to kLuaArenaMaxSmallSize bytes are served
+ * from segregated per-size free lists (one list per granule), which covers Lua's common small objects (short
+ * strings, tables, closures, upvalues) in constant time.  Larger blocks come from an address ordered, coalescing
+ * first-fit list.  Both fall back to carving fresh memory from the untouched top of the arena.
+ *
+ * Lua always passes the original block size on free/realloc, so blocks carry no header.
+ */
+
+constexpr size_t kLuaArenaGranularity = 8U;
+constexpr size_t kLuaArenaMaxSmallSize = 128U;
+constexpr size_t kLuaArenaSmallClasses = kLuaArenaMaxSmallSize / kLuaArenaGranularity;
+
+struct LuaArenaFreeBlock;
+
+struct LuaArenaStats
+{
+    size_t size_bytes;              // Total size of the arena.
+    size_t in_use_bytes;            // Bytes currently handed out to Lua.
+    size_t peak_in_use_bytes;       // Highest in_use_bytes ever seen.
+    size_t high_water_bytes;        // Highest address ever carved from the top of the arena.
+    size_t free_bytes;              // Bytes available, in free lists and at the top of the arena.
+    size_t largest_free_bytes;      // Largest single block that can currently be handed out.
+    uint32_t fragmentation_permille; // 1000 * (1 - largest_free_bytes / free_bytes).
+    uint32_t allocations;           // Number of successful allocations (including growing reallocs).
+    uint32_t failed_allocations;    // Number of requests that could not be served.
+};
+
+struct LuaArena
+{
+    uint8_t* base;
+    uint8_t* top;
+    uint8_t* high_water;            // Highest top ever, top is lowered when blocks bordering it are freed.
+    uint8_t* end;
+
+    std::array<LuaArenaFreeBlock*, kLuaArenaSmallClasses> small_free;
+    LuaArenaFreeBlock* large_free;
+
+    size_t in_use_bytes;
+    size_t peak_in_use_bytes;
+    uint32_t allocations;
+    uint32_t failed_allocations;
+};
+
+void lua_arena_init(LuaArena& arena, uint8_t* buffer, size_t size_bytes);
+
+/**
+ * lua_Alloc compatible entry point, pass a LuaArena as the user data to lua_newstate().
+ */
+void* lua_arena_alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+LuaArenaStats lua_arena_get_stats(const LuaArena& arena);
+
+#endif  // LUA_ARENA_H_
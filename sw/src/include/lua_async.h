@@ -0,0 +1,66 @@
+#ifndef LUA_ASYNC_H_
+#define LUA_ASYNC_H_
+
+#include "lua_watchdog.h"
+
+#include "FreeRTOS.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct lua_State;
+
+/**
+ * Coroutine runtime for long running sequences such as fan run-on timers or cranking logic.
+ *
+ *     spawn(function()
+ *         while true do
+ *             wait_for("engine_speed_rpm", function(rpm) return rpm == 0.0 end)
+ *             cooling_fan_request(1)
+ *             if not wait_for("engine_speed_rpm", function(rpm) return rpm > 0.0 end, 60000) then
+ *                 cooling_fan_request(0)
+ *             end
+ *         end
+ *     end)
+ *
+ * spawn(fn, ...) starts fn in a new coroutine from the next dispatch.  Inside it:
+ *   - sleep(ms) suspends for at least ms, and at least one tick.
+ *   - wait_for(signal, predicate, timeout_ms) returns the value of the signal as soon as predicate(value) holds,
+ *     checking it once right away and then whenever the signal changes.  Without predicate any change will do.  Returns
+ *     nil once timeout_ms expires, or never times out without it.
+ *   - on_signal(signal, timeout_ms) is wait_for without predicate.
+ *   - coroutine.yield() gives way until the next tick.
+ * Durations and timeouts over kLuaMaxWaitMs raise an error.
+ *
+ * Suspended coroutines with a deadline are parked in a timer wheel indexed by tick, so the Lua task only wakes up when
+ * the earliest of them is due.  Coroutines waiting on a signal are checked at the on-change polling rate, only while
+ * there are any.  Every resume runs under the watchdog, accounted to the script that spawned the coroutine.
+ */
+
+constexpr size_t kMaxLuaTasks = 32U;
+constexpr size_t kLuaTimerWheelSlots = 256U;
+
+// A week, deadlines must stay within 2^31 ticks for the wrap safe comparison of tick_reached().
+constexpr uint32_t kLuaMaxWaitMs = 7U * 24U * 3600U * 1000U;
+
+static_assert((kLuaTimerWheelSlots & (kLuaTimerWheelSlots - 1U)) == 0U, "Wheel slots must be a power of two.");
+
+/** Register spawn, sleep, wait_for and on_signal. */
+void lua_open_async(lua_State* L);
+
+/** Serial number the next spawned coroutine gets, they are handed out in increasing order. */
+uint32_t lua_async_serial();
+
+/** Stop the coroutines the script spawned before the one with the serial, e.g. after it was reloaded. */
+void lua_async_kill_before(lua_State* L, LuaScriptId script, uint32_t serial);
+
+/** Stop the coroutines the script spawned from the one with the serial on, e.g. when its load failed. */
+void lua_async_kill_since(lua_State* L, LuaScriptId script, uint32_t serial);
+
+/** Resume every coroutine whose deadline has passed or whose signal condition holds at now_ticks. */
+void lua_async_dispatch(lua_State* L, TickType_t now_ticks);
+
+/** The earliest tick a coroutine needs to be looked at, or now_ticks + idle_ticks when none does. */
+TickType_t lua_async_next_release(TickType_t now_ticks, TickType_t idle_ticks);
+
+#endif  // LUA_ASYNC_H_
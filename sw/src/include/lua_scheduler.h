@@ -0,0 +1,62 @@
+#ifndef LUA_SCHEDULER_H_
+#define LUA_SCHEDULER_H_
+
+#include "lua_watchdog.h"
+
+#include "FreeRTOS.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct lua_State;
+
+/**
+ * Multi-rate and event driven dispatch of Lua callbacks from a single task.
+ *
+ * Scripts register their callbacks while they are loaded:
+ *
+ *     every(10, function() ... end)
+ *     on_change("engine_temp_c", function(value) ... end)
+ *
+ * Once a script is loaded its callbacks are committed into a rate group table, each group holding a contiguous run
+ * of callbacks that share a release time.  Committing replaces the callbacks of an earlier load of the same script,
+ * so a script can be swapped between two dispatches.  A group without callbacks is never released, so the task only
+ * wakes up for the rates that are actually in use.  On-change callbacks are compared against the value they last saw
+ * at the on-change polling rate and only called when it differs.
+ *
+ * Every callback runs under the watchdog with half the period of its group as budget.
+ */
+
+constexpr std::array<uint32_t, 4U> kLuaRatesMs = {1U, 10U, 100U, 1000U};
+constexpr uint32_t kLuaOnChangeRateMs = 10U;
+constexpr size_t kMaxLuaCallbacks = 64U;
+
+/** Register `every` and `on_change`. */
+void lua_open_scheduler(lua_State* L);
+
+/** Open registration, the callbacks registered from now on belong to the script. */
+void lua_scheduler_begin(LuaScriptId script);
+
+/**
+ * Replace the earlier callbacks of the script with the ones registered since lua_scheduler_begin() and close
+ * registration.  Groups that had no callbacks are first released at now_ticks.
+ */
+void lua_scheduler_commit(lua_State* L, TickType_t now_ticks);
+
+/** Drop the callbacks registered since lua_scheduler_begin(), keeping the earlier ones, and close registration. */
+void lua_scheduler_rollback(lua_State* L);
+
+/** Call the callbacks of every group released at or before now_ticks. */
+void lua_scheduler_dispatch(lua_State* L, TickType_t now_ticks);
+
+/** The earliest upcoming release of any group, or now_ticks + idle_ticks when no callback is registered. */
+TickType_t lua_scheduler_next_release(TickType_t now_ticks, TickType_t idle_ticks);
+
+/** Wrap safe check whether the release time has been reached. */
+constexpr bool tick_reached(TickType_t now_ticks, TickType_t release_ticks)
+{
+    return static_cast<int32_t>(now_ticks - release_ticks) >= 0;
+}
+
+#endif  // LUA_SCHEDULER_H_
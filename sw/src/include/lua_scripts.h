@@ -0,0 +1,20 @@
+#ifndef LUA_SCRIPTS_H_
+#define LUA_SCRIPTS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lua scripts from src/scripts, precompiled on the host by the build and embedded into flash.
+ */
+struct LuaEmbeddedScript
+{
+    const char* name;
+    const uint8_t* chunk;
+    size_t size;
+};
+
+extern const LuaEmbeddedScript kLuaEmbeddedScripts[];
+extern const size_t kLuaEmbeddedScriptCount;
+
+#endif  // LUA_SCRIPTS_H_
@@ -0,0 +1,29 @@
+#ifndef LUA_SIGNALS_H_
+#define LUA_SIGNALS_H_
+
+#include "signal_db.h"
+
+struct lua_State;
+
+/**
+ * Expose the signal database to Lua.
+ *
+ * Scripts resolve a signal once, at load time, into an accessor:
+ *
+ *     local engine_temp_c = signal("engine_temp_c")
+ *     local cooling_fan_request = signal("cooling_fan_request")
+ *
+ *     function cycle()
+ *         cooling_fan_request(engine_temp_c() > 70.0)
+ *     end
+ *
+ * Calling an accessor without arguments reads the signal, calling it with a number or boolean writes it.  The
+ * accessor is a C closure holding a pointer to the signal's slot as its upvalue, so each access is one indexed load
+ * or store instead of a global table lookup by name.
+ */
+void lua_open_signals(lua_State* L);
+
+/** Resolve the argument, either a signal name or an accessor, to its slot.  Raises a Lua error otherwise. */
+SignalSlot lua_check_signal(lua_State* L, int arg);
+
+#endif  // LUA_SIGNALS_H_
@@ -0,0 +1,71 @@
+#ifndef LUA_WATCHDOG_H_
+#define LUA_WATCHDOG_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct lua_State;
+
+/**
+ * Execution budget enforcement and timing statistics for Lua scripts.
+ *
+ * A count hook runs every kLuaWatchdogHookInstructions VM instructions and compares the DWT cycle counter against the
+ * budget of the call in progress.  Once it is exceeded the call is aborted with a Lua error, raised again on every
+ * instruction until the call returns so pcall cannot catch it for good, and a runaway script loses its callback instead
+ * of starving the task.  Time spent inside a single C function is not interrupted.
+ *
+ * Every call is accounted to the script that registered it.
+ */
+
+constexpr int kLuaWatchdogHookInstructions = 1000;
+constexpr size_t kMaxLuaScripts = 16U;
+constexpr size_t kLuaScriptNameSize = 16U;
+
+using LuaScriptId = uint8_t;
+
+struct LuaScriptStats
+{
+    std::array<char, kLuaScriptNameSize> name;
+    uint32_t calls;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t overruns;
+    uint32_t errors;
+};
+
+void lua_watchdog_init(lua_State* L);
+
+/**
+ * Find the script by name, or add it to account calls to.  The name is copied, truncated if needed.  Once the table is
+ * full the last entry is shared.
+ */
+LuaScriptId lua_watchdog_add_script(const char* name);
+
+/**
+ * lua_pcall the function below its nargs arguments, aborting it after budget_cycles.
+ * Failures are printed and leave nothing on the stack.
+ *
+ * \return false if the call failed or was aborted.
+ */
+bool lua_watchdog_pcall(lua_State* L, LuaScriptId script, int nargs, uint32_t budget_cycles, int nresults = 0);
+
+/**
+ * lua_resume the thread with nargs arguments on its stack under the budget, discarding what it yields or returns.
+ * Failures are printed and popped.
+ *
+ * \return the status of lua_resume.
+ */
+int lua_watchdog_resume(lua_State* thread, lua_State* from, LuaScriptId script, int nargs, uint32_t budget_cycles);
+
+/** The script of the call in progress, or of the last one. */
+LuaScriptId lua_watchdog_current_script();
+
+/** Copy of the statistics of every script, safe to take from any task. */
+size_t lua_watchdog_get_stats(LuaScriptStats* stats, size_t max_scripts);
+
+/** Format the statistics as a text table for the diagnostics service. */
+size_t lua_watchdog_format_stats(char* buffer, size_t size);
+
+#endif  // LUA_WATCHDOG_H_
@@ -0,0 +1,241 @@
+#ifndef PTP_H_
+#define PTP_H_
+
+#include "conf_ptp.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * IEEE 802.1AS (gPTP) on a single port, over Ethernet to the 802.1AS multicast address.
+ *
+ * Both ends measure the link delay with the peer delay mechanism.  The master sends two-step Sync messages, the time
+ * the Sync left at follows in a Follow_Up, and the slave feeds its offset from the master into a PI servo driving its
+ * clock.  Times are ns of the PTP timescale on the clock of the port, the event messages (Sync, Pdelay_Req and
+ * Pdelay_Resp) timestamped by the MAC as they cross it.
+ *
+ * Portable, no FreeRTOS or ASF: the caller passes in the messages received and the hardware timestamps, sends the
+ * messages and applies the clock corrections it gets back, see task_ptp.h.  sw/tools/ptp_sim runs it natively.
+ */
+
+constexpr uint16_t kPtpEtherType = 0x88F7U;
+
+// Peer delay multicast address, every gPTP message is sent to it and none is forwarded by bridges.
+constexpr std::array<uint8_t, 6U> kPtpMulticastMac = {{0x01U, 0x80U, 0xC2U, 0x00U, 0x00U, 0x0EU}};
+
+// Follow_Up with the 802.1AS information TLV.
+constexpr size_t kPtpMaxMessageBytes = 76U;
+
+// Event message without a hardware timestamp.
+constexpr int64_t kPtpNoTimestamp = INT64_MIN;
+
+enum class PtpMessageType : uint8_t
+{
+    kSync = 0x0U,
+    kPdelayReq = 0x2U,
+    kPdelayResp = 0x3U,
+    kFollowUp = 0x8U,
+    kPdelayRespFollowUp = 0xAU,
+};
+
+struct PtpPortIdentity
+{
+    uint64_t clock_identity;
+    uint16_t port_number;
+};
+
+struct PtpMessage
+{
+    PtpMessageType type;
+    uint16_t sequence_id;
+    int8_t log_interval;
+    bool two_step;
+    int64_t correction_ns;
+    PtpPortIdentity source;
+
+    // Origin of a Sync, precise origin of a Follow_Up, request receipt of a Pdelay_Resp, response origin of a
+    // Pdelay_Resp_Follow_Up.
+    int64_t timestamp_ns;
+
+    // Pdelay_Resp and Pdelay_Resp_Follow_Up.
+    PtpPortIdentity requesting;
+};
+
+/**
+ * Encode the message, without the Ethernet header.
+ *
+ * \return the length of the message, 0 if it does not fit.
+ */
+size_t ptp_encode(const PtpMessage& message, uint8_t domain, uint8_t* data, size_t size);
+
+/**
+ * Decode a message, without the Ethernet header.
+ *
+ * \return false for a message of another domain, version or SDO, a type not handled here, or too short.
+ */
+bool ptp_decode(const uint8_t* data, size_t size, uint8_t domain, PtpMessage& message);
+
+/**
+ * EUI-64 clock identity of the EUI-48 MAC address, FF-FE in the middle.
+ */
+uint64_t ptp_clock_identity(const std::array<uint8_t, 6U>& mac);
+
+enum class PtpServoState : uint8_t
+{
+    kUnlocked,      // Waiting for two offsets to estimate the frequency from.
+    kLocked,        // PI on the offset.
+};
+
+struct PtpServo
+{
+    PtpServoState state;
+    uint32_t samples;
+    int64_t first_offset_ns;
+    int64_t first_local_ns;
+
+    // Frequency offset applied, and the integral term of the PI.
+    double frequency_ppb;
+    double integral_ppb;
+};
+
+// Corrections and messages to act upon, in this order: step the clock, set its frequency, send the messages.
+struct PtpOutput
+{
+    bool step;
+    int64_t step_ns;            // Added to the clock.
+
+    bool set_frequency;
+    double frequency_ppb;       // Offset from the nominal rate, the clock runs faster when positive.
+
+    std::array<PtpMessage, 2U> messages;
+    size_t message_count;
+};
+
+struct PtpStats
+{
+    uint32_t syncs;                 // Sync and Follow_Up pairs fed to the servo.
+    uint32_t sync_timeouts;         // Falls back to unlocked, without Sync for kSyncReceiptTimeout intervals.
+    uint32_t steps;
+    uint32_t pdelay_exchanges;      // Link delays measured.
+    uint32_t pdelay_lost;           // Requests without a complete response by the next one.
+    uint32_t responses_sent;        // Pdelay_Resp to the peer.
+    uint32_t missing_timestamps;    // Event messages without a hardware timestamp, dropped.
+    uint32_t ignored;               // Messages not expected in the role or state, or from another port.
+
+    int64_t offset_ns;              // Last offset from the master.
+    int64_t mean_link_delay_ns;
+    double neighbor_rate_ratio;
+    double frequency_ppb;
+    bool as_capable;
+    PtpServoState servo_state;
+};
+
+struct PtpPort
+{
+    ptp::Role role;
+    PtpPortIdentity identity;
+    int64_t sync_interval_ns;
+    int64_t pdelay_interval_ns;
+
+    // Master: next Sync, and the one waiting for its transmit timestamp.
+    int64_t next_sync_ns;
+    uint16_t sync_sequence;
+    bool sync_sent;
+
+    // Peer delay initiator, both roles.  The response may come before the transmit timestamp of the request.
+    int64_t next_pdelay_ns;
+    uint16_t pdelay_sequence;
+    bool pdelay_pending;
+    int64_t pdelay_t1_ns;
+    int64_t pdelay_t2_ns;
+    int64_t pdelay_t3_ns;
+    int64_t pdelay_t4_ns;
+    int64_t pdelay_resp_correction_ns;
+    bool pdelay_resp_received;
+    bool pdelay_follow_up_received;
+    uint32_t pdelay_lost_in_row;
+    bool link_delay_valid;
+    double mean_link_delay_ns;
+
+    // Previous response, for the neighbour rate ratio.
+    bool rate_reference_valid;
+    int64_t rate_reference_t3_ns;
+    int64_t rate_reference_t4_ns;
+
+    // Peer delay responder, both roles: Pdelay_Resp waiting for its transmit timestamp.
+    bool response_sent;
+    PtpMessage response;
+
+    // Slave: Sync waiting for its Follow_Up.
+    bool sync_received;
+    uint16_t sync_received_sequence;
+    int64_t sync_t2_ns;
+    int64_t sync_correction_ns;
+    PtpPortIdentity sync_source;
+    int64_t last_sync_ns;
+
+    PtpServo servo;
+    PtpStats stats;
+};
+
+void ptp_servo_reset(PtpServo& servo);
+
+/**
+ * Feed the offset of the clock from the master, measured at local time local_ns, into the servo.  Clock corrections
+ * go to output.
+ */
+void ptp_servo_sample(PtpServo& servo, int64_t offset_ns, int64_t local_ns, PtpOutput& output);
+
+void ptp_port_init(PtpPort& port, ptp::Role role, uint64_t clock_identity, int64_t now_ns);
+
+/**
+ * Send what is due at local time now_ns: Sync on the master, Pdelay_Req on both ends.  Call at least every
+ * kSlewIntervalMs.
+ */
+void ptp_port_tick(PtpPort& port, int64_t now_ns, PtpOutput& output);
+
+/**
+ * A message received, rx_timestamp_ns its hardware receive timestamp for an event message.
+ */
+void ptp_port_receive(PtpPort& port, const PtpMessage& message, int64_t rx_timestamp_ns, PtpOutput& output);
+
+/**
+ * An event message from output left, tx_timestamp_ns its hardware transmit timestamp or kPtpNoTimestamp if there was
+ * none in time.
+ */
+void ptp_port_transmitted(PtpPort& port, PtpMessageType type, uint16_t sequence_id, int64_t tx_timestamp_ns,
+    PtpOutput& output);
+
+/**
+ * Rate of a clock advancing by a fixed increment, in 2^-16 ns, every tick of its input clock: the TSU of the GMAC.
+ *
+ * The increment steps the rate by ~2.3 ppm at 150 MHz, far coarser than the servo.  The part of the frequency offset
+ * it cannot express is applied as phase instead, a few ns at a time every kSlewIntervalMs.
+ */
+struct PtpRate
+{
+    double nominal_increment;   // 2^-16 ns per tick, at 0 ppb.
+    uint32_t increment;         // Applied.
+    double residual_ppb;        // Requested, and not applied by the increment.
+    double residual_ns;         // Phase owed, below 1 ns.
+};
+
+void ptp_rate_init(PtpRate& rate, uint32_t tick_hz);
+
+/**
+ * \return the increment for the frequency offset, in 2^-16 ns per tick.
+ */
+uint32_t ptp_rate_set(PtpRate& rate, double frequency_ppb);
+
+/**
+ * \return the phase to add to the clock, in whole ns, for the residual frequency offset over elapsed_ns.
+ */
+int32_t ptp_rate_slew(PtpRate& rate, int64_t elapsed_ns);
+
+/**
+ * Cancel the phase owed, for a clock just stepped.
+ */
+void ptp_rate_clear_phase(PtpRate& rate);
+
+#endif  // PTP_H_
@@ -0,0 +1,76 @@
+#ifndef PTP_CLOCK_H_
+#define PTP_CLOCK_H_
+
+#include <cstdint>
+
+/**
+ * PTP clock of the board: the timestamp unit (TSU) of the GMAC, counting seconds and ns from the peripheral clock.
+ *
+ * The GMAC stamps the PTP event frames crossing it with the TSU, see ptp_clock_event().  As a gPTP slave the clock is
+ * stepped and its rate set by task_ptp.h, as a master it runs free.  Other tasks read the time of an event through the
+ * cycle counter, whose mapping onto the TSU is refreshed every kSlewIntervalMs, see ptp_clock_from_cycles().
+ */
+
+// Event registers of the TSU, each holding the time of the last frame of its kind.
+enum class PtpEvent : uint8_t
+{
+    kSyncRx,
+    kSyncTx,
+    kPdelayReqRx,
+    kPdelayReqTx,
+    kPdelayRespRx,
+    kPdelayRespTx,
+};
+
+constexpr uint32_t kPtpEvents = 6U;
+
+struct PtpEventTimestamp
+{
+    int64_t ns;
+    uint32_t count;     // Frames stamped so far, a timestamp is new once it changed.
+};
+
+/**
+ * Start the TSU at 0 at its nominal rate.  Call before the GMAC is enabled.
+ */
+void ptp_clock_init();
+
+/**
+ * \return the time of the TSU, in ns.
+ */
+int64_t ptp_clock_now();
+
+/**
+ * Add step_ns to the time of the TSU.
+ */
+void ptp_clock_step(int64_t step_ns);
+
+/**
+ * Run the TSU frequency_ppb away from its nominal rate, faster when positive.
+ */
+void ptp_clock_set_frequency(double frequency_ppb);
+
+/**
+ * Apply the part of the frequency offset finer than the TSU increment as phase.  Call every kSlewIntervalMs.
+ */
+void ptp_clock_slew();
+
+/**
+ * Map the cycle counter onto the TSU again, after a step and every kSlewIntervalMs.
+ */
+void ptp_clock_sample();
+
+/**
+ * \return the time of the TSU at a cycle counter value, up to a few s old.
+ */
+int64_t ptp_clock_from_cycles(uint32_t cycles);
+
+/**
+ * Latch the event registers flagged in the GMAC interrupt status.  Only ever called from the GMAC interrupt handler,
+ * before the next frame of the kind overwrites the register.
+ */
+void ptp_clock_capture_events(uint32_t isr);
+
+PtpEventTimestamp ptp_clock_event(PtpEvent event);
+
+#endif  // PTP_CLOCK_H_
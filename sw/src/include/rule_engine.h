@@ -0,0 +1,83 @@
+#ifndef RULE_ENGINE_H_
+#define RULE_ENGINE_H_
+
+#include "signal_db.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Native evaluator for output control rules such as `(engine_temp_c > 70.0f) && (vehicle_speed_mps < 5.0f)`.
+ *
+ * Rules are compiled once into a flat instruction array shared by all rules.  Every instruction writes its result
+ * into the register with its own index, so evaluating every rule is one pass over the array with no stack, no
+ * branches between rules and no allocation.  Booleans are 0.0f / 1.0f and `&&` / `||` do not short circuit, the
+ * operands have no side effects.
+ *
+ * Supported: float literals (optional `f` suffix), `true`, `false`, signal names, parentheses, unary `-` and `!`,
+ * `* /`, `+ -`, `< <= > >=`, `== !=`, `&&` and `||` with C precedence.
+ */
+
+constexpr size_t kMaxRuleInstructions = 1024U;
+
+enum class RuleOp : uint8_t
+{
+    kConst,
+    kLoad,
+    kStore,
+    kNeg,
+    kNot,
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kLt,
+    kLe,
+    kGt,
+    kGe,
+    kEq,
+    kNe,
+    kAnd,
+    kOr,
+};
+
+struct RuleInstruction
+{
+    RuleOp op;
+
+    // Register operands, or the signal slot for kLoad / kStore.
+    uint16_t a;
+    uint16_t b;
+
+    // Immediate for kConst.
+    float value;
+};
+
+struct RuleEngine
+{
+    std::array<RuleInstruction, kMaxRuleInstructions> code;
+    std::array<float, kMaxRuleInstructions> registers;
+    size_t length;
+    size_t rules;
+};
+
+struct RuleCompileError
+{
+    const char* message;
+    size_t position;
+};
+
+void rule_engine_clear(RuleEngine& engine);
+
+/**
+ * Compile the expression and append it to the engine, its result is stored into the output slot on every
+ * evaluation.  Signal names are resolved against the signal database at this point.
+ *
+ * \return false, with the engine left untouched and error filled in, if the expression could not be compiled.
+ */
+bool rule_engine_add(RuleEngine& engine, const char* expression, SignalSlot output, RuleCompileError* error);
+
+void rule_engine_evaluate(RuleEngine& engine, float* signals);
+
+#endif  // RULE_ENGINE_H_
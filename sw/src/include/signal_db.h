@@ -0,0 +1,34 @@
+#ifndef SIGNAL_DB_H_
+#define SIGNAL_DB_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Vehicle signal database.
+ *
+ * Every signal lives in one slot of a contiguous float array.  Names are only used to resolve slots when rules and
+ * scripts are loaded, after that every access is a single indexed load or store.  Slots are written by a single
+ * producer each, 32-bit float accesses are atomic on the Cortex-M7 so readers need no locking.
+ */
+
+using SignalSlot = uint16_t;
+
+constexpr SignalSlot kInvalidSignalSlot = UINT16_MAX;
+constexpr size_t kMaxSignals = 256U;
+
+/**
+ * Add a signal, or return the slot of the existing signal with the same name.
+ * The name must outlive the database, it is not copied.
+ */
+SignalSlot signal_db_add(const char* name, float initial_value = 0.0f);
+
+SignalSlot signal_db_find(const char* name);
+SignalSlot signal_db_find(const char* name, size_t length);
+
+const char* signal_db_name(SignalSlot slot);
+size_t signal_db_count();
+
+float* signal_db_values();
+
+#endif  // SIGNAL_DB_H_
@@ -0,0 +1,75 @@
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lock-free single producer, single consumer ring, typically filled from an interrupt and drained by a task.
+ *
+ * Head and tail are free running 32-bit counters, each written by one side only, so no slot is wasted to tell full
+ * from empty and neither side ever masks interrupts.  They sit on separate cache lines so the producer and consumer
+ * do not keep evicting each other's index.
+ */
+template <typename T, size_t N>
+struct SpscRing
+{
+    static_assert((N > 0U) && ((N & (N - 1U)) == 0U), "The capacity must be a power of two.");
+    static_assert(N <= (UINT32_MAX / 2U), "The capacity must fit the free running indices.");
+
+    static constexpr size_t kCapacity = N;
+    static constexpr uint32_t kMask = static_cast<uint32_t>(N - 1U);
+
+    // Cortex-M7 cache line.
+    static constexpr size_t kCacheLineSize = 32U;
+
+    /**
+     * Producer side.  Returns false, leaving the ring untouched, when it is full.
+     */
+    bool push(const T& item)
+    {
+        const uint32_t index = head.load(std::memory_order_relaxed);
+        if ((index - tail.load(std::memory_order_acquire)) >= N)
+        {
+            return false;
+        }
+
+        items[index & kMask] = item;
+        head.store(index + 1U, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Consumer side.  Returns false when the ring is empty.
+     */
+    bool pop(T& item)
+    {
+        const uint32_t index = tail.load(std::memory_order_relaxed);
+        if (index == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item = items[index & kMask];
+        tail.store(index + 1U, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Number of items waiting.  Only a snapshot, the other side may move its index at any time.
+     */
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    alignas(kCacheLineSize) std::atomic<uint32_t> head = 0U;
+    alignas(kCacheLineSize) std::atomic<uint32_t> tail = 0U;
+    alignas(kCacheLineSize) std::array<T, N> items = {};
+};
+
+#endif  // SPSC_RING_H_
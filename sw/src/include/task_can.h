@@ -0,0 +1,11 @@
+#ifndef TASK_CAN_H_
+#define TASK_CAN_H_
+
+#include <cstdbool>
+
+/**
+ * CAN receive task.  Woken once per batch of frames received on MCAN0 and MCAN1, see mcan_rx.h.
+ */
+bool create_task_can();
+
+#endif  // TASK_CAN_H_
@@ -0,0 +1,59 @@
+#ifndef TASK_CAN_BRIDGE_H_
+#define TASK_CAN_BRIDGE_H_
+
+#include "can_frame.h"
+
+#include <cstdbool>
+#include <cstdint>
+
+/**
+ * CAN to UDP bridge for the laptop tools, one UDP port per channel from kCanBridgeFirstPort, in the framing of
+ * cannelloni (version 2), e.g. on Linux
+ *
+ *     cannelloni -I vcan0 -R 192.168.0.100 -r 20000 -l 20000
+ *
+ * Frames received on a channel are packed into datagrams, each filled in place in a network buffer of the IP stack and
+ * sent without a copy once the next frame may not fit or once its first frame has waited kCanBridgeFlushTimeout.
+ * They are sent to the last peer a datagram was received from, so nothing is sent until then.  A peer sending the
+ * timestamped data op code, an extension of the framing, gets every frame preceded by its start of frame time, in
+ * microseconds of the PTP clock with features::kEnablePtp (see task_ptp.h).
+ *
+ * Frames received from the peer are queued into the TX FIFO of the channel, behind the frames of the gateway.  While
+ * the TX FIFO is full the datagram is held, and the IP stack drops further datagrams once the socket queue is full.
+ *
+ * Only the frames passing the acceptance filters of the channel reach the bridge, see can_filter_planner.h.
+ * tools/can_bridge holds a stand-in peer measuring the throughput in both directions.
+ */
+
+constexpr uint16_t kCanBridgeFirstPort = 20000U;
+
+struct CanBridgeStats
+{
+    // CAN to UDP.
+    uint32_t datagrams_sent;
+    uint32_t frames_sent;
+    uint32_t ring_overflows;        // Frames dropped because the bridge fell behind the CAN task.
+    uint32_t send_failures;         // Datagrams the IP task did not take, their frames are lost.
+
+    // UDP to CAN.
+    uint32_t datagrams_received;
+    uint32_t frames_injected;       // Frames queued into the TX FIFO.
+    uint32_t injection_errors;      // Malformed datagrams and frames the channel cannot send.
+    uint32_t tx_fifo_waits;         // Times a datagram was held until the TX FIFO had drained.
+};
+
+bool create_task_can_bridge();
+
+/**
+ * Hand a received frame over to the bridge, dropped while no peer is known.  Only ever called from the CAN task.
+ */
+void can_bridge_push(const CanFrame& frame);
+
+/**
+ * Wake the bridge up after a batch of can_bridge_push().
+ */
+void can_bridge_wake_up();
+
+CanBridgeStats can_bridge_get_stats(CanChannel channel);
+
+#endif  // TASK_CAN_BRIDGE_H_
@@ -0,0 +1,15 @@
+#ifndef TASK_DIAG_H_
+#define TASK_DIAG_H_
+
+#include <cstdbool>
+
+/**
+ * Diagnostics service.  Answers UDP datagrams on kDiagPort holding a command name with a plain text report, e.g.
+ *
+ *     echo -n lua | nc -u -w1 192.168.0.100 5002
+ *
+ * The "can" command answers with the binary snapshot of can_stats.h instead.
+ */
+bool create_task_diag();
+
+#endif  // TASK_DIAG_H_
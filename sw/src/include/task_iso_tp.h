@@ -0,0 +1,101 @@
+#ifndef TASK_ISO_TP_H_
+#define TASK_ISO_TP_H_
+
+#include "can_frame.h"
+
+#include "conf_iso_tp.h"
+
+#include "FreeRTOS.h"
+
+#include <array>
+#include <cstdbool>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * ISO-TP (ISO 15765-2) transport for the diagnostics and reflashing of the downstream ECUs, one session per ECU of
+ * iso_tp::kSessions, each sending and receiving at once.
+ *
+ * The CAN task hands the frames received on the identifier of a session over to the ISO-TP task, which reassembles
+ * multi-frame messages straight into a buffer of a pool shared by all sessions, handed over to the application as is.
+ * Messages are sent from the memory of the caller, each frame built in place in the TX FIFO of the channel, behind the
+ * frames of the gateway and the CAN bridge.  While the TX FIFO is full the ISO-TP task waits for it to drain.
+ *
+ * Separation times are timed with the cycle counter, but slept in ticks: anything below 1 ms asked by an ECU is
+ * rounded up to the next tick.  At a separation time of 0 consecutive frames are queued as fast as the TX FIFO drains.
+ *
+ * Classic sessions send frames of 8 bytes and CAN-FD sessions frames of up to 64 bytes, padded with iso_tp::kPadding.
+ * Frames received are accepted at any length, with the escape sequences of ISO 15765-2:2016.
+ */
+
+struct IsoTpBuffer
+{
+    size_t length;
+    std::array<uint8_t, iso_tp::kMaxMessageBytes> data;
+};
+
+enum class IsoTpResult : uint8_t
+{
+    kOk,
+    kBusy,          // The session is sending another message.
+    kInvalid,       // Empty message, unknown session, or the channel is not started.
+    kTimeout,       // No flow control from the ECU within iso_tp::kTimeoutMs, or no room to send within kTxTimeoutMs.
+    kOverflow,      // The ECU has no room for the message.
+    kAborted,       // Invalid flow control, or the ECU asked to wait more than iso_tp::kMaxWaits times in a row.
+};
+
+struct IsoTpStats
+{
+    uint32_t messages_sent;
+    uint32_t bytes_sent;
+    uint32_t send_errors;
+    uint32_t last_send_us;          // From the first frame queued to the last one, of the last message sent.
+
+    uint32_t messages_received;
+    uint32_t bytes_received;
+    uint32_t receive_errors;        // Malformed frames, sequence errors and timeouts.
+    uint32_t overflows;             // Messages refused, too long or no buffer free.
+    uint32_t queue_drops;           // Messages dropped because the application did not take the previous ones.
+    uint32_t ring_overflows;        // Frames dropped because the ISO-TP task fell behind the CAN task.
+    uint32_t last_receive_us;       // From the start of the first frame to the start of the last one.
+};
+
+bool create_task_iso_tp();
+
+/**
+ * Hand a received frame over to the session it is addressed to.  Only ever called from the CAN task.
+ *
+ * \return false if the frame is not for any session.
+ */
+bool iso_tp_push(const CanFrame& frame);
+
+/**
+ * Wake the ISO-TP task up after a batch of iso_tp_push().
+ */
+void iso_tp_wake_up();
+
+/**
+ * Send a message to the ECU of the session, blocking on the notification of the calling task until its last frame is
+ * queued or the transfer failed.  The data is read in place.
+ */
+IsoTpResult iso_tp_send(size_t session, const uint8_t* data, size_t length);
+
+/**
+ * Take the oldest message received on the session, waiting up to timeout_ticks for one.
+ *
+ * \return nullptr if none was received in time, else a buffer to give back with iso_tp_release().
+ */
+IsoTpBuffer* iso_tp_receive(size_t session, TickType_t timeout_ticks);
+
+void iso_tp_release(IsoTpBuffer* buffer);
+
+IsoTpStats iso_tp_get_stats(size_t session);
+
+/**
+ * Print the statistics of every session into the buffer, for the diagnostics service.
+ *
+ * \return the length of the report, without terminator.
+ */
+size_t iso_tp_format_stats(char* buffer, size_t size);
+
+#endif  // TASK_ISO_TP_H_
@@ -1,8 +1,43 @@
 #ifndef TASK_LUA_H_
 #define TASK_LUA_H_
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include <cstdbool>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A precompiled chunk to swap into the running Lua state.
+ */
+struct LuaReload
+{
+    const char* name;
+    const uint8_t* chunk;
+    size_t size;
+
+    // Filled in by the Lua task.
+    TaskHandle_t requester;
+    bool loaded;
+    uint32_t swap_cycles;
+};
 
 bool create_task_lua();
 
+/**
+ * Hand a binary chunk to the Lua task, which runs it between two scheduler cycles under the budget of a callback of
+ * the fastest rate group.  Its callbacks replace the ones of the script with the same name, or are kept out entirely
+ * when it fails.  The chunk must stay valid until this returns, and must come from the Lua compiler of the target or of
+ * the build.
+ *
+ * \return false if the Lua task did not pick the chunk up within timeout_ticks.
+ */
+bool lua_reload(LuaReload& reload, TickType_t timeout_ticks);
+
+/**
+ * Format the longest cycle of the Lua task and the statistics of every script as text for the diagnostics service.
+ */
+size_t lua_format_stats(char* buffer, size_t size);
+
 #endif  // TASK_LUA_H_
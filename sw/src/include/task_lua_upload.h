@@ -0,0 +1,21 @@
+#ifndef TASK_LUA_UPLOAD_H_
+#define TASK_LUA_UPLOAD_H_
+
+#include <cstdbool>
+
+/**
+ * Lua script upload endpoint on TCP port 5003.
+ *
+ * A client sends one `<name> <size>\n` header line followed by size bytes of Lua source, e.g.
+ *
+ *     (printf 'fan %d\n' $(stat -c %s fan.lua); cat fan.lua) | nc -N 192.168.0.100 5003
+ *
+ * The source is compiled in a scratch Lua state with its own arena, so a syntax error or an oversized script never
+ * touches the running VM.  Precompiled chunks are refused, only bytecode compiled on the target or embedded at build
+ * time is ever loaded.  The resulting bytecode is then swapped into the Lua task between two scheduler cycles, its main
+ * chunk running under the budget of a 1 ms callback, and one result line with the upload, compile and swap times is
+ * sent back.
+ */
+bool create_task_lua_upload();
+
+#endif  // TASK_LUA_UPLOAD_H_
@@ -0,0 +1,48 @@
+#ifndef TASK_PTP_H_
+#define TASK_PTP_H_
+
+#include "ptp.h"
+
+#include <cstdbool>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * gPTP (IEEE 802.1AS) on the Ethernet port, in the role of ptp::kRole, see conf_ptp.h.
+ *
+ * The IP task hands the frames of the PTP EtherType over to the PTP task, which runs the engine of ptp.h.  Event
+ * messages are stamped by the timestamp unit of the GMAC as they cross the MAC, and the interrupt handler latches the
+ * timestamps before the next frame of the same kind overwrites them, see ptp_clock.h.  A received event message takes
+ * the last timestamp of its kind, a sent one waits up to kPtpTimestampTimeoutMs for its own, polled every tick.
+ * Messages are built in network buffers and sent by the IP task, on the control queue of the GMAC.
+ *
+ * As a slave the PTP clock is stepped and its frequency set from the offsets to the master, with the part of the
+ * frequency finer than the TSU increment slewed in every kSlewIntervalMs.  The CAN and ADC timestamps are expressed in
+ * this clock.  sw/tools/ptp_sim runs the same engine against a stand-in master, for its convergence and jitter.
+ */
+
+constexpr uint32_t kPtpTimestampTimeoutMs = 5U;
+
+struct PtpTaskStats
+{
+    PtpStats port;
+
+    uint32_t frames_received;
+    uint32_t frames_sent;
+    uint32_t queue_drops;       // Frames dropped because the PTP task fell behind the IP task.
+    uint32_t send_failures;     // No network buffer, or the IP task did not take the frame.
+    uint32_t decode_errors;     // Frames of another domain, version or message type, or too short.
+};
+
+bool create_task_ptp();
+
+PtpTaskStats ptp_get_stats();
+
+/**
+ * Print the state and statistics of the port into the buffer, for the diagnostics service.
+ *
+ * \return the length of the report, without terminator.
+ */
+size_t ptp_format_stats(char* buffer, size_t size);
+
+#endif  // TASK_PTP_H_
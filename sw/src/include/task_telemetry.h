@@ -0,0 +1,62 @@
+#ifndef TASK_TELEMETRY_H_
+#define TASK_TELEMETRY_H_
+
+#include "conf_telemetry.h"
+
+#include <cstdbool>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Telemetry publisher.  Samples the signal groups of telemetry::kGroups from the signal database, each every
+ * period_ms, and sends them over UDP from and to telemetry::kPort at telemetry::kDestination, unicast or multicast.
+ *
+ * Samples are written straight into a network buffer of the IP stack and sent without a copy, once the next sample
+ * may not fit or once the first one has waited telemetry::kFlushPeriodMs.  Samples of several groups and periods
+ * share a datagram.  Without a free network buffer samples are skipped, never queued, and the GMAC sends them from the
+ * telemetry queue, behind the control frames, see conf_gmac_tx.h.
+ *
+ * Datagrams are little endian, a header then the samples back to back:
+ *
+ *     uint8_t  version            kTelemetryVersion
+ *     uint8_t  samples
+ *     uint16_t sequence           Of the datagram.
+ *
+ *     uint8_t  group              Index into telemetry::kGroups.
+ *     uint8_t  signals            Values that follow.
+ *     uint16_t sequence           Of the samples of the group, a gap is a sample lost.
+ *     uint64_t time_ns            PTP time with features::kEnablePtp, else since boot in ticks.
+ *     float    values[signals]    In the order of the group.
+ *
+ * The time spent sampling and handing the datagrams over is measured with the cycle counter, for the cost per signal
+ * published.  Sending costs the IP task and the GMAC driver about the same per datagram on top of it.
+ * sw/tools/telemetry receives and checks the datagrams and reads the cost from the diagnostics service.
+ */
+
+constexpr uint8_t kTelemetryVersion = 1U;
+
+struct TelemetryStats
+{
+    uint32_t datagrams_sent;
+    uint32_t samples_sent;
+    uint32_t signals_sent;
+    uint32_t send_failures;         // Datagrams the IP task did not take, their samples are lost.
+    uint32_t buffer_misses;         // Samples skipped for the lack of a network buffer.
+    uint32_t late_samples;          // Periods skipped because the task fell behind.
+
+    uint64_t publish_cycles;        // Sampling, serializing and sending, over every tick.
+    uint32_t max_publish_cycles;    // Of the longest tick.
+};
+
+bool create_task_telemetry();
+
+TelemetryStats telemetry_get_stats();
+
+/**
+ * Print the statistics and the cost per 1000 signals into the buffer, for the diagnostics service.
+ *
+ * \return the length of the report, without terminator.
+ */
+size_t telemetry_format_stats(char* buffer, size_t size);
+
+#endif  // TASK_TELEMETRY_H_
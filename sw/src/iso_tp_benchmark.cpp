@@ -0,0 +1,143 @@
+#include "iso_tp_benchmark.h"
+
+#include "cycle_timer.h"
+#include "task_iso_tp.h"
+
+#include "conf_iso_tp.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+constexpr const char* kIsoTpBenchmarkTaskName = "IsoTpBench";
+constexpr uint32_t kIsoTpBenchmarkTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kIsoTpBenchmarkTaskPriority = tskIDLE_PRIORITY + 1;
+
+constexpr TickType_t kIsoTpBenchmarkReportPeriod = pdMS_TO_TICKS(1000U);
+
+// The last frame is received right after it was queued, unless it got lost.
+constexpr TickType_t kIsoTpBenchmarkReceiveTimeout = pdMS_TO_TICKS(100U);
+
+static_assert(iso_tp::kSessions[iso_tp::kBenchmarkSender].channel !=
+    iso_tp::kSessions[iso_tp::kBenchmarkReceiver].channel, "Both ends of the benchmark must be on different channels.");
+
+static StackType_t iso_tp_benchmark_task_stack[kIsoTpBenchmarkTaskStackSize] = {};
+static StaticTask_t iso_tp_benchmark_task_buffer = {};
+
+static TaskHandle_t iso_tp_benchmark_task_handle = nullptr;
+
+static std::array<uint8_t, iso_tp::kMaxMessageBytes> iso_tp_benchmark_message = {};
+
+struct IsoTpBenchmarkTotals
+{
+    uint32_t messages;
+    uint32_t bytes;
+    uint64_t cycles;
+    uint32_t max_cycles;
+    uint32_t errors;
+};
+
+/**
+ * Send the message and take it back from the other end.
+ *
+ * \return false if it did not come back intact.
+ */
+static bool iso_tp_benchmark_round(uint8_t serial, uint32_t& cycles)
+{
+    // Every message differs from the last, a stale buffer would not pass.
+    iso_tp_benchmark_message[0] = serial;
+
+    const uint32_t start = cycle_timer_now();
+
+    const IsoTpResult result = iso_tp_send(iso_tp::kBenchmarkSender, iso_tp_benchmark_message.data(),
+        iso_tp_benchmark_message.size());
+    if (result != IsoTpResult::kOk)
+    {
+        printf("ISO-TP benchmark send failed: %u\r\n", static_cast<unsigned>(result));
+        return false;
+    }
+
+    IsoTpBuffer* buffer = iso_tp_receive(iso_tp::kBenchmarkReceiver, kIsoTpBenchmarkReceiveTimeout);
+    cycles = cycle_timer_elapsed(start);
+
+    if (buffer == nullptr)
+    {
+        printf("ISO-TP benchmark message lost\r\n");
+        return false;
+    }
+
+    const bool intact = (buffer->length == iso_tp_benchmark_message.size()) &&
+        (memcmp(&buffer->data[0], iso_tp_benchmark_message.data(), buffer->length) == 0);
+
+    iso_tp_release(buffer);
+
+    return intact;
+}
+
+static void task_iso_tp_benchmark(void* /*pvParameters*/)
+{
+    for (size_t i = 0U; i < iso_tp_benchmark_message.size(); i++)
+    {
+        iso_tp_benchmark_message[i] = static_cast<uint8_t>(i * 7U);
+    }
+
+    IsoTpBenchmarkTotals totals = {};
+    TickType_t last_report = xTaskGetTickCount();
+    uint8_t serial = 0U;
+
+    while (true)
+    {
+        uint32_t cycles = 0U;
+
+        if (iso_tp_benchmark_round(serial++, cycles))
+        {
+            totals.messages++;
+            totals.bytes += iso_tp_benchmark_message.size();
+            totals.cycles += cycles;
+            totals.max_cycles = (cycles > totals.max_cycles) ? cycles : totals.max_cycles;
+        }
+        else
+        {
+            totals.errors++;
+
+            // Leave the sessions time to time out.
+            vTaskDelay(pdMS_TO_TICKS(iso_tp::kTimeoutMs));
+        }
+
+        if ((xTaskGetTickCount() - last_report) < kIsoTpBenchmarkReportPeriod)
+        {
+            continue;
+        }
+
+        last_report = xTaskGetTickCount();
+
+        const uint64_t us = totals.cycles / kCyclesPerMicrosecond;
+        const uint32_t bytes_per_second = (us > 0U) ? static_cast<uint32_t>((totals.bytes * 1000000ULL) / us) : 0U;
+        const uint32_t mean_us = (totals.messages > 0U) ? static_cast<uint32_t>(us / totals.messages) : 0U;
+
+        printf("ISO-TP benchmark: %u messages of %u bytes, %u bytes/s, %u us mean, %u us max, %u errors\r\n",
+            static_cast<unsigned>(totals.messages), static_cast<unsigned>(iso_tp_benchmark_message.size()),
+            static_cast<unsigned>(bytes_per_second), static_cast<unsigned>(mean_us),
+            static_cast<unsigned>(cycles_to_us(totals.max_cycles)), static_cast<unsigned>(totals.errors));
+
+        totals = {};
+    }
+}
+
+bool create_task_iso_tp_benchmark()
+{
+    iso_tp_benchmark_task_handle = xTaskCreateStatic(
+        &task_iso_tp_benchmark,
+        kIsoTpBenchmarkTaskName,
+        kIsoTpBenchmarkTaskStackSize,
+        nullptr,
+        kIsoTpBenchmarkTaskPriority,
+        &iso_tp_benchmark_task_stack[0],
+        &iso_tp_benchmark_task_buffer
+    );
+
+    return iso_tp_benchmark_task_handle != nullptr;
+}
@@ -0,0 +1,199 @@
+#include "iso_tp_pci.h"
+
+#include <algorithm>
+#include <cstring>
+
+IsoTpPci iso_tp_pci_decode(const CanFrame& frame)
+{
+    IsoTpPci header = {};
+    header.type = IsoTpFrameType::kUnknown;
+
+    if (frame.length == 0U)
+    {
+        return header;
+    }
+
+    const uint8_t low = frame.data[0] & ~pci::kTypeMask;
+
+    switch (frame.data[0] & pci::kTypeMask)
+    {
+        case pci::kSingleFrame:
+            header.type = IsoTpFrameType::kSingle;
+            header.length = low;
+            header.offset = 1U;
+
+            // The escape sequence for lengths over 7 bytes, only in CAN-FD frames.
+            if ((header.length == 0U) && (frame.length > kIsoTpClassicFrameBytes))
+            {
+                header.length = frame.data[1];
+                header.offset = pci::kEscapeSingleFrameHeader;
+            }
+
+            header.valid = (header.length > 0U) && ((header.offset + header.length) <= frame.length);
+            break;
+
+        case pci::kFirstFrame:
+            header.type = IsoTpFrameType::kFirst;
+
+            if (frame.length < kIsoTpClassicFrameBytes)
+            {
+                break;
+            }
+
+            header.length = (static_cast<size_t>(low) << 8U) | frame.data[1];
+            header.offset = 2U;
+
+            if (header.length == 0U)
+            {
+                header.length = (static_cast<size_t>(frame.data[2]) << 24U) |
+                    (static_cast<size_t>(frame.data[3]) << 16U) | (static_cast<size_t>(frame.data[4]) << 8U) |
+                    frame.data[5];
+                header.offset = pci::kEscapeFirstFrameHeader;
+            }
+
+            // A message fitting the first frame is sent as a single frame.
+            header.valid = header.length > (frame.length - header.offset);
+            break;
+
+        case pci::kConsecutiveFrame:
+            header.type = IsoTpFrameType::kConsecutive;
+            header.sequence = low;
+            header.offset = 1U;
+            header.valid = true;
+            break;
+
+        case pci::kFlowControl:
+            header.type = IsoTpFrameType::kFlowControl;
+
+            if (frame.length >= 3U)
+            {
+                header.flow_status = low;
+                header.block_size = frame.data[1];
+                header.st_min = frame.data[2];
+                header.valid = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return header;
+}
+
+size_t iso_tp_pci_encode_first(CanFrame& frame, size_t frame_bytes, const uint8_t* message, size_t length)
+{
+    size_t offset = 0U;
+    size_t carried = 0U;
+
+    if (length < frame_bytes)
+    {
+        // Single frame, with the escape sequence for lengths over 7 bytes.
+        if (length < kIsoTpClassicFrameBytes)
+        {
+            frame.data[offset++] = pci::kSingleFrame | static_cast<uint8_t>(length);
+        }
+        else
+        {
+            frame.data[offset++] = pci::kSingleFrame;
+            frame.data[offset++] = static_cast<uint8_t>(length);
+        }
+
+        carried = std::min(length, frame_bytes - offset);
+        frame.length = static_cast<uint8_t>(std::max(offset + carried, kIsoTpClassicFrameBytes));
+    }
+
+    // Also when the message is one byte short of a CAN-FD frame, a single frame cannot fit it with its escape sequence.
+    if (carried < length)
+    {
+        // First frame, with the escape sequence for lengths over 4095 bytes.
+        offset = 0U;
+
+        if (length <= pci::kMaxFirstFrameLength)
+        {
+            frame.data[offset++] = pci::kFirstFrame | static_cast<uint8_t>(length >> 8U);
+            frame.data[offset++] = static_cast<uint8_t>(length);
+        }
+        else
+        {
+            frame.data[offset++] = pci::kFirstFrame;
+            frame.data[offset++] = 0U;
+            frame.data[offset++] = static_cast<uint8_t>(length >> 24U);
+            frame.data[offset++] = static_cast<uint8_t>(length >> 16U);
+            frame.data[offset++] = static_cast<uint8_t>(length >> 8U);
+            frame.data[offset++] = static_cast<uint8_t>(length);
+        }
+
+        carried = frame_bytes - offset;
+        frame.length = static_cast<uint8_t>(frame_bytes);
+    }
+
+    memcpy(&frame.data[offset], message, carried);
+
+    return carried;
+}
+
+size_t iso_tp_pci_encode_consecutive(CanFrame& frame, size_t frame_bytes, uint8_t sequence, const uint8_t* remaining,
+    size_t length)
+{
+    const size_t carried = std::min(length, frame_bytes - 1U);
+
+    frame.data[0] = pci::kConsecutiveFrame | (sequence & pci::kSequenceMask);
+    memcpy(&frame.data[1], remaining, carried);
+    frame.length = static_cast<uint8_t>(std::max(carried + 1U, kIsoTpClassicFrameBytes));
+
+    return carried;
+}
+
+void iso_tp_pci_encode_flow_control(CanFrame& frame, uint8_t flow_status, uint8_t block_size, uint8_t st_min)
+{
+    frame.data[0] = pci::kFlowControl | flow_status;
+    frame.data[1] = block_size;
+    frame.data[2] = st_min;
+    frame.length = std::max<uint8_t>(frame.length, 3U);
+}
+
+uint32_t iso_tp_st_min_us(uint8_t st_min)
+{
+    if (st_min <= 0x7FU)
+    {
+        return st_min * 1000UL;
+    }
+
+    if ((st_min >= 0xF1U) && (st_min <= 0xF9U))
+    {
+        return (st_min - 0xF0UL) * 100UL;
+    }
+
+    return 0x7FUL * 1000UL;
+}
+
+void iso_tp_reassembly_begin(IsoTpReassembly& reassembly, uint8_t* data, const CanFrame& frame,
+    const IsoTpPci& header)
+{
+    const size_t received = frame.length - header.offset;
+    memcpy(data, &frame.data[header.offset], received);
+
+    reassembly.data = data;
+    reassembly.length = received;
+    reassembly.expected = header.length;
+    reassembly.sequence = 1U;
+}
+
+IsoTpReassemblyStatus iso_tp_reassembly_add(IsoTpReassembly& reassembly, const CanFrame& frame,
+    const IsoTpPci& header)
+{
+    if (header.sequence != reassembly.sequence)
+    {
+        return IsoTpReassemblyStatus::kSequenceError;
+    }
+
+    const size_t length = std::min<size_t>(reassembly.expected - reassembly.length, frame.length - header.offset);
+    memcpy(&reassembly.data[reassembly.length], &frame.data[header.offset], length);
+    reassembly.length += length;
+
+    reassembly.sequence = (reassembly.sequence + 1U) & pci::kSequenceMask;
+
+    return (reassembly.length == reassembly.expected) ? IsoTpReassemblyStatus::kComplete :
+        IsoTpReassemblyStatus::kInProgress;
+}
@@ -25,6 +25,7 @@ typedef struct {
   void *data;
   int strip;
   int status;
+  size_t offset;  /* bytes written so far, to align code arrays */
 } DumpState;
 
 
@@ -42,6 +43,7 @@ static void dumpBlock (DumpState *D, const void *b, size_t size) {
     lua_unlock(D->L);
     D->status = (*D->writer)(D->L, b, size, D->data);
     lua_lock(D->L);
+    D->offset += size;
   }
 }
 
@@ -97,8 +99,23 @@ static void dumpString (DumpState *D, const TString *s) {
 }
 
 
+/*
+** Pad the chunk so that the next item starts at a multiple of 'align'
+** from its beginning.  The padding length goes first, so the loader can
+** skip it without knowing its own position.
+*/
+static void dumpAlign (DumpState *D, size_t align) {
+  static const char zeros[sizeof(Instruction)] = {0};
+  size_t pad = (align - (D->offset + 1) % align) % align;
+  lua_assert(pad < sizeof(zeros));
+  dumpByte(D, cast_int(pad));
+  dumpBlock(D, zeros, pad);
+}
+
+
 static void dumpCode (DumpState *D, const Proto *f) {
   dumpInt(D, f->sizecode);
+  dumpAlign(D, sizeof(Instruction));
   dumpVector(D, f->code, f->sizecode);
 }
 
@@ -218,6 +235,7 @@ int luaU_dump(lua_State *L, const Proto *f, lua_Writer w, void *data,
   D.data = data;
   D.strip = strip;
   D.status = 0;
+  D.offset = 0;
   dumpHeader(&D);
   dumpByte(&D, f->sizeupvalues);
   dumpFunction(&D, f, NULL);
@@ -768,6 +768,20 @@
 ** without modifying the main part of the file.
 */
 
+/*
+@@ luai_inrom is true when 'p' points into read-only memory that outlives
+** every Lua state, such as the flash of a microcontroller.  Precompiled
+** chunks loaded from there keep their code and line information in place
+** instead of copying them.  Define LUAI_ROM_BEGIN and LUAI_ROM_END to the
+** bounds of that memory to enable it.
+*/
+#if defined(LUAI_ROM_BEGIN) && defined(LUAI_ROM_END)
+#define luai_inrom(p)	((size_t)(p) >= (size_t)(LUAI_ROM_BEGIN) && \
+			 (size_t)(p) < (size_t)(LUAI_ROM_END))
+#else
+#define luai_inrom(p)	0
+#endif
+
 
 
 
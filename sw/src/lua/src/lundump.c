@@ -58,6 +58,24 @@ static void loadBlock (LoadState *S, void *b, size_t size) {
 #define loadVar(S,x)		loadVector(S,&x,1)
 
 
+/*
+** Return the next 'size' bytes of the chunk and skip over them when they
+** can be used in place: they are contiguous in the current buffer, aligned
+** to 'align' and in read-only memory that outlives the state (see
+** 'luai_inrom').  Return NULL otherwise.
+*/
+static const char *mapBlock (LoadState *S, size_t size, size_t align) {
+  const char *p = S->Z->p;
+  if (size > 0 && S->Z->n >= size && luai_inrom(p) &&
+      (size_t)p % align == 0) {
+    S->Z->p += size;
+    S->Z->n -= size;
+    return p;
+  }
+  return NULL;
+}
+
+
 static lu_byte loadByte (LoadState *S) {
   int b = zgetc(S->Z);
   if (b == EOZ)
@@ -140,9 +158,22 @@ static TString *loadString (LoadState *S, Proto *p) {
 
 static void loadCode (LoadState *S, Proto *f) {
   int n = loadInt(S);
-  f->code = luaM_newvectorchecked(S->L, n, Instruction);
-  f->sizecode = n;
-  loadVector(S, f->code, n);
+  const char *p;
+  char pad[sizeof(Instruction)];
+  size_t npad = loadByte(S);
+  if (npad >= sizeof(pad))
+    error(S, "bad code alignment");
+  loadBlock(S, pad, npad);
+  p = mapBlock(S, n * sizeof(Instruction), sizeof(Instruction));
+  if (p != NULL) {
+    f->code = cast(Instruction *, p);  /* never written nor freed */
+    f->sizecode = n;
+  }
+  else {
+    f->code = luaM_newvectorchecked(S->L, n, Instruction);
+    f->sizecode = n;
+    loadVector(S, f->code, n);
+  }
 }
 
 
@@ -216,10 +247,16 @@ static void loadUpvalues (LoadState *S, Proto *f) {
 
 static void loadDebug (LoadState *S, Proto *f) {
   int i, n;
+  const char *p;
   n = loadInt(S);
-  f->lineinfo = luaM_newvectorchecked(S->L, n, ls_byte);
+  p = mapBlock(S, n, 1);
+  if (p != NULL)
+    f->lineinfo = cast(ls_byte *, p);
+  else {
+    f->lineinfo = luaM_newvectorchecked(S->L, n, ls_byte);
+    loadVector(S, f->lineinfo, n);
+  }
   f->sizelineinfo = n;
-  loadVector(S, f->lineinfo, n);
   n = loadInt(S);
   f->abslineinfo = luaM_newvectorchecked(S->L, n, AbsLineInfo);
   f->sizeabslineinfo = n;
@@ -0,0 +1,308 @@
+#include "lua_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+struct LuaArenaFreeBlock
+{
+    LuaArenaFreeBlock* next;
+
+    // Only maintained for blocks on the large free list, small blocks are sized by their list.
+    size_t size;
+};
+
+static_assert(kLuaArenaGranularity >= sizeof(LuaArenaFreeBlock*), "Small blocks must be able to hold a link.");
+static_assert(kLuaArenaMaxSmallSize >= sizeof(LuaArenaFreeBlock), "Large blocks must be able to hold a header.");
+
+static constexpr size_t round_up(size_t size)
+{
+    return (size + (kLuaArenaGranularity - 1U)) & ~(kLuaArenaGranularity - 1U);
+}
+
+static constexpr size_t small_class_index(size_t size)
+{
+    return (size / kLuaArenaGranularity) - 1U;
+}
+
+static uint8_t* carve_top(LuaArena& arena, size_t size)
+{
+    uint8_t* ret = nullptr;
+
+    if (size <= static_cast<size_t>(arena.end - arena.top))
+    {
+        ret = arena.top;
+        arena.top += size;
+        arena.high_water = std::max(arena.high_water, arena.top);
+    }
+
+    return ret;
+}
+
+/**
+ * Put the large block back into the address ordered free list, merging it with its neighbours and handing it back
+ * to the top of the arena when it borders it.
+ */
+static void release_large(LuaArena& arena, uint8_t* ptr, size_t size)
+{
+    LuaArenaFreeBlock* prev = nullptr;
+    LuaArenaFreeBlock* next = arena.large_free;
+
+    while ((next != nullptr) && (reinterpret_cast<uint8_t*>(next) < ptr))
+    {
+        prev = next;
+        next = next->next;
+    }
+
+    if ((ptr + size) == arena.top)
+    {
+        arena.top = ptr;
+
+        // The block before may now border the top as well.
+        if ((prev != nullptr) && ((reinterpret_cast<uint8_t*>(prev) + prev->size) == arena.top))
+        {
+            arena.top = reinterpret_cast<uint8_t*>(prev);
+
+            LuaArenaFreeBlock** link = &arena.large_free;
+            while (*link != prev)
+            {
+                link = &((*link)->next);
+            }
+            *link = prev->next;
+        }
+
+        return;
+    }
+
+    auto* block = reinterpret_cast<LuaArenaFreeBlock*>(ptr);
+    block->size = size;
+    block->next = next;
+
+    if ((next != nullptr) && ((ptr + size) == reinterpret_cast<uint8_t*>(next)))
+    {
+        block->size += next->size;
+        block->next = next->next;
+    }
+
+    if ((prev != nullptr) && ((reinterpret_cast<uint8_t*>(prev) + prev->size) == ptr))
+    {
+        prev->size += block->size;
+        prev->next = block->next;
+    }
+    else if (prev != nullptr)
+    {
+        prev->next = block;
+    }
+    else
+    {
+        arena.large_free = block;
+    }
+}
+
+static void release(LuaArena& arena, uint8_t* ptr, size_t size)
+{
+    if (size <= kLuaArenaMaxSmallSize)
+    {
+        auto* block = reinterpret_cast<LuaArenaFreeBlock*>(ptr);
+        const size_t index = small_class_index(size);
+
+        block->next = arena.small_free[index];
+        arena.small_free[index] = block;
+    }
+    else
+    {
+        release_large(arena, ptr, size);
+    }
+}
+
+static uint8_t* take_large(LuaArena& arena, size_t size)
+{
+    LuaArenaFreeBlock** link = &arena.large_free;
+
+    while (*link != nullptr)
+    {
+        LuaArenaFreeBlock* block = *link;
+
+        if (block->size >= size)
+        {
+            const size_t remainder = block->size - size;
+            *link = block->next;
+
+            auto* ptr = reinterpret_cast<uint8_t*>(block);
+            if (remainder > 0U)
+            {
+                release(arena, ptr + size, remainder);
+            }
+
+            return ptr;
+        }
+
+        link = &(block->next);
+    }
+
+    return nullptr;
+}
+
+static uint8_t* allocate(LuaArena& arena, size_t size)
+{
+    uint8_t* ret = nullptr;
+
+    if (size <= kLuaArenaMaxSmallSize)
+    {
+        const size_t index = small_class_index(size);
+
+        if (arena.small_free[index] != nullptr)
+        {
+            ret = reinterpret_cast<uint8_t*>(arena.small_free[index]);
+            arena.small_free[index] = arena.small_free[index]->next;
+        }
+        else
+        {
+            ret = carve_top(arena, size);
+            if (ret == nullptr)
+            {
+                ret = take_large(arena, size);
+            }
+        }
+    }
+    else
+    {
+        ret = take_large(arena, size);
+        if (ret == nullptr)
+        {
+            ret = carve_top(arena, size);
+        }
+    }
+
+    if (ret != nullptr)
+    {
+        arena.allocations++;
+    }
+    else
+    {
+        arena.failed_allocations++;
+    }
+
+    return ret;
+}
+
+static void account(LuaArena& arena, size_t freed, size_t allocated)
+{
+    arena.in_use_bytes = arena.in_use_bytes - freed + allocated;
+    arena.peak_in_use_bytes = std::max(arena.peak_in_use_bytes, arena.in_use_bytes);
+}
+
+void lua_arena_init(LuaArena& arena, uint8_t* buffer, size_t size_bytes)
+{
+    // Keep every block aligned to the granularity, whatever the caller handed in.
+    const auto misalignment = reinterpret_cast<uintptr_t>(buffer) & (kLuaArenaGranularity - 1U);
+    const size_t skip = (misalignment != 0U) ? (kLuaArenaGranularity - misalignment) : 0U;
+
+    arena = {};
+    arena.base = buffer + skip;
+    arena.top = arena.base;
+    arena.high_water = arena.base;
+    arena.end = arena.base + ((size_bytes - skip) & ~(kLuaArenaGranularity - 1U));
+}
+
+void* lua_arena_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    auto& arena = *static_cast<LuaArena*>(ud);
+    auto* block = static_cast<uint8_t*>(ptr);
+
+    // When ptr is null, osize encodes the type of object being allocated, not a size.
+    const size_t old_size = (block != nullptr) ? round_up(osize) : 0U;
+    const size_t new_size = round_up(nsize);
+
+    if (new_size == 0U)
+    {
+        if (block != nullptr)
+        {
+            release(arena, block, old_size);
+            account(arena, old_size, 0U);
+        }
+
+        return nullptr;
+    }
+
+    if (block == nullptr)
+    {
+        block = allocate(arena, new_size);
+        if (block != nullptr)
+        {
+            account(arena, 0U, new_size);
+        }
+
+        return block;
+    }
+
+    if (new_size <= old_size)
+    {
+        // Shrinking never fails, the tail simply goes back to the matching free list.
+        if (new_size < old_size)
+        {
+            release(arena, block + new_size, old_size - new_size);
+            account(arena, old_size, new_size);
+        }
+
+        return block;
+    }
+
+    // Grow in place when the block borders the untouched top of the arena.
+    if (((block + old_size) == arena.top) && (carve_top(arena, new_size - old_size) != nullptr))
+    {
+        arena.allocations++;
+        account(arena, old_size, new_size);
+        return block;
+    }
+
+    // On failure the original block must be left untouched for Lua.
+    uint8_t* grown = allocate(arena, new_size);
+    if (grown != nullptr)
+    {
+        memcpy(grown, block, old_size);
+        release(arena, block, old_size);
+        account(arena, old_size, new_size);
+    }
+
+    return grown;
+}
+
+LuaArenaStats lua_arena_get_stats(const LuaArena& arena)
+{
+    LuaArenaStats stats = {};
+
+    stats.size_bytes = static_cast<size_t>(arena.end - arena.base);
+    stats.in_use_bytes = arena.in_use_bytes;
+    stats.peak_in_use_bytes = arena.peak_in_use_bytes;
+    stats.high_water_bytes = static_cast<size_t>(arena.high_water - arena.base);
+    stats.allocations = arena.allocations;
+    stats.failed_allocations = arena.failed_allocations;
+
+    stats.free_bytes = static_cast<size_t>(arena.end - arena.top);
+    stats.largest_free_bytes = stats.free_bytes;
+
+    for (size_t index = 0U; index < arena.small_free.size(); index++)
+    {
+        const size_t class_size = (index + 1U) * kLuaArenaGranularity;
+
+        for (const LuaArenaFreeBlock* block = arena.small_free[index]; block != nullptr; block = block->next)
+        {
+            stats.free_bytes += class_size;
+            stats.largest_free_bytes = std::max(stats.largest_free_bytes, class_size);
+        }
+    }
+
+    for (const LuaArenaFreeBlock* block = arena.large_free; block != nullptr; block = block->next)
+    {
+        stats.free_bytes += block->size;
+        stats.largest_free_bytes = std::max(stats.largest_free_bytes, block->size);
+    }
+
+    if (stats.free_bytes > 0U)
+    {
+        stats.fragmentation_permille = static_cast<uint32_t>(
+            1000U - ((static_cast<uint64_t>(stats.largest_free_bytes) * 1000U) / stats.free_bytes));
+    }
+
+    return stats;
+}
@@ -0,0 +1,455 @@
+#include "lua_async.h"
+
+#include "cycle_timer.h"
+#include "lua_scheduler.h"
+#include "lua_signals.h"
+#include "signal_db.h"
+
+#include "task.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+#include <array>
+
+constexpr TickType_t kSignalRateTicks = pdMS_TO_TICKS(kLuaOnChangeRateMs);
+constexpr uint32_t kLuaTaskBudgetCycles = us_to_cycles(5000U);
+constexpr TickType_t kWheelMask = kLuaTimerWheelSlots - 1U;
+
+enum class LuaTaskState : uint8_t
+{
+    kFree,
+    kRunning,
+    kSleeping,
+    kWaiting,
+};
+
+struct LuaTask
+{
+    lua_State* thread;
+    int thread_ref;
+    uint32_t serial;
+    LuaScriptId script;
+    LuaTaskState state;
+
+    // Arguments of spawn() still waiting on the stack of a coroutine that has not started yet.
+    int start_args;
+
+    // On the wheel while timed, linked through next.
+    bool timed;
+    TickType_t deadline_ticks;
+    LuaTask* next;
+
+    // Only used while waiting.
+    SignalSlot signal;
+    float last_value;
+    int predicate_ref;
+};
+
+static std::array<LuaTask, kMaxLuaTasks> tasks = {};
+static std::array<LuaTask*, kLuaTimerWheelSlots> wheel = {};
+
+// Next tick whose wheel slot has not been expired yet.
+static TickType_t wheel_ticks = 0U;
+
+static uint32_t next_serial = 0U;
+static size_t waiting_count = 0U;
+static TickType_t signal_release_ticks = 0U;
+
+static LuaTask* current_task(lua_State* L)
+{
+    return *static_cast<LuaTask**>(lua_getextraspace(L));
+}
+
+static_assert(((static_cast<uint64_t>(kLuaMaxWaitMs) * configTICK_RATE_HZ) / 1000U) < INT32_MAX,
+    "The longest wait must fit the wrap safe tick comparison.");
+
+/**
+ * Deadline of the duration in ms at arg, at least one tick away.  Raises a Lua error unless it is within
+ * 0..kLuaMaxWaitMs.
+ */
+static TickType_t check_deadline(lua_State* L, int arg)
+{
+    const lua_Integer ms = luaL_checkinteger(L, arg);
+    luaL_argcheck(L, (ms >= 0) && (ms <= static_cast<lua_Integer>(kLuaMaxWaitMs)), arg, "duration out of range");
+
+    // pdMS_TO_TICKS() would overflow 32 bits past 4294967 ms at 1 kHz.
+    const auto ticks = static_cast<TickType_t>((static_cast<uint64_t>(ms) * configTICK_RATE_HZ) / 1000U);
+
+    return xTaskGetTickCount() + ((ticks > 0U) ? ticks : 1U);
+}
+
+static void wheel_insert(LuaTask& task, TickType_t deadline_ticks)
+{
+    LuaTask*& head = wheel[deadline_ticks & kWheelMask];
+
+    task.timed = true;
+    task.deadline_ticks = deadline_ticks;
+    task.next = head;
+    head = &task;
+}
+
+static void wheel_remove(LuaTask& task)
+{
+    if (!task.timed)
+    {
+        return;
+    }
+
+    LuaTask** link = &wheel[task.deadline_ticks & kWheelMask];
+    while (*link != &task)
+    {
+        link = &((*link)->next);
+    }
+
+    *link = task.next;
+    task.next = nullptr;
+    task.timed = false;
+}
+
+/**
+ * Take the task off the wheel and the signal waiters.
+ */
+static void unpark(lua_State* L, LuaTask& task)
+{
+    wheel_remove(task);
+
+    if (task.state == LuaTaskState::kWaiting)
+    {
+        waiting_count--;
+        luaL_unref(L, LUA_REGISTRYINDEX, task.predicate_ref);
+        task.predicate_ref = LUA_NOREF;
+    }
+}
+
+static void release(lua_State* L, LuaTask& task)
+{
+    unpark(L, task);
+
+    lua_resetthread(task.thread);
+    luaL_unref(L, LUA_REGISTRYINDEX, task.thread_ref);
+
+    task = {};
+}
+
+/**
+ * Resume the task with the values pushed onto its stack, parking it again or releasing it depending on how it stops.
+ */
+static void wake(lua_State* L, LuaTask& task, int pushed)
+{
+    const int nargs = pushed + task.start_args;
+    task.start_args = 0;
+    task.state = LuaTaskState::kRunning;
+
+    const int status = lua_watchdog_resume(task.thread, L, task.script, nargs, kLuaTaskBudgetCycles);
+
+    if (LUA_YIELD != status)
+    {
+        release(L, task);
+    }
+    else if (task.state == LuaTaskState::kRunning)
+    {
+        // A plain coroutine.yield() gives way until the next tick.
+        task.state = LuaTaskState::kSleeping;
+        wheel_insert(task, xTaskGetTickCount() + 1U);
+    }
+}
+
+static LuaTask& check_task(lua_State* L, const char* function)
+{
+    LuaTask* task = current_task(L);
+
+    if (task == nullptr)
+    {
+        luaL_error(L, "%s can only be called from a coroutine started by spawn", function);
+    }
+
+    return *task;
+}
+
+static int async_spawn(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+
+    LuaTask* task = nullptr;
+    for (auto& candidate : tasks)
+    {
+        if (candidate.state == LuaTaskState::kFree)
+        {
+            task = &candidate;
+            break;
+        }
+    }
+
+    if (task == nullptr)
+    {
+        return luaL_error(L, "too many coroutines");
+    }
+
+    const int nargs = lua_gettop(L) - 1;
+
+    // Move the function and its arguments over to the new thread, which stays referenced from the registry.
+    lua_State* thread = lua_newthread(L);
+    *static_cast<LuaTask**>(lua_getextraspace(thread)) = task;
+    lua_insert(L, 1);
+    lua_xmove(L, thread, nargs + 1);
+
+    *task = {};
+    task->thread = thread;
+    task->thread_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    task->serial = next_serial++;
+    task->script = lua_watchdog_current_script();
+    task->state = LuaTaskState::kSleeping;
+    task->start_args = nargs;
+    task->predicate_ref = LUA_NOREF;
+    wheel_insert(*task, xTaskGetTickCount() + 1U);
+
+    return 0;
+}
+
+static int async_sleep(lua_State* L)
+{
+    LuaTask& task = check_task(L, "sleep");
+    const TickType_t deadline_ticks = check_deadline(L, 1);
+
+    task.state = LuaTaskState::kSleeping;
+    wheel_insert(task, deadline_ticks);
+
+    return lua_yield(L, 0);
+}
+
+static int wait(lua_State* L, LuaTask& task, int predicate, int timeout)
+{
+    const SignalSlot signal = lua_check_signal(L, 1);
+    const float value = signal_db_values()[signal];
+
+    // Checked before the predicate is referenced, an error past that point would leak the reference.
+    const bool timed = !lua_isnoneornil(L, timeout);
+    const TickType_t deadline_ticks = timed ? check_deadline(L, timeout) : 0U;
+
+    if (predicate != 0)
+    {
+        luaL_checktype(L, predicate, LUA_TFUNCTION);
+
+        lua_pushvalue(L, predicate);
+        lua_pushnumber(L, value);
+        lua_call(L, 1, 1);
+
+        if (lua_toboolean(L, -1))
+        {
+            lua_pushnumber(L, value);
+            return 1;
+        }
+
+        lua_pop(L, 1);
+        lua_pushvalue(L, predicate);
+        task.predicate_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    if (timed)
+    {
+        wheel_insert(task, deadline_ticks);
+    }
+
+    if (waiting_count == 0U)
+    {
+        signal_release_ticks = xTaskGetTickCount() + kSignalRateTicks;
+    }
+
+    task.state = LuaTaskState::kWaiting;
+    task.signal = signal;
+    task.last_value = value;
+    waiting_count++;
+
+    return lua_yield(L, 0);
+}
+
+static int async_wait_for(lua_State* L)
+{
+    LuaTask& task = check_task(L, "wait_for");
+
+    return wait(L, task, lua_isnoneornil(L, 2) ? 0 : 2, 3);
+}
+
+static int async_on_signal(lua_State* L)
+{
+    LuaTask& task = check_task(L, "on_signal");
+
+    return wait(L, task, 0, 2);
+}
+
+static void expire_slot(TickType_t now_ticks, size_t slot, std::array<LuaTask*, kMaxLuaTasks>& expired, size_t& count)
+{
+    LuaTask** link = &wheel[slot];
+
+    while (*link != nullptr)
+    {
+        LuaTask* task = *link;
+
+        // Later rounds of the wheel share the slot.
+        if (tick_reached(now_ticks, task->deadline_ticks))
+        {
+            *link = task->next;
+            task->next = nullptr;
+            task->timed = false;
+            expired[count] = task;
+            count++;
+        }
+        else
+        {
+            link = &(task->next);
+        }
+    }
+}
+
+static bool signal_condition(lua_State* L, LuaTask& task, float value)
+{
+    if (task.predicate_ref == LUA_NOREF)
+    {
+        return true;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, task.predicate_ref);
+    lua_pushnumber(L, value);
+
+    if (false == lua_watchdog_pcall(L, task.script, 1, kLuaTaskBudgetCycles, 1))
+    {
+        return false;
+    }
+
+    const bool ret = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    return ret;
+}
+
+void lua_open_async(lua_State* L)
+{
+    // Threads copy the extra space of the main thread, which holds no task.
+    *static_cast<LuaTask**>(lua_getextraspace(L)) = nullptr;
+
+    lua_pushcfunction(L, &async_spawn);
+    lua_setglobal(L, "spawn");
+    lua_pushcfunction(L, &async_sleep);
+    lua_setglobal(L, "sleep");
+    lua_pushcfunction(L, &async_wait_for);
+    lua_setglobal(L, "wait_for");
+    lua_pushcfunction(L, &async_on_signal);
+    lua_setglobal(L, "on_signal");
+
+    wheel_ticks = xTaskGetTickCount();
+}
+
+uint32_t lua_async_serial()
+{
+    return next_serial;
+}
+
+void lua_async_kill_before(lua_State* L, LuaScriptId script, uint32_t serial)
+{
+    for (auto& task : tasks)
+    {
+        if ((task.state != LuaTaskState::kFree) && (task.script == script) &&
+            (static_cast<int32_t>(task.serial - serial) < 0))
+        {
+            release(L, task);
+        }
+    }
+}
+
+void lua_async_kill_since(lua_State* L, LuaScriptId script, uint32_t serial)
+{
+    for (auto& task : tasks)
+    {
+        if ((task.state != LuaTaskState::kFree) && (task.script == script) &&
+            (static_cast<int32_t>(task.serial - serial) >= 0))
+        {
+            release(L, task);
+        }
+    }
+}
+
+void lua_async_dispatch(lua_State* L, TickType_t now_ticks)
+{
+    std::array<LuaTask*, kMaxLuaTasks> expired = {};
+    size_t expired_count = 0U;
+
+    if (tick_reached(now_ticks, wheel_ticks))
+    {
+        // After a long sleep every slot is looked at once.
+        const TickType_t elapsed_ticks = now_ticks - wheel_ticks + 1U;
+        const size_t slots = (elapsed_ticks < kLuaTimerWheelSlots) ? elapsed_ticks : kLuaTimerWheelSlots;
+
+        for (size_t i = 0U; i < slots; i++)
+        {
+            expire_slot(now_ticks, (wheel_ticks + i) & kWheelMask, expired, expired_count);
+        }
+
+        wheel_ticks = now_ticks + 1U;
+    }
+
+    for (size_t i = 0U; i < expired_count; i++)
+    {
+        LuaTask& task = *expired[i];
+
+        if (task.state == LuaTaskState::kWaiting)
+        {
+            // Timed out.
+            unpark(L, task);
+            lua_pushnil(task.thread);
+            wake(L, task, 1);
+        }
+        else
+        {
+            wake(L, task, 0);
+        }
+    }
+
+    if ((waiting_count > 0U) && tick_reached(now_ticks, signal_release_ticks))
+    {
+        const float* values = signal_db_values();
+
+        for (auto& task : tasks)
+        {
+            if ((task.state != LuaTaskState::kWaiting) || (values[task.signal] == task.last_value))
+            {
+                continue;
+            }
+
+            const float value = values[task.signal];
+            task.last_value = value;
+
+            if (signal_condition(L, task, value))
+            {
+                unpark(L, task);
+                lua_pushnumber(task.thread, value);
+                wake(L, task, 1);
+            }
+        }
+
+        signal_release_ticks = now_ticks + kSignalRateTicks;
+    }
+}
+
+TickType_t lua_async_next_release(TickType_t now_ticks, TickType_t idle_ticks)
+{
+    TickType_t next_release_ticks = now_ticks + idle_ticks;
+
+    for (const auto& task : tasks)
+    {
+        if (task.timed && tick_reached(next_release_ticks, task.deadline_ticks))
+        {
+            next_release_ticks = task.deadline_ticks;
+        }
+    }
+
+    if ((waiting_count > 0U) && tick_reached(next_release_ticks, signal_release_ticks))
+    {
+        next_release_ticks = signal_release_ticks;
+    }
+
+    return next_release_ticks;
+}
@@ -0,0 +1,244 @@
+#include "lua_scheduler.h"
+
+#include "cycle_timer.h"
+#include "lua_signals.h"
+#include "lua_watchdog.h"
+#include "signal_db.h"
+
+#include "task.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+
+// On-change callbacks form one more group after the periodic ones.
+constexpr size_t kOnChangeGroup = kLuaRatesMs.size();
+constexpr size_t kLuaRateGroups = kLuaRatesMs.size() + 1U;
+
+struct LuaCallback
+{
+    int ref;
+    LuaScriptId script;
+    uint8_t group;
+
+    // Only used by on-change callbacks.
+    SignalSlot signal;
+    float last_value;
+};
+
+struct LuaRateGroup
+{
+    TickType_t period_ticks;
+    TickType_t next_release_ticks;
+    uint32_t budget_cycles;
+    size_t first;
+    size_t count;
+};
+
+// Sorted by group once committed, callbacks registered by a script that is loading are appended at the end.
+static std::array<LuaCallback, kMaxLuaCallbacks> callbacks = {};
+static size_t callback_count = 0U;
+
+static std::array<LuaRateGroup, kLuaRateGroups> rate_groups = {};
+
+static LuaScriptId current_script = 0U;
+static size_t transaction_start = 0U;
+static bool frozen = false;
+
+static int register_callback(lua_State* L, uint8_t group, SignalSlot signal)
+{
+    if (frozen)
+    {
+        return luaL_error(L, "callbacks can only be registered while scripts load");
+    }
+
+    if (callback_count >= kMaxLuaCallbacks)
+    {
+        return luaL_error(L, "too many callbacks");
+    }
+
+    // Pops the function, keeping it alive in the registry.
+    const int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    const float last_value = (signal != kInvalidSignalSlot) ? signal_db_values()[signal] : 0.0f;
+    callbacks[callback_count] = {ref, current_script, group, signal, last_value};
+    callback_count++;
+
+    return 0;
+}
+
+static int every(lua_State* L)
+{
+    const lua_Integer period_ms = luaL_checkinteger(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    lua_settop(L, 2);
+
+    for (size_t group = 0U; group < kLuaRatesMs.size(); group++)
+    {
+        if (period_ms == static_cast<lua_Integer>(kLuaRatesMs[group]))
+        {
+            return register_callback(L, static_cast<uint8_t>(group), kInvalidSignalSlot);
+        }
+    }
+
+    return luaL_argerror(L, 1, "unsupported rate, use 1, 10, 100 or 1000 ms");
+}
+
+static int on_change(lua_State* L)
+{
+    const SignalSlot signal = lua_check_signal(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    lua_settop(L, 2);
+
+    return register_callback(L, static_cast<uint8_t>(kOnChangeGroup), signal);
+}
+
+void lua_open_scheduler(lua_State* L)
+{
+    lua_pushcfunction(L, &every);
+    lua_setglobal(L, "every");
+    lua_pushcfunction(L, &on_change);
+    lua_setglobal(L, "on_change");
+}
+
+void lua_scheduler_begin(LuaScriptId script)
+{
+    current_script = script;
+    transaction_start = callback_count;
+    frozen = false;
+}
+
+void lua_scheduler_commit(lua_State* L, TickType_t now_ticks)
+{
+    // The callbacks the script registered on an earlier load are replaced by the new ones.
+    size_t kept = 0U;
+    for (size_t i = 0U; i < callback_count; i++)
+    {
+        if ((i < transaction_start) && (callbacks[i].script == current_script))
+        {
+            luaL_unref(L, LUA_REGISTRYINDEX, callbacks[i].ref);
+        }
+        else
+        {
+            callbacks[kept] = callbacks[i];
+            kept++;
+        }
+    }
+    callback_count = kept;
+
+    // Insertion sort by group, stable so callbacks keep their registration order within a group.
+    for (size_t i = 1U; i < callback_count; i++)
+    {
+        const LuaCallback callback = callbacks[i];
+        size_t j = i;
+
+        while ((j > 0U) && (callbacks[j - 1U].group > callback.group))
+        {
+            callbacks[j] = callbacks[j - 1U];
+            j--;
+        }
+
+        callbacks[j] = callback;
+    }
+
+    size_t first = 0U;
+    for (size_t group = 0U; group < kLuaRateGroups; group++)
+    {
+        LuaRateGroup& rate_group = rate_groups[group];
+        const uint32_t period_ms = (group == kOnChangeGroup) ? kLuaOnChangeRateMs : kLuaRatesMs[group];
+
+        // Groups that were already running keep their phase.
+        if (rate_group.count == 0U)
+        {
+            rate_group.next_release_ticks = now_ticks;
+        }
+
+        // A callback may use up to half the period of its group before it is aborted.
+        rate_group.period_ticks = pdMS_TO_TICKS(period_ms);
+        rate_group.budget_cycles = us_to_cycles(period_ms * 500U);
+        rate_group.first = first;
+
+        while ((first < callback_count) && (callbacks[first].group == group))
+        {
+            first++;
+        }
+
+        rate_group.count = first - rate_group.first;
+    }
+
+    frozen = true;
+}
+
+void lua_scheduler_rollback(lua_State* L)
+{
+    for (size_t i = transaction_start; i < callback_count; i++)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, callbacks[i].ref);
+    }
+
+    callback_count = transaction_start;
+    frozen = true;
+}
+
+void lua_scheduler_dispatch(lua_State* L, TickType_t now_ticks)
+{
+    const float* values = signal_db_values();
+
+    for (size_t group = 0U; group < kLuaRateGroups; group++)
+    {
+        LuaRateGroup& rate_group = rate_groups[group];
+
+        if ((rate_group.count == 0U) || !tick_reached(now_ticks, rate_group.next_release_ticks))
+        {
+            continue;
+        }
+
+        for (size_t i = rate_group.first; i < (rate_group.first + rate_group.count); i++)
+        {
+            LuaCallback& callback = callbacks[i];
+
+            if (group == kOnChangeGroup)
+            {
+                const float value = values[callback.signal];
+                if (value == callback.last_value)
+                {
+                    continue;
+                }
+
+                callback.last_value = value;
+                lua_rawgeti(L, LUA_REGISTRYINDEX, callback.ref);
+                lua_pushnumber(L, value);
+                lua_watchdog_pcall(L, callback.script, 1, rate_group.budget_cycles);
+            }
+            else
+            {
+                lua_rawgeti(L, LUA_REGISTRYINDEX, callback.ref);
+                lua_watchdog_pcall(L, callback.script, 0, rate_group.budget_cycles);
+            }
+        }
+
+        // Releases missed because of an overrun are dropped rather than run back to back.
+        do
+        {
+            rate_group.next_release_ticks += rate_group.period_ticks;
+        } while (tick_reached(now_ticks, rate_group.next_release_ticks));
+    }
+}
+
+TickType_t lua_scheduler_next_release(TickType_t now_ticks, TickType_t idle_ticks)
+{
+    TickType_t next_release_ticks = now_ticks + idle_ticks;
+
+    for (const auto& rate_group : rate_groups)
+    {
+        if ((rate_group.count > 0U) && tick_reached(next_release_ticks, rate_group.next_release_ticks))
+        {
+            next_release_ticks = rate_group.next_release_ticks;
+        }
+    }
+
+    return next_release_ticks;
+}
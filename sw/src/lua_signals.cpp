@@ -0,0 +1,78 @@
+#include "lua_signals.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+static int signal_access(lua_State* L)
+{
+    auto* value = static_cast<float*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    if (lua_gettop(L) == 0)
+    {
+        lua_pushnumber(L, *value);
+        return 1;
+    }
+
+    if (lua_isboolean(L, 1))
+    {
+        *value = lua_toboolean(L, 1) ? 1.0f : 0.0f;
+    }
+    else
+    {
+        *value = static_cast<float>(luaL_checknumber(L, 1));
+    }
+
+    return 0;
+}
+
+static int signal_resolve(lua_State* L)
+{
+    const char* name = luaL_checkstring(L, 1);
+    const SignalSlot slot = signal_db_find(name);
+
+    if (slot == kInvalidSignalSlot)
+    {
+        return luaL_error(L, "unknown signal '%s'", name);
+    }
+
+    lua_pushlightuserdata(L, &(signal_db_values()[slot]));
+    lua_pushcclosure(L, &signal_access, 1);
+
+    return 1;
+}
+
+void lua_open_signals(lua_State* L)
+{
+    lua_pushcfunction(L, &signal_resolve);
+    lua_setglobal(L, "signal");
+}
+
+SignalSlot lua_check_signal(lua_State* L, int arg)
+{
+    if (lua_type(L, arg) == LUA_TSTRING)
+    {
+        const char* name = lua_tostring(L, arg);
+        const SignalSlot slot = signal_db_find(name);
+
+        if (slot == kInvalidSignalSlot)
+        {
+            luaL_error(L, "unknown signal '%s'", name);
+        }
+
+        return slot;
+    }
+
+    if (lua_tocfunction(L, arg) != &signal_access)
+    {
+        luaL_typeerror(L, arg, "signal name or accessor");
+    }
+
+    lua_getupvalue(L, arg, 1);
+    const auto* value = static_cast<const float*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+
+    return static_cast<SignalSlot>(value - signal_db_values());
+}
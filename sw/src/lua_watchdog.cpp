@@ -0,0 +1,212 @@
+#include "lua_watchdog.h"
+
+#include "cycle_timer.h"
+#include "diag_format.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+static std::array<LuaScriptStats, kMaxLuaScripts> script_stats = {};
+static size_t script_count = 0U;
+
+// Budget of the call in progress, the hook never fires outside of lua_watchdog_pcall while it is UINT32_MAX.
+static uint32_t call_start_cycles = 0U;
+static uint32_t call_budget_cycles = UINT32_MAX;
+static bool call_overrun = false;
+static LuaScriptId call_script = 0U;
+
+static void watchdog_hook(lua_State* L, lua_Debug* ar);
+
+static void watchdog_arm(lua_State* L, int instructions)
+{
+    lua_sethook(L, &watchdog_hook, LUA_MASKCOUNT, instructions);
+}
+
+/**
+ * Once the budget is exceeded the error is raised again on every instruction until the call ends, so a script
+ * catching it with pcall cannot run on.
+ */
+static void watchdog_hook(lua_State* L, lua_Debug* /*ar*/)
+{
+    if (false == call_overrun)
+    {
+        if (cycle_timer_elapsed(call_start_cycles) <= call_budget_cycles)
+        {
+            // A coroutine left armed by the overrun of an earlier call.
+            if (lua_gethookcount(L) != kLuaWatchdogHookInstructions)
+            {
+                watchdog_arm(L, kLuaWatchdogHookInstructions);
+            }
+            return;
+        }
+
+        call_overrun = true;
+    }
+
+    watchdog_arm(L, 1);
+    luaL_error(L, "budget of %d us exceeded", static_cast<int>(cycles_to_us(call_budget_cycles)));
+}
+
+void lua_watchdog_init(lua_State* L)
+{
+    watchdog_arm(L, kLuaWatchdogHookInstructions);
+}
+
+static void copy_name(std::array<char, kLuaScriptNameSize>& dest, const char* name)
+{
+    strncpy(&dest[0], name, dest.size() - 1U);
+    dest.back() = '\0';
+}
+
+LuaScriptId lua_watchdog_add_script(const char* name)
+{
+    for (size_t i = 0U; i < script_count; i++)
+    {
+        if (strncmp(&script_stats[i].name[0], name, kLuaScriptNameSize - 1U) == 0)
+        {
+            return static_cast<LuaScriptId>(i);
+        }
+    }
+
+    if (script_count < kMaxLuaScripts)
+    {
+        script_stats[script_count] = {{}, 0U, UINT32_MAX, 0U, 0U, 0U, 0U};
+        copy_name(script_stats[script_count].name, name);
+        script_count++;
+    }
+    else
+    {
+        copy_name(script_stats[kMaxLuaScripts - 1U].name, "(others)");
+    }
+
+    return static_cast<LuaScriptId>(script_count - 1U);
+}
+
+static void call_begin(LuaScriptId script, uint32_t budget_cycles)
+{
+    call_script = script;
+    call_overrun = false;
+    call_budget_cycles = budget_cycles;
+    call_start_cycles = cycle_timer_now();
+}
+
+/**
+ * Account the call and print its error, popping it from the state it was raised in.
+ */
+static bool call_end(lua_State* L, LuaScriptId script, int status)
+{
+    const uint32_t elapsed_cycles = cycle_timer_elapsed(call_start_cycles);
+    call_budget_cycles = UINT32_MAX;
+
+    const bool overrun = call_overrun;
+    call_overrun = false;
+    if (overrun)
+    {
+        watchdog_arm(L, kLuaWatchdogHookInstructions);
+    }
+
+    LuaScriptStats& stats = script_stats[script];
+
+    taskENTER_CRITICAL();
+    stats.calls++;
+    stats.total_cycles += elapsed_cycles;
+    stats.min_cycles = (elapsed_cycles < stats.min_cycles) ? elapsed_cycles : stats.min_cycles;
+    stats.max_cycles = (elapsed_cycles > stats.max_cycles) ? elapsed_cycles : stats.max_cycles;
+    stats.overruns += overrun ? 1U : 0U;
+    stats.errors += ((LUA_OK != status) && !overrun) ? 1U : 0U;
+    taskEXIT_CRITICAL();
+
+    if (LUA_OK != status)
+    {
+        printf("Script %s failed: %s\r\n", &stats.name[0], lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return false;
+    }
+
+    return true;
+}
+
+bool lua_watchdog_pcall(lua_State* L, LuaScriptId script, int nargs, uint32_t budget_cycles, int nresults)
+{
+    call_begin(script, budget_cycles);
+
+    const int status = lua_pcall(L, nargs, nresults, 0);
+
+    return call_end(L, script, status);
+}
+
+int lua_watchdog_resume(lua_State* thread, lua_State* from, LuaScriptId script, int nargs, uint32_t budget_cycles)
+{
+    call_begin(script, budget_cycles);
+
+    int results = 0;
+    const int status = lua_resume(thread, from, nargs, &results);
+
+    if ((LUA_OK == status) || (LUA_YIELD == status))
+    {
+        lua_pop(thread, results);
+        call_end(thread, script, LUA_OK);
+    }
+    else
+    {
+        call_end(thread, script, status);
+    }
+
+    return status;
+}
+
+LuaScriptId lua_watchdog_current_script()
+{
+    return call_script;
+}
+
+size_t lua_watchdog_get_stats(LuaScriptStats* stats, size_t max_scripts)
+{
+    taskENTER_CRITICAL();
+
+    const size_t count = (script_count < max_scripts) ? script_count : max_scripts;
+    for (size_t i = 0U; i < count; i++)
+    {
+        stats[i] = script_stats[i];
+    }
+
+    taskEXIT_CRITICAL();
+
+    return count;
+}
+
+size_t lua_watchdog_format_stats(char* buffer, size_t size)
+{
+    std::array<LuaScriptStats, kMaxLuaScripts> stats = {};
+    const size_t count = lua_watchdog_get_stats(&stats[0], stats.size());
+
+    size_t length = 0U;
+
+    diag_append(buffer, size, length, "%-16s %10s %8s %8s %8s %8s %8s\n", "script", "calls", "min_us", "mean_us",
+        "max_us", "overruns", "errors");
+
+    for (size_t i = 0U; i < count; i++)
+    {
+        const LuaScriptStats& script = stats[i];
+        const uint32_t min_cycles = (script.calls > 0U) ? script.min_cycles : 0U;
+        const auto mean_cycles = (script.calls > 0U) ? static_cast<uint32_t>(script.total_cycles / script.calls) : 0U;
+
+        diag_append(buffer, size, length, "%-16s %10lu %8lu %8lu %8lu %8lu %8lu\n", &script.name[0],
+            static_cast<unsigned long>(script.calls), static_cast<unsigned long>(cycles_to_us(min_cycles)),
+            static_cast<unsigned long>(cycles_to_us(mean_cycles)),
+            static_cast<unsigned long>(cycles_to_us(script.max_cycles)), static_cast<unsigned long>(script.overruns),
+            static_cast<unsigned long>(script.errors));
+    }
+
+    return length;
+}
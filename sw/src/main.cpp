@@ -1,13 +1,25 @@
 #include <board.h>
+#include <conf_board.h>
 #include <conf_features.h>
+#include <conf_logic.h>
 
 #include <chip_id_helper.h>
+#include <cycle_timer.h>
+#include <iso_tp_benchmark.h>
 #include <mac_address.h>
+#include <signal_db.h>
 
 #include <task_adc.h>
+#include <task_can.h>
+#include <task_can_bridge.h>
+#include <task_diag.h>
 #include <task_ethernet.h>
+#include <task_iso_tp.h>
 #include <task_led.h>
 #include <task_lua.h>
+#include <task_lua_upload.h>
+#include <task_ptp.h>
+#include <task_telemetry.h>
 
 #include <lua.h>
 
@@ -109,6 +121,7 @@ int main()
     /* Initialize the SAM system */
     sysclk_init();
     board_init();
+    cycle_timer_init();
 
     /* Initialize the console uart */
     configure_console();
@@ -157,6 +170,11 @@ int main()
     printf("-- FreeRTOS " tskKERNEL_VERSION_NUMBER "\n\r");
     printf("-- " LUA_VERSION "\n\r");
 
+    for (const char* name : logic::kSignals)
+    {
+        signal_db_add(name);
+    }
+
     if (false == create_task_led())
     {
         printf("Failed to create LED task.\r\n");
@@ -167,6 +185,30 @@ int main()
         printf("Failed to create ADC task.\r\n");
     }
 
+    if constexpr (features::kEnableCan)
+    {
+        if (false == create_task_can())
+        {
+            printf("Failed to create CAN task.\r\n");
+        }
+
+        if constexpr (features::kEnableIsoTp)
+        {
+            if (false == create_task_iso_tp())
+            {
+                printf("Failed to create ISO-TP task.\r\n");
+            }
+
+            if constexpr (features::kEnableIsoTpBenchmark)
+            {
+                if (false == create_task_iso_tp_benchmark())
+                {
+                    printf("Failed to create ISO-TP benchmark task.\r\n");
+                }
+            }
+        }
+    }
+
     if constexpr (features::kEnableLua)
     {
         if (false == create_task_lua())
@@ -181,6 +223,44 @@ int main()
         {
             printf("Failed to create Ethernet task.\n\r\n");
         }
+
+        if (false == create_task_diag())
+        {
+            printf("Failed to create diagnostics task.\r\n");
+        }
+
+        if constexpr (features::kEnablePtp)
+        {
+            if (false == create_task_ptp())
+            {
+                printf("Failed to create PTP task.\r\n");
+            }
+        }
+
+        // After the CAN task, which adds the signals of the DBC the groups refer to.
+        if constexpr (features::kEnableTelemetry)
+        {
+            if (false == create_task_telemetry())
+            {
+                printf("Failed to create telemetry task.\r\n");
+            }
+        }
+
+        if constexpr (features::kEnableCan && features::kEnableCanBridge)
+        {
+            if (false == create_task_can_bridge())
+            {
+                printf("Failed to create CAN bridge task.\r\n");
+            }
+        }
+
+        if constexpr (features::kEnableLua)
+        {
+            if (false == create_task_lua_upload())
+            {
+                printf("Failed to create Lua upload task.\r\n");
+            }
+        }
     }
 
     if constexpr (features::kEnableICache)
@@ -188,6 +268,10 @@ int main()
         SCB_EnableICache();
     }
 
+    // The MCAN message RAM, GMAC descriptors and RTT buffers must be out of the D-cache.
+    static_assert((false == features::kEnableDCache) || board::kConfigureMpuAtInit,
+        "The D-cache needs the non-cacheable region mapped by the MPU.");
+
     if constexpr (features::kEnableDCache)
     {
         SCB_EnableDCache();
@@ -0,0 +1,648 @@
+#include "ptp.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+constexpr size_t kHeaderBytes = 34U;
+constexpr size_t kTimestampBytes = 10U;
+constexpr size_t kPortIdentityBytes = 10U;
+
+// transportSpecific of gPTP, in the upper nibble of the first byte, and versionPTP 2.
+constexpr uint8_t kMajorSdoId = 0x1U;
+constexpr uint8_t kVersion = 0x2U;
+
+constexpr uint8_t kFlagTwoStep = 0x02U;        // First flag byte.
+constexpr uint8_t kFlagPtpTimescale = 0x08U;   // Second flag byte.
+
+// logMessageInterval of the peer delay responses.
+constexpr int8_t kLogIntervalNone = 0x7F;
+
+constexpr int64_t kNsPerSecond = 1000000000;
+
+// Follow_Up information TLV of 802.1AS: ORGANIZATION_EXTENSION, 28 bytes, 00-80-C2 subtype 1.
+constexpr size_t kFollowUpTlvBytes = 32U;
+constexpr std::array<uint8_t, 10U> kFollowUpTlvHeader = {{0x00U, 0x03U, 0x00U, 0x1CU, 0x00U, 0x80U, 0xC2U, 0x00U,
+    0x00U, 0x01U}};
+
+// Neighbour rate ratios further than this from 1 come from a step of either clock, not from their frequencies.
+constexpr double kMaxRateRatioOffset = 0.001;
+
+static size_t ptp_body_bytes(PtpMessageType type)
+{
+    switch (type)
+    {
+        case PtpMessageType::kSync:                 return kTimestampBytes;
+        case PtpMessageType::kFollowUp:             return kTimestampBytes + kFollowUpTlvBytes;
+        case PtpMessageType::kPdelayReq:            return kTimestampBytes + kPortIdentityBytes;
+        case PtpMessageType::kPdelayResp:           return kTimestampBytes + kPortIdentityBytes;
+        case PtpMessageType::kPdelayRespFollowUp:   return kTimestampBytes + kPortIdentityBytes;
+        default:                                    return 0U;
+    }
+}
+
+// controlField, of PTP version 1, still set by the standard.
+static uint8_t ptp_control_field(PtpMessageType type)
+{
+    switch (type)
+    {
+        case PtpMessageType::kSync:         return 0x0U;
+        case PtpMessageType::kFollowUp:     return 0x2U;
+        default:                            return 0x5U;
+    }
+}
+
+static void put_be(uint8_t* data, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0U; i < bytes; i++)
+    {
+        data[i] = static_cast<uint8_t>(value >> (8U * (bytes - 1U - i)));
+    }
+}
+
+static uint64_t get_be(const uint8_t* data, size_t bytes)
+{
+    uint64_t value = 0U;
+
+    for (size_t i = 0U; i < bytes; i++)
+    {
+        value = (value << 8U) | data[i];
+    }
+
+    return value;
+}
+
+static void put_timestamp(uint8_t* data, int64_t ns)
+{
+    // The PTP timescale has no negative times, a clock not yet set counts up from 0.
+    const uint64_t value = (ns > 0) ? static_cast<uint64_t>(ns) : 0U;
+
+    put_be(&data[0], value / kNsPerSecond, 6U);
+    put_be(&data[6], value % kNsPerSecond, 4U);
+}
+
+static int64_t get_timestamp(const uint8_t* data)
+{
+    return static_cast<int64_t>(get_be(&data[0], 6U)) * kNsPerSecond + static_cast<int64_t>(get_be(&data[6], 4U));
+}
+
+static void put_port_identity(uint8_t* data, const PtpPortIdentity& identity)
+{
+    put_be(&data[0], identity.clock_identity, 8U);
+    put_be(&data[8], identity.port_number, 2U);
+}
+
+static PtpPortIdentity get_port_identity(const uint8_t* data)
+{
+    return {get_be(&data[0], 8U), static_cast<uint16_t>(get_be(&data[8], 2U))};
+}
+
+static bool same_port(const PtpPortIdentity& a, const PtpPortIdentity& b)
+{
+    return (a.clock_identity == b.clock_identity) && (a.port_number == b.port_number);
+}
+
+size_t ptp_encode(const PtpMessage& message, uint8_t domain, uint8_t* data, size_t size)
+{
+    const size_t length = kHeaderBytes + ptp_body_bytes(message.type);
+    if ((length == kHeaderBytes) || (length > size))
+    {
+        return 0U;
+    }
+
+    memset(data, 0, length);
+
+    data[0] = static_cast<uint8_t>((kMajorSdoId << 4U) | static_cast<uint8_t>(message.type));
+    data[1] = kVersion;
+    put_be(&data[2], length, 2U);
+    data[4] = domain;
+    data[6] = message.two_step ? kFlagTwoStep : 0U;
+    data[7] = kFlagPtpTimescale;
+    put_be(&data[8], static_cast<uint64_t>(message.correction_ns * 65536), 8U);
+    put_port_identity(&data[20], message.source);
+    put_be(&data[30], message.sequence_id, 2U);
+    data[32] = ptp_control_field(message.type);
+    data[33] = static_cast<uint8_t>(message.log_interval);
+
+    uint8_t* body = &data[kHeaderBytes];
+
+    switch (message.type)
+    {
+        case PtpMessageType::kSync:
+        case PtpMessageType::kPdelayReq:
+            // Reserved, the time is in the Follow_Up or the response.
+            break;
+
+        case PtpMessageType::kFollowUp:
+            put_timestamp(body, message.timestamp_ns);
+            // Rate offset, time base and last phase and frequency changes all 0: this master is the grandmaster.
+            memcpy(&body[kTimestampBytes], kFollowUpTlvHeader.data(), kFollowUpTlvHeader.size());
+            break;
+
+        case PtpMessageType::kPdelayResp:
+        case PtpMessageType::kPdelayRespFollowUp:
+            put_timestamp(body, message.timestamp_ns);
+            put_port_identity(&body[kTimestampBytes], message.requesting);
+            break;
+    }
+
+    return length;
+}
+
+bool ptp_decode(const uint8_t* data, size_t size, uint8_t domain, PtpMessage& message)
+{
+    if (size < kHeaderBytes)
+    {
+        return false;
+    }
+
+    const auto type = static_cast<PtpMessageType>(data[0] & 0x0FU);
+    const size_t body_bytes = ptp_body_bytes(type);
+
+    // Follow_Up messages are accepted without the TLV, from masters of plain IEEE 1588 over Ethernet.
+    const size_t min_bytes = kHeaderBytes + ((type == PtpMessageType::kFollowUp) ? kTimestampBytes : body_bytes);
+
+    if (((data[0] >> 4U) != kMajorSdoId) || ((data[1] & 0x0FU) != kVersion) || (data[4] != domain) ||
+        (body_bytes == 0U) || (size < min_bytes) || (get_be(&data[2], 2U) < min_bytes))
+    {
+        return false;
+    }
+
+    message = {};
+    message.type = type;
+    message.two_step = (data[6] & kFlagTwoStep) != 0U;
+    message.correction_ns = static_cast<int64_t>(get_be(&data[8], 8U)) / 65536;
+    message.source = get_port_identity(&data[20]);
+    message.sequence_id = static_cast<uint16_t>(get_be(&data[30], 2U));
+    message.log_interval = static_cast<int8_t>(data[33]);
+
+    const uint8_t* body = &data[kHeaderBytes];
+
+    switch (type)
+    {
+        case PtpMessageType::kSync:
+        case PtpMessageType::kFollowUp:
+            message.timestamp_ns = get_timestamp(body);
+            break;
+
+        case PtpMessageType::kPdelayReq:
+            break;
+
+        case PtpMessageType::kPdelayResp:
+        case PtpMessageType::kPdelayRespFollowUp:
+            message.timestamp_ns = get_timestamp(body);
+            message.requesting = get_port_identity(&body[kTimestampBytes]);
+            break;
+    }
+
+    return true;
+}
+
+uint64_t ptp_clock_identity(const std::array<uint8_t, 6U>& mac)
+{
+    const std::array<uint8_t, 8U> eui64 = {{mac[0], mac[1], mac[2], 0xFFU, 0xFEU, mac[3], mac[4], mac[5]}};
+
+    return get_be(eui64.data(), eui64.size());
+}
+
+static double clamp_ppb(double ppb)
+{
+    return (ppb > ptp::kMaxFrequencyPpb) ? ptp::kMaxFrequencyPpb :
+        ((ppb < -ptp::kMaxFrequencyPpb) ? -ptp::kMaxFrequencyPpb : ppb);
+}
+
+void ptp_servo_reset(PtpServo& servo)
+{
+    // The frequency found so far is the best guess until the next estimate.
+    servo.state = PtpServoState::kUnlocked;
+    servo.samples = 0U;
+    servo.integral_ppb = servo.frequency_ppb;
+}
+
+void ptp_servo_sample(PtpServo& servo, int64_t offset_ns, int64_t local_ns, PtpOutput& output)
+{
+    if (servo.state == PtpServoState::kLocked)
+    {
+        if (llabs(offset_ns) > ptp::kStepThresholdNs)
+        {
+            output.step = true;
+            output.step_ns = -offset_ns;
+            ptp_servo_reset(servo);
+            return;
+        }
+
+        servo.integral_ppb = clamp_ppb(servo.integral_ppb - (ptp::kServoKi * static_cast<double>(offset_ns)));
+        servo.frequency_ppb = clamp_ppb(servo.integral_ppb - (ptp::kServoKp * static_cast<double>(offset_ns)));
+
+        output.set_frequency = true;
+        output.frequency_ppb = servo.frequency_ppb;
+        return;
+    }
+
+    if (servo.samples == 0U)
+    {
+        servo.first_offset_ns = offset_ns;
+        servo.first_local_ns = local_ns;
+        servo.samples = 1U;
+        return;
+    }
+
+    const int64_t elapsed_ns = local_ns - servo.first_local_ns;
+    if (elapsed_ns <= 0)
+    {
+        servo.samples = 0U;
+        return;
+    }
+
+    // The offset grew by the difference of the frequencies, on top of the one applied.
+    const double drift_ppb = static_cast<double>(offset_ns - servo.first_offset_ns) * 1e9 /
+        static_cast<double>(elapsed_ns);
+
+    servo.frequency_ppb = clamp_ppb(servo.frequency_ppb - drift_ppb);
+    servo.integral_ppb = servo.frequency_ppb;
+    servo.state = PtpServoState::kLocked;
+
+    output.set_frequency = true;
+    output.frequency_ppb = servo.frequency_ppb;
+
+    if (offset_ns != 0)
+    {
+        output.step = true;
+        output.step_ns = -offset_ns;
+    }
+}
+
+static void ptp_port_send(PtpOutput& output, const PtpMessage& message)
+{
+    if (output.message_count < output.messages.size())
+    {
+        output.messages[output.message_count++] = message;
+    }
+}
+
+static PtpMessage ptp_port_message(const PtpPort& port, PtpMessageType type, uint16_t sequence_id, int8_t log_interval)
+{
+    PtpMessage message = {};
+    message.type = type;
+    message.sequence_id = sequence_id;
+    message.log_interval = log_interval;
+    message.source = port.identity;
+    return message;
+}
+
+/**
+ * Times of this clock taken before a step are not comparable to the ones after it.
+ */
+static void ptp_port_clock_stepped(PtpPort& port, int64_t step_ns)
+{
+    port.next_sync_ns += step_ns;
+    port.next_pdelay_ns += step_ns;
+    port.last_sync_ns += step_ns;
+
+    port.pdelay_pending = false;
+    port.rate_reference_valid = false;
+    port.sync_received = false;
+    port.stats.steps++;
+}
+
+static void ptp_port_apply(PtpPort& port, const PtpOutput& output)
+{
+    if (output.step)
+    {
+        ptp_port_clock_stepped(port, output.step_ns);
+    }
+
+    port.stats.frequency_ppb = port.servo.frequency_ppb;
+    port.stats.servo_state = port.servo.state;
+}
+
+void ptp_port_init(PtpPort& port, ptp::Role role, uint64_t clock_identity, int64_t now_ns)
+{
+    port = {};
+    port.role = role;
+    port.identity = {clock_identity, 1U};
+    port.sync_interval_ns = (ptp::kLogSyncInterval >= 0) ? (kNsPerSecond << ptp::kLogSyncInterval) :
+        (kNsPerSecond >> -ptp::kLogSyncInterval);
+    port.pdelay_interval_ns = (ptp::kLogPdelayInterval >= 0) ? (kNsPerSecond << ptp::kLogPdelayInterval) :
+        (kNsPerSecond >> -ptp::kLogPdelayInterval);
+    port.next_sync_ns = now_ns;
+    port.next_pdelay_ns = now_ns;
+    port.last_sync_ns = now_ns;
+    port.stats.neighbor_rate_ratio = 1.0;
+
+    ptp_servo_reset(port.servo);
+}
+
+void ptp_port_tick(PtpPort& port, int64_t now_ns, PtpOutput& output)
+{
+    if ((port.role == ptp::Role::kMaster) && (now_ns >= port.next_sync_ns))
+    {
+        // A Sync still waiting for its timestamp is abandoned, the slave drops it without a Follow_Up.
+        port.sync_sequence++;
+        port.sync_sent = true;
+
+        PtpMessage sync = ptp_port_message(port, PtpMessageType::kSync, port.sync_sequence, ptp::kLogSyncInterval);
+        sync.two_step = true;
+        ptp_port_send(output, sync);
+
+        port.next_sync_ns += port.sync_interval_ns;
+        if (port.next_sync_ns <= now_ns)
+        {
+            port.next_sync_ns = now_ns + port.sync_interval_ns;
+        }
+    }
+
+    if ((port.role == ptp::Role::kSlave) && (port.servo.state == PtpServoState::kLocked) &&
+        ((now_ns - port.last_sync_ns) > static_cast<int64_t>(ptp::kSyncReceiptTimeout) * port.sync_interval_ns))
+    {
+        port.stats.sync_timeouts++;
+        ptp_servo_reset(port.servo);
+    }
+
+    if (now_ns >= port.next_pdelay_ns)
+    {
+        if (port.pdelay_pending)
+        {
+            port.stats.pdelay_lost++;
+
+            if (++port.pdelay_lost_in_row >= ptp::kAllowedLostResponses)
+            {
+                port.link_delay_valid = false;
+                port.rate_reference_valid = false;
+                port.stats.as_capable = false;
+            }
+        }
+
+        port.pdelay_sequence++;
+        port.pdelay_pending = true;
+        port.pdelay_resp_received = false;
+        port.pdelay_follow_up_received = false;
+        port.pdelay_t1_ns = kPtpNoTimestamp;
+
+        ptp_port_send(output, ptp_port_message(port, PtpMessageType::kPdelayReq, port.pdelay_sequence,
+            ptp::kLogPdelayInterval));
+
+        port.next_pdelay_ns += port.pdelay_interval_ns;
+        if (port.next_pdelay_ns <= now_ns)
+        {
+            port.next_pdelay_ns = now_ns + port.pdelay_interval_ns;
+        }
+    }
+
+    ptp_port_apply(port, output);
+}
+
+/**
+ * Complete the exchange once the follow up and the transmit timestamp of the request are both in.
+ */
+static void ptp_port_link_delay(PtpPort& port)
+{
+    if ((false == port.pdelay_pending) || (false == port.pdelay_follow_up_received) ||
+        (port.pdelay_t1_ns == kPtpNoTimestamp))
+    {
+        return;
+    }
+
+    const int64_t t1_ns = port.pdelay_t1_ns;
+    const int64_t t2_ns = port.pdelay_t2_ns;
+    const int64_t t3_ns = port.pdelay_t3_ns;
+    const int64_t t4_ns = port.pdelay_t4_ns;
+
+    port.pdelay_pending = false;
+    port.pdelay_lost_in_row = 0U;
+
+    // Rate of the peer's clock against this one, over the last two responses.
+    if (port.rate_reference_valid && (t4_ns > port.rate_reference_t4_ns))
+    {
+        const double ratio = static_cast<double>(t3_ns - port.rate_reference_t3_ns) /
+            static_cast<double>(t4_ns - port.rate_reference_t4_ns);
+
+        if (std::fabs(ratio - 1.0) < kMaxRateRatioOffset)
+        {
+            port.stats.neighbor_rate_ratio = ratio;
+        }
+    }
+
+    port.rate_reference_valid = true;
+    port.rate_reference_t3_ns = t3_ns;
+    port.rate_reference_t4_ns = t4_ns;
+
+    // Turnaround on the peer, measured by its clock, and round trip measured by this one, scaled onto the peer's.
+    const double round_trip_ns = static_cast<double>(t4_ns - t1_ns) * port.stats.neighbor_rate_ratio;
+    const auto turnaround_ns = static_cast<double>((t3_ns - t2_ns) + port.pdelay_resp_correction_ns);
+    const double delay_ns = (round_trip_ns - turnaround_ns) / 2.0;
+
+    // Averaged over 8 exchanges, the first one taken as is.
+    port.mean_link_delay_ns = port.link_delay_valid ?
+        (port.mean_link_delay_ns + ((delay_ns - port.mean_link_delay_ns) / 8.0)) : delay_ns;
+    port.link_delay_valid = true;
+    port.stats.mean_link_delay_ns = std::llround(port.mean_link_delay_ns);
+    port.stats.as_capable = port.stats.mean_link_delay_ns <= ptp::kNeighborPropDelayThreshNs;
+    port.stats.pdelay_exchanges++;
+}
+
+static void ptp_port_synchronize(PtpPort& port, int64_t t1_ns, int64_t correction_ns, PtpOutput& output)
+{
+    port.sync_received = false;
+
+    if (false == port.stats.as_capable)
+    {
+        port.stats.ignored++;
+        return;
+    }
+
+    const int64_t offset_ns = port.sync_t2_ns - t1_ns - correction_ns - port.stats.mean_link_delay_ns;
+
+    port.last_sync_ns = port.sync_t2_ns;
+    port.stats.offset_ns = offset_ns;
+    port.stats.syncs++;
+
+    ptp_servo_sample(port.servo, offset_ns, port.sync_t2_ns, output);
+}
+
+void ptp_port_receive(PtpPort& port, const PtpMessage& message, int64_t rx_timestamp_ns, PtpOutput& output)
+{
+    const bool event = (message.type == PtpMessageType::kSync) || (message.type == PtpMessageType::kPdelayReq) ||
+        (message.type == PtpMessageType::kPdelayResp);
+
+    if (event && (rx_timestamp_ns == kPtpNoTimestamp))
+    {
+        port.stats.missing_timestamps++;
+        return;
+    }
+
+    if (same_port(message.source, port.identity))
+    {
+        // Our own frame, looped back.
+        port.stats.ignored++;
+        return;
+    }
+
+    switch (message.type)
+    {
+        case PtpMessageType::kSync:
+            if (port.role != ptp::Role::kSlave)
+            {
+                port.stats.ignored++;
+                break;
+            }
+
+            port.sync_t2_ns = rx_timestamp_ns;
+            port.sync_correction_ns = message.correction_ns;
+            port.sync_source = message.source;
+            port.sync_received_sequence = message.sequence_id;
+            port.sync_received = message.two_step;
+
+            if (false == message.two_step)
+            {
+                ptp_port_synchronize(port, message.timestamp_ns, message.correction_ns, output);
+            }
+            break;
+
+        case PtpMessageType::kFollowUp:
+            if ((false == port.sync_received) || (message.sequence_id != port.sync_received_sequence) ||
+                (false == same_port(message.source, port.sync_source)))
+            {
+                port.stats.ignored++;
+                break;
+            }
+
+            ptp_port_synchronize(port, message.timestamp_ns, port.sync_correction_ns + message.correction_ns, output);
+            break;
+
+        case PtpMessageType::kPdelayReq:
+            // Answered right away, the receipt time goes in the response and the response's transmit time in its
+            // follow up.
+            port.response = ptp_port_message(port, PtpMessageType::kPdelayResp, message.sequence_id, kLogIntervalNone);
+            port.response.two_step = true;
+            port.response.timestamp_ns = rx_timestamp_ns;
+            port.response.requesting = message.source;
+            port.response_sent = true;
+            ptp_port_send(output, port.response);
+            break;
+
+        case PtpMessageType::kPdelayResp:
+            if ((false == port.pdelay_pending) || (message.sequence_id != port.pdelay_sequence) ||
+                (false == same_port(message.requesting, port.identity)))
+            {
+                port.stats.ignored++;
+                break;
+            }
+
+            port.pdelay_t2_ns = message.timestamp_ns;
+            port.pdelay_t4_ns = rx_timestamp_ns;
+            port.pdelay_resp_correction_ns = message.correction_ns;
+            port.pdelay_resp_received = true;
+            break;
+
+        case PtpMessageType::kPdelayRespFollowUp:
+            if ((false == port.pdelay_resp_received) || (message.sequence_id != port.pdelay_sequence) ||
+                (false == same_port(message.requesting, port.identity)))
+            {
+                port.stats.ignored++;
+                break;
+            }
+
+            port.pdelay_resp_received = false;
+            port.pdelay_follow_up_received = true;
+            port.pdelay_t3_ns = message.timestamp_ns;
+            port.pdelay_resp_correction_ns += message.correction_ns;
+            ptp_port_link_delay(port);
+            break;
+    }
+
+    ptp_port_apply(port, output);
+}
+
+void ptp_port_transmitted(PtpPort& port, PtpMessageType type, uint16_t sequence_id, int64_t tx_timestamp_ns,
+    PtpOutput& output)
+{
+    if (tx_timestamp_ns == kPtpNoTimestamp)
+    {
+        port.stats.missing_timestamps++;
+    }
+
+    switch (type)
+    {
+        case PtpMessageType::kSync:
+            if ((false == port.sync_sent) || (sequence_id != port.sync_sequence))
+            {
+                break;
+            }
+
+            port.sync_sent = false;
+
+            if (tx_timestamp_ns != kPtpNoTimestamp)
+            {
+                PtpMessage follow_up = ptp_port_message(port, PtpMessageType::kFollowUp, sequence_id,
+                    ptp::kLogSyncInterval);
+                follow_up.timestamp_ns = tx_timestamp_ns;
+                ptp_port_send(output, follow_up);
+            }
+            break;
+
+        case PtpMessageType::kPdelayReq:
+            if (port.pdelay_pending && (sequence_id == port.pdelay_sequence))
+            {
+                port.pdelay_t1_ns = tx_timestamp_ns;
+                ptp_port_link_delay(port);
+            }
+            break;
+
+        case PtpMessageType::kPdelayResp:
+            if ((false == port.response_sent) || (sequence_id != port.response.sequence_id))
+            {
+                break;
+            }
+
+            port.response_sent = false;
+
+            if (tx_timestamp_ns != kPtpNoTimestamp)
+            {
+                PtpMessage follow_up = port.response;
+                follow_up.type = PtpMessageType::kPdelayRespFollowUp;
+                follow_up.two_step = false;
+                follow_up.timestamp_ns = tx_timestamp_ns;
+                ptp_port_send(output, follow_up);
+                port.stats.responses_sent++;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    ptp_port_apply(port, output);
+}
+
+void ptp_rate_init(PtpRate& rate, uint32_t tick_hz)
+{
+    rate = {};
+    rate.nominal_increment = 65536.0 * 1e9 / static_cast<double>(tick_hz);
+    ptp_rate_set(rate, 0.0);
+}
+
+uint32_t ptp_rate_set(PtpRate& rate, double frequency_ppb)
+{
+    const double increment = rate.nominal_increment * (1.0 + (frequency_ppb * 1e-9));
+
+    rate.increment = static_cast<uint32_t>(std::llround(increment));
+    rate.residual_ppb = (increment - static_cast<double>(rate.increment)) * 1e9 / rate.nominal_increment;
+
+    return rate.increment;
+}
+
+int32_t ptp_rate_slew(PtpRate& rate, int64_t elapsed_ns)
+{
+    rate.residual_ns += rate.residual_ppb * static_cast<double>(elapsed_ns) * 1e-9;
+
+    const auto whole_ns = static_cast<int32_t>(rate.residual_ns);
+    rate.residual_ns -= whole_ns;
+
+    return whole_ns;
+}
+
+void ptp_rate_clear_phase(PtpRate& rate)
+{
+    rate.residual_ns = 0.0;
+}
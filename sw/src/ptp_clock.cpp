@@ -0,0 +1,217 @@
+#include "ptp_clock.h"
+
+#include "conf_ptp.h"
+#include "cycle_timer.h"
+#include "ptp.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "gmac.h"
+#include "sysclk.h"
+
+#include <array>
+
+constexpr int64_t kNsPerSecond = 1000000000;
+
+// TA adjusts the TSU by up to 2^30 - 1 ns without stopping it, anything larger is written over.
+constexpr int64_t kMaxAdjustNs = GMAC_TA_ITDT_Msk;
+
+// Cycle counter to TSU ns, in Q24.
+constexpr uint32_t kCycleScaleShift = 24U;
+constexpr int64_t kNominalNsPerCycleQ24 = (kNsPerSecond << kCycleScaleShift) / configCPU_CLOCK_HZ;
+
+struct PtpCycleMapping
+{
+    uint32_t cycles;
+    int64_t ns;
+    int64_t ns_per_cycle_q24;
+};
+
+static PtpRate ptp_clock_rate = {};
+static uint32_t ptp_clock_last_slew_cycles = 0U;
+
+static PtpCycleMapping ptp_clock_mapping = {0U, 0, kNominalNsPerCycleQ24};
+static bool ptp_clock_mapped = false;
+
+static std::array<PtpEventTimestamp, kPtpEvents> ptp_clock_events = {};
+
+static int64_t ptp_clock_time(uint32_t seconds_high, uint32_t seconds_low, uint32_t ns)
+{
+    const auto seconds = static_cast<int64_t>((static_cast<uint64_t>(seconds_high & 0xFFFFU) << 32U) | seconds_low);
+
+    return (seconds * kNsPerSecond) + static_cast<int64_t>(ns & GMAC_TN_TNS_Msk);
+}
+
+static void ptp_clock_write_increment(uint32_t increment)
+{
+    GMAC->GMAC_TISUBN = GMAC_TISUBN_LSBTIR(increment & 0xFFFFU);
+    GMAC->GMAC_TI = GMAC_TI_CNS(increment >> 16U);
+}
+
+void ptp_clock_init()
+{
+    ptp_rate_init(ptp_clock_rate, sysclk_get_peripheral_hz());
+    ptp_clock_write_increment(ptp_clock_rate.increment);
+
+    GMAC->GMAC_TSH = 0U;
+    GMAC->GMAC_TSL = 0U;
+    GMAC->GMAC_TN = 0U;
+
+    ptp_clock_last_slew_cycles = cycle_timer_now();
+}
+
+int64_t ptp_clock_now()
+{
+    uint32_t seconds_low = GMAC->GMAC_TSL;
+    uint32_t ns = GMAC->GMAC_TN;
+
+    // Read again across the turn of a second.
+    if (GMAC->GMAC_TSL != seconds_low)
+    {
+        seconds_low = GMAC->GMAC_TSL;
+        ns = GMAC->GMAC_TN;
+    }
+
+    return ptp_clock_time(GMAC->GMAC_TSH, seconds_low, ns);
+}
+
+void ptp_clock_step(int64_t step_ns)
+{
+    if ((step_ns >= -kMaxAdjustNs) && (step_ns <= kMaxAdjustNs))
+    {
+        GMAC->GMAC_TA = ((step_ns < 0) ? GMAC_TA_ADJ : 0U) |
+            GMAC_TA_ITDT(static_cast<uint32_t>((step_ns < 0) ? -step_ns : step_ns));
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+
+        const int64_t time_ns = ptp_clock_now() + step_ns;
+        const uint64_t value = (time_ns > 0) ? static_cast<uint64_t>(time_ns) : 0U;
+        const uint64_t seconds = value / kNsPerSecond;
+
+        GMAC->GMAC_TSH = static_cast<uint32_t>(seconds >> 32U) & GMAC_TSH_TCS_Msk;
+        GMAC->GMAC_TSL = static_cast<uint32_t>(seconds);
+        GMAC->GMAC_TN = GMAC_TN_TNS(static_cast<uint32_t>(value % kNsPerSecond));
+
+        taskEXIT_CRITICAL();
+    }
+
+    ptp_rate_clear_phase(ptp_clock_rate);
+}
+
+void ptp_clock_set_frequency(double frequency_ppb)
+{
+    ptp_clock_write_increment(ptp_rate_set(ptp_clock_rate, frequency_ppb));
+}
+
+void ptp_clock_slew()
+{
+    const uint32_t now = cycle_timer_now();
+    const uint32_t elapsed_cycles = now - ptp_clock_last_slew_cycles;
+    ptp_clock_last_slew_cycles = now;
+
+    const int32_t slew_ns = ptp_rate_slew(ptp_clock_rate,
+        static_cast<int64_t>(elapsed_cycles) * kNsPerSecond / configCPU_CLOCK_HZ);
+
+    if (slew_ns != 0)
+    {
+        GMAC->GMAC_TA = ((slew_ns < 0) ? GMAC_TA_ADJ : 0U) |
+            GMAC_TA_ITDT(static_cast<uint32_t>((slew_ns < 0) ? -slew_ns : slew_ns));
+    }
+}
+
+void ptp_clock_sample()
+{
+    taskENTER_CRITICAL();
+
+    const uint32_t cycles = cycle_timer_now();
+    const int64_t ns = ptp_clock_now();
+
+    // The core clock against the TSU, over the last interval.  Intervals with a step in between are off by the step,
+    // those are as rare as they are short lived.
+    const uint32_t elapsed_cycles = cycles - ptp_clock_mapping.cycles;
+    const int64_t elapsed_ns = ns - ptp_clock_mapping.ns;
+
+    if (ptp_clock_mapped && (elapsed_cycles != 0U) && (elapsed_ns > 0) && (elapsed_ns < kNsPerSecond))
+    {
+        const int64_t ns_per_cycle_q24 = (elapsed_ns << kCycleScaleShift) / elapsed_cycles;
+
+        // Within 0.1 % of the nominal rate.
+        if ((ns_per_cycle_q24 > (kNominalNsPerCycleQ24 - (kNominalNsPerCycleQ24 / 1000))) &&
+            (ns_per_cycle_q24 < (kNominalNsPerCycleQ24 + (kNominalNsPerCycleQ24 / 1000))))
+        {
+            ptp_clock_mapping.ns_per_cycle_q24 = ns_per_cycle_q24;
+        }
+    }
+
+    ptp_clock_mapping.cycles = cycles;
+    ptp_clock_mapping.ns = ns;
+    ptp_clock_mapped = true;
+
+    taskEXIT_CRITICAL();
+}
+
+int64_t ptp_clock_from_cycles(uint32_t cycles)
+{
+    taskENTER_CRITICAL();
+    const PtpCycleMapping mapping = ptp_clock_mapping;
+    taskEXIT_CRITICAL();
+
+    // Negative for a cycle counter value before the last sample.
+    const auto elapsed_cycles = static_cast<int32_t>(cycles - mapping.cycles);
+
+    return mapping.ns + ((static_cast<int64_t>(elapsed_cycles) * mapping.ns_per_cycle_q24) >> kCycleScaleShift);
+}
+
+static void ptp_clock_capture(PtpEvent event, uint32_t seconds_high, uint32_t seconds_low, uint32_t ns)
+{
+    PtpEventTimestamp& timestamp = ptp_clock_events[static_cast<uint32_t>(event)];
+
+    timestamp.ns = ptp_clock_time(seconds_high, seconds_low, ns);
+    timestamp.count++;
+}
+
+void ptp_clock_capture_events(uint32_t isr)
+{
+    if (isr & GMAC_ISR_SFR)
+    {
+        ptp_clock_capture(PtpEvent::kSyncRx, GMAC->GMAC_EFRSH, GMAC->GMAC_EFRSL, GMAC->GMAC_EFRN);
+    }
+
+    if (isr & GMAC_ISR_SFT)
+    {
+        ptp_clock_capture(PtpEvent::kSyncTx, GMAC->GMAC_EFTSH, GMAC->GMAC_EFTSL, GMAC->GMAC_EFTN);
+    }
+
+    // Both peer delay messages share the peer event registers of their direction.
+    if (isr & GMAC_ISR_PDRQFR)
+    {
+        ptp_clock_capture(PtpEvent::kPdelayReqRx, GMAC->GMAC_PEFRSH, GMAC->GMAC_PEFRSL, GMAC->GMAC_PEFRN);
+    }
+
+    if (isr & GMAC_ISR_PDRSFR)
+    {
+        ptp_clock_capture(PtpEvent::kPdelayRespRx, GMAC->GMAC_PEFRSH, GMAC->GMAC_PEFRSL, GMAC->GMAC_PEFRN);
+    }
+
+    if (isr & GMAC_ISR_PDRQFT)
+    {
+        ptp_clock_capture(PtpEvent::kPdelayReqTx, GMAC->GMAC_PEFTSH, GMAC->GMAC_PEFTSL, GMAC->GMAC_PEFTN);
+    }
+
+    if (isr & GMAC_ISR_PDRSFT)
+    {
+        ptp_clock_capture(PtpEvent::kPdelayRespTx, GMAC->GMAC_PEFTSH, GMAC->GMAC_PEFTSL, GMAC->GMAC_PEFTN);
+    }
+}
+
+PtpEventTimestamp ptp_clock_event(PtpEvent event)
+{
+    taskENTER_CRITICAL();
+    const PtpEventTimestamp timestamp = ptp_clock_events[static_cast<uint32_t>(event)];
+    taskEXIT_CRITICAL();
+
+    return timestamp;
+}
@@ -0,0 +1,428 @@
+#include "rule_engine.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+constexpr uint16_t kNoRegister = UINT16_MAX;
+
+static_assert(kMaxRuleInstructions < kNoRegister, "Registers are addressed with 16 bits.");
+
+/**
+ * Recursive descent parser state.  Code is emitted straight into the engine in evaluation order, every parse
+ * function returns the register holding the value of what it parsed, or kNoRegister on error.
+ */
+struct RuleParser
+{
+    RuleEngine& engine;
+    const char* begin;
+    const char* cursor;
+    RuleCompileError error;
+};
+
+static inline float apply(RuleOp op, float a, float b)
+{
+    switch (op)
+    {
+        case RuleOp::kNeg:  return -a;
+        case RuleOp::kNot:  return (a == 0.0f) ? 1.0f : 0.0f;
+        case RuleOp::kAdd:  return a + b;
+        case RuleOp::kSub:  return a - b;
+        case RuleOp::kMul:  return a * b;
+        case RuleOp::kDiv:  return a / b;
+        case RuleOp::kLt:   return (a < b) ? 1.0f : 0.0f;
+        case RuleOp::kLe:   return (a <= b) ? 1.0f : 0.0f;
+        case RuleOp::kGt:   return (a > b) ? 1.0f : 0.0f;
+        case RuleOp::kGe:   return (a >= b) ? 1.0f : 0.0f;
+        case RuleOp::kEq:   return (a == b) ? 1.0f : 0.0f;
+        case RuleOp::kNe:   return (a != b) ? 1.0f : 0.0f;
+        case RuleOp::kAnd:  return ((a != 0.0f) && (b != 0.0f)) ? 1.0f : 0.0f;
+        case RuleOp::kOr:   return ((a != 0.0f) || (b != 0.0f)) ? 1.0f : 0.0f;
+        default:            return 0.0f;
+    }
+}
+
+static uint16_t fail(RuleParser& parser, const char* message)
+{
+    if (parser.error.message == nullptr)
+    {
+        parser.error.message = message;
+        parser.error.position = static_cast<size_t>(parser.cursor - parser.begin);
+    }
+
+    return kNoRegister;
+}
+
+static uint16_t emit(RuleParser& parser, RuleOp op, uint16_t a, uint16_t b, float value)
+{
+    RuleEngine& engine = parser.engine;
+
+    if (engine.length >= kMaxRuleInstructions)
+    {
+        return fail(parser, "rule engine is full");
+    }
+
+    const auto reg = static_cast<uint16_t>(engine.length);
+    engine.code[reg] = {op, a, b, value};
+
+    // Constants never change, their register is filled in once here and skipped during evaluation.
+    engine.registers[reg] = value;
+    engine.length++;
+
+    return reg;
+}
+
+static bool is_const(const RuleParser& parser, uint16_t reg)
+{
+    return parser.engine.code[reg].op == RuleOp::kConst;
+}
+
+static uint16_t emit_unary(RuleParser& parser, RuleOp op, uint16_t a)
+{
+    if (a == kNoRegister)
+    {
+        return kNoRegister;
+    }
+
+    // A constant operand is always the last instruction emitted, fold it in place.
+    if (is_const(parser, a))
+    {
+        parser.engine.length = a;
+        return emit(parser, RuleOp::kConst, 0U, 0U, apply(op, parser.engine.code[a].value, 0.0f));
+    }
+
+    return emit(parser, op, a, 0U, 0.0f);
+}
+
+static uint16_t emit_binary(RuleParser& parser, RuleOp op, uint16_t a, uint16_t b)
+{
+    if ((a == kNoRegister) || (b == kNoRegister))
+    {
+        return kNoRegister;
+    }
+
+    // Both constant operands are the last two instructions emitted, fold them in place.
+    if (is_const(parser, a) && is_const(parser, b))
+    {
+        const float value = apply(op, parser.engine.code[a].value, parser.engine.code[b].value);
+        parser.engine.length = a;
+        return emit(parser, RuleOp::kConst, 0U, 0U, value);
+    }
+
+    return emit(parser, op, a, b, 0.0f);
+}
+
+static void skip_whitespace(RuleParser& parser)
+{
+    while (isspace(static_cast<unsigned char>(*parser.cursor)))
+    {
+        parser.cursor++;
+    }
+}
+
+static bool accept(RuleParser& parser, const char* token)
+{
+    skip_whitespace(parser);
+
+    const size_t length = strlen(token);
+    if (strncmp(parser.cursor, token, length) != 0)
+    {
+        return false;
+    }
+
+    // Do not take the first character of a two character operator.
+    const char next = parser.cursor[length];
+    if ((length == 1U) && ((token[0] == '<') || (token[0] == '>') || (token[0] == '!')) && (next == '='))
+    {
+        return false;
+    }
+
+    parser.cursor += length;
+    return true;
+}
+
+static bool is_identifier_char(char c, bool first)
+{
+    const auto uc = static_cast<unsigned char>(c);
+    return (isalpha(uc) != 0) || (c == '_') || (!first && (isdigit(uc) != 0));
+}
+
+static uint16_t parse_expression(RuleParser& parser);
+
+static uint16_t parse_primary(RuleParser& parser)
+{
+    skip_whitespace(parser);
+
+    const char c = *parser.cursor;
+
+    if (accept(parser, "("))
+    {
+        const uint16_t reg = parse_expression(parser);
+
+        if ((reg != kNoRegister) && !accept(parser, ")"))
+        {
+            return fail(parser, "expected ')'");
+        }
+
+        return reg;
+    }
+
+    if ((isdigit(static_cast<unsigned char>(c)) != 0) || (c == '.'))
+    {
+        char* end = nullptr;
+        const float value = strtof(parser.cursor, &end);
+
+        if (end == parser.cursor)
+        {
+            return fail(parser, "malformed number");
+        }
+
+        parser.cursor = end;
+        if ((*parser.cursor == 'f') || (*parser.cursor == 'F'))
+        {
+            parser.cursor++;
+        }
+
+        return emit(parser, RuleOp::kConst, 0U, 0U, value);
+    }
+
+    if (is_identifier_char(c, true))
+    {
+        const char* name = parser.cursor;
+        while (is_identifier_char(*parser.cursor, false))
+        {
+            parser.cursor++;
+        }
+
+        const auto length = static_cast<size_t>(parser.cursor - name);
+
+        if ((length == 4U) && (strncmp(name, "true", length) == 0))
+        {
+            return emit(parser, RuleOp::kConst, 0U, 0U, 1.0f);
+        }
+
+        if ((length == 5U) && (strncmp(name, "false", length) == 0))
+        {
+            return emit(parser, RuleOp::kConst, 0U, 0U, 0.0f);
+        }
+
+        const SignalSlot slot = signal_db_find(name, length);
+        if (slot == kInvalidSignalSlot)
+        {
+            parser.cursor = name;
+            return fail(parser, "unknown signal");
+        }
+
+        return emit(parser, RuleOp::kLoad, slot, 0U, 0.0f);
+    }
+
+    return fail(parser, "expected a value");
+}
+
+static uint16_t parse_unary(RuleParser& parser)
+{
+    if (accept(parser, "-"))
+    {
+        return emit_unary(parser, RuleOp::kNeg, parse_unary(parser));
+    }
+
+    if (accept(parser, "!"))
+    {
+        return emit_unary(parser, RuleOp::kNot, parse_unary(parser));
+    }
+
+    return parse_primary(parser);
+}
+
+static uint16_t parse_term(RuleParser& parser)
+{
+    uint16_t reg = parse_unary(parser);
+
+    while (reg != kNoRegister)
+    {
+        if (accept(parser, "*"))
+        {
+            reg = emit_binary(parser, RuleOp::kMul, reg, parse_unary(parser));
+        }
+        else if (accept(parser, "/"))
+        {
+            reg = emit_binary(parser, RuleOp::kDiv, reg, parse_unary(parser));
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return reg;
+}
+
+static uint16_t parse_additive(RuleParser& parser)
+{
+    uint16_t reg = parse_term(parser);
+
+    while (reg != kNoRegister)
+    {
+        if (accept(parser, "+"))
+        {
+            reg = emit_binary(parser, RuleOp::kAdd, reg, parse_term(parser));
+        }
+        else if (accept(parser, "-"))
+        {
+            reg = emit_binary(parser, RuleOp::kSub, reg, parse_term(parser));
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return reg;
+}
+
+static uint16_t parse_relational(RuleParser& parser)
+{
+    uint16_t reg = parse_additive(parser);
+
+    while (reg != kNoRegister)
+    {
+        if (accept(parser, "<="))
+        {
+            reg = emit_binary(parser, RuleOp::kLe, reg, parse_additive(parser));
+        }
+        else if (accept(parser, ">="))
+        {
+            reg = emit_binary(parser, RuleOp::kGe, reg, parse_additive(parser));
+        }
+        else if (accept(parser, "<"))
+        {
+            reg = emit_binary(parser, RuleOp::kLt, reg, parse_additive(parser));
+        }
+        else if (accept(parser, ">"))
+        {
+            reg = emit_binary(parser, RuleOp::kGt, reg, parse_additive(parser));
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return reg;
+}
+
+static uint16_t parse_equality(RuleParser& parser)
+{
+    uint16_t reg = parse_relational(parser);
+
+    while (reg != kNoRegister)
+    {
+        if (accept(parser, "=="))
+        {
+            reg = emit_binary(parser, RuleOp::kEq, reg, parse_relational(parser));
+        }
+        else if (accept(parser, "!="))
+        {
+            reg = emit_binary(parser, RuleOp::kNe, reg, parse_relational(parser));
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return reg;
+}
+
+static uint16_t parse_and(RuleParser& parser)
+{
+    uint16_t reg = parse_equality(parser);
+
+    while ((reg != kNoRegister) && accept(parser, "&&"))
+    {
+        reg = emit_binary(parser, RuleOp::kAnd, reg, parse_equality(parser));
+    }
+
+    return reg;
+}
+
+static uint16_t parse_expression(RuleParser& parser)
+{
+    uint16_t reg = parse_and(parser);
+
+    while ((reg != kNoRegister) && accept(parser, "||"))
+    {
+        reg = emit_binary(parser, RuleOp::kOr, reg, parse_and(parser));
+    }
+
+    return reg;
+}
+
+void rule_engine_clear(RuleEngine& engine)
+{
+    engine.length = 0U;
+    engine.rules = 0U;
+}
+
+bool rule_engine_add(RuleEngine& engine, const char* expression, SignalSlot output, RuleCompileError* error)
+{
+    RuleParser parser = {engine, expression, expression, {nullptr, 0U}};
+    const size_t start = engine.length;
+
+    uint16_t reg = parse_expression(parser);
+
+    skip_whitespace(parser);
+    if ((reg != kNoRegister) && (*parser.cursor != '\0'))
+    {
+        reg = fail(parser, "unexpected character");
+    }
+
+    if ((reg != kNoRegister) && (output == kInvalidSignalSlot))
+    {
+        reg = fail(parser, "invalid output signal");
+    }
+
+    if ((reg == kNoRegister) || (emit(parser, RuleOp::kStore, output, reg, 0.0f) == kNoRegister))
+    {
+        engine.length = start;
+
+        if (error != nullptr)
+        {
+            *error = parser.error;
+        }
+
+        return false;
+    }
+
+    engine.rules++;
+    return true;
+}
+
+void rule_engine_evaluate(RuleEngine& engine, float* signals)
+{
+    const RuleInstruction* code = &engine.code[0];
+    float* r = &engine.registers[0];
+
+    for (size_t i = 0U; i < engine.length; i++)
+    {
+        const RuleInstruction& ins = code[i];
+
+        switch (ins.op)
+        {
+            case RuleOp::kConst:
+                break;
+
+            case RuleOp::kLoad:
+                r[i] = signals[ins.a];
+                break;
+
+            case RuleOp::kStore:
+                signals[ins.a] = r[ins.b];
+                break;
+
+            default:
+                r[i] = apply(ins.op, r[ins.a], r[ins.b]);
+                break;
+        }
+    }
+}
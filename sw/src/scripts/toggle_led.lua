@@ -0,0 +1,2 @@
+-- Heartbeat on LED1.
+every(1000, toggle_led)
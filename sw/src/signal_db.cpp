@@ -0,0 +1,56 @@
+#include "signal_db.h"
+
+#include <array>
+#include <cstring>
+
+static std::array<const char*, kMaxSignals> signal_names = {};
+static std::array<float, kMaxSignals> signal_values = {};
+static size_t signal_count = 0U;
+
+SignalSlot signal_db_add(const char* name, float initial_value)
+{
+    SignalSlot slot = signal_db_find(name);
+
+    if ((slot == kInvalidSignalSlot) && (signal_count < kMaxSignals))
+    {
+        slot = static_cast<SignalSlot>(signal_count);
+        signal_names[slot] = name;
+        signal_values[slot] = initial_value;
+        signal_count++;
+    }
+
+    return slot;
+}
+
+SignalSlot signal_db_find(const char* name)
+{
+    return signal_db_find(name, strlen(name));
+}
+
+SignalSlot signal_db_find(const char* name, size_t length)
+{
+    for (size_t slot = 0U; slot < signal_count; slot++)
+    {
+        if ((strncmp(signal_names[slot], name, length) == 0) && (signal_names[slot][length] == '\0'))
+        {
+            return static_cast<SignalSlot>(slot);
+        }
+    }
+
+    return kInvalidSignalSlot;
+}
+
+const char* signal_db_name(SignalSlot slot)
+{
+    return (slot < signal_count) ? signal_names[slot] : nullptr;
+}
+
+size_t signal_db_count()
+{
+    return signal_count;
+}
+
+float* signal_db_values()
+{
+    return &signal_values[0];
+}
@@ -11,6 +11,10 @@ extern "C"
 
 #include "board.h"
 
+#include "conf_features.h"
+#include "cycle_timer.h"
+#include "ptp_clock.h"
+
 constexpr const char* kAdcTaskName = "ADC";
 constexpr uint32_t kAdcTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
 constexpr UBaseType_t kAdcTaskPriority = tskIDLE_PRIORITY;
@@ -23,6 +27,13 @@ static TaskHandle_t adc_task_handle = nullptr;
 
 static QueueHandle_t queue_adc_sample = {};
 
+// Conversion result, stamped with the cycle counter at its end of conversion interrupt.
+struct AdcSample
+{
+    uint32_t value;
+    uint32_t timestamp_cycles;
+};
+
 /** Reference voltage for AFEC,in mv. */
 constexpr uint32_t kVoltRef = 3300UL;
 
@@ -58,10 +69,10 @@ void AFEC1_Handler(void)
     traceISR_ENTER();
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-    uint32_t ul_value = afec_channel_get_value(AFEC1, PIN_HIGHSIDE12_ADC_CHANNEL);
+    const AdcSample sample = {afec_channel_get_value(AFEC1, PIN_HIGHSIDE12_ADC_CHANNEL), cycle_timer_now()};
 
-    /* Post the byte. */
-    xQueueSendFromISR(queue_adc_sample, &ul_value, &xHigherPriorityTaskWoken);
+    /* Post the sample. */
+    xQueueSendFromISR(queue_adc_sample, &sample, &xHigherPriorityTaskWoken);
 
     /* Now the buffer is empty we can switch context if necessary. */
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
@@ -69,7 +80,7 @@ void AFEC1_Handler(void)
 
 static void task_adc(void* /*pvParameters*/)
 {
-    uint32_t rx_adc_sample = 0U;
+    AdcSample rx_adc_sample = {};
     TickType_t last_wake_time_ticks = xTaskGetTickCount();
 
     while (true)
@@ -77,7 +88,13 @@ static void task_adc(void* /*pvParameters*/)
         afec_start_software_conversion(AFEC1);
         if (xQueueReceive(queue_adc_sample, &rx_adc_sample, portMAX_DELAY) == pdPASS)
         {
-            SEGGER_SYSVIEW_PrintfTarget("ADC is: %d", rx_adc_sample);
+            // Microseconds of the PTP clock modulo 2^32, or of the cycle counter without PTP.
+            const auto timestamp_us = features::kEnablePtp ?
+                static_cast<uint32_t>(static_cast<uint64_t>(ptp_clock_from_cycles(rx_adc_sample.timestamp_cycles)) /
+                    1000U) :
+                cycles_to_us(rx_adc_sample.timestamp_cycles);
+
+            SEGGER_SYSVIEW_PrintfTarget("ADC is: %d at %u us", rx_adc_sample.value, timestamp_us);
         }
 
         vTaskDelayUntil(&last_wake_time_ticks, kAdcTaskRateTicks);
@@ -86,7 +103,7 @@ static void task_adc(void* /*pvParameters*/)
 
 bool create_task_adc()
 {
-    queue_adc_sample = xQueueCreate(2U, sizeof(uint32_t));
+    queue_adc_sample = xQueueCreate(2U, sizeof(AdcSample));
 
     adc_task_handle = xTaskCreateStatic(
         &task_adc,
@@ -0,0 +1,311 @@
+#include "task_can.h"
+
+#include "can_dbc.h"
+#include "can_filter_planner.h"
+#include "can_frame.h"
+#include "can_stats.h"
+#include "can_tx_scheduler.h"
+#include "cycle_timer.h"
+#include "mcan_rx.h"
+#include "signal_db.h"
+#include "task_can_bridge.h"
+#include "task_iso_tp.h"
+
+#include "conf_board.h"
+#include "conf_can.h"
+#include "conf_features.h"
+#include "conf_iso_tp.h"
+#include "conf_logic.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+constexpr const char* kCanTaskName = "CAN";
+constexpr uint32_t kCanTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kCanTaskPriority = tskIDLE_PRIORITY + 2;
+
+// Frames received are also handed over to the CAN bridge, see task_can_bridge.h.
+constexpr bool kCanBridgeEnabled = features::kEnableCanBridge && features::kEnableEthernet;
+
+// Frames of the ISO-TP sessions go to the ISO-TP task, see task_iso_tp.h.
+constexpr bool kIsoTpEnabled = features::kEnableIsoTp;
+
+// The task also wakes up without any frame to sample the statistics and report the transmit jitter.
+constexpr TickType_t kCanReportPeriod = pdMS_TO_TICKS(1000U);
+
+static StackType_t can_task_stack[kCanTaskStackSize] = {};
+static StaticTask_t can_task_buffer = {};
+
+static TaskHandle_t can_task_handle = nullptr;
+
+static can_dbc::SlotTable can_dbc_slots = {};
+
+// Identifiers received on a channel, sorted in place by the planner.
+constexpr size_t kCanMaxSubscribedIds =
+    can_dbc::kMessages.size() + logic::kCanRoutes.size() + iso_tp::kSessions.size();
+static std::array<uint32_t, kCanMaxSubscribedIds> can_standard_ids = {};
+static std::array<uint32_t, kCanMaxSubscribedIds> can_extended_ids = {};
+
+static std::array<CanFilterPlan, kCanChannels> can_standard_plans = {};
+static std::array<CanFilterPlan, kCanChannels> can_extended_plans = {};
+
+// Transmit jitter already reported, per entry of can_dbc::kTxMessages.
+static std::array<uint32_t, can_dbc::kTxMessages.size()> can_tx_jitter_reported_cycles = {};
+
+static void can_process_frame(const CanFrame& frame)
+{
+    // Frames that are not in the DBC are simply ignored here.
+    (void)can_dbc::decode(frame, signal_db_values(), can_dbc_slots);
+
+    // The longest is reported by the "can" diagnostics command.
+    can_stats_record_latency(frame.channel, cycle_timer_elapsed(frame.timestamp_cycles));
+}
+
+static void can_report_tx_jitter()
+{
+    for (size_t i = 0U; i < can_dbc::kTxMessages.size(); i++)
+    {
+        const CanTxMessageStats stats = can_tx_scheduler_get_message_stats(i);
+
+        if (stats.jitter_max_cycles > can_tx_jitter_reported_cycles[i])
+        {
+            can_tx_jitter_reported_cycles[i] = stats.jitter_max_cycles;
+            printf("CAN %s transmit jitter: %u us, %u sent, %u skipped\r\n", can_dbc::kTxMessages[i].name,
+                static_cast<unsigned>(cycles_to_us(stats.jitter_max_cycles)), static_cast<unsigned>(stats.sent),
+                static_cast<unsigned>(stats.skipped));
+        }
+    }
+}
+
+static void task_can(void* /*pvParameters*/)
+{
+    TickType_t last_report = xTaskGetTickCount();
+
+    while (true)
+    {
+        (void)ulTaskNotifyTake(pdTRUE, kCanReportPeriod);
+
+        bool received = false;
+        bool iso_tp_received = false;
+
+        for (size_t i = 0U; i < kCanChannels; i++)
+        {
+            CanFrame frame = {};
+
+            while (mcan_rx_pop(static_cast<CanChannel>(i), frame))
+            {
+                can_process_frame(frame);
+                received = true;
+
+                if constexpr (kIsoTpEnabled)
+                {
+                    iso_tp_received |= iso_tp_push(frame);
+                }
+
+                if constexpr (kCanBridgeEnabled)
+                {
+                    can_bridge_push(frame);
+                }
+            }
+        }
+
+        if (kIsoTpEnabled && iso_tp_received)
+        {
+            iso_tp_wake_up();
+        }
+
+        if (kCanBridgeEnabled && received)
+        {
+            can_bridge_wake_up();
+        }
+
+        if ((xTaskGetTickCount() - last_report) >= kCanReportPeriod)
+        {
+            last_report = xTaskGetTickCount();
+            can_stats_sample();
+            can_report_tx_jitter();
+        }
+    }
+}
+
+/**
+ * Plan the acceptance filters so that only the frames in the DBC, the frames routed from the channel and the frames of
+ * the ISO-TP sessions reach the CPU.
+ */
+static bool can_plan_filters(CanChannel channel)
+{
+    const can::ChannelConfig& config = can::kChannels[static_cast<size_t>(channel)];
+    CanFilterPlan& standard_plan = can_standard_plans[static_cast<size_t>(channel)];
+    CanFilterPlan& extended_plan = can_extended_plans[static_cast<size_t>(channel)];
+
+    size_t standard_count = 0U;
+    size_t extended_count = 0U;
+
+    for (const auto& message : can_dbc::kMessages)
+    {
+        if ((message.id & can_dbc::kExtendedIdFlag) != 0U)
+        {
+            can_extended_ids[extended_count++] = message.id & ~can_dbc::kExtendedIdFlag;
+        }
+        else
+        {
+            can_standard_ids[standard_count++] = message.id;
+        }
+    }
+
+    for (const auto& route : logic::kCanRoutes)
+    {
+        if (route.source != channel)
+        {
+            continue;
+        }
+
+        if (route.extended)
+        {
+            can_extended_ids[extended_count++] = route.id;
+        }
+        else
+        {
+            can_standard_ids[standard_count++] = route.id;
+        }
+    }
+
+    for (const auto& session : iso_tp::kSessions)
+    {
+        if ((false == kIsoTpEnabled) || (session.channel != channel))
+        {
+            continue;
+        }
+
+        if (session.extended)
+        {
+            can_extended_ids[extended_count++] = session.rx_id;
+        }
+        else
+        {
+            can_standard_ids[standard_count++] = session.rx_id;
+        }
+    }
+
+    const CanFilterRequest standard_request = {
+        .ids = can_standard_ids.data(),
+        .id_count = standard_count,
+        .priority_ids = logic::kCanPriorityIds.data(),
+        .priority_count = logic::kCanPriorityIds.size(),
+        .id_mask = kCanStandardIdMask,
+        .max_filters = std::min<size_t>(config.standard_filters, kMaxCanFilters),
+        .first_rx_buffer = 0U,
+        .max_rx_buffers = config.rx_buffers,
+    };
+
+    if (false == can_filter_plan(standard_request, standard_plan))
+    {
+        return false;
+    }
+
+    const CanFilterRequest extended_request = {
+        .ids = can_extended_ids.data(),
+        .id_count = extended_count,
+        .priority_ids = logic::kCanPriorityIds.data(),
+        .priority_count = logic::kCanPriorityIds.size(),
+        .id_mask = kCanExtendedIdMask,
+        .max_filters = std::min<size_t>(config.extended_filters, kMaxCanFilters),
+        .first_rx_buffer = standard_plan.rx_buffers,
+        .max_rx_buffers = config.rx_buffers - standard_plan.rx_buffers,
+    };
+
+    if (false == can_filter_plan(extended_request, extended_plan))
+    {
+        return false;
+    }
+
+    printf("CAN%u filters: %u standard, %u extended, %u RX buffers, %u unwanted IDs accepted\r\n",
+        static_cast<unsigned>(channel), static_cast<unsigned>(standard_plan.count),
+        static_cast<unsigned>(extended_plan.count),
+        static_cast<unsigned>(standard_plan.rx_buffers + extended_plan.rx_buffers),
+        static_cast<unsigned>(standard_plan.extra_ids + extended_plan.extra_ids));
+
+    return true;
+}
+
+static bool can_start_channel(CanChannel channel)
+{
+    if (false == can_plan_filters(channel))
+    {
+        printf("Failed to plan the CAN%u acceptance filters.\r\n", static_cast<unsigned>(channel));
+        return false;
+    }
+
+    if (false == mcan_rx_init(channel, can_task_handle, can_standard_plans[static_cast<size_t>(channel)],
+        can_extended_plans[static_cast<size_t>(channel)]))
+    {
+        printf("CAN%u message RAM crosses a 64 kB boundary.\r\n", static_cast<unsigned>(channel));
+        return false;
+    }
+
+    return true;
+}
+
+bool create_task_can()
+{
+    // The CAN task is the only writer of the signals decoded from the DBC.
+    if (false == can_dbc::resolve_slots(can_dbc_slots))
+    {
+        printf("Too many CAN signals for the signal database.\r\n");
+        return false;
+    }
+
+    can_task_handle = xTaskCreateStatic(
+        &task_can,
+        kCanTaskName,
+        kCanTaskStackSize,
+        nullptr,
+        kCanTaskPriority,
+        &can_task_stack[0],
+        &can_task_buffer
+    );
+
+    if (can_task_handle == nullptr)
+    {
+        return false;
+    }
+
+    if constexpr (board::kEnableCan0)
+    {
+        if (false == can_start_channel(CanChannel::kCan0))
+        {
+            return false;
+        }
+    }
+
+    if constexpr (board::kEnableCan1)
+    {
+        if (false == can_start_channel(CanChannel::kCan1))
+        {
+            return false;
+        }
+    }
+
+    constexpr bool kTransmitChannelEnabled =
+        (logic::kCanTransmitChannel == CanChannel::kCan0) ? board::kEnableCan0 : board::kEnableCan1;
+
+    if constexpr (kTransmitChannelEnabled)
+    {
+        can_tx_scheduler_start(can_dbc_slots);
+
+        const CanTxStats stats = can_tx_scheduler_get_stats();
+        printf("CAN%u schedule: %u messages, bus load %u.%u %%, busiest slot %u.%u %% (%u.%u %% unplanned)\r\n",
+            static_cast<unsigned>(logic::kCanTransmitChannel), static_cast<unsigned>(stats.messages),
+            static_cast<unsigned>(stats.load_permille / 10U), static_cast<unsigned>(stats.load_permille % 10U),
+            static_cast<unsigned>(stats.peak_slot_load_permille / 10U),
+            static_cast<unsigned>(stats.peak_slot_load_permille % 10U),
+            static_cast<unsigned>(stats.unplanned_peak_slot_permille / 10U),
+            static_cast<unsigned>(stats.unplanned_peak_slot_permille % 10U));
+    }
+
+    return true;
+}
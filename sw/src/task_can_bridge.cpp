@@ -0,0 +1,555 @@
+#include "task_can_bridge.h"
+
+#include "conf_features.h"
+#include "cycle_timer.h"
+#include "mcan_rx.h"
+#include "ptp_clock.h"
+#include "spsc_ring.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+constexpr const char* kCanBridgeTaskName = "CanBridge";
+constexpr uint32_t kCanBridgeTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kCanBridgeTaskPriority = tskIDLE_PRIORITY + 1;
+
+// 128 frames is over 25 ms of back to back frames at 500 kbit/s.
+constexpr size_t kCanBridgeRingSize = 128U;
+
+constexpr TickType_t kCanBridgeFlushTimeout = pdMS_TO_TICKS(2U);
+
+// Longest sleep, the microsecond clock is extended from the cycle counter at least this often.
+constexpr TickType_t kCanBridgeIdlePeriod = pdMS_TO_TICKS(1000U);
+
+// A single Ethernet frame, less the IP and UDP headers.
+constexpr size_t kCanBridgeDatagramSizeBytes = ipconfigNETWORK_MTU - 28U;
+
+// Datagrams queued on each socket while their frames wait for the TX FIFO, a burst of injected frames comes as a
+// datagram every cannelloni timeout.  Both channels together hold a third of the network buffers at most.
+constexpr UBaseType_t kCanBridgeRxDatagrams = ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS / (3U * kCanChannels);
+
+namespace cannelloni
+{
+
+constexpr uint8_t kVersion = 2U;
+constexpr uint8_t kOpData = 0U;
+
+// Extension, every frame is preceded by its start of frame time in microseconds, 32-bit big endian.  Only sent to a
+// peer sending it, stock cannelloni ignores the op code.
+constexpr uint8_t kOpTimestampedData = 0x80U;
+
+// Version, op code, sequence number and 16-bit big endian frame count.
+constexpr size_t kHeaderSizeBytes = 5U;
+
+// Linux SocketCAN identifier flags.
+constexpr uint32_t kExtendedFlag = 0x80000000U;
+constexpr uint32_t kRemoteFlag = 0x40000000U;
+constexpr uint32_t kErrorFlag = 0x20000000U;
+
+// Set in the length of CAN-FD frames, followed by a byte of CAN-FD flags.
+constexpr uint8_t kFdLength = 0x80U;
+constexpr uint8_t kFdBitRateSwitch = 0x01U;
+
+// Timestamp, identifier, length, CAN-FD flags and data.
+constexpr size_t kMaxFrameSizeBytes = 4U + 4U + 1U + 1U + kCanMaxDataBytes;
+
+}  // namespace cannelloni
+
+struct CanBridgeChannel
+{
+    Socket_t socket;
+    freertos_sockaddr peer;
+
+    // Set once a peer is known, read by the CAN task.
+    std::atomic<bool> active = false;
+
+    // Op code of the peer, for the datagrams sent to it.
+    uint8_t peer_op;
+    uint8_t sequence;
+
+    // Datagram being filled in place, nullptr until the next frame.
+    uint8_t* tx_datagram;
+    size_t tx_size;
+    uint16_t tx_frames;
+    uint8_t tx_op;
+    TickType_t tx_start;
+
+    // Datagram being injected, held while the TX FIFO is full.
+    uint8_t* rx_datagram;
+    size_t rx_size;
+    size_t rx_offset;
+    uint16_t rx_frames;
+    uint8_t rx_op;
+
+    SpscRing<CanFrame, kCanBridgeRingSize> ring;
+    CanBridgeStats stats;
+};
+
+static StackType_t can_bridge_task_stack[kCanBridgeTaskStackSize] = {};
+static StaticTask_t can_bridge_task_buffer = {};
+
+static TaskHandle_t can_bridge_task_handle = nullptr;
+
+// Given by the IP task for every datagram received, by the CAN task and by the MCAN interrupt once a TX FIFO drained.
+static StaticSemaphore_t can_bridge_wake_buffer = {};
+static SemaphoreHandle_t can_bridge_wake = nullptr;
+
+static std::array<CanBridgeChannel, kCanChannels> can_bridge_channels = {};
+
+// Cycle counter extended to 64 bits.
+static uint64_t can_bridge_clock_cycles = 0U;
+static uint32_t can_bridge_clock_last = 0U;
+
+static void can_bridge_update_clock()
+{
+    const uint32_t now = cycle_timer_now();
+
+    can_bridge_clock_cycles += now - can_bridge_clock_last;
+    can_bridge_clock_last = now;
+}
+
+/**
+ * Microseconds of the PTP clock at the timestamp, or since the cycle counter started without PTP, modulo 2^32.
+ */
+static uint32_t can_bridge_timestamp_us(uint32_t timestamp_cycles)
+{
+    if constexpr (features::kEnablePtp)
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(ptp_clock_from_cycles(timestamp_cycles)) / 1000U);
+    }
+
+    can_bridge_update_clock();
+
+    // Frames are at most a few ms old, far less than the cycle counter wraps around in.
+    const uint64_t cycles = can_bridge_clock_cycles - (can_bridge_clock_last - timestamp_cycles);
+
+    return static_cast<uint32_t>(cycles / kCyclesPerMicrosecond);
+}
+
+static void can_bridge_put_u32(uint8_t* data, uint32_t value)
+{
+    data[0] = static_cast<uint8_t>(value >> 24U);
+    data[1] = static_cast<uint8_t>(value >> 16U);
+    data[2] = static_cast<uint8_t>(value >> 8U);
+    data[3] = static_cast<uint8_t>(value);
+}
+
+static uint32_t can_bridge_get_u32(const uint8_t* data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24U) | (static_cast<uint32_t>(data[1]) << 16U) |
+        (static_cast<uint32_t>(data[2]) << 8U) | data[3];
+}
+
+static size_t can_bridge_encode(uint8_t op, const CanFrame& frame, uint8_t* data)
+{
+    size_t size = 0U;
+
+    if (op == cannelloni::kOpTimestampedData)
+    {
+        can_bridge_put_u32(&data[size], can_bridge_timestamp_us(frame.timestamp_cycles));
+        size += 4U;
+    }
+
+    uint32_t id = frame.id;
+    if ((frame.flags & can_flags::kExtended) != 0U)
+    {
+        id |= cannelloni::kExtendedFlag;
+    }
+
+    const bool remote = (frame.flags & can_flags::kRemote) != 0U;
+    if (remote)
+    {
+        id |= cannelloni::kRemoteFlag;
+    }
+
+    can_bridge_put_u32(&data[size], id);
+    size += 4U;
+
+    if ((frame.flags & can_flags::kFd) != 0U)
+    {
+        data[size++] = frame.length | cannelloni::kFdLength;
+        data[size++] = ((frame.flags & can_flags::kBitRateSwitch) != 0U) ? cannelloni::kFdBitRateSwitch : 0U;
+    }
+    else
+    {
+        data[size++] = frame.length;
+    }
+
+    if (false == remote)
+    {
+        memcpy(&data[size], &frame.data[0], frame.length);
+        size += frame.length;
+    }
+
+    return size;
+}
+
+/**
+ * Decode the next frame of the datagram being injected.
+ *
+ * \return the size of the frame in the datagram, 0 if it is malformed.
+ */
+static size_t can_bridge_decode(const CanBridgeChannel& channel, CanFrame& frame)
+{
+    const uint8_t* data = &channel.rx_datagram[channel.rx_offset];
+    const size_t available = channel.rx_size - channel.rx_offset;
+
+    // The time of a frame sent to the VCM means nothing here, it is skipped.
+    size_t size = (channel.rx_op == cannelloni::kOpTimestampedData) ? 4U : 0U;
+
+    if (available < (size + 5U))
+    {
+        return 0U;
+    }
+
+    const uint32_t id = can_bridge_get_u32(&data[size]);
+    size += 4U;
+
+    uint8_t length = data[size++];
+
+    if ((length & cannelloni::kFdLength) != 0U)
+    {
+        if (available < (size + 1U))
+        {
+            return 0U;
+        }
+
+        frame.flags |= can_flags::kFd;
+
+        if ((data[size++] & cannelloni::kFdBitRateSwitch) != 0U)
+        {
+            frame.flags |= can_flags::kBitRateSwitch;
+        }
+
+        length &= ~cannelloni::kFdLength;
+    }
+
+    const size_t max_length = ((frame.flags & can_flags::kFd) != 0U) ? kCanMaxDataBytes : 8U;
+    if ((length > max_length) || ((id & cannelloni::kErrorFlag) != 0U))
+    {
+        return 0U;
+    }
+
+    if ((id & cannelloni::kExtendedFlag) != 0U)
+    {
+        frame.id = id & kCanExtendedIdMask;
+        frame.flags |= can_flags::kExtended;
+    }
+    else
+    {
+        frame.id = id & kCanStandardIdMask;
+    }
+
+    frame.length = length;
+
+    // Remote frames carry no data, only the length.
+    if ((id & cannelloni::kRemoteFlag) != 0U)
+    {
+        frame.flags |= can_flags::kRemote;
+    }
+    else
+    {
+        if (available < (size + length))
+        {
+            return 0U;
+        }
+
+        memcpy(&frame.data[0], &data[size], length);
+        size += length;
+    }
+
+    return size;
+}
+
+static void can_bridge_send(CanBridgeChannel& channel)
+{
+    uint8_t* datagram = channel.tx_datagram;
+    channel.tx_datagram = nullptr;
+
+    datagram[0] = cannelloni::kVersion;
+    datagram[1] = channel.tx_op;
+    datagram[2] = channel.sequence++;
+    datagram[3] = static_cast<uint8_t>(channel.tx_frames >> 8U);
+    datagram[4] = static_cast<uint8_t>(channel.tx_frames);
+
+    // The IP task owns the buffer once it took it.
+    if (FreeRTOS_sendto(channel.socket, datagram, channel.tx_size, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT,
+        &channel.peer, sizeof(channel.peer)) > 0)
+    {
+        channel.stats.datagrams_sent++;
+        channel.stats.frames_sent += channel.tx_frames;
+    }
+    else
+    {
+        FreeRTOS_ReleaseUDPPayloadBuffer(datagram);
+        channel.stats.send_failures++;
+    }
+}
+
+/**
+ * Move the frames of the ring into the datagram being filled, sending it whenever the largest frame may not fit.
+ * Without a free network buffer the frames wait in the ring.
+ */
+static void can_bridge_pack(CanBridgeChannel& channel)
+{
+    while (channel.ring.size() > 0U)
+    {
+        if ((channel.tx_datagram != nullptr) &&
+            ((kCanBridgeDatagramSizeBytes - channel.tx_size) < cannelloni::kMaxFrameSizeBytes))
+        {
+            can_bridge_send(channel);
+        }
+
+        if (channel.tx_datagram == nullptr)
+        {
+            channel.tx_datagram = static_cast<uint8_t*>(FreeRTOS_GetUDPPayloadBuffer(kCanBridgeDatagramSizeBytes, 0U));
+            if (channel.tx_datagram == nullptr)
+            {
+                return;
+            }
+
+            channel.tx_size = cannelloni::kHeaderSizeBytes;
+            channel.tx_frames = 0U;
+            channel.tx_op = channel.peer_op;
+            channel.tx_start = xTaskGetTickCount();
+        }
+
+        CanFrame frame = {};
+        (void)channel.ring.pop(frame);
+
+        channel.tx_size += can_bridge_encode(channel.tx_op, frame, &channel.tx_datagram[channel.tx_size]);
+        channel.tx_frames++;
+    }
+}
+
+/**
+ * Queue the frames left in the datagram being injected into the TX FIFO.
+ *
+ * \return false if the TX FIFO is full, the MCAN interrupt gives can_bridge_wake once it has drained.
+ */
+static bool can_bridge_inject(CanBridgeChannel& channel, CanChannel id)
+{
+    while (channel.rx_frames > 0U)
+    {
+        CanFrame frame = {};
+        frame.channel = id;
+
+        const size_t size = can_bridge_decode(channel, frame);
+        if (size == 0U)
+        {
+            // The rest of the datagram cannot be found either.
+            channel.stats.injection_errors++;
+            return true;
+        }
+
+        if (false == mcan_tx_can_send(id, frame))
+        {
+            channel.stats.injection_errors++;
+        }
+        else if (false == mcan_tx_fifo_send(id, frame))
+        {
+            if (mcan_tx_fifo_wait_empty(id, can_bridge_wake))
+            {
+                channel.stats.tx_fifo_waits++;
+                return false;
+            }
+
+            // An element was freed in the meantime.
+            continue;
+        }
+        else
+        {
+            channel.stats.frames_injected++;
+        }
+
+        channel.rx_offset += size;
+        channel.rx_frames--;
+    }
+
+    return true;
+}
+
+static void can_bridge_set_peer(CanBridgeChannel& channel, CanChannel id, const freertos_sockaddr& peer, uint8_t op)
+{
+    if ((peer.sin_addr != channel.peer.sin_addr) || (peer.sin_port != channel.peer.sin_port) ||
+        (op != channel.peer_op) || (false == channel.active.load(std::memory_order_relaxed)))
+    {
+        // sin_addr is in network order, its bytes are the octets of the address.
+        const auto* octets = reinterpret_cast<const uint8_t*>(&peer.sin_addr);
+        printf("CAN%u bridge peer: %u.%u.%u.%u:%u%s\r\n", static_cast<unsigned>(id), octets[0], octets[1], octets[2],
+            octets[3], static_cast<unsigned>(FreeRTOS_ntohs(peer.sin_port)),
+            (op == cannelloni::kOpTimestampedData) ? ", timestamped" : "");
+    }
+
+    channel.peer = peer;
+    channel.peer_op = op;
+    channel.active.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * Take the datagrams waiting on the socket and inject their frames, until the TX FIFO is full.
+ */
+static void can_bridge_receive(CanBridgeChannel& channel, CanChannel id)
+{
+    while (true)
+    {
+        if (channel.rx_datagram == nullptr)
+        {
+            uint8_t* datagram = nullptr;
+            freertos_sockaddr source = {};
+            socklen_t source_size = sizeof(source);
+
+            const int32_t size = FreeRTOS_recvfrom(channel.socket, &datagram, 0U,
+                FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT, &source, &source_size);
+            if (size <= 0)
+            {
+                return;
+            }
+
+            channel.stats.datagrams_received++;
+
+            const bool valid = (static_cast<size_t>(size) >= cannelloni::kHeaderSizeBytes) &&
+                (datagram[0] == cannelloni::kVersion) &&
+                ((datagram[1] == cannelloni::kOpData) || (datagram[1] == cannelloni::kOpTimestampedData));
+
+            if (false == valid)
+            {
+                channel.stats.injection_errors++;
+                FreeRTOS_ReleaseUDPPayloadBuffer(datagram);
+                continue;
+            }
+
+            // The last peer heard from gets every frame from now on, even an empty datagram registers it.
+            can_bridge_set_peer(channel, id, source, datagram[1]);
+
+            channel.rx_datagram = datagram;
+            channel.rx_size = static_cast<size_t>(size);
+            channel.rx_offset = cannelloni::kHeaderSizeBytes;
+            channel.rx_frames = static_cast<uint16_t>((datagram[3] << 8U) | datagram[4]);
+            channel.rx_op = datagram[1];
+        }
+
+        if (false == can_bridge_inject(channel, id))
+        {
+            return;
+        }
+
+        FreeRTOS_ReleaseUDPPayloadBuffer(channel.rx_datagram);
+        channel.rx_datagram = nullptr;
+    }
+}
+
+static void task_can_bridge(void* /*pvParameters*/)
+{
+    for (size_t i = 0U; i < kCanChannels; i++)
+    {
+        CanBridgeChannel& channel = can_bridge_channels[i];
+
+        channel.socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+        configASSERT(channel.socket != FREERTOS_INVALID_SOCKET);
+
+        FreeRTOS_setsockopt(channel.socket, 0, FREERTOS_SO_SET_SEMAPHORE, &can_bridge_wake, sizeof(can_bridge_wake));
+        FreeRTOS_setsockopt(channel.socket, 0, FREERTOS_SO_UDP_MAX_RX_PACKETS, &kCanBridgeRxDatagrams,
+            sizeof(kCanBridgeRxDatagrams));
+
+        freertos_sockaddr bind_address = {};
+        bind_address.sin_port = FreeRTOS_htons(static_cast<uint16_t>(kCanBridgeFirstPort + i));
+        FreeRTOS_bind(channel.socket, &bind_address, sizeof(bind_address));
+    }
+
+    can_bridge_clock_last = cycle_timer_now();
+    can_bridge_clock_cycles = can_bridge_clock_last;
+
+    TickType_t timeout = kCanBridgeIdlePeriod;
+
+    while (true)
+    {
+        (void)xSemaphoreTake(can_bridge_wake, timeout);
+
+        can_bridge_update_clock();
+        timeout = kCanBridgeIdlePeriod;
+
+        for (size_t i = 0U; i < kCanChannels; i++)
+        {
+            CanBridgeChannel& channel = can_bridge_channels[i];
+
+            can_bridge_receive(channel, static_cast<CanChannel>(i));
+            can_bridge_pack(channel);
+
+            if (channel.tx_datagram != nullptr)
+            {
+                const TickType_t waited = xTaskGetTickCount() - channel.tx_start;
+
+                if (waited >= kCanBridgeFlushTimeout)
+                {
+                    can_bridge_send(channel);
+                }
+                else
+                {
+                    timeout = std::min(timeout, kCanBridgeFlushTimeout - waited);
+                }
+            }
+
+            // Out of network buffers, try again soon.
+            if (channel.ring.size() > 0U)
+            {
+                timeout = std::min(timeout, kCanBridgeFlushTimeout);
+            }
+        }
+    }
+}
+
+bool create_task_can_bridge()
+{
+    can_bridge_wake = xSemaphoreCreateBinaryStatic(&can_bridge_wake_buffer);
+
+    can_bridge_task_handle = xTaskCreateStatic(
+        &task_can_bridge,
+        kCanBridgeTaskName,
+        kCanBridgeTaskStackSize,
+        nullptr,
+        kCanBridgeTaskPriority,
+        &can_bridge_task_stack[0],
+        &can_bridge_task_buffer
+    );
+
+    return can_bridge_task_handle != nullptr;
+}
+
+void can_bridge_push(const CanFrame& frame)
+{
+    CanBridgeChannel& channel = can_bridge_channels[static_cast<size_t>(frame.channel)];
+
+    if (false == channel.active.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    if (false == channel.ring.push(frame))
+    {
+        channel.stats.ring_overflows++;
+    }
+}
+
+void can_bridge_wake_up()
+{
+    if (can_bridge_wake != nullptr)
+    {
+        (void)xSemaphoreGive(can_bridge_wake);
+    }
+}
+
+CanBridgeStats can_bridge_get_stats(CanChannel channel)
+{
+    return can_bridge_channels[static_cast<size_t>(channel)].stats;
+}
@@ -0,0 +1,134 @@
+#include "task_diag.h"
+
+#include "can_stats.h"
+#include "gmac_stats.h"
+#include "task_iso_tp.h"
+#include "task_lua.h"
+#include "task_ptp.h"
+#include "task_telemetry.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+constexpr const char* kDiagTaskName = "Diag";
+constexpr uint32_t kDiagTaskStackSize = 2048U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kDiagTaskPriority = tskIDLE_PRIORITY + 1;
+
+constexpr uint16_t kDiagPort = 5002U;
+constexpr size_t kDiagRequestSizeBytes = 32U;
+constexpr size_t kDiagReplySizeBytes = 1400U;
+
+static StackType_t diag_task_stack[kDiagTaskStackSize] = {};
+static StaticTask_t diag_task_buffer = {};
+
+static TaskHandle_t diag_task_handle = nullptr;
+
+static std::array<char, kDiagReplySizeBytes> diag_reply = {};
+
+static size_t format_help(char* buffer, size_t size);
+
+/**
+ * A report the service can produce, written into the reply buffer.
+ */
+struct DiagCommand
+{
+    const char* name;
+    size_t (*format)(char* buffer, size_t size);
+};
+
+static constexpr std::array<DiagCommand, 7U> kDiagCommands = {{
+    // name       format
+    {"help",      &format_help},
+    {"lua",       &lua_format_stats},
+    {"can",       &can_stats_format_snapshot},
+    {"isotp",     &iso_tp_format_stats},
+    {"gmac",      &gmac_format_stats},
+    {"ptp",       &ptp_format_stats},
+    {"telemetry", &telemetry_format_stats},
+}};
+
+static size_t format_help(char* buffer, size_t size)
+{
+    size_t length = 0U;
+
+    for (const auto& command : kDiagCommands)
+    {
+        const int written = snprintf(&buffer[length], size - length, "%s\n", command.name);
+        if ((written < 0) || (static_cast<size_t>(written) >= (size - length)))
+        {
+            break;
+        }
+
+        length += static_cast<size_t>(written);
+    }
+
+    return length;
+}
+
+static size_t run_command(const char* request)
+{
+    for (const auto& command : kDiagCommands)
+    {
+        if (strcmp(request, command.name) == 0)
+        {
+            return command.format(&diag_reply[0], diag_reply.size());
+        }
+    }
+
+    return static_cast<size_t>(snprintf(&diag_reply[0], diag_reply.size(), "unknown command '%s'\n", request));
+}
+
+static void task_diag(void* /*pvParameters*/)
+{
+    Socket_t socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+    configASSERT(socket != FREERTOS_INVALID_SOCKET);
+
+    const TickType_t receive_timeout = portMAX_DELAY;
+    FreeRTOS_setsockopt(socket, 0, FREERTOS_SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+
+    freertos_sockaddr bind_address = {};
+    bind_address.sin_port = FreeRTOS_htons(kDiagPort);
+    FreeRTOS_bind(socket, &bind_address, sizeof(bind_address));
+
+    while (true)
+    {
+        std::array<char, kDiagRequestSizeBytes> request = {};
+        freertos_sockaddr client = {};
+        socklen_t client_size = sizeof(client);
+
+        const int32_t received = FreeRTOS_recvfrom(socket, &request[0], request.size() - 1U, 0, &client,
+            &client_size);
+        if (received <= 0)
+        {
+            continue;
+        }
+
+        // Tolerate a trailing newline from interactive tools.
+        request[strcspn(&request[0], "\r\n")] = '\0';
+
+        const size_t length = run_command(&request[0]);
+        FreeRTOS_sendto(socket, &diag_reply[0], length, 0, &client, client_size);
+    }
+}
+
+bool create_task_diag()
+{
+    diag_task_handle = xTaskCreateStatic(
+        &task_diag,
+        kDiagTaskName,
+        kDiagTaskStackSize,
+        nullptr,
+        kDiagTaskPriority,
+        &diag_task_stack[0],
+        &diag_task_buffer
+    );
+
+    return diag_task_handle != nullptr;
+}
@@ -0,0 +1,793 @@
+#include "task_iso_tp.h"
+
+#include "cycle_timer.h"
+#include "diag_format.h"
+#include "iso_tp_pci.h"
+#include "mcan_rx.h"
+#include "spsc_ring.h"
+
+#include "conf_can.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+constexpr const char* kIsoTpTaskName = "IsoTp";
+constexpr uint32_t kIsoTpTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kIsoTpTaskPriority = tskIDLE_PRIORITY + 2;
+
+// 64 frames is over 6 ms of back to back frames at 500 kbit/s, far longer than the task ever waits.
+constexpr size_t kIsoTpRingSize = 64U;
+
+constexpr TickType_t kIsoTpTimeout = pdMS_TO_TICKS(iso_tp::kTimeoutMs);
+constexpr TickType_t kIsoTpTxTimeout = pdMS_TO_TICKS(iso_tp::kTxTimeoutMs);
+constexpr TickType_t kIsoTpIdlePeriod = pdMS_TO_TICKS(1000U);
+
+constexpr bool iso_tp_valid_session(const iso_tp::SessionConfig& session)
+{
+    const can::ChannelConfig& channel = can::kChannels[static_cast<size_t>(session.channel)];
+    return (false == session.fd) ||
+        ((channel.data_bitrate != 0U) && (channel.element_data_bytes >= kIsoTpFdFrameBytes));
+}
+
+constexpr bool iso_tp_valid_sessions()
+{
+    return std::all_of(iso_tp::kSessions.begin(), iso_tp::kSessions.end(), &iso_tp_valid_session);
+}
+
+static_assert(iso_tp_valid_sessions(), "CAN-FD sessions need a channel with a data bit rate and 64-byte elements.");
+
+enum class IsoTpSendState : uint8_t
+{
+    kIdle,
+    kFirstFrame,        // Request taken, its single or first frame is still to be queued.
+    kFlowControl,       // Waiting for the flow control of the ECU.
+    kConsecutive,
+};
+
+/**
+ * A message to send, on the stack of the caller of iso_tp_send().
+ */
+struct IsoTpRequest
+{
+    const uint8_t* data;
+    size_t length;
+    TaskHandle_t requester;
+    IsoTpResult result;
+};
+
+struct IsoTpSession
+{
+    const iso_tp::SessionConfig* config;
+
+    // Receiving, rx_buffer is nullptr while no multi-frame message is in progress.
+    IsoTpBuffer* rx_buffer;
+    IsoTpReassembly rx;
+    uint8_t rx_block;               // Consecutive frames received since the last flow control.
+    bool rx_flow_pending;           // Flow control to send, with rx_flow_status.
+    uint8_t rx_flow_status;
+    TickType_t rx_last_tick;
+    uint32_t rx_start_cycles;
+
+    // Sending, request is set by iso_tp_send() and cleared here once done.
+    IsoTpRequest* request;
+    IsoTpSendState tx_state;
+    size_t tx_offset;
+    uint8_t tx_sequence;
+    uint8_t tx_block_size;          // From the flow control of the ECU, 0 for no limit.
+    uint8_t tx_block;               // Consecutive frames sent since the last flow control.
+    uint8_t tx_waits;
+    uint32_t tx_st_min_cycles;
+    uint32_t tx_last_cycles;        // When the last consecutive frame was queued.
+    uint32_t tx_start_cycles;
+    TickType_t tx_last_tick;
+
+    QueueHandle_t queue;
+    StaticQueue_t queue_buffer;
+    std::array<IsoTpBuffer*, iso_tp::kReceiveQueueLength> queue_storage;
+
+    IsoTpStats stats;
+};
+
+struct IsoTpFrame
+{
+    CanFrame frame;
+    uint8_t session;
+};
+
+static StackType_t iso_tp_task_stack[kIsoTpTaskStackSize] = {};
+static StaticTask_t iso_tp_task_buffer = {};
+
+static TaskHandle_t iso_tp_task_handle = nullptr;
+
+// Given by the CAN task, by iso_tp_send() and by the MCAN interrupt once a TX FIFO drained.
+static StaticSemaphore_t iso_tp_wake_buffer = {};
+static SemaphoreHandle_t iso_tp_wake = nullptr;
+
+// Free buffers of the pool.
+static std::array<IsoTpBuffer, iso_tp::kBuffers> iso_tp_buffers = {};
+static std::array<IsoTpBuffer*, iso_tp::kBuffers> iso_tp_pool_storage = {};
+static StaticQueue_t iso_tp_pool_buffer = {};
+static QueueHandle_t iso_tp_pool = nullptr;
+
+static std::array<IsoTpSession, iso_tp::kSessions.size()> iso_tp_sessions = {};
+
+static SpscRing<IsoTpFrame, kIsoTpRingSize> iso_tp_ring = {};
+
+static IsoTpBuffer* iso_tp_acquire()
+{
+    IsoTpBuffer* buffer = nullptr;
+    (void)xQueueReceive(iso_tp_pool, &buffer, 0U);
+
+    return buffer;
+}
+
+static size_t iso_tp_frame_bytes(const IsoTpSession& session)
+{
+    return session.config->fd ? kIsoTpFdFrameBytes : kIsoTpClassicFrameBytes;
+}
+
+/**
+ * A frame to the ECU, padded, carrying length bytes.  Classic frames always carry 8 bytes and CAN-FD frames at least
+ * 8, the driver pads them up to the next valid length from the data.
+ */
+static CanFrame iso_tp_frame(const IsoTpSession& session, size_t length)
+{
+    const iso_tp::SessionConfig& config = *session.config;
+
+    CanFrame frame = {};
+    frame.id = config.tx_id;
+    frame.channel = config.channel;
+    frame.length = static_cast<uint8_t>(std::max(length, kIsoTpClassicFrameBytes));
+    frame.flags = config.extended ? can_flags::kExtended : 0U;
+
+    if (config.fd)
+    {
+        frame.flags |= can_flags::kFd | can_flags::kBitRateSwitch;
+    }
+
+    frame.data.fill(iso_tp::kPadding);
+
+    return frame;
+}
+
+/**
+ * Queue the frame into the TX FIFO, the channel must be able to send it.
+ *
+ * \return false if the TX FIFO is full, the MCAN interrupt gives iso_tp_wake once it has drained.
+ */
+static bool iso_tp_queue(const IsoTpSession& session, const CanFrame& frame)
+{
+    while (false == mcan_tx_fifo_send(session.config->channel, frame))
+    {
+        if (mcan_tx_fifo_wait_empty(session.config->channel, iso_tp_wake))
+        {
+            return false;
+        }
+
+        // An element was freed in the meantime.
+    }
+
+    return true;
+}
+
+static void iso_tp_abort_receive(IsoTpSession& session)
+{
+    if (session.rx_buffer != nullptr)
+    {
+        iso_tp_release(session.rx_buffer);
+        session.rx_buffer = nullptr;
+        session.stats.receive_errors++;
+    }
+}
+
+static void iso_tp_deliver(IsoTpSession& session, IsoTpBuffer* buffer, uint32_t end_cycles)
+{
+    // The buffer belongs to the application once queued.
+    const size_t length = buffer->length;
+
+    if (xQueueSend(session.queue, &buffer, 0U) != pdPASS)
+    {
+        iso_tp_release(buffer);
+        session.stats.queue_drops++;
+        return;
+    }
+
+    session.stats.messages_received++;
+    session.stats.bytes_received += length;
+    session.stats.last_receive_us = cycles_to_us(end_cycles - session.rx_start_cycles);
+}
+
+static void iso_tp_receive_single(IsoTpSession& session, const CanFrame& frame, const IsoTpPci& header)
+{
+    if (false == header.valid)
+    {
+        session.stats.receive_errors++;
+        return;
+    }
+
+    // A new message from the ECU ends the one in progress.
+    iso_tp_abort_receive(session);
+
+    IsoTpBuffer* buffer = iso_tp_acquire();
+    if (buffer == nullptr)
+    {
+        session.stats.overflows++;
+        return;
+    }
+
+    memcpy(&buffer->data[0], &frame.data[header.offset], header.length);
+    buffer->length = header.length;
+
+    session.rx_start_cycles = frame.timestamp_cycles;
+    iso_tp_deliver(session, buffer, frame.timestamp_cycles);
+}
+
+static void iso_tp_receive_first(IsoTpSession& session, const CanFrame& frame, const IsoTpPci& header)
+{
+    if (false == header.valid)
+    {
+        session.stats.receive_errors++;
+        return;
+    }
+
+    iso_tp_abort_receive(session);
+
+    session.rx_flow_pending = true;
+    session.rx_last_tick = xTaskGetTickCount();
+
+    IsoTpBuffer* buffer = (header.length <= iso_tp::kMaxMessageBytes) ? iso_tp_acquire() : nullptr;
+    if (buffer == nullptr)
+    {
+        session.rx_flow_status = pci::kOverflow;
+        session.stats.overflows++;
+        return;
+    }
+
+    iso_tp_reassembly_begin(session.rx, &buffer->data[0], frame, header);
+
+    session.rx_buffer = buffer;
+    session.rx_block = 0U;
+    session.rx_flow_status = pci::kContinueToSend;
+    session.rx_start_cycles = frame.timestamp_cycles;
+}
+
+static void iso_tp_receive_consecutive(IsoTpSession& session, const CanFrame& frame, const IsoTpPci& header)
+{
+    // Consecutive frames of no message in progress are ignored.
+    IsoTpBuffer* buffer = session.rx_buffer;
+    if (buffer == nullptr)
+    {
+        return;
+    }
+
+    const IsoTpReassemblyStatus status = iso_tp_reassembly_add(session.rx, frame, header);
+    if (status == IsoTpReassemblyStatus::kSequenceError)
+    {
+        iso_tp_abort_receive(session);
+        return;
+    }
+
+    session.rx_last_tick = xTaskGetTickCount();
+
+    if (status == IsoTpReassemblyStatus::kComplete)
+    {
+        buffer->length = session.rx.length;
+        session.rx_buffer = nullptr;
+        iso_tp_deliver(session, buffer, frame.timestamp_cycles);
+        return;
+    }
+
+    const uint8_t block_size = session.config->block_size;
+    if ((block_size != 0U) && (++session.rx_block == block_size))
+    {
+        session.rx_block = 0U;
+        session.rx_flow_pending = true;
+        session.rx_flow_status = pci::kContinueToSend;
+    }
+}
+
+static void iso_tp_finish(IsoTpSession& session, IsoTpResult result)
+{
+    IsoTpRequest* request = session.request;
+    request->result = result;
+
+    if (result == IsoTpResult::kOk)
+    {
+        session.stats.messages_sent++;
+        session.stats.bytes_sent += request->length;
+        session.stats.last_send_us = cycles_to_us(cycle_timer_elapsed(session.tx_start_cycles));
+    }
+    else
+    {
+        session.stats.send_errors++;
+    }
+
+    session.tx_state = IsoTpSendState::kIdle;
+
+    taskENTER_CRITICAL();
+    session.request = nullptr;
+    taskEXIT_CRITICAL();
+
+    xTaskNotifyGive(request->requester);
+}
+
+static void iso_tp_flow_control(IsoTpSession& session, const IsoTpPci& header)
+{
+    // Flow control of no message being sent is ignored.
+    if (session.tx_state != IsoTpSendState::kFlowControl)
+    {
+        return;
+    }
+
+    if (false == header.valid)
+    {
+        iso_tp_finish(session, IsoTpResult::kAborted);
+        return;
+    }
+
+    switch (header.flow_status)
+    {
+        case pci::kContinueToSend:
+            session.tx_state = IsoTpSendState::kConsecutive;
+            session.tx_block_size = header.block_size;
+            session.tx_block = 0U;
+            session.tx_waits = 0U;
+            session.tx_st_min_cycles = us_to_cycles(iso_tp_st_min_us(header.st_min));
+
+            // The separation time only applies between consecutive frames.
+            session.tx_last_cycles = cycle_timer_now() - session.tx_st_min_cycles;
+            session.tx_last_tick = xTaskGetTickCount();
+            break;
+
+        case pci::kWait:
+            if (++session.tx_waits > iso_tp::kMaxWaits)
+            {
+                iso_tp_finish(session, IsoTpResult::kAborted);
+            }
+            else
+            {
+                session.tx_last_tick = xTaskGetTickCount();
+            }
+            break;
+
+        case pci::kOverflow:
+            iso_tp_finish(session, IsoTpResult::kOverflow);
+            break;
+
+        default:
+            iso_tp_finish(session, IsoTpResult::kAborted);
+            break;
+    }
+}
+
+static void iso_tp_handle_frame(IsoTpSession& session, const CanFrame& frame)
+{
+    if ((frame.length == 0U) || ((frame.flags & can_flags::kRemote) != 0U))
+    {
+        session.stats.receive_errors++;
+        return;
+    }
+
+    const IsoTpPci header = iso_tp_pci_decode(frame);
+
+    switch (header.type)
+    {
+        case IsoTpFrameType::kSingle:
+            iso_tp_receive_single(session, frame, header);
+            break;
+
+        case IsoTpFrameType::kFirst:
+            iso_tp_receive_first(session, frame, header);
+            break;
+
+        case IsoTpFrameType::kConsecutive:
+            iso_tp_receive_consecutive(session, frame, header);
+            break;
+
+        case IsoTpFrameType::kFlowControl:
+            iso_tp_flow_control(session, header);
+            break;
+
+        default:
+            session.stats.receive_errors++;
+            break;
+    }
+}
+
+/**
+ * Send the flow control the ECU is waiting for.
+ *
+ * \return false if the TX FIFO is full.
+ */
+static bool iso_tp_send_flow_control(IsoTpSession& session)
+{
+    if (false == session.rx_flow_pending)
+    {
+        return true;
+    }
+
+    CanFrame frame = iso_tp_frame(session, 3U);
+    iso_tp_pci_encode_flow_control(frame, session.rx_flow_status, session.config->block_size, session.config->st_min);
+
+    if (false == mcan_tx_can_send(session.config->channel, frame))
+    {
+        // The ECU times out on its own.
+        iso_tp_abort_receive(session);
+        session.rx_flow_pending = false;
+        return true;
+    }
+
+    if (false == iso_tp_queue(session, frame))
+    {
+        return false;
+    }
+
+    session.rx_flow_pending = false;
+
+    return true;
+}
+
+/**
+ * Queue the single or first frame of the message taken.
+ */
+static void iso_tp_send_first(IsoTpSession& session)
+{
+    const IsoTpRequest& request = *session.request;
+    const size_t frame_bytes = iso_tp_frame_bytes(session);
+
+    CanFrame frame = iso_tp_frame(session, frame_bytes);
+    const size_t length = iso_tp_pci_encode_first(frame, frame_bytes, request.data, request.length);
+
+    if (false == iso_tp_queue(session, frame))
+    {
+        return;
+    }
+
+    if (length == request.length)
+    {
+        iso_tp_finish(session, IsoTpResult::kOk);
+        return;
+    }
+
+    session.tx_state = IsoTpSendState::kFlowControl;
+    session.tx_offset = length;
+    session.tx_sequence = 1U;
+    session.tx_waits = 0U;
+    session.tx_last_tick = xTaskGetTickCount();
+}
+
+/**
+ * Queue the consecutive frames due, up to the end of the block.
+ *
+ * \return the cycles left until the next one is due, 0 if none is.
+ */
+static uint32_t iso_tp_send_consecutive(IsoTpSession& session)
+{
+    const IsoTpRequest& request = *session.request;
+    const size_t frame_bytes = iso_tp_frame_bytes(session);
+
+    while (session.tx_state == IsoTpSendState::kConsecutive)
+    {
+        const uint32_t elapsed = cycle_timer_elapsed(session.tx_last_cycles);
+        if (elapsed < session.tx_st_min_cycles)
+        {
+            return session.tx_st_min_cycles - elapsed;
+        }
+
+        CanFrame frame = iso_tp_frame(session, kIsoTpClassicFrameBytes);
+        const size_t length = iso_tp_pci_encode_consecutive(frame, frame_bytes, session.tx_sequence,
+            &request.data[session.tx_offset], request.length - session.tx_offset);
+
+        if (false == iso_tp_queue(session, frame))
+        {
+            return 0U;
+        }
+
+        session.tx_last_cycles = cycle_timer_now();
+        session.tx_last_tick = xTaskGetTickCount();
+        session.tx_offset += length;
+        session.tx_sequence = (session.tx_sequence + 1U) & pci::kSequenceMask;
+
+        if (session.tx_offset == request.length)
+        {
+            iso_tp_finish(session, IsoTpResult::kOk);
+        }
+        else if ((session.tx_block_size != 0U) && (++session.tx_block == session.tx_block_size))
+        {
+            session.tx_state = IsoTpSendState::kFlowControl;
+            session.tx_last_tick = xTaskGetTickCount();
+        }
+    }
+
+    return 0U;
+}
+
+/**
+ * Take the next message to send, if any.
+ */
+static void iso_tp_take_request(IsoTpSession& session)
+{
+    taskENTER_CRITICAL();
+    const bool requested = (session.request != nullptr);
+    taskEXIT_CRITICAL();
+
+    if (false == requested)
+    {
+        return;
+    }
+
+    if (false == mcan_tx_can_send(session.config->channel, iso_tp_frame(session, iso_tp_frame_bytes(session))))
+    {
+        iso_tp_finish(session, IsoTpResult::kInvalid);
+        return;
+    }
+
+    session.tx_state = IsoTpSendState::kFirstFrame;
+    session.tx_start_cycles = cycle_timer_now();
+    session.tx_last_tick = xTaskGetTickCount();
+}
+
+/**
+ * Ticks from since to now, 0 if since was taken after now.
+ */
+static TickType_t iso_tp_waited(TickType_t now, TickType_t since)
+{
+    return (static_cast<int32_t>(now - since) > 0) ? (now - since) : 0U;
+}
+
+/**
+ * Move the session on: flow control, frames to send and timeouts.
+ *
+ * \return the ticks until the session needs to be looked at again.
+ */
+static TickType_t iso_tp_service(IsoTpSession& session, TickType_t now)
+{
+    TickType_t timeout = kIsoTpIdlePeriod;
+
+    // A frame to send waiting on a full TX FIFO, checked first as the flow control below may be blocked by it too.
+    if ((session.tx_state == IsoTpSendState::kFirstFrame) || (session.tx_state == IsoTpSendState::kConsecutive))
+    {
+        const TickType_t waited = iso_tp_waited(now, session.tx_last_tick);
+
+        if (waited >= kIsoTpTxTimeout)
+        {
+            iso_tp_finish(session, IsoTpResult::kTimeout);
+        }
+        else
+        {
+            timeout = std::min(timeout, kIsoTpTxTimeout - waited);
+        }
+    }
+
+    // Blocked on a full TX FIFO, woken up once it drained.
+    if (false == iso_tp_send_flow_control(session))
+    {
+        return timeout;
+    }
+
+    if (session.rx_buffer != nullptr)
+    {
+        const TickType_t waited = now - session.rx_last_tick;
+
+        if (waited >= kIsoTpTimeout)
+        {
+            iso_tp_abort_receive(session);
+        }
+        else
+        {
+            timeout = std::min(timeout, kIsoTpTimeout - waited);
+        }
+    }
+
+    if (session.tx_state == IsoTpSendState::kIdle)
+    {
+        iso_tp_take_request(session);
+    }
+
+    if (session.tx_state == IsoTpSendState::kFirstFrame)
+    {
+        iso_tp_send_first(session);
+    }
+
+    if (session.tx_state == IsoTpSendState::kConsecutive)
+    {
+        const uint32_t due_cycles = iso_tp_send_consecutive(session);
+        if (due_cycles > 0U)
+        {
+            // The tick may come early, the separation time is checked again on waking up.
+            timeout = std::min<TickType_t>(timeout, (due_cycles + kCyclesPerTick - 1U) / kCyclesPerTick);
+        }
+    }
+
+    if (session.tx_state == IsoTpSendState::kFlowControl)
+    {
+        const TickType_t waited = iso_tp_waited(now, session.tx_last_tick);
+
+        if (waited >= kIsoTpTimeout)
+        {
+            iso_tp_finish(session, IsoTpResult::kTimeout);
+        }
+        else
+        {
+            timeout = std::min(timeout, kIsoTpTimeout - waited);
+        }
+    }
+
+    return timeout;
+}
+
+static void task_iso_tp(void* /*pvParameters*/)
+{
+    TickType_t timeout = kIsoTpIdlePeriod;
+
+    while (true)
+    {
+        (void)xSemaphoreTake(iso_tp_wake, timeout);
+
+        IsoTpFrame received = {};
+        while (iso_tp_ring.pop(received))
+        {
+            iso_tp_handle_frame(iso_tp_sessions[received.session], received.frame);
+        }
+
+        const TickType_t now = xTaskGetTickCount();
+        timeout = kIsoTpIdlePeriod;
+
+        for (auto& session : iso_tp_sessions)
+        {
+            timeout = std::min(timeout, iso_tp_service(session, now));
+        }
+    }
+}
+
+bool create_task_iso_tp()
+{
+    iso_tp_wake = xSemaphoreCreateBinaryStatic(&iso_tp_wake_buffer);
+
+    iso_tp_pool = xQueueCreateStatic(iso_tp_pool_storage.size(), sizeof(IsoTpBuffer*),
+        reinterpret_cast<uint8_t*>(iso_tp_pool_storage.data()), &iso_tp_pool_buffer);
+
+    for (auto& buffer : iso_tp_buffers)
+    {
+        iso_tp_release(&buffer);
+    }
+
+    for (size_t i = 0U; i < iso_tp_sessions.size(); i++)
+    {
+        IsoTpSession& session = iso_tp_sessions[i];
+
+        session.config = &iso_tp::kSessions[i];
+        session.queue = xQueueCreateStatic(session.queue_storage.size(), sizeof(IsoTpBuffer*),
+            reinterpret_cast<uint8_t*>(session.queue_storage.data()), &session.queue_buffer);
+    }
+
+    iso_tp_task_handle = xTaskCreateStatic(
+        &task_iso_tp,
+        kIsoTpTaskName,
+        kIsoTpTaskStackSize,
+        nullptr,
+        kIsoTpTaskPriority,
+        &iso_tp_task_stack[0],
+        &iso_tp_task_buffer
+    );
+
+    return iso_tp_task_handle != nullptr;
+}
+
+bool iso_tp_push(const CanFrame& frame)
+{
+    const bool extended = (frame.flags & can_flags::kExtended) != 0U;
+
+    for (size_t i = 0U; i < iso_tp::kSessions.size(); i++)
+    {
+        const iso_tp::SessionConfig& config = iso_tp::kSessions[i];
+
+        if ((config.rx_id != frame.id) || (config.channel != frame.channel) || (config.extended != extended))
+        {
+            continue;
+        }
+
+        if (false == iso_tp_ring.push({frame, static_cast<uint8_t>(i)}))
+        {
+            iso_tp_sessions[i].stats.ring_overflows++;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void iso_tp_wake_up()
+{
+    if (iso_tp_wake != nullptr)
+    {
+        (void)xSemaphoreGive(iso_tp_wake);
+    }
+}
+
+IsoTpResult iso_tp_send(size_t index, const uint8_t* data, size_t length)
+{
+    if ((iso_tp_wake == nullptr) || (index >= iso_tp_sessions.size()) || (length == 0U))
+    {
+        return IsoTpResult::kInvalid;
+    }
+
+    IsoTpSession& session = iso_tp_sessions[index];
+    IsoTpRequest request = {data, length, xTaskGetCurrentTaskHandle(), IsoTpResult::kOk};
+
+    (void)ulTaskNotifyTake(pdTRUE, 0U);
+
+    taskENTER_CRITICAL();
+    const bool busy = (session.request != nullptr);
+    if (!busy)
+    {
+        session.request = &request;
+    }
+    taskEXIT_CRITICAL();
+
+    if (busy)
+    {
+        return IsoTpResult::kBusy;
+    }
+
+    (void)xSemaphoreGive(iso_tp_wake);
+
+    // Every transfer ends, at the latest once the ECU stops sending flow control or the TX FIFO stops draining.
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return request.result;
+}
+
+IsoTpBuffer* iso_tp_receive(size_t index, TickType_t timeout_ticks)
+{
+    if ((iso_tp_wake == nullptr) || (index >= iso_tp_sessions.size()))
+    {
+        return nullptr;
+    }
+
+    IsoTpBuffer* buffer = nullptr;
+    (void)xQueueReceive(iso_tp_sessions[index].queue, &buffer, timeout_ticks);
+
+    return buffer;
+}
+
+void iso_tp_release(IsoTpBuffer* buffer)
+{
+    (void)xQueueSend(iso_tp_pool, &buffer, 0U);
+}
+
+IsoTpStats iso_tp_get_stats(size_t index)
+{
+    return iso_tp_sessions[index].stats;
+}
+
+size_t iso_tp_format_stats(char* buffer, size_t size)
+{
+    size_t length = 0U;
+
+    diag_append(buffer, size, length, "%-10s %4s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "session", "can",
+        "sent", "tx_bytes", "tx_err", "tx_us", "received", "rx_bytes", "rx_err", "overflow", "dropped", "rx_us", "ring");
+
+    for (size_t i = 0U; i < iso_tp_sessions.size(); i++)
+    {
+        const IsoTpStats stats = iso_tp_get_stats(i);
+
+        diag_append(buffer, size, length,
+            "%-10s %4u %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n", iso_tp::kSessions[i].name,
+            static_cast<unsigned>(iso_tp::kSessions[i].channel), static_cast<unsigned long>(stats.messages_sent),
+            static_cast<unsigned long>(stats.bytes_sent), static_cast<unsigned long>(stats.send_errors),
+            static_cast<unsigned long>(stats.last_send_us), static_cast<unsigned long>(stats.messages_received),
+            static_cast<unsigned long>(stats.bytes_received), static_cast<unsigned long>(stats.receive_errors),
+            static_cast<unsigned long>(stats.overflows), static_cast<unsigned long>(stats.queue_drops),
+            static_cast<unsigned long>(stats.last_receive_us), static_cast<unsigned long>(stats.ring_overflows));
+    }
+
+    return length;
+}
@@ -1,5 +1,18 @@
 #include "task_lua.h"
 
+#include "cycle_timer.h"
+#include "lua_arena.h"
+#include "lua_async.h"
+#include "lua_scheduler.h"
+#include "lua_scripts.h"
+#include "lua_signals.h"
+#include "lua_watchdog.h"
+#include "rule_engine.h"
+#include "signal_db.h"
+
+#include "conf_features.h"
+#include "conf_logic.h"
+
 #include "ioport.h"
 
 #include "FreeRTOS.h"
@@ -12,18 +25,55 @@ extern "C"
 #include "lauxlib.h"
 }
 
+#include <algorithm>
+#include <cstdio>
+
 constexpr const char* kLuaTaskName = "Lua";
 constexpr uint32_t kLuaTaskStackSize = (10U * 1024U) / sizeof(portSTACK_TYPE);
 constexpr UBaseType_t kLuaTaskPriority = tskIDLE_PRIORITY;
-constexpr TickType_t kTaskRateTicks = pdMS_TO_TICKS(1000);
+constexpr TickType_t kRuleRateTicks = pdMS_TO_TICKS(10);
+
+// Longest sleep when no callback is registered and no rule is loaded.
+constexpr TickType_t kIdleRateTicks = pdMS_TO_TICKS(1000);
+
+// Budget for running the main chunk of an embedded script at boot, before the scheduler starts.
+constexpr uint32_t kLuaLoadBudgetCycles = us_to_cycles(100000U);
+
+// Budget for running the main chunk of a script reloaded between two cycles, the budget of a callback of the fastest
+// rate group so a reload delays the callbacks no more than one of them does.
+constexpr uint32_t kLuaReloadBudgetCycles = us_to_cycles(kLuaRatesMs[0] * 500U);
+
+// Slack left untouched before the next deadline, covers the longest single collector step.
+constexpr uint32_t kLuaGcGuardCycles = us_to_cycles(250U);
+
+// Memory available to the Lua VM.  Kept out of the newlib heap so allocation time and fragmentation are bounded.
+constexpr size_t kLuaArenaSizeBytes = 64U * 1024U;
 
 static StackType_t lua_task_stack[kLuaTaskStackSize] = {};
 static StaticTask_t lua_task_buffer = {};
 
 static TaskHandle_t lua_task_handle = nullptr;
 
+alignas(kLuaArenaGranularity) static uint8_t lua_arena_buffer[kLuaArenaSizeBytes] = {};
+static LuaArena lua_arena = {};
+
 static lua_State* L = nullptr;
 
+static RuleEngine rule_engine = {};
+
+// Longest cycle of the task, collector steps in the slack excluded.
+static uint32_t lua_cycle_wcet_cycles = 0U;
+
+// Reload handed over by another task, taken by the Lua task between two cycles.
+static LuaReload* pending_reload = nullptr;
+
+static int lua_panic(lua_State* state)
+{
+    printf("Lua panic: %s\r\n", lua_tostring(state, -1));
+
+    return 0;
+}
+
 static int toggle_led(lua_State* /*L*/)
 {
     ioport_toggle_pin_level(LED1_GPIO);
@@ -31,25 +81,249 @@ static int toggle_led(lua_State* /*L*/)
     return 0;
 }
 
+/**
+ * Load and run the main chunk of a script, committing the callbacks it registers only if it succeeds.  The callbacks
+ * are then called by the scheduler through their references in the Lua registry.
+ */
+static bool lua_script_load(const char* name, const char* chunk, size_t size, uint32_t budget_cycles,
+    TickType_t now_ticks)
+{
+    // Binary chunks only, compiled at build time or by the upload task from source.
+    if (LUA_OK != luaL_loadbufferx(L, chunk, size, name, "b"))
+    {
+        printf("Failed to compile %s: %s\r\n", name, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return false;
+    }
+
+    const LuaScriptId id = lua_watchdog_add_script(name);
+    const uint32_t serial = lua_async_serial();
+    lua_scheduler_begin(id);
+
+    if (false == lua_watchdog_pcall(L, id, 0, budget_cycles))
+    {
+        lua_scheduler_rollback(L);
+        lua_async_kill_since(L, id, serial);
+        return false;
+    }
+
+    lua_scheduler_commit(L, now_ticks);
+    lua_async_kill_before(L, id, serial);
+
+    return true;
+}
+
+static void lua_take_reload(TickType_t now_ticks)
+{
+    taskENTER_CRITICAL();
+    LuaReload* reload = pending_reload;
+    pending_reload = nullptr;
+    taskEXIT_CRITICAL();
+
+    if (reload == nullptr)
+    {
+        return;
+    }
+
+    const uint32_t start = cycle_timer_now();
+    reload->loaded = lua_script_load(reload->name, reinterpret_cast<const char*>(reload->chunk), reload->size,
+        kLuaReloadBudgetCycles, now_ticks);
+    reload->swap_cycles = cycle_timer_elapsed(start);
+
+    xTaskNotifyGive(reload->requester);
+}
+
+bool lua_reload(LuaReload& reload, TickType_t timeout_ticks)
+{
+    reload.requester = xTaskGetCurrentTaskHandle();
+    reload.loaded = false;
+    reload.swap_cycles = 0U;
+
+    (void)ulTaskNotifyTake(pdTRUE, 0U);
+
+    taskENTER_CRITICAL();
+    const bool busy = (pending_reload != nullptr);
+    if (!busy)
+    {
+        pending_reload = &reload;
+    }
+    taskEXIT_CRITICAL();
+
+    if (busy)
+    {
+        return false;
+    }
+
+    if (0U != ulTaskNotifyTake(pdTRUE, timeout_ticks))
+    {
+        return true;
+    }
+
+    // Withdraw the request, unless the Lua task took it in the meantime and is about to finish it.
+    taskENTER_CRITICAL();
+    const bool withdrawn = (pending_reload == &reload);
+    if (withdrawn)
+    {
+        pending_reload = nullptr;
+    }
+    taskEXIT_CRITICAL();
+
+    if (!withdrawn)
+    {
+        (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    return !withdrawn;
+}
+
+static void load_rules()
+{
+    rule_engine_clear(rule_engine);
+
+    for (const auto& rule : logic::kRules)
+    {
+        RuleCompileError error = {};
+
+        if (false == rule_engine_add(rule_engine, rule.expression, signal_db_find(rule.output), &error))
+        {
+            printf("Failed to compile rule %s: %s at %u\r\n", rule.output, error.message,
+                static_cast<unsigned>(error.position));
+        }
+    }
+}
+
+/**
+ * Step the collector until it completes a cycle or the slack before the next deadline is used up.  The collector is
+ * stopped otherwise, so it never runs from an allocation inside a script.
+ */
+static void lua_gc_in_slack(uint32_t cycle_start, uint32_t slack_cycles)
+{
+    while ((cycle_timer_elapsed(cycle_start) + kLuaGcGuardCycles) < slack_cycles)
+    {
+        if (0 != lua_gc(L, LUA_GCSTEP, 0))
+        {
+            break;
+        }
+    }
+}
+
 static void task_lua(void* /*pvParameters*/)
 {
     TickType_t last_wake_time_ticks = xTaskGetTickCount();
+    TickType_t rule_release_ticks = last_wake_time_ticks;
 
     while (true)
     {
-        //ioport_toggle_pin_level(LED1_GPIO);
-        luaL_dostring(L, "toggle_led()");
-        vTaskDelayUntil(&last_wake_time_ticks, kTaskRateTicks);
+        const uint32_t cycle_start = cycle_timer_now();
+        const TickType_t now_ticks = last_wake_time_ticks;
+
+        lua_take_reload(now_ticks);
+
+        if ((rule_engine.rules > 0U) && tick_reached(now_ticks, rule_release_ticks))
+        {
+            rule_engine_evaluate(rule_engine, signal_db_values());
+
+            do
+            {
+                rule_release_ticks += kRuleRateTicks;
+            } while (tick_reached(now_ticks, rule_release_ticks));
+        }
+
+        lua_scheduler_dispatch(L, now_ticks);
+        lua_async_dispatch(L, now_ticks);
+
+        TickType_t next_release_ticks = lua_scheduler_next_release(now_ticks, kIdleRateTicks);
+        const TickType_t async_release_ticks = lua_async_next_release(now_ticks, kIdleRateTicks);
+        if (tick_reached(next_release_ticks, async_release_ticks))
+        {
+            next_release_ticks = async_release_ticks;
+        }
+
+        if ((rule_engine.rules > 0U) && tick_reached(next_release_ticks, rule_release_ticks))
+        {
+            next_release_ticks = rule_release_ticks;
+        }
+
+        const uint32_t cycle_cycles = cycle_timer_elapsed(cycle_start);
+        if (cycle_cycles > lua_cycle_wcet_cycles)
+        {
+            taskENTER_CRITICAL();
+            lua_cycle_wcet_cycles = cycle_cycles;
+            taskEXIT_CRITICAL();
+        }
+
+        if constexpr (features::kLuaGcInSlack)
+        {
+            // No slack at all when the next release is already due.
+            const TickType_t slack_ticks = tick_reached(now_ticks, next_release_ticks) ? 0U :
+                (next_release_ticks - now_ticks);
+            lua_gc_in_slack(cycle_start, slack_ticks * kCyclesPerTick);
+        }
+
+        vTaskDelayUntil(&last_wake_time_ticks, next_release_ticks - last_wake_time_ticks);
+    }
+}
+
+size_t lua_format_stats(char* buffer, size_t size)
+{
+    taskENTER_CRITICAL();
+    const uint32_t wcet_cycles = lua_cycle_wcet_cycles;
+    taskEXIT_CRITICAL();
+
+    size_t length = 0U;
+    const int written = snprintf(buffer, size, "cycle WCET %lu us, GC %s\n\n",
+        static_cast<unsigned long>(cycles_to_us(wcet_cycles)), features::kLuaGcInSlack ? "in slack" : "automatic");
+    if (written > 0)
+    {
+        length = std::min(static_cast<size_t>(written), size - 1U);
     }
+
+    return length + lua_watchdog_format_stats(&buffer[length], size - length);
 }
 
 bool create_task_lua()
 {
-    L = luaL_newstate();
+    load_rules();
+
+    lua_arena_init(lua_arena, &lua_arena_buffer[0], sizeof(lua_arena_buffer));
+
+    L = lua_newstate(&lua_arena_alloc, &lua_arena);
+    if (L == nullptr)
+    {
+        return false;
+    }
+
+    lua_atpanic(L, &lua_panic);
+    lua_watchdog_init(L);
     luaL_openlibs(L);
+    lua_open_signals(L);
+    lua_open_scheduler(L);
+    lua_open_async(L);
     lua_pushcfunction(L, toggle_led);
     lua_setglobal(L, "toggle_led");
 
+    // Scripts are precompiled on the host, their code is executed straight from flash.
+    const uint32_t load_start = cycle_timer_now();
+    for (size_t i = 0U; i < kLuaEmbeddedScriptCount; i++)
+    {
+        const LuaEmbeddedScript& script = kLuaEmbeddedScripts[i];
+        lua_script_load(script.name, reinterpret_cast<const char*>(script.chunk), script.size, kLuaLoadBudgetCycles,
+            xTaskGetTickCount());
+    }
+    const uint32_t load_cycles = cycle_timer_elapsed(load_start);
+
+    // Start the control loop from a clean heap.
+    lua_gc(L, LUA_GCCOLLECT);
+    if constexpr (features::kLuaGcInSlack)
+    {
+        lua_gc(L, LUA_GCSTOP);
+    }
+
+    const LuaArenaStats stats = lua_arena_get_stats(lua_arena);
+    printf("Lua arena: %u of %u bytes in use, scripts loaded in %lu us\r\n",
+        static_cast<unsigned>(stats.in_use_bytes), static_cast<unsigned>(stats.size_bytes),
+        static_cast<unsigned long>(cycles_to_us(load_cycles)));
+
     lua_task_handle = xTaskCreateStatic(
         &task_lua,
         kLuaTaskName,
@@ -0,0 +1,262 @@
+#include "task_lua_upload.h"
+
+#include "cycle_timer.h"
+#include "lua_arena.h"
+#include "lua_watchdog.h"
+#include "task_lua.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+constexpr const char* kLuaUploadTaskName = "LuaUpload";
+constexpr uint32_t kLuaUploadTaskStackSize = 4096U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kLuaUploadTaskPriority = tskIDLE_PRIORITY;
+
+constexpr uint16_t kLuaUploadPort = 5003U;
+constexpr TickType_t kLuaUploadReceiveTimeoutTicks = pdMS_TO_TICKS(5000);
+constexpr TickType_t kLuaUploadSwapTimeoutTicks = pdMS_TO_TICKS(5000);
+
+constexpr size_t kLuaUploadHeaderSizeBytes = 32U;
+constexpr size_t kLuaUploadMaxSizeBytes = 16U * 1024U;
+constexpr size_t kLuaUploadArenaSizeBytes = 32U * 1024U;
+
+static StackType_t lua_upload_task_stack[kLuaUploadTaskStackSize] = {};
+static StaticTask_t lua_upload_task_buffer = {};
+
+static TaskHandle_t lua_upload_task_handle = nullptr;
+
+static std::array<uint8_t, kLuaUploadMaxSizeBytes> upload_buffer = {};
+static std::array<uint8_t, kLuaUploadMaxSizeBytes> bytecode_buffer = {};
+static size_t bytecode_size = 0U;
+
+// The scratch state only lives while a chunk is compiled.
+alignas(kLuaArenaGranularity) static uint8_t scratch_arena_buffer[kLuaUploadArenaSizeBytes] = {};
+static LuaArena scratch_arena = {};
+
+static int dump_writer(lua_State* /*state*/, const void* data, size_t size, void* /*ud*/)
+{
+    if (size > (bytecode_buffer.size() - bytecode_size))
+    {
+        return 1;
+    }
+
+    memcpy(&bytecode_buffer[bytecode_size], data, size);
+    bytecode_size += size;
+
+    return 0;
+}
+
+/**
+ * Compile source in a scratch state and dump it into bytecode_buffer.  Binary chunks are refused, Lua does not verify
+ * bytecode when it loads it and a crafted chunk could corrupt any memory of the target.
+ */
+static bool compile(const char* name, size_t size, char* error, size_t error_size)
+{
+    lua_arena_init(scratch_arena, &scratch_arena_buffer[0], sizeof(scratch_arena_buffer));
+
+    lua_State* scratch = lua_newstate(&lua_arena_alloc, &scratch_arena);
+    if (scratch == nullptr)
+    {
+        snprintf(error, error_size, "no memory for the scratch state");
+        return false;
+    }
+
+    bool ret = false;
+    bytecode_size = 0U;
+
+    if (LUA_OK != luaL_loadbufferx(scratch, reinterpret_cast<const char*>(&upload_buffer[0]), size, name, "t"))
+    {
+        snprintf(error, error_size, "%s", lua_tostring(scratch, -1));
+    }
+    else if (0 != lua_dump(scratch, &dump_writer, nullptr, 0))
+    {
+        snprintf(error, error_size, "bytecode larger than %u bytes", static_cast<unsigned>(bytecode_buffer.size()));
+    }
+    else
+    {
+        ret = true;
+    }
+
+    lua_close(scratch);
+
+    return ret;
+}
+
+static bool receive_exact(Socket_t socket, uint8_t* data, size_t size)
+{
+    size_t received = 0U;
+
+    while (received < size)
+    {
+        const BaseType_t bytes = FreeRTOS_recv(socket, &data[received], size - received, 0);
+        if (bytes <= 0)
+        {
+            return false;
+        }
+
+        received += static_cast<size_t>(bytes);
+    }
+
+    return true;
+}
+
+static bool receive_header(Socket_t socket, std::array<char, kLuaScriptNameSize>& name, size_t& size)
+{
+    std::array<char, kLuaUploadHeaderSizeBytes> header = {};
+
+    for (size_t i = 0U; i < (header.size() - 1U); i++)
+    {
+        if (false == receive_exact(socket, reinterpret_cast<uint8_t*>(&header[i]), 1U))
+        {
+            return false;
+        }
+
+        if (header[i] == '\n')
+        {
+            header[i] = '\0';
+
+            char* separator = strchr(&header[0], ' ');
+            if ((separator == nullptr) || (separator == &header[0]))
+            {
+                return false;
+            }
+
+            *separator = '\0';
+            strncpy(&name[0], &header[0], name.size() - 1U);
+            size = strtoul(separator + 1, nullptr, 10);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void handle_upload(Socket_t socket)
+{
+    std::array<char, kLuaScriptNameSize> name = {};
+    std::array<char, 160U> reply = {};
+    size_t size = 0U;
+
+    const uint32_t upload_start = cycle_timer_now();
+
+    if (false == receive_header(socket, name, size))
+    {
+        snprintf(&reply[0], reply.size(), "error: expected '<name> <size>\\n'\n");
+    }
+    else if ((size == 0U) || (size > upload_buffer.size()))
+    {
+        snprintf(&reply[0], reply.size(), "error: size must be 1 to %u bytes\n",
+            static_cast<unsigned>(upload_buffer.size()));
+    }
+    else if (false == receive_exact(socket, &upload_buffer[0], size))
+    {
+        snprintf(&reply[0], reply.size(), "error: upload incomplete\n");
+    }
+    else
+    {
+        const uint32_t upload_cycles = cycle_timer_elapsed(upload_start);
+
+        std::array<char, 120U> error = {};
+        const uint32_t compile_start = cycle_timer_now();
+        const bool compiled = compile(&name[0], size, &error[0], error.size());
+        const uint32_t compile_cycles = cycle_timer_elapsed(compile_start);
+
+        LuaReload reload = {&name[0], &bytecode_buffer[0], bytecode_size, nullptr, false, 0U};
+
+        if (false == compiled)
+        {
+            snprintf(&reply[0], reply.size(), "error: %s\n", &error[0]);
+        }
+        else if (false == lua_reload(reload, kLuaUploadSwapTimeoutTicks))
+        {
+            snprintf(&reply[0], reply.size(), "error: Lua task busy\n");
+        }
+        else if (false == reload.loaded)
+        {
+            snprintf(&reply[0], reply.size(), "error: %s failed to load, kept the previous version\n", &name[0]);
+        }
+        else
+        {
+            snprintf(&reply[0], reply.size(), "ok %s: %u bytes, upload %lu us, compile %lu us, swap %lu us\n",
+                &name[0], static_cast<unsigned>(bytecode_size), static_cast<unsigned long>(cycles_to_us(upload_cycles)),
+                static_cast<unsigned long>(cycles_to_us(compile_cycles)),
+                static_cast<unsigned long>(cycles_to_us(reload.swap_cycles)));
+        }
+    }
+
+    printf("Lua upload: %s", &reply[0]);
+    FreeRTOS_send(socket, &reply[0], strlen(&reply[0]), 0);
+}
+
+static void task_lua_upload(void* /*pvParameters*/)
+{
+    Socket_t listening_socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP);
+    configASSERT(listening_socket != FREERTOS_INVALID_SOCKET);
+
+    const TickType_t accept_timeout = portMAX_DELAY;
+    FreeRTOS_setsockopt(listening_socket, 0, FREERTOS_SO_RCVTIMEO, &accept_timeout, sizeof(accept_timeout));
+
+    freertos_sockaddr bind_address = {};
+    bind_address.sin_port = FreeRTOS_htons(kLuaUploadPort);
+    FreeRTOS_bind(listening_socket, &bind_address, sizeof(bind_address));
+
+    // One upload at a time.
+    FreeRTOS_listen(listening_socket, 1);
+
+    while (true)
+    {
+        freertos_sockaddr client = {};
+        socklen_t client_size = sizeof(client);
+
+        Socket_t socket = FreeRTOS_accept(listening_socket, &client, &client_size);
+        if (socket == FREERTOS_INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        FreeRTOS_setsockopt(socket, 0, FREERTOS_SO_RCVTIMEO, &kLuaUploadReceiveTimeoutTicks,
+            sizeof(kLuaUploadReceiveTimeoutTicks));
+
+        handle_upload(socket);
+
+        FreeRTOS_shutdown(socket, FREERTOS_SHUT_RDWR);
+
+        // Give the peer one receive timeout to acknowledge the shutdown before releasing the socket.
+        std::array<uint8_t, 16U> drain = {};
+        while (FreeRTOS_recv(socket, &drain[0], drain.size(), 0) > 0)
+        {
+        }
+
+        FreeRTOS_closesocket(socket);
+    }
+}
+
+bool create_task_lua_upload()
+{
+    lua_upload_task_handle = xTaskCreateStatic(
+        &task_lua_upload,
+        kLuaUploadTaskName,
+        kLuaUploadTaskStackSize,
+        nullptr,
+        kLuaUploadTaskPriority,
+        &lua_upload_task_stack[0],
+        &lua_upload_task_buffer
+    );
+
+    return lua_upload_task_handle != nullptr;
+}
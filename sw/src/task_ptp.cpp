@@ -0,0 +1,391 @@
+#include "task_ptp.h"
+
+#include "conf_ptp.h"
+#include "diag_format.h"
+#include "ptp_clock.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "NetworkBufferManagement.h"
+
+#include <array>
+#include <cstring>
+
+extern "C"
+{
+eFrameProcessingResult_t eApplicationProcessCustomFrameHook(NetworkBufferDescriptor_t* const pxNetworkBuffer);
+}
+
+constexpr const char* kPtpTaskName = "PTP";
+constexpr uint32_t kPtpTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kPtpTaskPriority = tskIDLE_PRIORITY + 2;
+
+constexpr size_t kPtpQueueLength = 4U;
+constexpr TickType_t kPtpSlewPeriod = pdMS_TO_TICKS(ptp::kSlewIntervalMs);
+constexpr TickType_t kPtpTimestampTimeout = pdMS_TO_TICKS(kPtpTimestampTimeoutMs);
+constexpr TickType_t kPtpNetworkPollPeriod = pdMS_TO_TICKS(100U);
+
+constexpr size_t kEthernetHeaderBytes = 14U;
+constexpr size_t kEthernetMinFrameBytes = 60U;
+
+struct PtpPendingTx
+{
+    bool active;
+    PtpMessageType type;
+    uint16_t sequence_id;
+    uint32_t count;             // Of the event register before the frame was sent.
+    TickType_t sent_ticks;
+};
+
+static StackType_t ptp_task_stack[kPtpTaskStackSize] = {};
+static StaticTask_t ptp_task_buffer = {};
+
+static TaskHandle_t ptp_task_handle = nullptr;
+
+static QueueHandle_t ptp_frame_queue = nullptr;
+
+static PtpPort ptp_port = {};
+static PtpTaskStats ptp_stats = {};
+
+// Sent event messages waiting for their timestamp, one per event register: Sync, Pdelay_Req and Pdelay_Resp.
+static std::array<PtpPendingTx, 3U> ptp_pending_tx = {};
+
+// Counts of the receive event registers at the last message of their kind.
+static std::array<uint32_t, kPtpEvents> ptp_rx_counts = {};
+
+static void ptp_apply(const PtpOutput& output);
+
+eFrameProcessingResult_t eApplicationProcessCustomFrameHook(NetworkBufferDescriptor_t* const pxNetworkBuffer)
+{
+    const auto* header = reinterpret_cast<const EthernetHeader_t*>(pxNetworkBuffer->pucEthernetBuffer);
+
+    if ((ptp_frame_queue == nullptr) || (header->usFrameType != FreeRTOS_htons(kPtpEtherType)))
+    {
+        return eReleaseBuffer;
+    }
+
+    if (xQueueSend(ptp_frame_queue, &pxNetworkBuffer, 0U) != pdPASS)
+    {
+        ptp_stats.queue_drops++;
+        return eReleaseBuffer;
+    }
+
+    return eFrameConsumed;
+}
+
+static PtpPendingTx* ptp_pending_slot(PtpMessageType type)
+{
+    switch (type)
+    {
+        case PtpMessageType::kSync:         return &ptp_pending_tx[0];
+        case PtpMessageType::kPdelayReq:    return &ptp_pending_tx[1];
+        case PtpMessageType::kPdelayResp:   return &ptp_pending_tx[2];
+        default:                            return nullptr;
+    }
+}
+
+static PtpEvent ptp_tx_event(PtpMessageType type)
+{
+    switch (type)
+    {
+        case PtpMessageType::kSync:         return PtpEvent::kSyncTx;
+        case PtpMessageType::kPdelayReq:    return PtpEvent::kPdelayReqTx;
+        default:                            return PtpEvent::kPdelayRespTx;
+    }
+}
+
+/**
+ * Report the timestamp of a sent event message to the engine, and act upon the follow up.
+ */
+static void ptp_transmitted(PtpPendingTx& pending, int64_t tx_timestamp_ns)
+{
+    pending.active = false;
+
+    PtpOutput output = {};
+    ptp_port_transmitted(ptp_port, pending.type, pending.sequence_id, tx_timestamp_ns, output);
+    ptp_apply(output);
+}
+
+static bool ptp_send(const PtpMessage& message)
+{
+    NetworkBufferDescriptor_t* buffer = pxGetNetworkBufferWithDescriptor(kEthernetHeaderBytes + kPtpMaxMessageBytes,
+        0U);
+
+    if (buffer == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t* frame = buffer->pucEthernetBuffer;
+    memset(frame, 0, kEthernetHeaderBytes + kPtpMaxMessageBytes);
+    memcpy(&frame[0], kPtpMulticastMac.data(), kPtpMulticastMac.size());
+    memcpy(&frame[6], FreeRTOS_GetMACAddress(), ipMAC_ADDRESS_LENGTH_BYTES);
+    frame[12] = static_cast<uint8_t>(kPtpEtherType >> 8U);
+    frame[13] = static_cast<uint8_t>(kPtpEtherType);
+
+    const size_t length = kEthernetHeaderBytes +
+        ptp_encode(message, ptp::kDomain, &frame[kEthernetHeaderBytes], kPtpMaxMessageBytes);
+
+    // Padded up to the shortest frame, the message carries its own length.
+    buffer->xDataLength = (length > kEthernetMinFrameBytes) ? length : kEthernetMinFrameBytes;
+
+    const IPStackEvent_t event = {eNetworkTxEvent, buffer};
+
+    if (xSendEventStructToIPTask(&event, 0U) != pdPASS)
+    {
+        vReleaseNetworkBufferAndDescriptor(buffer);
+        return false;
+    }
+
+    return true;
+}
+
+static void ptp_send_message(const PtpMessage& message)
+{
+    PtpPendingTx* pending = ptp_pending_slot(message.type);
+
+    // A previous message of the kind still waiting for its timestamp never gets it, the register is overwritten.
+    if ((pending != nullptr) && pending->active)
+    {
+        ptp_transmitted(*pending, kPtpNoTimestamp);
+    }
+
+    const uint32_t count = (pending != nullptr) ? ptp_clock_event(ptp_tx_event(message.type)).count : 0U;
+
+    if (false == ptp_send(message))
+    {
+        ptp_stats.send_failures++;
+
+        if (pending != nullptr)
+        {
+            *pending = {true, message.type, message.sequence_id, count, xTaskGetTickCount()};
+            ptp_transmitted(*pending, kPtpNoTimestamp);
+        }
+        return;
+    }
+
+    ptp_stats.frames_sent++;
+
+    if (pending != nullptr)
+    {
+        *pending = {true, message.type, message.sequence_id, count, xTaskGetTickCount()};
+    }
+}
+
+static void ptp_apply(const PtpOutput& output)
+{
+    if (output.step)
+    {
+        ptp_clock_step(output.step_ns);
+        ptp_clock_sample();
+    }
+
+    if (output.set_frequency)
+    {
+        ptp_clock_set_frequency(output.frequency_ppb);
+    }
+
+    for (size_t i = 0U; i < output.message_count; i++)
+    {
+        ptp_send_message(output.messages[i]);
+    }
+}
+
+static void ptp_poll_transmitted()
+{
+    for (auto& pending : ptp_pending_tx)
+    {
+        if (false == pending.active)
+        {
+            continue;
+        }
+
+        const PtpEventTimestamp timestamp = ptp_clock_event(ptp_tx_event(pending.type));
+
+        if (timestamp.count != pending.count)
+        {
+            ptp_transmitted(pending, timestamp.ns);
+        }
+        else if ((xTaskGetTickCount() - pending.sent_ticks) > kPtpTimestampTimeout)
+        {
+            ptp_transmitted(pending, kPtpNoTimestamp);
+        }
+    }
+}
+
+static bool ptp_tx_pending()
+{
+    for (const auto& pending : ptp_pending_tx)
+    {
+        if (pending.active)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Receive timestamp of an event message, the last one latched for its kind if it is new.
+ */
+static int64_t ptp_rx_timestamp(PtpMessageType type)
+{
+    PtpEvent event = PtpEvent::kSyncRx;
+
+    switch (type)
+    {
+        case PtpMessageType::kSync:         event = PtpEvent::kSyncRx; break;
+        case PtpMessageType::kPdelayReq:    event = PtpEvent::kPdelayReqRx; break;
+        case PtpMessageType::kPdelayResp:   event = PtpEvent::kPdelayRespRx; break;
+        default:                            return kPtpNoTimestamp;
+    }
+
+    const PtpEventTimestamp timestamp = ptp_clock_event(event);
+    uint32_t& last_count = ptp_rx_counts[static_cast<uint32_t>(event)];
+
+    if (timestamp.count == last_count)
+    {
+        return kPtpNoTimestamp;
+    }
+
+    last_count = timestamp.count;
+    return timestamp.ns;
+}
+
+static void ptp_receive(NetworkBufferDescriptor_t* buffer)
+{
+    ptp_stats.frames_received++;
+
+    PtpMessage message = {};
+
+    if ((buffer->xDataLength <= kEthernetHeaderBytes) ||
+        (false == ptp_decode(&buffer->pucEthernetBuffer[kEthernetHeaderBytes],
+            buffer->xDataLength - kEthernetHeaderBytes, ptp::kDomain, message)))
+    {
+        ptp_stats.decode_errors++;
+        vReleaseNetworkBufferAndDescriptor(buffer);
+        return;
+    }
+
+    vReleaseNetworkBufferAndDescriptor(buffer);
+
+    PtpOutput output = {};
+    ptp_port_receive(ptp_port, message, ptp_rx_timestamp(message.type), output);
+    ptp_apply(output);
+}
+
+static void ptp_publish_stats()
+{
+    taskENTER_CRITICAL();
+    ptp_stats.port = ptp_port.stats;
+    taskEXIT_CRITICAL();
+}
+
+static void task_ptp(void* /*pvParameters*/)
+{
+    // The MAC address is set and the IP task takes frames to send.
+    while (false == xIPIsNetworkTaskReady())
+    {
+        vTaskDelay(kPtpNetworkPollPeriod);
+    }
+
+    std::array<uint8_t, ipMAC_ADDRESS_LENGTH_BYTES> mac = {};
+    memcpy(mac.data(), FreeRTOS_GetMACAddress(), mac.size());
+
+    ptp_port_init(ptp_port, ptp::kRole, ptp_clock_identity(mac), ptp_clock_now());
+    ptp_clock_sample();
+
+    TickType_t last_slew_ticks = xTaskGetTickCount();
+
+    while (true)
+    {
+        // Timestamps of sent messages are polled every tick, they come within a frame time.
+        const TickType_t wait_ticks = ptp_tx_pending() ? 1U : kPtpSlewPeriod;
+
+        NetworkBufferDescriptor_t* buffer = nullptr;
+        if (xQueueReceive(ptp_frame_queue, &buffer, wait_ticks) == pdPASS)
+        {
+            ptp_receive(buffer);
+        }
+
+        ptp_poll_transmitted();
+
+        PtpOutput output = {};
+        ptp_port_tick(ptp_port, ptp_clock_now(), output);
+        ptp_apply(output);
+
+        if ((xTaskGetTickCount() - last_slew_ticks) >= kPtpSlewPeriod)
+        {
+            last_slew_ticks = xTaskGetTickCount();
+
+            ptp_clock_slew();
+            ptp_clock_sample();
+        }
+
+        ptp_publish_stats();
+    }
+}
+
+bool create_task_ptp()
+{
+    ptp_frame_queue = xQueueCreate(kPtpQueueLength, sizeof(NetworkBufferDescriptor_t*));
+
+    ptp_task_handle = xTaskCreateStatic(
+        &task_ptp,
+        kPtpTaskName,
+        kPtpTaskStackSize,
+        nullptr,
+        kPtpTaskPriority,
+        &ptp_task_stack[0],
+        &ptp_task_buffer
+    );
+
+    return (ptp_frame_queue != nullptr) && (ptp_task_handle != nullptr);
+}
+
+PtpTaskStats ptp_get_stats()
+{
+    taskENTER_CRITICAL();
+    const PtpTaskStats stats = ptp_stats;
+    taskEXIT_CRITICAL();
+
+    return stats;
+}
+
+size_t ptp_format_stats(char* buffer, size_t size)
+{
+    size_t length = 0U;
+
+    const PtpTaskStats stats = ptp_get_stats();
+    const PtpStats& port = stats.port;
+
+    diag_append(buffer, size, length, "%6s %8s %7s %12s %10s %12s %10s %16s\n", "role", "servo", "capable", "offset_ns",
+        "delay_ns", "rate_ppb", "freq_ppb", "clock_ns");
+    diag_append(buffer, size, length, "%6s %8s %7s %12ld %10ld %12ld %10ld %16lld\n",
+        (ptp::kRole == ptp::Role::kMaster) ? "master" : "slave",
+        (port.servo_state == PtpServoState::kLocked) ? "locked" : "unlocked", port.as_capable ? "yes" : "no",
+        static_cast<long>(port.offset_ns), static_cast<long>(port.mean_link_delay_ns),
+        static_cast<long>((port.neighbor_rate_ratio - 1.0) * 1e9), static_cast<long>(port.frequency_ppb),
+        static_cast<long long>(ptp_clock_now()));
+
+    diag_append(buffer, size, length, "%8s %8s %8s %8s %8s %8s %8s %8s\n", "syncs", "timeouts", "steps",
+        "pdelays", "lost", "answered", "no_ts", "ignored");
+    diag_append(buffer, size, length, "%8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n",
+        static_cast<unsigned long>(port.syncs), static_cast<unsigned long>(port.sync_timeouts),
+        static_cast<unsigned long>(port.steps), static_cast<unsigned long>(port.pdelay_exchanges),
+        static_cast<unsigned long>(port.pdelay_lost), static_cast<unsigned long>(port.responses_sent),
+        static_cast<unsigned long>(port.missing_timestamps), static_cast<unsigned long>(port.ignored));
+
+    diag_append(buffer, size, length, "%8s %8s %8s %8s %8s\n", "rx", "tx", "dropped", "tx_fail", "invalid");
+    diag_append(buffer, size, length, "%8lu %8lu %8lu %8lu %8lu\n",
+        static_cast<unsigned long>(stats.frames_received), static_cast<unsigned long>(stats.frames_sent),
+        static_cast<unsigned long>(stats.queue_drops), static_cast<unsigned long>(stats.send_failures),
+        static_cast<unsigned long>(stats.decode_errors));
+
+    return length;
+}
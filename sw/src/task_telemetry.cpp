@@ -0,0 +1,335 @@
+#include "task_telemetry.h"
+
+#include "conf_features.h"
+#include "cycle_timer.h"
+#include "diag_format.h"
+#include "ptp_clock.h"
+#include "signal_db.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+constexpr const char* kTelemetryTaskName = "Telemetry";
+constexpr uint32_t kTelemetryTaskStackSize = 1024U / sizeof(portSTACK_TYPE);
+constexpr UBaseType_t kTelemetryTaskPriority = tskIDLE_PRIORITY + 1;
+
+constexpr TickType_t kTelemetryFlushTimeout = pdMS_TO_TICKS(telemetry::kFlushPeriodMs);
+
+// Version, sample count and sequence number.
+constexpr size_t kTelemetryHeaderSizeBytes = 4U;
+
+// Group, signal count, sequence number and time, followed by the values.
+constexpr size_t kTelemetrySampleHeaderSizeBytes = 12U;
+
+static_assert((kTelemetryHeaderSizeBytes + kTelemetrySampleHeaderSizeBytes +
+    (telemetry::kMaxGroupSignals * sizeof(float))) <= telemetry::kDatagramBytes,
+    "The largest sample must fit a datagram.");
+
+struct TelemetryGroup
+{
+    std::array<SignalSlot, telemetry::kMaxGroupSignals> slots;
+    uint8_t signals;
+    uint16_t sequence;
+
+    TickType_t period;
+    TickType_t next_due;
+};
+
+static StackType_t telemetry_task_stack[kTelemetryTaskStackSize] = {};
+static StaticTask_t telemetry_task_buffer = {};
+
+static TaskHandle_t telemetry_task_handle = nullptr;
+
+static std::array<TelemetryGroup, telemetry::kGroups.size()> telemetry_groups = {};
+
+static Socket_t telemetry_socket = FREERTOS_INVALID_SOCKET;
+static freertos_sockaddr telemetry_destination = {};
+
+// Datagram being filled in place, nullptr until the next sample.
+static uint8_t* telemetry_datagram = nullptr;
+static size_t telemetry_size = 0U;
+static uint8_t telemetry_samples = 0U;
+static uint16_t telemetry_sequence = 0U;
+static TickType_t telemetry_start = 0U;
+
+// Counted by the task, published once a tick.
+static TelemetryStats telemetry_counts = {};
+static TelemetryStats telemetry_stats = {};
+
+static void telemetry_put_u16(uint8_t* data, uint16_t value)
+{
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8U);
+}
+
+static void telemetry_put_u64(uint8_t* data, uint64_t value)
+{
+    for (size_t i = 0U; i < 8U; i++)
+    {
+        data[i] = static_cast<uint8_t>(value >> (8U * i));
+    }
+}
+
+/**
+ * Nanoseconds of the PTP clock, or since boot at the tick resolution without PTP.
+ */
+static uint64_t telemetry_time_ns()
+{
+    if constexpr (features::kEnablePtp)
+    {
+        return static_cast<uint64_t>(ptp_clock_now());
+    }
+
+    return static_cast<uint64_t>(xTaskGetTickCount()) * (1000000000U / configTICK_RATE_HZ);
+}
+
+static void telemetry_send()
+{
+    uint8_t* datagram = telemetry_datagram;
+    telemetry_datagram = nullptr;
+
+    datagram[0] = kTelemetryVersion;
+    datagram[1] = telemetry_samples;
+    telemetry_put_u16(&datagram[2], telemetry_sequence++);
+
+    // The IP task owns the buffer once it took it.
+    if (FreeRTOS_sendto(telemetry_socket, datagram, telemetry_size, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT,
+        &telemetry_destination, sizeof(telemetry_destination)) > 0)
+    {
+        telemetry_counts.datagrams_sent++;
+    }
+    else
+    {
+        FreeRTOS_ReleaseUDPPayloadBuffer(datagram);
+        telemetry_counts.send_failures++;
+    }
+}
+
+/**
+ * Write a sample of the group into the datagram being filled, sending it first if the sample does not fit.  Without a
+ * free network buffer the sample is skipped.
+ */
+static void telemetry_sample(size_t index, uint64_t time_ns)
+{
+    TelemetryGroup& group = telemetry_groups[index];
+    const size_t size = kTelemetrySampleHeaderSizeBytes + (group.signals * sizeof(float));
+
+    if ((telemetry_datagram != nullptr) && ((telemetry::kDatagramBytes - telemetry_size) < size))
+    {
+        telemetry_send();
+    }
+
+    if (telemetry_datagram == nullptr)
+    {
+        telemetry_datagram = static_cast<uint8_t*>(FreeRTOS_GetUDPPayloadBuffer(telemetry::kDatagramBytes, 0U));
+        if (telemetry_datagram == nullptr)
+        {
+            group.sequence++;
+            telemetry_counts.buffer_misses++;
+            return;
+        }
+
+        telemetry_size = kTelemetryHeaderSizeBytes;
+        telemetry_samples = 0U;
+        telemetry_start = xTaskGetTickCount();
+    }
+
+    uint8_t* data = &telemetry_datagram[telemetry_size];
+
+    data[0] = static_cast<uint8_t>(index);
+    data[1] = group.signals;
+    telemetry_put_u16(&data[2], group.sequence++);
+    telemetry_put_u64(&data[4], time_ns);
+
+    // Floats are little endian on the Cortex-M7, the values are copied as they are.
+    const float* values = signal_db_values();
+    data = &data[kTelemetrySampleHeaderSizeBytes];
+
+    for (size_t i = 0U; i < group.signals; i++)
+    {
+        memcpy(&data[i * sizeof(float)], &values[group.slots[i]], sizeof(float));
+    }
+
+    telemetry_size += size;
+    telemetry_samples++;
+
+    telemetry_counts.samples_sent++;
+    telemetry_counts.signals_sent += group.signals;
+}
+
+static void task_telemetry(void* /*pvParameters*/)
+{
+    telemetry_socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+    configASSERT(telemetry_socket != FREERTOS_INVALID_SOCKET);
+
+    freertos_sockaddr bind_address = {};
+    bind_address.sin_port = FreeRTOS_htons(telemetry::kPort);
+    FreeRTOS_bind(telemetry_socket, &bind_address, sizeof(bind_address));
+
+    const auto& octets = telemetry::kDestination;
+    telemetry_destination.sin_addr = FreeRTOS_inet_addr_quick(octets[0], octets[1], octets[2], octets[3]);
+    telemetry_destination.sin_port = FreeRTOS_htons(telemetry::kPort);
+
+    TickType_t last_wake = xTaskGetTickCount();
+
+    for (auto& group : telemetry_groups)
+    {
+        group.next_due = last_wake;
+    }
+
+    while (true)
+    {
+        vTaskDelayUntil(&last_wake, 1U);
+
+        const uint32_t start = cycle_timer_now();
+        const TickType_t now = xTaskGetTickCount();
+
+        // Every sample of the tick gets the same time, the signals are only refreshed at the tick rate anyway.
+        uint64_t time_ns = 0U;
+        bool time_read = false;
+
+        for (size_t i = 0U; i < telemetry_groups.size(); i++)
+        {
+            TelemetryGroup& group = telemetry_groups[i];
+
+            if (static_cast<int32_t>(now - group.next_due) < 0)
+            {
+                continue;
+            }
+
+            if (false == time_read)
+            {
+                time_ns = telemetry_time_ns();
+                time_read = true;
+            }
+
+            telemetry_sample(i, time_ns);
+
+            group.next_due += group.period;
+
+            // Fell a period or more behind, the periods missed are skipped rather than sent in a burst.
+            if (static_cast<int32_t>(now - group.next_due) >= 0)
+            {
+                const TickType_t missed = ((now - group.next_due) / group.period) + 1U;
+
+                telemetry_counts.late_samples += missed;
+                group.sequence += static_cast<uint16_t>(missed);
+                group.next_due += missed * group.period;
+            }
+        }
+
+        if ((telemetry_datagram != nullptr) && ((now - telemetry_start) >= kTelemetryFlushTimeout))
+        {
+            telemetry_send();
+        }
+
+        const uint32_t cycles = cycle_timer_elapsed(start);
+
+        telemetry_counts.publish_cycles += cycles;
+        if (cycles > telemetry_counts.max_publish_cycles)
+        {
+            telemetry_counts.max_publish_cycles = cycles;
+        }
+
+        taskENTER_CRITICAL();
+        telemetry_stats = telemetry_counts;
+        taskEXIT_CRITICAL();
+    }
+}
+
+bool create_task_telemetry()
+{
+    // The slots are resolved once, after the CAN task added the signals of the DBC.  Signals nobody writes are added,
+    // and sent as their initial value.
+    for (size_t i = 0U; i < telemetry::kGroups.size(); i++)
+    {
+        const telemetry::GroupConfig& config = telemetry::kGroups[i];
+        TelemetryGroup& group = telemetry_groups[i];
+
+        for (const char* name : config.signals)
+        {
+            if (name == nullptr)
+            {
+                break;
+            }
+
+            const SignalSlot slot = signal_db_add(name);
+            if (slot == kInvalidSignalSlot)
+            {
+                printf("Too many signals for the signal database, telemetry of %s skipped.\r\n", name);
+                continue;
+            }
+
+            group.slots[group.signals++] = slot;
+        }
+
+        group.period = (config.period_ms > 0U) ? pdMS_TO_TICKS(config.period_ms) : 1U;
+    }
+
+    telemetry_task_handle = xTaskCreateStatic(
+        &task_telemetry,
+        kTelemetryTaskName,
+        kTelemetryTaskStackSize,
+        nullptr,
+        kTelemetryTaskPriority,
+        &telemetry_task_stack[0],
+        &telemetry_task_buffer
+    );
+
+    return telemetry_task_handle != nullptr;
+}
+
+TelemetryStats telemetry_get_stats()
+{
+    taskENTER_CRITICAL();
+    const TelemetryStats stats = telemetry_stats;
+    taskEXIT_CRITICAL();
+
+    return stats;
+}
+
+size_t telemetry_format_stats(char* buffer, size_t size)
+{
+    size_t length = 0U;
+
+    const TelemetryStats stats = telemetry_get_stats();
+
+    // Signals a second of the configuration, what the task is sized for.
+    uint32_t configured = 0U;
+    for (size_t i = 0U; i < telemetry_groups.size(); i++)
+    {
+        configured += telemetry_groups[i].signals * (1000U / telemetry::kGroups[i].period_ms);
+    }
+
+    diag_append(buffer, size, length, "%10s %10s %10s %8s %8s %8s\n", "datagrams", "samples", "signals", "tx_fail",
+        "no_buf", "late");
+    diag_append(buffer, size, length, "%10lu %10lu %10lu %8lu %8lu %8lu\n",
+        static_cast<unsigned long>(stats.datagrams_sent), static_cast<unsigned long>(stats.samples_sent),
+        static_cast<unsigned long>(stats.signals_sent), static_cast<unsigned long>(stats.send_failures),
+        static_cast<unsigned long>(stats.buffer_misses), static_cast<unsigned long>(stats.late_samples));
+
+    // Cost of publishing a thousand signals, including the ticks with nothing to send and the datagrams handed over.
+    const uint64_t cycles_per_1k = (stats.signals_sent > 0U) ?
+        ((stats.publish_cycles * 1000U) / stats.signals_sent) : 0U;
+
+    // Share of the CPU at the configured rate, in tenths of a percent.
+    const uint64_t load_permille = (cycles_per_1k * configured) / (configCPU_CLOCK_HZ / 1000U) / 1000U;
+
+    diag_append(buffer, size, length, "%10s %10s %10s %10s %8s\n", "signals/s", "cycles/1k", "us/1k",
+        "max_us", "cpu_%");
+    diag_append(buffer, size, length, "%10lu %10lu %8lu.%lu %10lu %6lu.%lu\n",
+        static_cast<unsigned long>(configured), static_cast<unsigned long>(cycles_per_1k),
+        static_cast<unsigned long>((cycles_per_1k * 10U / kCyclesPerMicrosecond) / 10U),
+        static_cast<unsigned long>((cycles_per_1k * 10U / kCyclesPerMicrosecond) % 10U),
+        static_cast<unsigned long>(cycles_to_us(stats.max_publish_cycles)),
+        static_cast<unsigned long>(load_permille / 10U), static_cast<unsigned long>(load_permille % 10U));
+
+    return length;
+}
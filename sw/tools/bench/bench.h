@@ -0,0 +1,62 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Timing of the host benchmarks.  Numbers are host nanoseconds, only their ratios carry over to the target.
+ */
+
+constexpr size_t kBenchDefaultIterations = 1000000U;
+
+/**
+ * Call run() iterations times after a tenth as many to warm up.
+ *
+ * \return the mean time of a call, in ns.
+ */
+template <typename Run>
+double bench_ns_per_call(size_t iterations, Run&& run)
+{
+    for (size_t i = 0U; i < (iterations / 10U); i++)
+    {
+        run();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0U; i < iterations; i++)
+    {
+        run();
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / static_cast<double>(iterations);
+}
+
+/**
+ * Parse the only option of the benchmarks, --iterations n.
+ *
+ * \return false on anything else.
+ */
+inline bool bench_parse_iterations(int argc, char** argv, size_t& iterations)
+{
+    iterations = kBenchDefaultIterations;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "--iterations") == 0) && ((i + 1) < argc))
+        {
+            iterations = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return iterations > 0U;
+}
+
+#endif  // BENCH_H_
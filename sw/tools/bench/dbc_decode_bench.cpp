@@ -0,0 +1,265 @@
+/**
+ * Cost of decoding a CAN log of millions of frames on the host, with the decoder generated from vehicle.dbc and with a
+ * decoder reading the same descriptors at run time.
+ *
+ *     dbc_decode_bench [--frames 4000000] [--unknown-pct 20] [--seed 1]
+ *
+ * The log is synthesized with random payloads, each frame one of the messages of the DBC, or an identifier it does not
+ * know with a probability of --unknown-pct.  The run time decoder looks the message up in kMessages and extracts every
+ * signal from a 64-bit window of the payload with the shift, mask and sign extension of its descriptor, as a generic
+ * DBC library would.  Each frame is copied into a CanFrame before it is decoded, as it is out of the message RAM on
+ * target, and that copy alone is timed too.  Both decoders must agree on every signal before they are timed.
+ */
+
+#include "can_dbc.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+constexpr size_t kDefaultFrames = 4000000U;
+constexpr uint32_t kDefaultUnknownPct = 20U;
+constexpr uint32_t kDefaultSeed = 1U;
+
+/**
+ * A frame of the log, its payload in a separate pool so the log only takes the bytes frames actually carry.
+ */
+struct LogFrame
+{
+    uint32_t id;
+    uint8_t length;
+    uint8_t flags;
+    uint32_t data_offset;
+};
+
+struct Log
+{
+    std::vector<LogFrame> frames;
+    std::vector<uint8_t> data;
+};
+
+static can_dbc::SlotTable slots = {};
+
+static void synthesize(Log& log, size_t frames, uint32_t unknown_pct, uint32_t seed)
+{
+    std::mt19937 random(seed);
+
+    log.frames.reserve(frames);
+    log.data.reserve(frames * 10U);
+
+    for (size_t i = 0U; i < frames; i++)
+    {
+        LogFrame frame = {};
+
+        if ((random() % 100U) < unknown_pct)
+        {
+            frame.id = 0x600U + (random() % 0x100U);
+            frame.length = 8U;
+        }
+        else
+        {
+            const auto& message = can_dbc::kMessages[random() % can_dbc::kMessages.size()];
+            frame.id = message.id & ~can_dbc::kExtendedIdFlag;
+            frame.flags = ((message.id & can_dbc::kExtendedIdFlag) != 0U) ? can_flags::kExtended : 0U;
+            frame.flags |= (message.length > 8U) ? can_flags::kFd : 0U;
+            frame.length = message.length;
+        }
+
+        frame.data_offset = static_cast<uint32_t>(log.data.size());
+        for (size_t byte = 0U; byte < frame.length; byte++)
+        {
+            log.data.push_back(static_cast<uint8_t>(random()));
+        }
+
+        log.frames.push_back(frame);
+    }
+}
+
+static void load(const Log& log, const LogFrame& entry, CanFrame& frame)
+{
+    frame.id = entry.id;
+    frame.length = entry.length;
+    frame.flags = entry.flags;
+    memcpy(&frame.data[0], &log.data[entry.data_offset], entry.length);
+}
+
+static float decode_signal(const uint8_t* data, const can_dbc::SignalDescriptor& signal)
+{
+    uint64_t raw = 0U;
+
+    if (signal.big_endian)
+    {
+        // The most significant bit is moved to the top of the window, then down to the length of the signal.
+        const uint64_t window = can_dbc::load_be(&data[signal.start_bit / 8U]);
+        raw = (window << (7U - (signal.start_bit % 8U))) >> (64U - signal.length);
+    }
+    else
+    {
+        const uint64_t window = can_dbc::load_le(&data[signal.start_bit / 8U]);
+        const uint64_t mask = (signal.length == 64U) ? UINT64_MAX : ((1ULL << signal.length) - 1U);
+        raw = (window >> (signal.start_bit % 8U)) & mask;
+    }
+
+    const float value = signal.is_signed ? static_cast<float>(can_dbc::sign_extend64(raw, signal.length)) :
+        static_cast<float>(raw);
+
+    return (value * signal.factor) + signal.offset;
+}
+
+static bool decode_at_run_time(const CanFrame& frame, float* values)
+{
+    const uint32_t id = ((frame.flags & can_flags::kExtended) != 0U) ? (frame.id | can_dbc::kExtendedIdFlag) :
+        frame.id;
+
+    for (const auto& message : can_dbc::kMessages)
+    {
+        if ((message.id == id) && (frame.length >= message.length))
+        {
+            for (size_t i = message.first_signal; i < (message.first_signal + message.signal_count); i++)
+            {
+                values[slots[i]] = decode_signal(&frame.data[0], can_dbc::kSignals[i]);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Decode the whole log with decode(frame, values).
+ *
+ * \return the time per frame in ns, and the frames decoded.
+ */
+template <typename Decode>
+static double run(const Log& log, Decode&& decode, size_t& decoded)
+{
+    float* values = signal_db_values();
+    CanFrame frame = {};
+    decoded = 0U;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const LogFrame& entry : log.frames)
+    {
+        load(log, entry, frame);
+        decoded += decode(frame, values) ? 1U : 0U;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / static_cast<double>(log.frames.size());
+}
+
+/**
+ * Decode the first frames of the log both ways.
+ *
+ * \return the number of signals they disagree on.
+ */
+static size_t compare(const Log& log, size_t frames)
+{
+    float* values = signal_db_values();
+    std::vector<float> generated(signal_db_count());
+    CanFrame frame = {};
+    size_t mismatches = 0U;
+
+    for (size_t n = 0U; n < std::min(frames, log.frames.size()); n++)
+    {
+        load(log, log.frames[n], frame);
+
+        const bool known = can_dbc::decode(frame, values, slots);
+        generated.assign(values, values + signal_db_count());
+
+        if (known != decode_at_run_time(frame, values))
+        {
+            mismatches++;
+        }
+
+        for (size_t i = 0U; i < signal_db_count(); i++)
+        {
+            // The run time decoder scales with a multiply and add, factors of 1 and offsets of 0 included.
+            mismatches += (generated[i] == values[i]) ? 0U : 1U;
+        }
+    }
+
+    return mismatches;
+}
+
+static void usage()
+{
+    printf("Usage: dbc_decode_bench [--frames n] [--unknown-pct pct] [--seed n]\n");
+}
+
+int main(int argc, char** argv)
+{
+    size_t frames = kDefaultFrames;
+    uint32_t unknown_pct = kDefaultUnknownPct;
+    uint32_t seed = kDefaultSeed;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+        const bool has_value = (i + 1) < argc;
+
+        if ((strcmp(argument, "--frames") == 0) && has_value)
+        {
+            frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((strcmp(argument, "--unknown-pct") == 0) && has_value)
+        {
+            unknown_pct = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if ((strcmp(argument, "--seed") == 0) && has_value)
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((frames == 0U) || (unknown_pct > 100U))
+    {
+        usage();
+        return 1;
+    }
+
+    if (false == can_dbc::resolve_slots(slots))
+    {
+        printf("Too many CAN signals for the signal database\n");
+        return 1;
+    }
+
+    Log log = {};
+    synthesize(log, frames, unknown_pct, seed);
+
+    const size_t mismatches = compare(log, 100000U);
+    if (mismatches > 0U)
+    {
+        printf("Generated and run time decoders disagree %zu times\n", mismatches);
+        return 1;
+    }
+
+    size_t decoded = 0U;
+    const double copy_ns = run(log, [](const CanFrame& frame, float* /*values*/) { return frame.length > 0U; },
+        decoded);
+    const double generated_ns = run(log, [](const CanFrame& frame, float* values)
+    {
+        return can_dbc::decode(frame, values, slots);
+    }, decoded);
+    const double run_time_ns = run(log, &decode_at_run_time, decoded);
+
+    printf("%zu frames, %zu in the DBC, %zu bytes of payload\n", log.frames.size(), decoded, log.data.size());
+    printf("%-20s %6.2f ns per frame\n", "Copy only", copy_ns);
+    printf("%-20s %6.2f ns per frame, %6.2f ns decoding, %5.1f M frames/s\n", "Generated", generated_ns,
+        generated_ns - copy_ns, 1000.0 / generated_ns);
+    printf("%-20s %6.2f ns per frame, %6.2f ns decoding, %5.1f M frames/s\n", "Run time", run_time_ns,
+        run_time_ns - copy_ns, 1000.0 / run_time_ns);
+    printf("Decoding %.1f times faster\n", (run_time_ns - copy_ns) / (generated_ns - copy_ns));
+
+    return 0;
+}
@@ -0,0 +1,424 @@
+/**
+ * The Lua arena of the firmware against the stock allocator of Lua, on an allocation trace recorded from a control
+ * script: the latency of every allocation, reallocation and free, the peak memory use and the fragmentation.
+ *
+ *     lua_alloc_trace_bench [--cycles 20000] [--repeat 20]
+ *
+ * The trace is recorded from a state set up as task_lua.cpp does, with the collector stopped and stepped once per
+ * cycle, running --cycles cycles of a script that keeps a sliding window of samples in tables, formats and splits
+ * strings, makes closures and resumes a coroutine.  Its blocks are then allocated, resized and freed in the same order
+ * by lua_arena_alloc() over an arena the size of the firmware's, and by l_alloc() of lauxlib.c, which on target sits on
+ * newlib realloc() and here on the realloc() of the host C library.
+ *
+ * Latencies are timed one by one on a first replay, including the cost of reading the clock, and the mean over
+ * --repeat more.  Memory use is the highest address carved from the arena, and the heap below its top free chunk and
+ * the mapped memory of the C library, block headers and padding included.  Fragmentation is taken before lua_close(),
+ * as the free memory that is not in the largest free block: the largest block of the arena, and the top of the heap
+ * of the C library.
+ */
+
+#include "lua_arena.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+constexpr size_t kDefaultCycles = 20000U;
+constexpr size_t kDefaultRepeat = 20U;
+
+// As in task_lua.cpp.
+constexpr size_t kLuaArenaSizeBytes = 64U * 1024U;
+
+// Room for the recording, which must not fail.
+constexpr size_t kRecordArenaSizeBytes = 4U * 1024U * 1024U;
+
+constexpr const char* kScript = R"(
+local window = {}
+local fan = {on = false, run_on = 0}
+
+local function filter(gain)
+    local state = 0
+    return function(value)
+        state = state + gain * (value - state)
+        return state
+    end
+end
+
+local smooth = filter(0.2)
+
+local ticker = coroutine.wrap(function()
+    while true do
+        for step = 1, 10 do
+            coroutine.yield(step)
+        end
+    end
+end)
+
+function cycle(n)
+    local temperature = smooth(80 + (n % 40))
+    window[#window + 1] = {value = temperature, at = n, step = ticker()}
+    if #window > 32 then
+        table.remove(window, 1)
+    end
+
+    local sum = 0
+    for _, sample in ipairs(window) do
+        sum = sum + sample.value
+    end
+    local mean = sum / #window
+
+    if mean > 95 then
+        fan.on, fan.run_on = true, 50
+    elseif fan.run_on > 0 then
+        fan.run_on = fan.run_on - 1
+    else
+        fan.on = false
+    end
+
+    local words = {}
+    for word in string.format("fan %s mean %.1f run-on %d", tostring(fan.on), mean, fan.run_on):gmatch("%S+") do
+        words[#words + 1] = word
+    end
+
+    return #words
+end
+)";
+
+/**
+ * A call to the allocator: a new block when old_size is 0, freed when new_size is 0, else resized.
+ */
+struct TraceOp
+{
+    uint32_t block;
+    uint32_t old_size;
+    uint32_t new_size;
+};
+
+struct Trace
+{
+    std::vector<TraceOp> ops;
+    size_t blocks;
+    size_t close_index;     // First operation of lua_close().
+};
+
+struct Recorder
+{
+    LuaArena arena;
+    Trace trace;
+    std::unordered_map<void*, uint32_t> blocks;
+};
+
+alignas(kLuaArenaGranularity) static uint8_t record_buffer[kRecordArenaSizeBytes] = {};
+alignas(kLuaArenaGranularity) static uint8_t replay_buffer[kLuaArenaSizeBytes] = {};
+
+static void* record_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    auto& recorder = *static_cast<Recorder*>(ud);
+
+    if ((ptr == nullptr) && (nsize == 0U))
+    {
+        return nullptr;
+    }
+
+    // Lua passes the type of a new object as osize.
+    const size_t old_size = (ptr == nullptr) ? 0U : osize;
+    uint32_t block = static_cast<uint32_t>(recorder.trace.blocks);
+
+    if (ptr == nullptr)
+    {
+        recorder.trace.blocks++;
+    }
+    else
+    {
+        block = recorder.blocks[ptr];
+        recorder.blocks.erase(ptr);
+    }
+
+    void* result = lua_arena_alloc(&recorder.arena, ptr, old_size, nsize);
+    if (result != nullptr)
+    {
+        recorder.blocks[result] = block;
+    }
+
+    recorder.trace.ops.push_back({block, static_cast<uint32_t>(old_size), static_cast<uint32_t>(nsize)});
+
+    return result;
+}
+
+static bool record(Trace& trace, size_t cycles)
+{
+    static Recorder recorder = {};
+    lua_arena_init(recorder.arena, &record_buffer[0], sizeof(record_buffer));
+
+    lua_State* L = lua_newstate(&record_alloc, &recorder);
+    luaL_openlibs(L);
+
+    bool ok = (LUA_OK == luaL_dostring(L, kScript));
+    lua_gc(L, LUA_GCCOLLECT);
+    lua_gc(L, LUA_GCSTOP);
+
+    for (size_t n = 0U; ok && (n < cycles); n++)
+    {
+        lua_getglobal(L, "cycle");
+        lua_pushinteger(L, static_cast<lua_Integer>(n));
+        ok = (LUA_OK == lua_pcall(L, 1, 0, 0));
+        lua_gc(L, LUA_GCSTEP, 0);
+    }
+
+    if (false == ok)
+    {
+        printf("Script failed: %s\n", lua_tostring(L, -1));
+    }
+
+    recorder.trace.close_index = recorder.trace.ops.size();
+    lua_close(L);
+
+    trace = std::move(recorder.trace);
+
+    return ok && recorder.blocks.empty() && (recorder.arena.failed_allocations == 0U);
+}
+
+struct ReplayStats
+{
+    double mean_ns;
+    double p99_ns;
+    double max_ns;
+    size_t peak_requested_bytes;
+    size_t peak_footprint_bytes;
+    uint32_t fragmentation_permille;    // Before lua_close().
+    uint32_t failed;
+};
+
+struct ArenaReplay
+{
+    LuaArena arena;
+
+    void reset()
+    {
+        lua_arena_init(arena, &replay_buffer[0], sizeof(replay_buffer));
+    }
+
+    void* alloc(void* ptr, size_t old_size, size_t new_size)
+    {
+        return lua_arena_alloc(&arena, ptr, old_size, new_size);
+    }
+
+    size_t footprint() const
+    {
+        return lua_arena_get_stats(arena).high_water_bytes;
+    }
+
+    uint32_t fragmentation() const
+    {
+        return lua_arena_get_stats(arena).fragmentation_permille;
+    }
+};
+
+struct StockReplay
+{
+    lua_Alloc l_alloc;
+    void* ud;
+    size_t baseline;
+
+    // Heap up to its top free chunk, as the high water of the arena, and mapped blocks.
+    static size_t heap_size()
+    {
+        const struct mallinfo2 info = mallinfo2();
+        return (info.arena - info.keepcost) + info.hblkhd;
+    }
+
+    void reset()
+    {
+        malloc_trim(0U);
+        baseline = heap_size();
+    }
+
+    void* alloc(void* ptr, size_t old_size, size_t new_size)
+    {
+        return l_alloc(ud, ptr, old_size, new_size);
+    }
+
+    size_t footprint() const
+    {
+        const size_t size = heap_size();
+        return (size > baseline) ? (size - baseline) : 0U;
+    }
+
+    uint32_t fragmentation() const
+    {
+        const struct mallinfo2 info = mallinfo2();
+        return (info.fordblks == 0U) ? 0U :
+            static_cast<uint32_t>(1000U - ((static_cast<uint64_t>(info.keepcost) * 1000U) / info.fordblks));
+    }
+};
+
+/**
+ * Replay the trace, the blocks a failed allocation did not get are left out of the rest of it.
+ */
+template <typename Allocator, typename Observe>
+static uint32_t replay(const Trace& trace, Allocator& allocator, std::vector<void*>& blocks, Observe&& observe)
+{
+    uint32_t failed = 0U;
+    std::fill(blocks.begin(), blocks.end(), nullptr);
+
+    for (size_t i = 0U; i < trace.ops.size(); i++)
+    {
+        const TraceOp& op = trace.ops[i];
+        void*& block = blocks[op.block];
+
+        if ((op.old_size > 0U) && (block == nullptr))
+        {
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        void* result = allocator.alloc(block, op.old_size, op.new_size);
+        const auto end = std::chrono::steady_clock::now();
+
+        if ((op.new_size > 0U) && (result == nullptr))
+        {
+            failed++;
+        }
+        else
+        {
+            block = result;
+        }
+
+        observe(i, op, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    return failed;
+}
+
+template <typename Allocator>
+static ReplayStats measure(const Trace& trace, Allocator& allocator, size_t repeat)
+{
+    ReplayStats stats = {};
+    std::vector<void*> blocks(trace.blocks);
+    std::vector<double> latencies;
+    latencies.reserve(trace.ops.size());
+
+    size_t requested = 0U;
+    allocator.reset();
+    stats.failed = replay(trace, allocator, blocks, [&](size_t i, const TraceOp& op, double ns)
+    {
+        latencies.push_back(ns);
+
+        requested = requested + op.new_size - op.old_size;
+        stats.peak_requested_bytes = std::max(stats.peak_requested_bytes, requested);
+        stats.peak_footprint_bytes = std::max(stats.peak_footprint_bytes, allocator.footprint());
+
+        if ((i + 1U) == trace.close_index)
+        {
+            stats.fragmentation_permille = allocator.fragmentation();
+        }
+    });
+
+    std::sort(latencies.begin(), latencies.end());
+    stats.p99_ns = latencies[(latencies.size() * 99U) / 100U];
+    stats.max_ns = latencies.back();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0U; i < repeat; i++)
+    {
+        allocator.reset();
+        replay(trace, allocator, blocks, [](size_t, const TraceOp&, double) {});
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    stats.mean_ns = elapsed.count() / static_cast<double>(repeat * trace.ops.size());
+
+    return stats;
+}
+
+static void print(const char* name, const ReplayStats& stats)
+{
+    printf("%-26s %8.1f %8.1f %8.1f %10zu %10zu %8.1f %8u\n", name, stats.mean_ns, stats.p99_ns, stats.max_ns,
+        stats.peak_requested_bytes, stats.peak_footprint_bytes,
+        static_cast<double>(stats.fragmentation_permille) / 10.0, stats.failed);
+}
+
+static void usage()
+{
+    printf("Usage: lua_alloc_trace_bench [--cycles 20000] [--repeat 20]\n");
+}
+
+int main(int argc, char** argv)
+{
+    size_t cycles = kDefaultCycles;
+    size_t repeat = kDefaultRepeat;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+        const bool has_value = (i + 1) < argc;
+
+        if ((strcmp(argument, "--cycles") == 0) && has_value)
+        {
+            cycles = strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((strcmp(argument, "--repeat") == 0) && has_value)
+        {
+            repeat = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((cycles == 0U) || (repeat == 0U))
+    {
+        usage();
+        return 1;
+    }
+
+    Trace trace = {};
+    if (false == record(trace, cycles))
+    {
+        printf("Recording the trace failed\n");
+        return 1;
+    }
+
+    size_t news = 0U;
+    size_t frees = 0U;
+    for (const TraceOp& op : trace.ops)
+    {
+        news += (op.old_size == 0U) ? 1U : 0U;
+        frees += (op.new_size == 0U) ? 1U : 0U;
+    }
+
+    printf("%zu cycles, %zu operations: %zu allocations, %zu frees, %zu reallocations\n", cycles, trace.ops.size(),
+        news, frees, trace.ops.size() - news - frees);
+
+    static ArenaReplay arena = {};
+
+    // The allocator of luaL_newstate(), l_alloc() of lauxlib.c.
+    StockReplay stock = {};
+    lua_State* L = luaL_newstate();
+    stock.l_alloc = lua_getallocf(L, &stock.ud);
+    lua_close(L);
+
+    const ReplayStats arena_stats = measure(trace, arena, repeat);
+    const ReplayStats stock_stats = measure(trace, stock, repeat);
+
+    printf("%-26s %8s %8s %8s %10s %10s %8s %8s\n", "", "mean_ns", "p99_ns", "max_ns", "peak_used", "footprint",
+        "frag_%", "failed");
+    print("lua_arena_alloc (64 kB)", arena_stats);
+    print("l_alloc and realloc", stock_stats);
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * Cost of a Lua control cycle on the host, when the script is compiled again every cycle as luaL_dostring() does and
+ * when it is compiled once and called through a reference in the registry as task_lua.cpp does.
+ *
+ *     lua_call_bench [--iterations 1000000]
+ *
+ * Both run toggle_led() from a state backed by the Lua arena of the firmware, and report the mean time and the arena
+ * allocations of a cycle.
+ */
+
+#include "bench.h"
+#include "lua_arena.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+#include <cstdio>
+
+// As in task_lua.cpp.
+constexpr size_t kLuaArenaSizeBytes = 64U * 1024U;
+
+constexpr const char* kScript = "toggle_led()";
+
+alignas(kLuaArenaGranularity) static uint8_t lua_arena_buffer[kLuaArenaSizeBytes] = {};
+static LuaArena lua_arena = {};
+
+static bool led = false;
+
+static int toggle_led(lua_State* /*L*/)
+{
+    led = !led;
+
+    return 0;
+}
+
+static lua_State* open_state()
+{
+    lua_arena_init(lua_arena, &lua_arena_buffer[0], sizeof(lua_arena_buffer));
+
+    lua_State* L = lua_newstate(&lua_arena_alloc, &lua_arena);
+    luaL_openlibs(L);
+    lua_pushcfunction(L, toggle_led);
+    lua_setglobal(L, "toggle_led");
+
+    return L;
+}
+
+struct CycleCost
+{
+    double ns;
+    double allocations;
+};
+
+template <typename Cycle>
+static CycleCost measure(size_t iterations, Cycle&& cycle)
+{
+    const uint32_t allocations = lua_arena.allocations;
+    const double ns = bench_ns_per_call(iterations, cycle);
+
+    // Warm-up calls included.
+    const size_t calls = iterations + (iterations / 10U);
+
+    return {ns, static_cast<double>(lua_arena.allocations - allocations) / static_cast<double>(calls)};
+}
+
+static CycleCost measure_dostring(size_t iterations)
+{
+    lua_State* L = open_state();
+
+    const CycleCost cost = measure(iterations, [&]()
+    {
+        if (LUA_OK != luaL_dostring(L, kScript))
+        {
+            lua_pop(L, 1);
+        }
+    });
+
+    lua_close(L);
+
+    return cost;
+}
+
+static CycleCost measure_ref(size_t iterations)
+{
+    lua_State* L = open_state();
+
+    luaL_loadstring(L, kScript);
+    const int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    const CycleCost cost = measure(iterations, [&]()
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+        if (LUA_OK != lua_pcall(L, 0, 0, 0))
+        {
+            lua_pop(L, 1);
+        }
+    });
+
+    lua_close(L);
+
+    return cost;
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = 0U;
+    if (false == bench_parse_iterations(argc, argv, iterations))
+    {
+        printf("Usage: lua_call_bench [--iterations n]\n");
+        return 1;
+    }
+
+    const CycleCost dostring = measure_dostring(iterations);
+    const CycleCost ref = measure_ref(iterations);
+
+    printf("%zu cycles of %s\n", iterations, kScript);
+    printf("%-28s %8.1f ns, %5.1f allocations per cycle\n", "luaL_dostring every cycle", dostring.ns,
+        dostring.allocations);
+    printf("%-28s %8.1f ns, %5.1f allocations per cycle\n", "Registry ref and lua_pcall", ref.ns, ref.allocations);
+    printf("%.1f times faster\n", dostring.ns / ref.ns);
+
+    return 0;
+}
@@ -0,0 +1,320 @@
+/**
+ * Cost of evaluating a few hundred output control rules on the host, compiled by the native rule engine and written as
+ * Lua scripts reading and writing the same signals through their accessors.
+ *
+ *     rule_bench [--iterations 1000000]
+ *
+ * The rules are generated at random, comparisons of sums and products of signals and literals combined with
+ * `&&`, `||` and `!`, and written in both languages.  The Lua rules are split into scripts of kRulesPerScript, each
+ * returning one function called every cycle through a registry reference, as the scheduler calls callbacks.  The
+ * native rules fill as many engines as they need, kMaxRuleInstructions each, evaluated back to back.  Both are run on
+ * the same inputs and must write the same outputs before they are timed.
+ */
+
+#include "bench.h"
+#include "lua_arena.h"
+#include "lua_signals.h"
+#include "rule_engine.h"
+#include "signal_db.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+constexpr size_t kRules = 300U;
+constexpr size_t kInputs = 48U;
+constexpr size_t kOutputs = 192U;
+constexpr size_t kRulesPerScript = 25U;
+constexpr size_t kRuleDepth = 1U;
+constexpr size_t kMaxEngines = 8U;
+
+static_assert((kInputs + kOutputs) <= kMaxSignals, "Inputs and outputs must fit the signal database.");
+
+// Four times the arena of task_lua.cpp, the compiled scripts alone outgrow it.
+constexpr size_t kLuaArenaSizeBytes = 256U * 1024U;
+
+alignas(kLuaArenaGranularity) static uint8_t lua_arena_buffer[kLuaArenaSizeBytes] = {};
+static LuaArena lua_arena = {};
+
+static std::array<std::array<char, 16U>, kInputs + kOutputs> signal_names = {};
+
+static std::array<RuleEngine, kMaxEngines> engines = {};
+static size_t engine_count = 1U;
+
+struct Rule
+{
+    std::string c;
+    std::string lua;
+    std::set<std::string> signals;
+};
+
+static void append(Rule& rule, const char* c, const char* lua)
+{
+    rule.c += c;
+    rule.lua += lua;
+}
+
+static void random_value(std::mt19937& random, size_t depth, Rule& rule)
+{
+    const unsigned choice = random() % ((depth == 0U) ? 2U : 5U);
+
+    if (choice == 0U)
+    {
+        const std::string name = &signal_names[random() % kInputs][0];
+        append(rule, name.c_str(), (name + "()").c_str());
+        rule.signals.insert(name);
+    }
+    else if (choice == 1U)
+    {
+        char literal[16] = {};
+        snprintf(literal, sizeof(literal), "%.1f", static_cast<double>(random() % 2000U) / 10.0);
+        append(rule, (std::string(literal) + "f").c_str(), literal);
+    }
+    else
+    {
+        const char* const operators[] = {"+", "-", "*"};
+        const char* op = operators[choice - 2U];
+
+        append(rule, "(", "(");
+        random_value(random, depth - 1U, rule);
+        append(rule, (std::string(") ") + op + " (").c_str(), (std::string(") ") + op + " (").c_str());
+        random_value(random, depth - 1U, rule);
+        append(rule, ")", ")");
+    }
+}
+
+static void random_condition(std::mt19937& random, size_t depth, Rule& rule)
+{
+    const unsigned choice = random() % ((depth == 0U) ? 1U : 4U);
+
+    if (choice == 0U)
+    {
+        const char* const c_operators[] = {"<", "<=", ">", ">=", "==", "!="};
+        const char* const lua_operators[] = {"<", "<=", ">", ">=", "==", "~="};
+        const unsigned op = random() % 6U;
+
+        append(rule, "(", "(");
+        random_value(random, kRuleDepth, rule);
+        append(rule, (std::string(") ") + c_operators[op] + " (").c_str(),
+            (std::string(") ") + lua_operators[op] + " (").c_str());
+        random_value(random, kRuleDepth, rule);
+        append(rule, ")", ")");
+    }
+    else if (choice == 1U)
+    {
+        append(rule, "!(", "not (");
+        random_condition(random, depth - 1U, rule);
+        append(rule, ")", ")");
+    }
+    else
+    {
+        append(rule, "(", "(");
+        random_condition(random, depth - 1U, rule);
+        append(rule, (choice == 2U) ? ") && (" : ") || (", (choice == 2U) ? ") and (" : ") or (");
+        random_condition(random, depth - 1U, rule);
+        append(rule, ")", ")");
+    }
+}
+
+/**
+ * One script of the Lua rules from first, the accessors it uses resolved into locals when it is loaded.
+ */
+static std::string lua_script(const std::vector<Rule>& rules, size_t first)
+{
+    const size_t last = std::min(first + kRulesPerScript, rules.size());
+
+    std::set<std::string> names;
+    for (size_t i = first; i < last; i++)
+    {
+        names.insert(rules[i].signals.begin(), rules[i].signals.end());
+        names.insert(&signal_names[kInputs + (i % kOutputs)][0]);
+    }
+
+    std::string script;
+    for (const std::string& name : names)
+    {
+        script += "local " + name + " = signal(\"" + name + "\")\n";
+    }
+
+    script += "return function()\n";
+    for (size_t i = first; i < last; i++)
+    {
+        script += std::string("    ") + &signal_names[kInputs + (i % kOutputs)][0] + "(" + rules[i].lua + ")\n";
+    }
+    script += "end\n";
+
+    return script;
+}
+
+static void set_inputs(std::mt19937& random)
+{
+    float* values = signal_db_values();
+
+    for (size_t i = 0U; i < kInputs; i++)
+    {
+        values[i] = static_cast<float>(random() % 2000U) / 10.0f;
+    }
+}
+
+static void evaluate_rules()
+{
+    for (size_t i = 0U; i < engine_count; i++)
+    {
+        rule_engine_evaluate(engines[i], signal_db_values());
+    }
+}
+
+/**
+ * Compile the rule into the last engine, or into a new one once it is full.
+ */
+static bool add_rule(const char* expression, SignalSlot output)
+{
+    RuleCompileError error = {};
+    if (rule_engine_add(engines[engine_count - 1U], expression, output, &error))
+    {
+        return true;
+    }
+
+    if ((engine_count < kMaxEngines) && rule_engine_add(engines[engine_count], expression, output, &error))
+    {
+        engine_count++;
+        return true;
+    }
+
+    printf("Failed to compile rule %s: %s at %zu\n", expression, error.message, error.position);
+    return false;
+}
+
+static void call_scripts(lua_State* L, const std::vector<int>& refs)
+{
+    for (const int ref : refs)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+        if (LUA_OK != lua_pcall(L, 0, 0, 0))
+        {
+            printf("Script failed: %s\n", lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
+    }
+}
+
+/**
+ * Run both on the same inputs.
+ *
+ * \return the number of outputs they disagree on.
+ */
+static size_t compare(lua_State* L, const std::vector<int>& refs, std::mt19937& random)
+{
+    float* values = signal_db_values();
+    set_inputs(random);
+
+    evaluate_rules();
+    const std::vector<float> native(&values[kInputs], &values[kInputs + kOutputs]);
+
+    std::fill(&values[kInputs], &values[kInputs + kOutputs], NAN);
+    call_scripts(L, refs);
+
+    size_t mismatches = 0U;
+    for (size_t i = 0U; i < kOutputs; i++)
+    {
+        mismatches += (native[i] == values[kInputs + i]) ? 0U : 1U;
+    }
+
+    return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = 0U;
+    if (false == bench_parse_iterations(argc, argv, iterations))
+    {
+        printf("Usage: rule_bench [--iterations n]\n");
+        return 1;
+    }
+
+    for (size_t i = 0U; i < signal_names.size(); i++)
+    {
+        snprintf(&signal_names[i][0], signal_names[i].size(), (i < kInputs) ? "in%zu" : "out%zu",
+            (i < kInputs) ? i : (i - kInputs));
+        signal_db_add(&signal_names[i][0]);
+    }
+
+    std::mt19937 random(1U);
+
+    std::vector<Rule> rules(kRules);
+    for (size_t i = 0U; i < kRules; i++)
+    {
+        random_condition(random, kRuleDepth, rules[i]);
+
+        if (false == add_rule(rules[i].c.c_str(), static_cast<SignalSlot>(kInputs + (i % kOutputs))))
+        {
+            return 1;
+        }
+    }
+
+    lua_arena_init(lua_arena, &lua_arena_buffer[0], sizeof(lua_arena_buffer));
+    lua_State* L = lua_newstate(&lua_arena_alloc, &lua_arena);
+    luaL_openlibs(L);
+    lua_open_signals(L);
+
+    std::vector<int> refs;
+    for (size_t first = 0U; first < kRules; first += kRulesPerScript)
+    {
+        const std::string script = lua_script(rules, first);
+
+        if ((LUA_OK != luaL_loadstring(L, script.c_str())) || (LUA_OK != lua_pcall(L, 0, 1, 0)))
+        {
+            printf("Failed to load script: %s\n", lua_tostring(L, -1));
+            return 1;
+        }
+
+        refs.push_back(luaL_ref(L, LUA_REGISTRYINDEX));
+    }
+    lua_gc(L, LUA_GCCOLLECT);
+
+    for (size_t i = 0U; i < 100U; i++)
+    {
+        const size_t mismatches = compare(L, refs, random);
+        if (mismatches > 0U)
+        {
+            printf("Native and Lua rules disagree on %zu outputs\n", mismatches);
+            return 1;
+        }
+    }
+
+    set_inputs(random);
+
+    const double native_ns = bench_ns_per_call(iterations, &evaluate_rules);
+
+    const double lua_ns = bench_ns_per_call(iterations, [&]()
+    {
+        call_scripts(L, refs);
+    });
+
+    size_t instructions = 0U;
+    for (size_t i = 0U; i < engine_count; i++)
+    {
+        instructions += engines[i].length;
+    }
+
+    printf("%zu rules over %zu inputs, %zu cycles\n", kRules, kInputs, iterations);
+    printf("%zu instructions in %zu engines, %zu Lua scripts in %zu bytes\n", instructions, engine_count, refs.size(),
+        lua_arena_get_stats(lua_arena).in_use_bytes);
+    printf("%-12s %10.1f ns per cycle, %6.1f ns per rule\n", "Native", native_ns,
+        native_ns / static_cast<double>(kRules));
+    printf("%-12s %10.1f ns per cycle, %6.1f ns per rule\n", "Lua", lua_ns, lua_ns / static_cast<double>(kRules));
+    printf("%.1f times faster\n", lua_ns / native_ns);
+
+    lua_close(L);
+
+    return 0;
+}
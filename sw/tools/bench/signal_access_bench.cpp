@@ -0,0 +1,184 @@
+/**
+ * Cost of a signal access from Lua on the host, through the accessors of lua_signals.h against plain globals.
+ *
+ *     signal_access_bench [--iterations 1000000]
+ *
+ * Each cycle calls a function reading kSignals signals and writing their sum to one more, through a registry reference
+ * as the scheduler does.  With accessors the function calls the C closures it resolved into locals when it was loaded.
+ * With globals every access is a lookup by name in the global table, which also has to be kept in step with the
+ * signal database from C around every cycle, and that is timed separately.  The cost of calling an empty function is
+ * taken off both before dividing by the accesses of a cycle.
+ */
+
+#include "bench.h"
+#include "lua_arena.h"
+#include "lua_signals.h"
+#include "signal_db.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+#include <string>
+
+constexpr size_t kSignals = 32U;
+constexpr size_t kAccesses = kSignals + 1U;
+
+// As in task_lua.cpp.
+constexpr size_t kLuaArenaSizeBytes = 64U * 1024U;
+
+alignas(kLuaArenaGranularity) static uint8_t lua_arena_buffer[kLuaArenaSizeBytes] = {};
+static LuaArena lua_arena = {};
+
+static std::array<std::array<char, 16U>, kSignals + 1U> signal_names = {};
+
+static const char* output_name()
+{
+    return &signal_names[kSignals][0];
+}
+
+/**
+ * Load the script, which returns the function to call every cycle.
+ *
+ * \return its reference in the registry.
+ */
+static int load(lua_State* L, const std::string& script)
+{
+    if ((LUA_OK != luaL_loadstring(L, script.c_str())) || (LUA_OK != lua_pcall(L, 0, 1, 0)))
+    {
+        printf("Failed to load script: %s\n", lua_tostring(L, -1));
+        return LUA_NOREF;
+    }
+
+    return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+static void call(lua_State* L, int ref)
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    if (LUA_OK != lua_pcall(L, 0, 0, 0))
+    {
+        printf("Script failed: %s\n", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+}
+
+static std::string accessor_script()
+{
+    std::string script;
+    for (const auto& name : signal_names)
+    {
+        script += std::string("local ") + &name[0] + " = signal(\"" + &name[0] + "\")\n";
+    }
+
+    script += std::string("return function()\n    ") + output_name() + "(";
+    for (size_t i = 0U; i < kSignals; i++)
+    {
+        script += std::string((i > 0U) ? " + " : "") + &signal_names[i][0] + "()";
+    }
+    script += ")\nend\n";
+
+    return script;
+}
+
+static std::string global_script()
+{
+    std::string script = std::string("return function()\n    ") + output_name() + " = ";
+    for (size_t i = 0U; i < kSignals; i++)
+    {
+        script += std::string((i > 0U) ? " + " : "") + &signal_names[i][0];
+    }
+    script += "\nend\n";
+
+    return script;
+}
+
+/**
+ * Copy the inputs into the globals before a cycle and the output back after it.
+ */
+static void sync_globals(lua_State* L)
+{
+    const float* values = signal_db_values();
+
+    for (size_t i = 0U; i < kSignals; i++)
+    {
+        lua_pushnumber(L, values[i]);
+        lua_setglobal(L, &signal_names[i][0]);
+    }
+
+    lua_getglobal(L, output_name());
+    signal_db_values()[kSignals] = static_cast<float>(lua_tonumber(L, -1));
+    lua_pop(L, 1);
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = 0U;
+    if (false == bench_parse_iterations(argc, argv, iterations))
+    {
+        printf("Usage: signal_access_bench [--iterations n]\n");
+        return 1;
+    }
+
+    float expected = 0.0f;
+    for (size_t i = 0U; i < signal_names.size(); i++)
+    {
+        snprintf(&signal_names[i][0], signal_names[i].size(), (i < kSignals) ? "in%zu" : "out", i);
+        signal_db_add(&signal_names[i][0], static_cast<float>(i));
+        expected += (i < kSignals) ? static_cast<float>(i) : 0.0f;
+    }
+
+    lua_arena_init(lua_arena, &lua_arena_buffer[0], sizeof(lua_arena_buffer));
+    lua_State* L = lua_newstate(&lua_arena_alloc, &lua_arena);
+    luaL_openlibs(L);
+    lua_open_signals(L);
+
+    const int empty = load(L, "return function() end");
+    const int accessors = load(L, accessor_script());
+    const int globals = load(L, global_script());
+    if ((empty == LUA_NOREF) || (accessors == LUA_NOREF) || (globals == LUA_NOREF))
+    {
+        return 1;
+    }
+
+    float* values = signal_db_values();
+
+    // Both must compute the same output before they are timed.
+    values[kSignals] = 0.0f;
+    call(L, accessors);
+    const bool accessors_ok = (values[kSignals] == expected);
+
+    values[kSignals] = 0.0f;
+    sync_globals(L);
+    call(L, globals);
+    sync_globals(L);
+    const bool globals_ok = (values[kSignals] == expected);
+
+    if (!accessors_ok || !globals_ok)
+    {
+        printf("Wrong output, accessors %s, globals %s\n", accessors_ok ? "right" : "wrong",
+            globals_ok ? "right" : "wrong");
+        return 1;
+    }
+
+    const double empty_ns = bench_ns_per_call(iterations, [&]() { call(L, empty); });
+    const double accessors_ns = bench_ns_per_call(iterations, [&]() { call(L, accessors); });
+    const double globals_ns = bench_ns_per_call(iterations, [&]() { call(L, globals); });
+    const double sync_ns = bench_ns_per_call(iterations, [&]() { sync_globals(L); });
+
+    const auto per_access = [](double ns) { return ns / static_cast<double>(kAccesses); };
+
+    printf("%zu signal accesses per cycle, %zu cycles, %.1f ns per empty call\n", kAccesses, iterations, empty_ns);
+    printf("%-24s %8.1f ns per cycle, %5.1f ns per access\n", "Accessors", accessors_ns,
+        per_access(accessors_ns - empty_ns));
+    printf("%-24s %8.1f ns per cycle, %5.1f ns per access\n", "Globals", globals_ns, per_access(globals_ns - empty_ns));
+    printf("%-24s %8.1f ns per cycle, %5.1f ns per access\n", "Globals kept in step", globals_ns + sync_ns,
+        per_access(globals_ns + sync_ns - empty_ns));
+
+    lua_close(L);
+
+    return 0;
+}
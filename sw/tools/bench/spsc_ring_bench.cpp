@@ -0,0 +1,257 @@
+/**
+ * The RX rings of the MCAN driver under sustained 100 % bus load on both channels, on the host: one producer thread
+ * per channel stands in for the RX interrupt and pushes frames at the back to back rate of the shortest frame on its
+ * bus, and one consumer thread stands in for the RX task and drains both rings every --wake-us.
+ *
+ *     spsc_ring_bench [--frames 200000] [--wake-us 2000]
+ *
+ * Each channel sends --frames frames numbered in order.  The consumer checks that every frame comes out in order and
+ * that the only gaps are the frames the producer could not push, reported as overflows along with the fullest the
+ * rings got.  Then the cost of a push and a pop is timed with both sides running flat out.
+ */
+
+#include "can_frame.h"
+#include "conf_can.h"
+#include "spsc_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+constexpr size_t kDefaultFrames = 200000U;
+constexpr uint32_t kDefaultWakeUs = 2000U;
+constexpr size_t kFlatOutFrames = 10000000U;
+
+// Same as kCanRxRingSize of mcan_rx.h, which needs FreeRTOS.
+constexpr size_t kCanRxRingSize = 256U;
+
+// Nominal bit rate of conf_mcan.h.
+constexpr uint32_t kCanNominalBitrate = 500000U;
+
+// Shortest frames, with no data and no stuff bit, as can_frame_bits() of mcan_clock.h counts them: 47 bits for a
+// classic frame, 30 nominal and 32 fast bits for a CAN-FD frame with bit rate switching.
+constexpr uint32_t kClassicFrameBits = 47U;
+constexpr uint32_t kFdNominalBits = 30U;
+constexpr uint32_t kFdDataBits = 32U;
+
+using CanRxRing = SpscRing<CanFrame, kCanRxRingSize>;
+
+struct ChannelRun
+{
+    CanRxRing ring;
+    std::chrono::nanoseconds frame_period;
+    uint32_t overflows;     // Written by the producer.
+    uint32_t received;      // Written by the consumer from here on.
+    uint32_t gaps;
+    uint32_t out_of_order;
+    uint32_t next;
+    size_t max_fill;
+};
+
+static std::chrono::nanoseconds shortest_frame(const can::ChannelConfig& config)
+{
+    const double classic_s = static_cast<double>(kClassicFrameBits) / kCanNominalBitrate;
+    const double fd_s = (config.data_bitrate == 0U) ? classic_s :
+        ((static_cast<double>(kFdNominalBits) / kCanNominalBitrate) +
+            (static_cast<double>(kFdDataBits) / config.data_bitrate));
+
+    return std::chrono::nanoseconds(static_cast<int64_t>(std::min(classic_s, fd_s) * 1e9));
+}
+
+/**
+ * Push the frames on the schedule of the bus, catching up in a burst when the thread was held up, as the RX FIFO of
+ * the MCAN would hand them over after the interrupt was held up.
+ */
+static void produce(ChannelRun& channel, size_t frames)
+{
+    CanFrame frame = {};
+    frame.flags = can_flags::kFd | can_flags::kBitRateSwitch;
+
+    auto release = std::chrono::steady_clock::now();
+    for (size_t i = 0U; i < frames; i++)
+    {
+        release += channel.frame_period;
+        std::this_thread::sleep_until(release);
+
+        frame.timestamp_cycles = static_cast<uint32_t>(i);
+        if (false == channel.ring.push(frame))
+        {
+            channel.overflows++;
+        }
+    }
+}
+
+static void drain(ChannelRun& channel)
+{
+    channel.max_fill = std::max(channel.max_fill, channel.ring.size());
+
+    CanFrame frame = {};
+    while (channel.ring.pop(frame))
+    {
+        const uint32_t sequence = frame.timestamp_cycles;
+
+        if (sequence < channel.next)
+        {
+            channel.out_of_order++;
+        }
+        else
+        {
+            channel.gaps += sequence - channel.next;
+            channel.next = sequence + 1U;
+        }
+
+        channel.received++;
+    }
+}
+
+static void consume(std::array<ChannelRun, kCanChannels>& channels, const std::atomic<bool>& done,
+    std::chrono::microseconds wake)
+{
+    while (false == done.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(wake);
+
+        for (ChannelRun& channel : channels)
+        {
+            drain(channel);
+        }
+    }
+
+    for (ChannelRun& channel : channels)
+    {
+        drain(channel);
+    }
+}
+
+/**
+ * Both sides flat out on a single ring.
+ *
+ * \return the mean time of a push and a pop, in ns.
+ */
+static double flat_out_ns(uint32_t frames)
+{
+    static CanRxRing ring = {};
+    uint32_t errors = 0U;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread consumer([&]()
+    {
+        CanFrame frame = {};
+        for (uint32_t i = 0U; i < frames; i++)
+        {
+            while (false == ring.pop(frame))
+            {
+                std::this_thread::yield();
+            }
+            errors += (frame.timestamp_cycles != i) ? 1U : 0U;
+        }
+    });
+
+    CanFrame frame = {};
+    for (uint32_t i = 0U; i < frames; i++)
+    {
+        frame.timestamp_cycles = i;
+        while (false == ring.push(frame))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    consumer.join();
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (errors > 0U)
+    {
+        printf("%lu frames out of order flat out\n", static_cast<unsigned long>(errors));
+    }
+
+    return elapsed.count() / static_cast<double>(frames);
+}
+
+static void usage()
+{
+    printf("Usage: spsc_ring_bench [--frames 200000] [--wake-us 2000]\n");
+}
+
+int main(int argc, char** argv)
+{
+    size_t frames = kDefaultFrames;
+    uint32_t wake_us = kDefaultWakeUs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+        const bool has_value = (i + 1) < argc;
+
+        if ((strcmp(argument, "--frames") == 0) && has_value)
+        {
+            frames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((strcmp(argument, "--wake-us") == 0) && has_value)
+        {
+            wake_us = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((frames == 0U) || (frames > UINT32_MAX) || (wake_us == 0U))
+    {
+        usage();
+        return 1;
+    }
+
+    static std::array<ChannelRun, kCanChannels> channels = {};
+    for (size_t i = 0U; i < kCanChannels; i++)
+    {
+        channels[i].frame_period = shortest_frame(can::kChannels[i]);
+    }
+
+    std::atomic<bool> done = false;
+    std::thread consumer(&consume, std::ref(channels), std::cref(done), std::chrono::microseconds(wake_us));
+    std::thread can0(&produce, std::ref(channels[0]), frames);
+    std::thread can1(&produce, std::ref(channels[1]), frames);
+
+    can0.join();
+    can1.join();
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    bool failed = false;
+    printf("%-6s %10s %10s %10s %10s %10s %10s\n", "", "frame_us", "frames/s", "received", "overflows", "max_fill",
+        "ring_ms");
+
+    for (size_t i = 0U; i < kCanChannels; i++)
+    {
+        const ChannelRun& channel = channels[i];
+        const double frame_us = static_cast<double>(channel.frame_period.count()) / 1000.0;
+
+        printf("CAN%-3zu %10.1f %10.0f %10lu %10lu %10zu %10.1f\n", i, frame_us, 1e6 / frame_us,
+            static_cast<unsigned long>(channel.received), static_cast<unsigned long>(channel.overflows),
+            channel.max_fill, (frame_us * kCanRxRingSize) / 1000.0);
+
+        if ((channel.out_of_order > 0U) || (channel.gaps != channel.overflows) ||
+            ((channel.received + channel.overflows) != frames))
+        {
+            printf("CAN%zu: %lu frames out of order, %lu missing for %lu overflows\n", i,
+                static_cast<unsigned long>(channel.out_of_order), static_cast<unsigned long>(channel.gaps),
+                static_cast<unsigned long>(channel.overflows));
+            failed = true;
+        }
+
+        failed = failed || (channel.overflows > 0U);
+    }
+
+    const double push_pop_ns = flat_out_ns(kFlatOutFrames);
+    printf("Push and pop flat out %.1f ns per frame, %.1f M frames/s\n", push_pop_ns, 1000.0 / push_pop_ns);
+
+    return failed ? 1 : 0;
+}
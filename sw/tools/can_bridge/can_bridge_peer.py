@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""Stand-in for cannelloni measuring the throughput of the VCM CAN bridge, on both channels at once.
+
+    can_bridge_peer.py [--host 192.168.0.100] [--channels 0,1] [--duration 10] [--inject-rate full] ...
+
+One UDP socket per channel talks to the bridge port of the channel (20000 + channel), in the cannelloni version 2
+framing.  An empty datagram first registers this host as the peer, with the timestamped data op code unless
+--no-timestamps is given, so every frame comes back stamped with its start of frame time on the VCM.
+
+Every second and at the end, for each channel, the frames and datagrams received per second, the frames per datagram,
+the datagrams lost (gaps in the sequence numbers) and the span of the frame timestamps within a datagram are printed,
+along with the frames injected per second.
+
+With --inject-rate frames are sent into the TX FIFO of every channel, up to 'full' bus load of the bit rate with the
+frame given by --inject-id and --inject-length.  Only use this on a bench: the frames go out on the bus, and frames in
+the DBC are decoded by the VCM like any other.  With both channels wired to the same bus, each channel receives what
+the other one sends, provided the identifier passes the acceptance filters, and the injected frames come back.
+"""
+
+import argparse
+import select
+import socket
+import struct
+import sys
+import time
+
+VERSION = 2
+OP_DATA = 0
+OP_TIMESTAMPED_DATA = 0x80
+
+HEADER = struct.Struct('>BBBH')
+
+EXTENDED_FLAG = 0x80000000
+REMOTE_FLAG = 0x40000000
+FD_LENGTH = 0x80
+FD_BIT_RATE_SWITCH = 0x01
+
+# A single Ethernet frame, less the IP and UDP headers.
+MAX_DATAGRAM_SIZE = 1472
+
+
+class Frame:
+    def __init__(self, can_id, data, extended=False, remote=False, fd=False, brs=False, timestamp_us=None):
+        self.can_id = can_id
+        self.data = data
+        self.extended = extended
+        self.remote = remote
+        self.fd = fd
+        self.brs = brs
+        self.timestamp_us = timestamp_us
+
+
+def encode(frames, op, sequence):
+    datagram = bytearray(HEADER.pack(VERSION, op, sequence & 0xFF, len(frames)))
+
+    for frame in frames:
+        if op == OP_TIMESTAMPED_DATA:
+            datagram += struct.pack('>I', 0)
+
+        can_id = frame.can_id | (EXTENDED_FLAG if frame.extended else 0) | (REMOTE_FLAG if frame.remote else 0)
+        datagram += struct.pack('>I', can_id)
+
+        if frame.fd:
+            datagram += bytes((len(frame.data) | FD_LENGTH, FD_BIT_RATE_SWITCH if frame.brs else 0))
+        else:
+            datagram += bytes((len(frame.data),))
+
+        if not frame.remote:
+            datagram += frame.data
+
+    return bytes(datagram)
+
+
+def decode(datagram):
+    """Return the op code, sequence number and frames of a datagram, raise ValueError if it is malformed."""
+    if len(datagram) < HEADER.size:
+        raise ValueError('datagram shorter than its header')
+
+    version, op, sequence, count = HEADER.unpack_from(datagram)
+    if version != VERSION or op not in (OP_DATA, OP_TIMESTAMPED_DATA):
+        raise ValueError('version %u, op code %u' % (version, op))
+
+    frames = []
+    offset = HEADER.size
+
+    for _ in range(count):
+        timestamp_us = None
+        if op == OP_TIMESTAMPED_DATA:
+            (timestamp_us,) = struct.unpack_from('>I', datagram, offset)
+            offset += 4
+
+        can_id, length = struct.unpack_from('>IB', datagram, offset)
+        offset += 5
+
+        fd = (length & FD_LENGTH) != 0
+        brs = False
+        if fd:
+            brs = (datagram[offset] & FD_BIT_RATE_SWITCH) != 0
+            offset += 1
+            length &= ~FD_LENGTH
+
+        remote = (can_id & REMOTE_FLAG) != 0
+        data = b''
+        if not remote:
+            data = datagram[offset:offset + length]
+            if len(data) != length:
+                raise ValueError('frame past the end of the datagram')
+            offset += length
+
+        extended = (can_id & EXTENDED_FLAG) != 0
+        frames.append(Frame(can_id & (0x1FFFFFFF if extended else 0x7FF), data, extended, remote, fd, brs,
+                            timestamp_us))
+
+    return op, sequence, frames
+
+
+def frame_bits(length, extended):
+    """Bits of a classic frame on the bus, without stuffing, with the interframe space."""
+    return (67 if extended else 47) + (8 * length)
+
+
+class Channel:
+    def __init__(self, index, host, port, local_port):
+        self.index = index
+        self.address = (host, port)
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.socket.bind(('', local_port))
+        self.socket.setblocking(False)
+        self.sequence = 0
+        self.expected_sequence = None
+        self.reset()
+        self.total_frames = 0
+        self.total_datagrams = 0
+        self.total_lost = 0
+        self.total_injected = 0
+
+    def reset(self):
+        self.frames = 0
+        self.datagrams = 0
+        self.lost = 0
+        self.malformed = 0
+        self.injected = 0
+        self.max_frames = 0
+        self.max_span_us = 0
+
+    def send(self, frames, op):
+        self.socket.sendto(encode(frames, op, self.sequence), self.address)
+        self.sequence += 1
+        self.injected += len(frames)
+        self.total_injected += len(frames)
+
+    def receive(self):
+        while True:
+            try:
+                datagram = self.socket.recv(65536)
+            except BlockingIOError:
+                return
+
+            try:
+                _, sequence, frames = decode(datagram)
+            except (ValueError, struct.error):
+                self.malformed += 1
+                continue
+
+            if self.expected_sequence is not None:
+                lost = (sequence - self.expected_sequence) & 0xFF
+                self.lost += lost
+                self.total_lost += lost
+            self.expected_sequence = (sequence + 1) & 0xFF
+
+            self.datagrams += 1
+            self.frames += len(frames)
+            self.total_datagrams += 1
+            self.total_frames += len(frames)
+            self.max_frames = max(self.max_frames, len(frames))
+
+            stamps = [frame.timestamp_us for frame in frames if frame.timestamp_us is not None]
+            if stamps:
+                self.max_span_us = max(self.max_span_us, (stamps[-1] - stamps[0]) & 0xFFFFFFFF)
+
+
+def report(channels, seconds):
+    for channel in channels:
+        frames_per_datagram = channel.frames / channel.datagrams if channel.datagrams else 0.0
+        print('CAN%u: rx %7.0f frames/s %6.0f datagrams/s %5.1f frames/datagram (max %u, span %u us) '
+              '%u lost %u malformed, tx %7.0f frames/s' % (
+                  channel.index, channel.frames / seconds, channel.datagrams / seconds, frames_per_datagram,
+                  channel.max_frames, channel.max_span_us, channel.lost, channel.malformed,
+                  channel.injected / seconds))
+        channel.reset()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--host', default='192.168.0.100', help='address of the VCM')
+    parser.add_argument('--port', type=int, default=20000, help='bridge port of CAN0, CAN1 is on the next one')
+    parser.add_argument('--local-port', type=int, default=None, help='local port of CAN0, same as --port by default')
+    parser.add_argument('--channels', default='0,1', help='channels to bridge, comma separated')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds to run for')
+    parser.add_argument('--no-timestamps', action='store_true', help='plain cannelloni data, without timestamps')
+    parser.add_argument('--inject-rate', default='0',
+                        help="frames per second sent on every channel, 'full' for the whole bus")
+    parser.add_argument('--inject-id', type=lambda value: int(value, 0), default=0x7FF)
+    parser.add_argument('--inject-length', type=int, default=8)
+    parser.add_argument('--inject-batch', type=int, default=16,
+                        help='frames per datagram, the TX FIFO of a channel holds 16')
+    parser.add_argument('--bitrate', type=int, default=500000, help="nominal bit rate, for 'full'")
+    args = parser.parse_args()
+
+    op = OP_DATA if args.no_timestamps else OP_TIMESTAMPED_DATA
+    local_port = args.port if args.local_port is None else args.local_port
+    extended = args.inject_id > 0x7FF
+
+    if args.inject_rate == 'full':
+        rate = args.bitrate / frame_bits(args.inject_length, extended)
+    else:
+        rate = float(args.inject_rate)
+
+    channels = [Channel(int(index), args.host, args.port + int(index), local_port + int(index))
+                for index in args.channels.split(',')]
+
+    # Registers this host as the peer of every channel.
+    for channel in channels:
+        channel.socket.sendto(encode([], op, 0), channel.address)
+
+    payload = bytes(range(args.inject_length))
+    frame = Frame(args.inject_id, payload, extended)
+    frames_per_datagram = min(args.inject_batch, (MAX_DATAGRAM_SIZE - HEADER.size) // (4 + 4 + 1 + args.inject_length))
+
+    start = time.monotonic()
+    last_report = start
+    injected = 0.0
+
+    while True:
+        now = time.monotonic()
+        if now - start >= args.duration:
+            break
+
+        ready, _, _ = select.select([channel.socket for channel in channels], [], [], 0.001)
+
+        for channel in channels:
+            if channel.socket in ready:
+                channel.receive()
+
+        # Frames due since the start, in full datagrams.
+        due = int(rate * (now - start) - injected)
+        while due >= frames_per_datagram:
+            count = min(due, frames_per_datagram)
+            for channel in channels:
+                channel.send([frame] * count, op)
+            injected += count
+            due -= count
+
+        if now - last_report >= 1.0:
+            report(channels, now - last_report)
+            last_report = now
+
+    report(channels, time.monotonic() - last_report)
+
+    elapsed = time.monotonic() - start
+    for channel in channels:
+        print('CAN%u total: rx %u frames in %u datagrams (%.0f frames/s), %u datagrams lost, tx %u frames '
+              '(%.0f frames/s)' % (channel.index, channel.total_frames, channel.total_datagrams,
+                                   channel.total_frames / elapsed, channel.total_lost, channel.total_injected,
+                                   channel.total_injected / elapsed))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Read the CAN statistics snapshot of the VCM from its diagnostics service and print it.
+
+    can_stats.py [192.168.0.100] [--port 5002] [--watch]
+
+The layout follows CanStatsSnapshot in sw/src/include/can_stats.h, every field a 32-bit little endian integer.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+MAGIC = 0x534E4143
+VERSION = 1
+
+HEADER = struct.Struct('<4I')
+
+LATENCY_BUCKETS = 12
+CHANNEL_FIELDS = (
+    'frames_received', 'frames_sent', 'received_per_second', 'sent_per_second', 'bus_load_permille',
+    'bus_load_peak_permille', 'transmit_errors', 'receive_errors', 'protocol_status', 'errors', 'warnings',
+    'error_passives', 'bus_offs', 'last_error_code', 'fifo0_high_water', 'fifo1_high_water', 'fifo0_lost',
+    'fifo1_lost', 'ring_high_water', 'ring_overflows', 'latency_max_us',
+)
+CHANNEL = struct.Struct('<%uI' % (len(CHANNEL_FIELDS) + LATENCY_BUCKETS))
+
+# PSR.LEC
+LAST_ERROR_CODES = ('none', 'stuff', 'form', 'ack', 'bit1', 'bit0', 'crc', 'no change')
+
+PSR_EP = 1 << 5
+PSR_EW = 1 << 6
+PSR_BO = 1 << 7
+
+
+def request(host, port, timeout=1.0):
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.settimeout(timeout)
+        sock.sendto(b'can', (host, port))
+        reply, _ = sock.recvfrom(2048)
+    return reply
+
+
+def decode(reply):
+    """Return the uptime in ms and a list of one dict per channel, raise ValueError if the reply is not a snapshot."""
+    if len(reply) < HEADER.size:
+        raise ValueError('reply shorter than the header: %r' % reply[:64])
+
+    magic, version, uptime_ms, channels = HEADER.unpack_from(reply)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError('magic 0x%08X, version %u' % (magic, version))
+    if len(reply) != HEADER.size + (channels * CHANNEL.size):
+        raise ValueError('%u bytes for %u channels' % (len(reply), channels))
+
+    snapshots = []
+    for index in range(channels):
+        values = CHANNEL.unpack_from(reply, HEADER.size + (index * CHANNEL.size))
+        snapshot = dict(zip(CHANNEL_FIELDS, values))
+        snapshot['latency_histogram'] = values[len(CHANNEL_FIELDS):]
+        snapshots.append(snapshot)
+
+    return uptime_ms, snapshots
+
+
+def bucket_label(index):
+    if index == 0:
+        return '<8'
+    if index == LATENCY_BUCKETS - 1:
+        return '>=%u' % (1 << (index + 2))
+    return '<%u' % (1 << (index + 3))
+
+
+def error_state(status):
+    if status & PSR_BO:
+        return 'bus off'
+    if status & PSR_EP:
+        return 'error passive'
+    if status & PSR_EW:
+        return 'warning'
+    return 'active'
+
+
+def report(uptime_ms, snapshots):
+    print('uptime %.1f s' % (uptime_ms / 1000.0))
+
+    for index, channel in enumerate(snapshots):
+        print('CAN%u: rx %u (%u/s) tx %u (%u/s), bus load %.1f%% (peak %.1f%%)' % (
+            index, channel['frames_received'], channel['received_per_second'], channel['frames_sent'],
+            channel['sent_per_second'], channel['bus_load_permille'] / 10.0, channel['bus_load_peak_permille'] / 10.0))
+        print('  %s, TEC %u REC %u, %u errors, last %s, %u warnings %u error passives %u bus offs' % (
+            error_state(channel['protocol_status']), channel['transmit_errors'], channel['receive_errors'],
+            channel['errors'], LAST_ERROR_CODES[channel['last_error_code'] & 0x7], channel['warnings'],
+            channel['error_passives'], channel['bus_offs']))
+        print('  FIFO high water %u/%u lost %u/%u, ring high water %u overflows %u' % (
+            channel['fifo0_high_water'], channel['fifo1_high_water'], channel['fifo0_lost'], channel['fifo1_lost'],
+            channel['ring_high_water'], channel['ring_overflows']))
+        print('  latency max %u us: %s' % (channel['latency_max_us'], ' '.join(
+            '%s:%u' % (bucket_label(bucket), count)
+            for bucket, count in enumerate(channel['latency_histogram']) if count != 0)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', nargs='?', default='192.168.0.100', help='address of the VCM')
+    parser.add_argument('--port', type=int, default=5002, help='port of the diagnostics service')
+    parser.add_argument('--watch', action='store_true', help='poll every second until interrupted')
+    args = parser.parse_args()
+
+    while True:
+        try:
+            report(*decode(request(args.host, args.port)))
+        except (socket.timeout, ValueError) as error:
+            print('no snapshot: %s' % error, file=sys.stderr)
+            if not args.watch:
+                return 1
+
+        if not args.watch:
+            return 0
+
+        time.sleep(1.0)
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main())
+    except KeyboardInterrupt:
+        sys.exit(0)
@@ -0,0 +1,629 @@
+#!/usr/bin/env python3
+"""Turn a DBC file into a C++ header decoding its messages into the signal database.
+
+    dbc_codegen.py <input.dbc> <output.h> [node]
+
+The header holds constexpr message and signal descriptors and one decode function per message, with the bit
+extraction, sign extension, scaling and offset of every signal unrolled.  Decoding a frame is a switch on its
+identifier, nothing of the DBC is parsed or interpreted at run time.
+
+Messages sent by node are encoded from the signal database instead, with one encode function per message rounding,
+saturating and packing every signal.  Their GenMsgCycleTime attribute, if any, is the period they are broadcast at.
+
+Only what the generator needs is read: messages (BO_), signals (SG_), float signal types (SIG_VALTYPE_) and message
+cycle times (BA_ "GenMsgCycleTime").  Multiplexed signals are skipped with a warning.  Messages longer than 8 bytes
+are CAN-FD frames, of up to 64 bytes.
+"""
+
+import os
+import re
+import sys
+
+EXTENDED_ID_FLAG = 0x80000000
+
+# Payload lengths a DLC can encode, CAN-FD above 8 bytes.
+FRAME_LENGTHS = (0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64)
+
+MESSAGE_RE = re.compile(r'^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+(\w+)')
+SIGNAL_RE = re.compile(
+    r'^SG_\s+(\w+)\s*(M|m\d+M?)?\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+    r'\(\s*([^,\s]+)\s*,\s*([^)\s]+)\s*\)\s*\[\s*([^|\s]+)\s*\|\s*([^\]\s]+)\s*\]\s*"([^"]*)"')
+VALTYPE_RE = re.compile(r'^SIG_VALTYPE_\s+(\d+)\s+(\w+)\s*:\s*([012])\s*;')
+CYCLE_TIME_RE = re.compile(r'^BA_\s+"GenMsgCycleTime"\s+BO_\s+(\d+)\s+(\d+)\s*;')
+
+
+class Signal:
+    def __init__(self, name, start, length, big_endian, signed, factor, offset, unit):
+        self.name = name
+        self.start = start
+        self.length = length
+        self.big_endian = big_endian
+        self.signed = signed
+        self.factor = factor
+        self.offset = offset
+        self.unit = unit
+        # 0: integer, 1: IEEE float, 2: IEEE double.
+        self.value_type = 0
+
+
+class Message:
+    def __init__(self, frame_id, name, length, sender):
+        self.frame_id = frame_id
+        self.name = name
+        self.length = length
+        self.sender = sender
+        self.signals = []
+        # Milliseconds, 0 for a message not sent periodically.
+        self.cycle_time = 0
+
+
+def fail(path, number, message):
+    sys.exit(f'{path}:{number}: {message}')
+
+
+def parse(path):
+    messages = []
+    by_id = {}
+
+    with open(path, encoding='latin-1') as dbc:
+        for number, line in enumerate(dbc, 1):
+            line = line.strip()
+
+            match = MESSAGE_RE.match(line)
+            if match:
+                message = Message(int(match.group(1)), match.group(2), int(match.group(3)), match.group(4))
+                if message.length not in FRAME_LENGTHS:
+                    fail(path, number, f'{message.name} does not have the length of a CAN or CAN-FD frame')
+                messages.append(message)
+                by_id[message.frame_id] = message
+                continue
+
+            match = SIGNAL_RE.match(line)
+            if match:
+                if not messages:
+                    fail(path, number, 'signal outside of a message')
+
+                name, multiplex = match.group(1), match.group(2)
+                if multiplex:
+                    print(f'{path}:{number}: warning: skipping multiplexed signal {name}', file=sys.stderr)
+                    continue
+
+                signal = Signal(name, int(match.group(3)), int(match.group(4)), match.group(5) == '0',
+                                match.group(6) == '-', float(match.group(7)), float(match.group(8)), match.group(11))
+                check_layout(path, number, messages[-1], signal)
+                messages[-1].signals.append(signal)
+                continue
+
+            match = VALTYPE_RE.match(line)
+            if match:
+                message = by_id.get(int(match.group(1)))
+                signal = next((s for s in message.signals if s.name == match.group(2)), None) if message else None
+                if signal is None:
+                    fail(path, number, f'unknown signal {match.group(2)}')
+                signal.value_type = int(match.group(3))
+                if (signal.value_type == 1 and signal.length != 32) or (signal.value_type == 2 and signal.length != 64):
+                    fail(path, number, f'{signal.name} does not have the size of its float type')
+                continue
+
+            match = CYCLE_TIME_RE.match(line)
+            if match:
+                message = by_id.get(int(match.group(1)))
+                if message is None:
+                    fail(path, number, f'unknown message {match.group(1)}')
+                message.cycle_time = int(match.group(2))
+                if message.cycle_time > 65535:
+                    fail(path, number, f'{message.name} has too long a cycle time')
+
+    names = {}
+    for message in messages:
+        for signal in message.signals:
+            if signal.name in names:
+                sys.exit(f'{path}: {signal.name} is defined in both {names[signal.name]} and {message.name}')
+            names[signal.name] = message.name
+
+    return messages
+
+
+def byte_span(signal):
+    """First and last byte of the frame holding bits of the signal."""
+    if signal.big_endian:
+        # Motorola start bits point at the most significant bit, in the sawtooth numbering of the DBC.  Counting
+        # bits from the most significant bit of byte 0 instead, the signal is contiguous.
+        msb = (signal.start // 8) * 8 + 7 - signal.start % 8
+        return msb // 8, (msb + signal.length - 1) // 8
+    return signal.start // 8, (signal.start + signal.length - 1) // 8
+
+
+def window(signal):
+    """Byte the 64-bit word holding the signal is loaded from, and the position of the signal lsb in that word.
+
+    Signals share the words loaded from every 8th byte, a signal crossing from one to the next gets a word loaded from
+    its own first byte.  The frame data is always 64 bytes long, any load from up to byte 56 is valid.
+    """
+    first, last = byte_span(signal)
+    base = (first // 8) * 8
+    if last >= base + 8:
+        base = min(first, 56)
+
+    if signal.big_endian:
+        msb = (signal.start // 8) * 8 + 7 - signal.start % 8
+        return base, 63 - (msb + signal.length - 1 - 8 * base)
+    return base, signal.start - 8 * base
+
+
+def check_layout(path, number, message, signal):
+    if signal.length < 1 or signal.length > 64:
+        fail(path, number, f'{signal.name} has an invalid length')
+
+    _, last = byte_span(signal)
+    if last >= message.length:
+        fail(path, number, f'{signal.name} does not fit the {message.length} bytes of {message.name}')
+
+    _, lsb = window(signal)
+    if lsb < 0 or lsb + signal.length > 64:
+        fail(path, number, f'{signal.name} straddles more than 8 bytes')
+
+
+def literal(value):
+    text = repr(float(value))
+    if 'inf' in text or 'nan' in text:
+        sys.exit(f'invalid scaling value {value}')
+    return text + 'f'
+
+
+def identifier(name):
+    return re.sub(r'(?<=[a-z0-9])([A-Z])', r'_\1', name).lower()
+
+
+def word_name(signal):
+    base, _ = window(signal)
+    word = 'be' if signal.big_endian else 'le'
+    return f'{word}{base}' if base else word
+
+
+def raw_expression(signal):
+    word = word_name(signal)
+    _, lsb = window(signal)
+    shifted = f'({word} >> {lsb}U)' if lsb else word
+
+    if signal.length == 64:
+        return shifted
+    if signal.length > 32:
+        return f'({shifted} & 0x{(1 << signal.length) - 1:X}ULL)'
+    return f'static_cast<uint32_t>({shifted} & 0x{(1 << signal.length) - 1:X}U)'
+
+
+def value_expression(signal):
+    raw = raw_expression(signal)
+
+    if signal.value_type == 1:
+        value = f'as_float({raw})'
+    elif signal.value_type == 2:
+        value = f'static_cast<float>(as_double({raw}))'
+    elif signal.signed:
+        if signal.length in (8, 16, 32, 64):
+            value = f'static_cast<float>(static_cast<int{signal.length}_t>({raw}))'
+        elif signal.length < 32:
+            value = f'static_cast<float>(sign_extend({raw}, {signal.length}U))'
+        else:
+            value = f'static_cast<float>(sign_extend64({raw}, {signal.length}U))'
+    else:
+        value = f'static_cast<float>({raw})'
+
+    if signal.factor != 1.0:
+        value = f'{value} * {literal(signal.factor)}'
+    if signal.offset > 0.0:
+        value = f'{value} + {literal(signal.offset)}'
+    elif signal.offset < 0.0:
+        value = f'{value} - {literal(-signal.offset)}'
+
+    return value
+
+
+def encoded_expression(signal, value):
+    """Raw bits of the signal, shifted into place in its window word, from the physical value."""
+    if signal.offset > 0.0:
+        value = f'({value} - {literal(signal.offset)})'
+    elif signal.offset < 0.0:
+        value = f'({value} + {literal(-signal.offset)})'
+    if signal.factor != 1.0:
+        value = f'{value} / {literal(signal.factor)}'
+
+    mask = (1 << signal.length) - 1
+    if signal.value_type == 1:
+        raw = f'from_float({value})'
+    elif signal.value_type == 2:
+        raw = f'from_double(static_cast<double>({value}))'
+    elif signal.length > 32:
+        if signal.signed:
+            raw = f'to_signed64({value}, {signal.length}U)'
+            if signal.length < 64:
+                raw = f'({raw} & 0x{mask:X}ULL)'
+        else:
+            raw = f'to_unsigned64({value}, 0x{mask:X}ULL)'
+    elif signal.signed:
+        raw = f'to_signed({value}, {signal.length}U)'
+        if signal.length < 32:
+            raw = f'({raw} & 0x{mask:X}U)'
+    else:
+        raw = f'to_unsigned({value}, 0x{mask:X}U)'
+
+    _, lsb = window(signal)
+    raw = f'static_cast<uint64_t>({raw})'
+    return f'{raw} << {lsb}U' if lsb else raw
+
+
+def format_id(message):
+    if message.frame_id & EXTENDED_ID_FLAG:
+        return f'0x{message.frame_id & ~EXTENDED_ID_FLAG:08X}U | kExtendedIdFlag'
+    return f'0x{message.frame_id:03X}U'
+
+
+def describe_id(message):
+    if message.frame_id & EXTENDED_ID_FLAG:
+        return f'0x{message.frame_id & ~EXTENDED_ID_FLAG:08X} (extended)'
+    return f'0x{message.frame_id:03X}'
+
+
+def message_comment(message):
+    comment = f'// {message.name}, {describe_id(message)}, {message.length} bytes'
+    if message.cycle_time:
+        comment += f', every {message.cycle_time} ms'
+    return comment + '.'
+
+
+def words_of(message):
+    """Window words of the message, as (name, first byte, big endian)."""
+    words = sorted({(window(s)[0], s.big_endian) for s in message.signals}, key=lambda w: (w[1], w[0]))
+    return [(('be' if big_endian else 'le') + (str(base) if base else ''), base, big_endian)
+            for base, big_endian in words]
+
+
+def generate(messages, source, node):
+    signals = [signal for message in messages for signal in message.signals]
+
+    first = 0
+    for message in messages:
+        message.first_signal = first
+        first += len(message.signals)
+
+    received = [message for message in messages if message.sender != node]
+    sent = [message for message in messages if message.sender == node]
+    guard = 'CAN_DBC_H_'
+
+    out = []
+    emit = out.append
+
+    emit(f'// Generated from {source} by tools/dbc/dbc_codegen.py, do not edit.')
+    emit(f'#ifndef {guard}')
+    emit(f'#define {guard}')
+    emit('')
+    emit('#include "can_frame.h"')
+    emit('#include "signal_db.h"')
+    emit('')
+    emit('#include <array>')
+    emit('#include <cstddef>')
+    emit('#include <cstdint>')
+    emit('#include <cstring>')
+    emit('')
+    emit('namespace can_dbc')
+    emit('{')
+    emit('')
+    emit('// Set on the identifier of extended frames, as in the DBC.')
+    emit('constexpr uint32_t kExtendedIdFlag = 0x80000000U;')
+    emit('')
+    emit('struct SignalDescriptor')
+    emit('{')
+    emit('    const char* name;')
+    emit('    const char* unit;')
+    emit('    uint8_t start_bit;')
+    emit('    uint8_t length;')
+    emit('    bool big_endian;')
+    emit('    bool is_signed;')
+    emit('    float factor;')
+    emit('    float offset;')
+    emit('};')
+    emit('')
+    emit('struct MessageDescriptor')
+    emit('{')
+    emit('    const char* name;')
+    emit('    uint32_t id;')
+    emit('    uint8_t length;')
+    emit('    uint16_t cycle_time_ms;     // 0 unless sent periodically.')
+    emit('    uint16_t first_signal;')
+    emit('    uint16_t signal_count;')
+    emit('};')
+    emit('')
+    emit(f'constexpr std::array<SignalDescriptor, {len(signals)}U> kSignals = {{{{')
+    for signal in signals:
+        emit(f'    {{"{signal.name}", "{signal.unit}", {signal.start}U, {signal.length}U, '
+             f'{"true" if signal.big_endian else "false"}, {"true" if signal.signed else "false"}, '
+             f'{literal(signal.factor)}, {literal(signal.offset)}}},')
+    emit('}};')
+    emit('')
+    tx_comment = f'Messages sent by {node or "this node"}, encoded from the signal database.'
+    for name, group, comment in (('kMessages', received, 'Messages decoded from the bus.'),
+                                 ('kTxMessages', sent, tx_comment)):
+        emit(f'// {comment}')
+        emit(f'constexpr std::array<MessageDescriptor, {len(group)}U> {name} = {{{{')
+        for message in group:
+            emit(f'    {{"{message.name}", {format_id(message)}, {message.length}U, {message.cycle_time}U, '
+                 f'{message.first_signal}U, {len(message.signals)}U}},')
+        emit('}};')
+        emit('')
+    emit('// Signal database slot of every entry of kSignals.')
+    emit('using SlotTable = std::array<SignalSlot, kSignals.size()>;')
+    emit('')
+    emit('/**')
+    emit(' * Add every signal to the signal database.')
+    emit(' *')
+    emit(' * \\return false if the database is full, decode() and encode() must not be called then.')
+    emit(' */')
+    emit('inline bool resolve_slots(SlotTable& slots)')
+    emit('{')
+    emit('    for (size_t i = 0U; i < kSignals.size(); i++)')
+    emit('    {')
+    emit('        slots[i] = signal_db_add(kSignals[i].name);')
+    emit('        if (slots[i] == kInvalidSignalSlot)')
+    emit('        {')
+    emit('            return false;')
+    emit('        }')
+    emit('    }')
+    emit('')
+    emit('    return true;')
+    emit('}')
+    emit('')
+    emit('// The target is little endian: byte 0 ends up in the low bits of le and in the high bits of be.')
+    emit('inline uint64_t load_le(const uint8_t* data)')
+    emit('{')
+    emit('    uint64_t word = 0U;')
+    emit('    memcpy(&word, data, sizeof(word));')
+    emit('    return word;')
+    emit('}')
+    emit('')
+    emit('inline uint64_t load_be(const uint8_t* data)')
+    emit('{')
+    emit('    return __builtin_bswap64(load_le(data));')
+    emit('}')
+    emit('')
+    emit('inline int32_t sign_extend(uint32_t raw, uint32_t bits)')
+    emit('{')
+    emit('    return static_cast<int32_t>(raw << (32U - bits)) >> (32U - bits);')
+    emit('}')
+    emit('')
+    emit('inline int64_t sign_extend64(uint64_t raw, uint32_t bits)')
+    emit('{')
+    emit('    return static_cast<int64_t>(raw << (64U - bits)) >> (64U - bits);')
+    emit('}')
+    emit('')
+    emit('inline float as_float(uint32_t raw)')
+    emit('{')
+    emit('    float value = 0.0f;')
+    emit('    memcpy(&value, &raw, sizeof(value));')
+    emit('    return value;')
+    emit('}')
+    emit('')
+    emit('inline double as_double(uint64_t raw)')
+    emit('{')
+    emit('    double value = 0.0;')
+    emit('    memcpy(&value, &raw, sizeof(value));')
+    emit('    return value;')
+    emit('}')
+    if sent:
+        emit('')
+        emit('// Words are merged into the frame data, signals crossing from one window to the next overlap.')
+        emit('inline void merge_le(uint8_t* data, uint64_t word)')
+        emit('{')
+        emit('    const uint64_t merged = load_le(data) | word;')
+        emit('    memcpy(data, &merged, sizeof(merged));')
+        emit('}')
+        emit('')
+        emit('inline void merge_be(uint8_t* data, uint64_t word)')
+        emit('{')
+        emit('    merge_le(data, __builtin_bswap64(word));')
+        emit('}')
+        emit('')
+        emit('// Nearest whole number, halves away from zero.  Floats from 2^23 up are whole already, adding 0.5')
+        emit('// to them would round the odd ones up.  NaN is returned as is.')
+        emit('inline float round_half_away(float value)')
+        emit('{')
+        emit('    if (!((value < 8388608.0f) && (value > -8388608.0f)))')
+        emit('    {')
+        emit('        return value;')
+        emit('    }')
+        emit('')
+        emit('    const float whole = static_cast<float>(static_cast<int32_t>(value));')
+        emit('    const float fraction = value - whole;')
+        emit('')
+        emit('    if (fraction >= 0.5f)')
+        emit('    {')
+        emit('        return whole + 1.0f;')
+        emit('    }')
+        emit('')
+        emit('    return (fraction <= -0.5f) ? (whole - 1.0f) : whole;')
+        emit('}')
+        emit('')
+        emit('// Values are rounded to the nearest raw value and saturate to its range, NaN encodes as 0.')
+        emit('inline uint32_t to_unsigned(float value, uint32_t max)')
+        emit('{')
+        emit('    const float rounded = round_half_away(value);')
+        emit('')
+        emit('    if (rounded >= static_cast<float>(max))')
+        emit('    {')
+        emit('        return max;')
+        emit('    }')
+        emit('')
+        emit('    return (rounded >= 1.0f) ? static_cast<uint32_t>(rounded) : 0U;')
+        emit('}')
+        emit('')
+        emit('inline uint64_t to_unsigned64(float value, uint64_t max)')
+        emit('{')
+        emit('    const float rounded = round_half_away(value);')
+        emit('')
+        emit('    if (rounded >= static_cast<float>(max))')
+        emit('    {')
+        emit('        return max;')
+        emit('    }')
+        emit('')
+        emit('    return (rounded >= 1.0f) ? static_cast<uint64_t>(rounded) : 0U;')
+        emit('}')
+        emit('')
+        emit('// Two\'s complement raw value, the bits above the signal still need masking.')
+        emit('inline uint32_t to_signed(float value, uint32_t bits)')
+        emit('{')
+        emit('    const uint32_t limit = 1UL << (bits - 1U);')
+        emit('    const float rounded = round_half_away(value);')
+        emit('')
+        emit('    if (rounded >= static_cast<float>(limit))')
+        emit('    {')
+        emit('        return limit - 1U;')
+        emit('    }')
+        emit('')
+        emit('    if (rounded > -static_cast<float>(limit))')
+        emit('    {')
+        emit('        return static_cast<uint32_t>(static_cast<int32_t>(rounded));')
+        emit('    }')
+        emit('')
+        emit('    return (rounded <= -static_cast<float>(limit)) ? (0U - limit) : 0U;')
+        emit('}')
+        emit('')
+        emit('inline uint64_t to_signed64(float value, uint32_t bits)')
+        emit('{')
+        emit('    const uint64_t limit = 1ULL << (bits - 1U);')
+        emit('    const float rounded = round_half_away(value);')
+        emit('')
+        emit('    if (rounded >= static_cast<float>(limit))')
+        emit('    {')
+        emit('        return limit - 1U;')
+        emit('    }')
+        emit('')
+        emit('    if (rounded > -static_cast<float>(limit))')
+        emit('    {')
+        emit('        return static_cast<uint64_t>(static_cast<int64_t>(rounded));')
+        emit('    }')
+        emit('')
+        emit('    return (rounded <= -static_cast<float>(limit)) ? (0U - limit) : 0U;')
+        emit('}')
+        emit('')
+        emit('inline uint32_t from_float(float value)')
+        emit('{')
+        emit('    uint32_t raw = 0U;')
+        emit('    memcpy(&raw, &value, sizeof(raw));')
+        emit('    return raw;')
+        emit('}')
+        emit('')
+        emit('inline uint64_t from_double(double value)')
+        emit('{')
+        emit('    uint64_t raw = 0U;')
+        emit('    memcpy(&raw, &value, sizeof(raw));')
+        emit('    return raw;')
+        emit('}')
+
+    for message in received:
+        emit('')
+        emit(message_comment(message))
+        emit(f'inline void decode_{identifier(message.name)}(const uint8_t* data, float* values, '
+             f'const SignalSlot* slots)')
+        emit('{')
+        for name, base, big_endian in words_of(message):
+            offset = f'data + {base}' if base else 'data'
+            emit(f'    const uint64_t {name} = load_{"be" if big_endian else "le"}({offset});')
+        if not message.signals:
+            emit('    (void)data;')
+            emit('    (void)values;')
+            emit('    (void)slots;')
+        for index, signal in enumerate(message.signals):
+            emit(f'    values[slots[{index}U]] = {value_expression(signal)};')
+        emit('}')
+
+    for message in sent:
+        emit('')
+        emit(message_comment(message))
+        emit(f'inline void encode_{identifier(message.name)}(const float* values, const SignalSlot* slots, '
+             f'uint8_t* data)')
+        emit('{')
+        words = words_of(message)
+        for name, _, _ in words:
+            emit(f'    uint64_t {name} = 0U;')
+        if not message.signals:
+            emit('    (void)values;')
+            emit('    (void)slots;')
+            emit('    (void)data;')
+        for index, signal in enumerate(message.signals):
+            emit(f'    {word_name(signal)} |= {encoded_expression(signal, f"values[slots[{index}U]]")};')
+        for name, base, big_endian in words:
+            offset = f'data + {base}' if base else 'data'
+            emit(f'    merge_{"be" if big_endian else "le"}({offset}, {name});')
+        emit('}')
+
+    emit('')
+    emit('/**')
+    emit(' * Decode the frame into the signal database values, through the slots resolved by resolve_slots().')
+    emit(' *')
+    emit(' * \\return false if the frame is not in the DBC, or shorter than it should be.')
+    emit(' */')
+    emit('inline bool decode(const CanFrame& frame, float* values, const SlotTable& slots)')
+    emit('{')
+    emit('    const bool extended = (frame.flags & can_flags::kExtended) != 0U;')
+    emit('    const uint32_t id = extended ? (frame.id | kExtendedIdFlag) : frame.id;')
+    emit('')
+    emit('    switch (id)')
+    emit('    {')
+    for message in received:
+        emit(f'        case {format_id(message)}:')
+        emit(f'            if (frame.length < {message.length}U)')
+        emit('            {')
+        emit('                return false;')
+        emit('            }')
+        emit(f'            decode_{identifier(message.name)}(&frame.data[0], values, &slots[{message.first_signal}U]);')
+        emit('            return true;')
+        emit('')
+    emit('        default:')
+    emit('            return false;')
+    emit('    }')
+    emit('}')
+    emit('')
+    emit('/**')
+    emit(' * Encode entry index of kTxMessages from the signal database values, through the slots resolved by')
+    emit(' * resolve_slots().  The data must be kCanMaxDataBytes long and all zero.')
+    emit(' */')
+    emit('inline void encode(size_t index, const float* values, const SlotTable& slots, uint8_t* data)')
+    emit('{')
+    if not sent:
+        emit('    (void)values;')
+        emit('    (void)slots;')
+        emit('    (void)data;')
+        emit('')
+    emit('    switch (index)')
+    emit('    {')
+    for index, message in enumerate(sent):
+        emit(f'        case {index}U:')
+        emit(f'            encode_{identifier(message.name)}(values, &slots[{message.first_signal}U], data);')
+        emit('            break;')
+        emit('')
+    emit('        default:')
+    emit('            break;')
+    emit('    }')
+    emit('}')
+    emit('')
+    emit('}  // namespace can_dbc')
+    emit('')
+    emit(f'#endif  // {guard}')
+
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    if len(sys.argv) not in (3, 4):
+        sys.exit('usage: dbc_codegen.py <input.dbc> <output.h> [node]')
+
+    source, output = sys.argv[1], sys.argv[2]
+    node = sys.argv[3] if len(sys.argv) == 4 else None
+    header = generate(parse(source), os.path.basename(source), node)
+
+    with open(output, 'w', encoding='utf-8') as out:
+        out.write(header)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,272 @@
+/**
+ * CAN signal decoder generated from vehicle.dbc on the host: every signal of random frames is decoded as a bit by bit
+ * reading of its descriptor in kSignals, Intel and Motorola, signed and unsigned, scaled and offset.  Every signal the
+ * VCM sends reads back as encoded, rounded to the nearest raw value and saturated to its range, and never spills into
+ * the rest of the frame.
+ *
+ *     can_dbc_test
+ */
+
+#include "can_dbc.h"
+#include "host_test.h"
+
+#include <cmath>
+#include <random>
+
+constexpr size_t kRandomFrames = 1000U;
+
+static can_dbc::SlotTable slots = {};
+
+/**
+ * Position in the frame of the bit after bit in the signal.  Intel signals start from their least significant bit and
+ * go up, Motorola signals from their most significant bit and go down each byte, then on to the top of the next one.
+ */
+static size_t next_bit(const can_dbc::SignalDescriptor& signal, size_t bit)
+{
+    if (signal.big_endian)
+    {
+        return ((bit % 8U) == 0U) ? (bit + 15U) : (bit - 1U);
+    }
+
+    return bit + 1U;
+}
+
+/**
+ * Raw value of the signal, one bit at a time.
+ */
+static uint64_t reference_raw(const uint8_t* data, const can_dbc::SignalDescriptor& signal)
+{
+    uint64_t raw = 0U;
+    size_t bit = signal.start_bit;
+
+    for (size_t i = 0U; i < signal.length; i++)
+    {
+        const uint64_t value = (data[bit / 8U] >> (bit % 8U)) & 1U;
+        raw = signal.big_endian ? ((raw << 1U) | value) : (raw | (value << i));
+        bit = next_bit(signal, bit);
+    }
+
+    return raw;
+}
+
+static float reference_value(uint64_t raw, const can_dbc::SignalDescriptor& signal)
+{
+    float value = 0.0f;
+    if (signal.is_signed)
+    {
+        value = static_cast<float>(can_dbc::sign_extend64(raw, signal.length));
+    }
+    else
+    {
+        value = static_cast<float>(raw);
+    }
+
+    if (signal.factor != 1.0f)
+    {
+        value *= signal.factor;
+    }
+
+    if (signal.offset != 0.0f)
+    {
+        value += signal.offset;
+    }
+
+    return value;
+}
+
+static uint64_t raw_range(const can_dbc::SignalDescriptor& signal)
+{
+    return (signal.length == 64U) ? UINT64_MAX : ((1ULL << signal.length) - 1U);
+}
+
+static CanFrame frame_of(const can_dbc::MessageDescriptor& message)
+{
+    CanFrame frame = {};
+    frame.id = message.id & ~can_dbc::kExtendedIdFlag;
+    frame.flags = ((message.id & can_dbc::kExtendedIdFlag) != 0U) ? can_flags::kExtended : 0U;
+    frame.flags |= (message.length > 8U) ? can_flags::kFd : 0U;
+    frame.length = message.length;
+
+    return frame;
+}
+
+static void test_decode(std::mt19937& random)
+{
+    float* values = signal_db_values();
+
+    for (const auto& message : can_dbc::kMessages)
+    {
+        for (size_t n = 0U; n < kRandomFrames; n++)
+        {
+            CanFrame frame = frame_of(message);
+            for (auto& byte : frame.data)
+            {
+                byte = static_cast<uint8_t>(random());
+            }
+
+            CHECK(can_dbc::decode(frame, values, slots));
+
+            for (size_t i = message.first_signal; i < (message.first_signal + message.signal_count); i++)
+            {
+                const auto& signal = can_dbc::kSignals[i];
+                const float expected = reference_value(reference_raw(&frame.data[0], signal), signal);
+
+                CHECK(values[slots[i]] == expected);
+                if (values[slots[i]] != expected)
+                {
+                    printf("  %s: %g, expected %g\n", signal.name, static_cast<double>(values[slots[i]]),
+                        static_cast<double>(expected));
+                }
+            }
+        }
+    }
+}
+
+static void test_rejected()
+{
+    float* values = signal_db_values();
+
+    // Too short, unknown, and known identifiers in the other format.
+    for (const auto& message : can_dbc::kMessages)
+    {
+        CanFrame frame = frame_of(message);
+        frame.length = static_cast<uint8_t>(message.length - 1U);
+        CHECK(false == can_dbc::decode(frame, values, slots));
+
+        frame = frame_of(message);
+        frame.flags ^= can_flags::kExtended;
+        CHECK(false == can_dbc::decode(frame, values, slots));
+    }
+
+    CanFrame frame = {};
+    frame.id = 0x7FFU;
+    frame.length = 8U;
+    CHECK(false == can_dbc::decode(frame, values, slots));
+}
+
+/**
+ * Encode the values of the signals of the message and check each reads back as expected_raw() of its value.
+ */
+template <typename ExpectedRaw>
+static void check_encode(size_t index, ExpectedRaw&& expected_raw)
+{
+    const auto& message = can_dbc::kTxMessages[index];
+    const float* values = signal_db_values();
+
+    std::array<uint8_t, kCanMaxDataBytes> data = {};
+    can_dbc::encode(index, values, slots, &data[0]);
+
+    std::array<uint8_t, kCanMaxDataBytes> covered = {};
+
+    for (size_t i = message.first_signal; i < (message.first_signal + message.signal_count); i++)
+    {
+        const auto& signal = can_dbc::kSignals[i];
+        const uint64_t raw = reference_raw(&data[0], signal);
+        const uint64_t expected = expected_raw(signal, values[slots[i]]);
+
+        CHECK(raw == expected);
+        if (raw != expected)
+        {
+            printf("  %s = %g: raw 0x%llx, expected 0x%llx\n", signal.name, static_cast<double>(values[slots[i]]),
+                static_cast<unsigned long long>(raw), static_cast<unsigned long long>(expected));
+        }
+
+        size_t bit = signal.start_bit;
+        for (size_t n = 0U; n < signal.length; n++)
+        {
+            covered[bit / 8U] |= static_cast<uint8_t>(1U << (bit % 8U));
+            bit = next_bit(signal, bit);
+        }
+    }
+
+    for (size_t byte = 0U; byte < data.size(); byte++)
+    {
+        CHECK((data[byte] & ~covered[byte]) == 0U);
+    }
+}
+
+static void test_encode(std::mt19937& random)
+{
+    float* values = signal_db_values();
+
+    for (size_t index = 0U; index < can_dbc::kTxMessages.size(); index++)
+    {
+        const auto& message = can_dbc::kTxMessages[index];
+
+        // Values on the raw grid read back as their raw value.
+        for (size_t n = 0U; n < kRandomFrames; n++)
+        {
+            std::array<uint64_t, can_dbc::kSignals.size()> raws = {};
+
+            for (size_t i = message.first_signal; i < (message.first_signal + message.signal_count); i++)
+            {
+                const auto& signal = can_dbc::kSignals[i];
+
+                // Within 24 bits, for floats to hold the value exactly.
+                raws[i] = (static_cast<uint64_t>(random()) & raw_range(signal)) & 0xFFFFFFU;
+                values[slots[i]] = reference_value(raws[i], signal);
+            }
+
+            check_encode(index, [&](const can_dbc::SignalDescriptor& signal, float)
+            {
+                return raws[static_cast<size_t>(&signal - &can_dbc::kSignals[0])];
+            });
+        }
+
+        // Out of range values saturate, NaN encodes as 0.
+        const float special[] = {1.0e12f, -1.0e12f, NAN};
+        for (const float value : special)
+        {
+            for (size_t i = message.first_signal; i < (message.first_signal + message.signal_count); i++)
+            {
+                values[slots[i]] = value;
+            }
+
+            check_encode(index, [&](const can_dbc::SignalDescriptor& signal, float)
+            {
+                if (std::isnan(value))
+                {
+                    return uint64_t{0U};
+                }
+
+                if (signal.is_signed)
+                {
+                    const uint64_t limit = 1ULL << (signal.length - 1U);
+                    return ((value > 0.0f) ? (limit - 1U) : limit) & raw_range(signal);
+                }
+
+                return (value > 0.0f) ? raw_range(signal) : uint64_t{0U};
+            });
+        }
+    }
+}
+
+static void test_rounding()
+{
+    CHECK(can_dbc::round_half_away(0.49999997f) == 0.0f);
+    CHECK(can_dbc::round_half_away(0.5f) == 1.0f);
+    CHECK(can_dbc::round_half_away(2.5f) == 3.0f);
+    CHECK(can_dbc::round_half_away(-0.5f) == -1.0f);
+    CHECK(can_dbc::round_half_away(-2.4f) == -2.0f);
+    CHECK(can_dbc::round_half_away(8388607.5f) == 8388608.0f);
+    CHECK(can_dbc::round_half_away(8388609.0f) == 8388609.0f);
+    CHECK(std::isnan(can_dbc::round_half_away(NAN)));
+
+    // Odd values past 2^23 stay odd.
+    CHECK(can_dbc::to_unsigned(12879991.0f, UINT32_MAX) == 12879991U);
+    CHECK(can_dbc::to_signed(-12879991.0f, 32U) == static_cast<uint32_t>(-12879991));
+}
+
+int main()
+{
+    CHECK(can_dbc::resolve_slots(slots));
+
+    std::mt19937 random(1U);
+
+    test_decode(random);
+    test_rejected();
+    test_rounding();
+    test_encode(random);
+
+    return host_test_result("can_dbc_test");
+}
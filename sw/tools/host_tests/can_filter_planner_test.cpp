@@ -0,0 +1,266 @@
+/**
+ * MCAN acceptance filter planner of the firmware on the host: random sets of standard and extended identifiers, as
+ * runs, bit patterns and scattered, with priority identifiers and filter budgets of every size.  Every plan must fit
+ * its budget, accept every subscribed identifier, accept exactly extra_ids identifiers nobody subscribed to, none when
+ * the exact plan fits, and store the priority identifiers into their RX buffers ahead of any other element.
+ *
+ *     can_filter_planner_test
+ */
+
+#include "can_filter_planner.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+constexpr size_t kRandomPlans = 3000U;
+constexpr uint32_t kExtendedWindow = 8192U;
+
+struct Subscription
+{
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> priority_ids;
+    uint32_t id_mask;
+    uint32_t first;     // The identifiers are all within first..last.
+    uint32_t last;
+};
+
+static uint32_t random_in(std::mt19937& random, uint32_t first, uint32_t last)
+{
+    return first + (random() % (last - first + 1U));
+}
+
+static Subscription random_subscription(std::mt19937& random)
+{
+    Subscription subscription = {};
+
+    const bool extended = (random() % 3U) == 0U;
+    subscription.id_mask = extended ? kCanExtendedIdMask : kCanStandardIdMask;
+    subscription.first = extended ? random_in(random, 0U, kCanExtendedIdMask - kExtendedWindow + 1U) : 0U;
+    subscription.last = extended ? (subscription.first + kExtendedWindow - 1U) : kCanStandardIdMask;
+
+    const size_t target = random_in(random, 1U, kMaxCanFilterIds);
+    while (subscription.ids.size() < target)
+    {
+        const uint32_t base = random_in(random, subscription.first, subscription.last);
+
+        switch (random() % 3U)
+        {
+            case 0U:
+            {
+                // A run of consecutive identifiers.
+                const uint32_t length = random_in(random, 1U, 24U);
+                for (uint32_t id = base; (id <= std::min(base + length - 1U, subscription.last)); id++)
+                {
+                    subscription.ids.push_back(id);
+                }
+                break;
+            }
+
+            case 1U:
+            {
+                // Every combination of a few bits, as a mask element covers them.
+                const uint32_t bits = (1U << (random() % 4U)) | (1U << (4U + (random() % 4U))) |
+                    (((random() % 2U) == 0U) ? 0U : (1U << (8U + (random() % 2U))));
+                const uint32_t fixed = base & ~bits;
+
+                uint32_t subset = bits;
+                while (true)
+                {
+                    const uint32_t id = fixed | subset;
+                    if ((id >= subscription.first) && (id <= subscription.last))
+                    {
+                        subscription.ids.push_back(id);
+                    }
+
+                    if (subset == 0U)
+                    {
+                        break;
+                    }
+                    subset = (subset - 1U) & bits;
+                }
+                break;
+            }
+
+            default:
+                subscription.ids.push_back(base);
+                break;
+        }
+    }
+
+    // Repeated identifiers are allowed, too many are not.
+    subscription.ids.resize(std::min(subscription.ids.size(), kMaxCanFilterIds));
+    std::shuffle(subscription.ids.begin(), subscription.ids.end(), random);
+
+    // Mostly subscribed identifiers, some that are not.
+    const size_t priority_count = random() % 6U;
+    for (size_t i = 0U; i < priority_count; i++)
+    {
+        subscription.priority_ids.push_back(((random() % 4U) == 0U) ?
+            random_in(random, subscription.first, subscription.last) :
+            subscription.ids[random() % subscription.ids.size()]);
+    }
+
+    return subscription;
+}
+
+static void check_plan(const Subscription& subscription, const CanFilterRequest& request, const CanFilterPlan& plan)
+{
+    const std::set<uint32_t> wanted(subscription.ids.begin(), subscription.ids.end());
+
+    CHECK(plan.count <= request.max_filters);
+    CHECK(plan.rx_buffers <= request.max_rx_buffers);
+
+    for (size_t i = 0U; i < plan.count; i++)
+    {
+        const CanFilter& filter = plan.filters[i];
+        CHECK((filter.type == CanFilterType::kRxBuffer) == (i < plan.rx_buffers));
+        CHECK((filter.type != CanFilterType::kRange) || (filter.id1 <= filter.id2));
+        CHECK((filter.id1 & ~request.id_mask) == 0U);
+    }
+
+    // Priority identifiers that were subscribed, in order, each stored by the first element matching it.
+    size_t buffer = 0U;
+    for (const uint32_t id : subscription.priority_ids)
+    {
+        if ((buffer == plan.rx_buffers) || (wanted.count(id) == 0U))
+        {
+            continue;
+        }
+
+        const CanFilter& filter = plan.filters[buffer];
+        if (filter.id1 != id)
+        {
+            // Only an identifier that already has its buffer is skipped.
+            bool repeated = false;
+            for (size_t i = 0U; i < buffer; i++)
+            {
+                repeated = repeated || (plan.filters[i].id1 == id);
+            }
+            CHECK(repeated);
+            continue;
+        }
+
+        CHECK(filter.id2 == (request.first_rx_buffer + buffer));
+        buffer++;
+    }
+    CHECK(buffer == plan.rx_buffers);
+
+    uint32_t extra_ids = 0U;
+    for (uint32_t id = subscription.first; id <= subscription.last; id++)
+    {
+        const bool accepted = can_filter_accepts(plan, id);
+        const bool subscribed = (wanted.count(id) != 0U);
+
+        CHECK(accepted || !subscribed);
+        extra_ids += (accepted && !subscribed) ? 1U : 0U;
+    }
+
+    CHECK(extra_ids == plan.extra_ids);
+
+    // Nothing outside the window of an extended subscription.
+    if (subscription.first > 0U)
+    {
+        CHECK(false == can_filter_accepts(plan, subscription.first - 1U));
+    }
+    if (subscription.last < subscription.id_mask)
+    {
+        CHECK(false == can_filter_accepts(plan, subscription.last + 1U));
+    }
+}
+
+static void test_random()
+{
+    std::mt19937 random(1U);
+    size_t exact = 0U;
+
+    for (size_t n = 0U; n < kRandomPlans; n++)
+    {
+        const Subscription subscription = random_subscription(random);
+        std::vector<uint32_t> ids = subscription.ids;
+
+        CanFilterRequest request = {};
+        request.ids = ids.data();
+        request.id_count = ids.size();
+        request.priority_ids = subscription.priority_ids.data();
+        request.priority_count = subscription.priority_ids.size();
+        request.id_mask = subscription.id_mask;
+        request.max_filters = random_in(random, 1U, kMaxCanFilters);
+        request.first_rx_buffer = random() % 8U;
+        request.max_rx_buffers = random() % 5U;
+
+        CanFilterPlan plan = {};
+        CHECK(can_filter_plan(request, plan));
+        check_plan(subscription, request, plan);
+
+        // A plan with room to spare must be exact.
+        if (plan.count < request.max_filters)
+        {
+            CHECK(plan.extra_ids == 0U);
+        }
+
+        exact += (plan.extra_ids == 0U) ? 1U : 0U;
+    }
+
+    // Both exact and merged plans were covered.
+    CHECK((exact > (kRandomPlans / 10U)) && (exact < (kRandomPlans - (kRandomPlans / 10U))));
+}
+
+static void test_exact()
+{
+    // A run, a bit pattern and a pair fit three elements.
+    std::vector<uint32_t> ids = {0x100U, 0x101U, 0x102U, 0x103U, 0x200U, 0x210U, 0x220U, 0x230U, 0x300U, 0x305U};
+
+    CanFilterRequest request = {};
+    request.ids = ids.data();
+    request.id_count = ids.size();
+    request.id_mask = kCanStandardIdMask;
+    request.max_filters = kMaxCanFilters;
+
+    CanFilterPlan plan = {};
+    CHECK(can_filter_plan(request, plan));
+    CHECK((plan.count == 3U) && (plan.extra_ids == 0U));
+    CHECK(plan.filters[0].type == CanFilterType::kRange);
+    CHECK(plan.filters[1].type == CanFilterType::kMask);
+    CHECK(plan.filters[2].type == CanFilterType::kDual);
+
+    // With a single element everything is merged into one range.
+    ids = {0x100U, 0x101U, 0x102U, 0x103U, 0x200U, 0x210U, 0x220U, 0x230U, 0x300U, 0x305U};
+    request.ids = ids.data();
+    request.max_filters = 1U;
+    CHECK(can_filter_plan(request, plan));
+    CHECK((plan.count == 1U) && (plan.filters[0].type == CanFilterType::kRange));
+    CHECK((plan.filters[0].id1 == 0x100U) && (plan.filters[0].id2 == 0x305U));
+    CHECK(plan.extra_ids == (0x305U - 0x100U + 1U - 10U));
+}
+
+static void test_invalid()
+{
+    std::vector<uint32_t> ids = {0x100U, 0x800U};
+
+    CanFilterRequest request = {};
+    request.ids = ids.data();
+    request.id_count = ids.size();
+    request.id_mask = kCanStandardIdMask;
+    request.max_filters = kMaxCanFilters;
+
+    CanFilterPlan plan = {};
+    CHECK(false == can_filter_plan(request, plan));
+    CHECK(plan.count == 0U);
+
+    std::vector<uint32_t> many(kMaxCanFilterIds + 1U, 0x100U);
+    request.ids = many.data();
+    request.id_count = many.size();
+    CHECK(false == can_filter_plan(request, plan));
+}
+
+int main()
+{
+    test_exact();
+    test_invalid();
+    test_random();
+
+    return host_test_result("can_filter_planner_test");
+}
@@ -0,0 +1,62 @@
+/**
+ * Report formatting of the diagnostics service on the host: lines are appended one after the other, a report too long
+ * for the buffer is truncated and stays terminated, and an empty buffer is never written to.
+ *
+ *     diag_format_test
+ */
+
+#include "diag_format.h"
+#include "host_test.h"
+
+#include <cstring>
+
+static void test_append()
+{
+    char buffer[32] = {};
+    size_t length = 0U;
+
+    diag_append(buffer, sizeof(buffer), length, "%s %u\n", "calls", 12U);
+    diag_append(buffer, sizeof(buffer), length, "%s\n", "errors");
+
+    CHECK(length == 16U);
+    CHECK(strcmp(buffer, "calls 12\nerrors\n") == 0);
+}
+
+static void test_truncated()
+{
+    char buffer[9] = {};
+    buffer[8] = 'x';
+    size_t length = 0U;
+
+    diag_append(buffer, 8U, length, "%s\n", "overruns");
+    CHECK(length == 7U);
+    CHECK(strcmp(buffer, "overrun") == 0);
+
+    // Full, nothing more is written.
+    diag_append(buffer, 8U, length, "%s\n", "errors");
+    CHECK(length == 7U);
+    CHECK(strcmp(buffer, "overrun") == 0);
+    CHECK(buffer[8] == 'x');
+}
+
+static void test_empty_buffer()
+{
+    char buffer[1] = {'x'};
+    size_t length = 0U;
+
+    diag_append(buffer, 0U, length, "%s\n", "calls");
+    CHECK(length == 0U);
+    CHECK(buffer[0] == 'x');
+
+    diag_append(nullptr, 0U, length, "%s\n", "calls");
+    CHECK(length == 0U);
+}
+
+int main()
+{
+    test_append();
+    test_truncated();
+    test_empty_buffer();
+
+    return host_test_result("diag_format_test");
+}
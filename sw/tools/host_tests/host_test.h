@@ -0,0 +1,32 @@
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <cstdio>
+
+/**
+ * Checks of the host tests.  A failed check is printed and counted, the test goes on and main() returns
+ * host_test_result() for ctest.
+ */
+
+inline unsigned host_test_checks = 0U;
+inline unsigned host_test_failures = 0U;
+
+#define CHECK(condition) \
+    do \
+    { \
+        host_test_checks++; \
+        if (!(condition)) \
+        { \
+            host_test_failures++; \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (false)
+
+inline int host_test_result(const char* name)
+{
+    printf("%s: %u checks, %u failed\n", name, host_test_checks, host_test_failures);
+
+    return (host_test_failures == 0U) ? 0 : 1;
+}
+
+#endif  // HOST_TEST_H_
@@ -0,0 +1,224 @@
+/**
+ * ISO-TP framing of the firmware on the host: messages of every length class are split into frames as task_iso_tp.cpp
+ * sends them, decoded and reassembled as it receives them, classic and CAN-FD, and malformed frames are refused.
+ *
+ *     iso_tp_test
+ */
+
+#include "host_test.h"
+#include "iso_tp_pci.h"
+
+#include <cstring>
+#include <vector>
+
+constexpr uint8_t kPadding = 0xCCU;
+
+static CanFrame padded_frame()
+{
+    CanFrame frame = {};
+    frame.data.fill(kPadding);
+
+    return frame;
+}
+
+static CanFrame frame_of(std::initializer_list<uint8_t> bytes)
+{
+    CanFrame frame = padded_frame();
+    frame.length = static_cast<uint8_t>(bytes.size());
+    std::copy(bytes.begin(), bytes.end(), frame.data.begin());
+
+    return frame;
+}
+
+/**
+ * Frames of the message, as sent with no block size limit.
+ */
+static std::vector<CanFrame> split(const std::vector<uint8_t>& message, size_t frame_bytes)
+{
+    std::vector<CanFrame> frames;
+
+    CanFrame frame = padded_frame();
+    size_t offset = iso_tp_pci_encode_first(frame, frame_bytes, message.data(), message.size());
+    frames.push_back(frame);
+
+    uint8_t sequence = 1U;
+    while (offset < message.size())
+    {
+        frame = padded_frame();
+        offset += iso_tp_pci_encode_consecutive(frame, frame_bytes, sequence, &message[offset],
+            message.size() - offset);
+        frames.push_back(frame);
+        sequence = (sequence + 1U) & pci::kSequenceMask;
+    }
+
+    return frames;
+}
+
+/**
+ * Receive the frames as the ISO-TP task does.
+ *
+ * \return the message, empty if it was not received.
+ */
+static std::vector<uint8_t> receive(const std::vector<CanFrame>& frames)
+{
+    const IsoTpPci first = iso_tp_pci_decode(frames[0]);
+    CHECK(first.valid);
+
+    if (first.type == IsoTpFrameType::kSingle)
+    {
+        CHECK(frames.size() == 1U);
+        return std::vector<uint8_t>(&frames[0].data[first.offset], &frames[0].data[first.offset + first.length]);
+    }
+
+    CHECK(first.type == IsoTpFrameType::kFirst);
+
+    std::vector<uint8_t> message(first.length);
+    IsoTpReassembly reassembly = {};
+    iso_tp_reassembly_begin(reassembly, message.data(), frames[0], first);
+
+    for (size_t i = 1U; i < frames.size(); i++)
+    {
+        const IsoTpPci header = iso_tp_pci_decode(frames[i]);
+        CHECK(header.valid && (header.type == IsoTpFrameType::kConsecutive));
+
+        const IsoTpReassemblyStatus status = iso_tp_reassembly_add(reassembly, frames[i], header);
+        if (status == IsoTpReassemblyStatus::kComplete)
+        {
+            CHECK(i == (frames.size() - 1U));
+            return message;
+        }
+
+        CHECK(status == IsoTpReassemblyStatus::kInProgress);
+    }
+
+    return {};
+}
+
+static void test_round_trip(size_t frame_bytes)
+{
+    const size_t lengths[] = {1U, 6U, 7U, 8U, 9U, 61U, 62U, 63U, 64U, 65U, 100U, 4095U, 4096U, 5000U};
+
+    for (const size_t length : lengths)
+    {
+        std::vector<uint8_t> message(length);
+        for (size_t i = 0U; i < length; i++)
+        {
+            message[i] = static_cast<uint8_t>((i * 7U) + length);
+        }
+
+        const std::vector<CanFrame> frames = split(message, frame_bytes);
+
+        for (const CanFrame& frame : frames)
+        {
+            // Classic frames always carry 8 bytes, CAN-FD frames at least 8.
+            CHECK((frame.length >= kIsoTpClassicFrameBytes) && (frame.length <= frame_bytes));
+        }
+
+        // Single frames as long as the message and its header fit.
+        const size_t single_header = (length < kIsoTpClassicFrameBytes) ? 1U : pci::kEscapeSingleFrameHeader;
+        CHECK((frames.size() == 1U) == ((length + single_header) <= frame_bytes));
+
+        // The escape sequence of first frames only past 4095 bytes.
+        if (frames.size() > 1U)
+        {
+            const bool escaped = (frames[0].data[0] == pci::kFirstFrame) && (frames[0].data[1] == 0U);
+            CHECK(escaped == (length > pci::kMaxFirstFrameLength));
+        }
+
+        CHECK(receive(frames) == message);
+    }
+}
+
+static void test_sequence_error()
+{
+    std::vector<uint8_t> message(40U, 0x5AU);
+    std::vector<CanFrame> frames = split(message, kIsoTpClassicFrameBytes);
+    CHECK(frames.size() == 6U);
+
+    const IsoTpPci first = iso_tp_pci_decode(frames[0]);
+    std::vector<uint8_t> buffer(first.length);
+    IsoTpReassembly reassembly = {};
+    iso_tp_reassembly_begin(reassembly, buffer.data(), frames[0], first);
+
+    CHECK(iso_tp_reassembly_add(reassembly, frames[1], iso_tp_pci_decode(frames[1])) ==
+        IsoTpReassemblyStatus::kInProgress);
+
+    // Frame 2 lost.
+    CHECK(iso_tp_reassembly_add(reassembly, frames[3], iso_tp_pci_decode(frames[3])) ==
+        IsoTpReassemblyStatus::kSequenceError);
+}
+
+static void test_sequence_wrap()
+{
+    // 16 consecutive frames and more, the sequence number wraps from 15 to 0.
+    std::vector<uint8_t> message(200U);
+    for (size_t i = 0U; i < message.size(); i++)
+    {
+        message[i] = static_cast<uint8_t>(i);
+    }
+
+    const std::vector<CanFrame> frames = split(message, kIsoTpClassicFrameBytes);
+    CHECK(frames.size() > 17U);
+    CHECK((frames[16].data[0] & pci::kSequenceMask) == 0U);
+    CHECK(receive(frames) == message);
+}
+
+static void test_malformed()
+{
+    // Single frame of length 0, and longer than the frame.
+    CHECK(false == iso_tp_pci_decode(frame_of({0x00U, 1U, 2U, 3U, 4U, 5U, 6U, 7U})).valid);
+    CHECK(false == iso_tp_pci_decode(frame_of({0x05U, 1U, 2U})).valid);
+
+    // Escaped single frame in a classic frame.
+    CHECK(false == iso_tp_pci_decode(frame_of({0x00U, 6U, 1U, 2U, 3U, 4U, 5U, 6U})).valid);
+
+    // First frame shorter than 8 bytes, and first frame of a message fitting a single frame.
+    CHECK(false == iso_tp_pci_decode(frame_of({0x10U, 20U, 1U, 2U, 3U})).valid);
+    CHECK(false == iso_tp_pci_decode(frame_of({0x10U, 6U, 1U, 2U, 3U, 4U, 5U, 6U})).valid);
+
+    // Flow control shorter than 3 bytes, and an unknown frame type.
+    const IsoTpPci flow_control = iso_tp_pci_decode(frame_of({0x30U, 0U}));
+    CHECK((flow_control.type == IsoTpFrameType::kFlowControl) && (false == flow_control.valid));
+    CHECK(iso_tp_pci_decode(frame_of({0x40U, 0U, 0U})).type == IsoTpFrameType::kUnknown);
+    CHECK(iso_tp_pci_decode(frame_of({})).type == IsoTpFrameType::kUnknown);
+}
+
+static void test_flow_control()
+{
+    CanFrame frame = padded_frame();
+    frame.length = kIsoTpClassicFrameBytes;
+    iso_tp_pci_encode_flow_control(frame, pci::kWait, 8U, 0xF3U);
+
+    const IsoTpPci header = iso_tp_pci_decode(frame);
+    CHECK(header.valid && (header.type == IsoTpFrameType::kFlowControl));
+    CHECK((header.flow_status == pci::kWait) && (header.block_size == 8U) && (header.st_min == 0xF3U));
+    CHECK(frame.length == kIsoTpClassicFrameBytes);
+    CHECK(frame.data[3] == kPadding);
+}
+
+static void test_st_min()
+{
+    CHECK(iso_tp_st_min_us(0x00U) == 0U);
+    CHECK(iso_tp_st_min_us(0x01U) == 1000U);
+    CHECK(iso_tp_st_min_us(0x7FU) == 127000U);
+    CHECK(iso_tp_st_min_us(0xF1U) == 100U);
+    CHECK(iso_tp_st_min_us(0xF9U) == 900U);
+
+    // Reserved values.
+    CHECK(iso_tp_st_min_us(0x80U) == 127000U);
+    CHECK(iso_tp_st_min_us(0xF0U) == 127000U);
+    CHECK(iso_tp_st_min_us(0xFAU) == 127000U);
+}
+
+int main()
+{
+    test_round_trip(kIsoTpClassicFrameBytes);
+    test_round_trip(kIsoTpFdFrameBytes);
+    test_sequence_error();
+    test_sequence_wrap();
+    test_malformed();
+    test_flow_control();
+    test_st_min();
+
+    return host_test_result("iso_tp_test");
+}
@@ -0,0 +1,92 @@
+/**
+ * Lua arena allocator of the firmware on the host: blocks are reused from their free lists, large blocks coalesce back
+ * into the top of the arena, and the statistics keep the highest extent the arena ever reached.
+ *
+ *     lua_arena_test
+ */
+
+#include "host_test.h"
+#include "lua_arena.h"
+
+constexpr size_t kArenaSizeBytes = 4096U;
+
+alignas(kLuaArenaGranularity) static uint8_t arena_buffer[kArenaSizeBytes] = {};
+
+static void* alloc(LuaArena& arena, size_t size)
+{
+    return lua_arena_alloc(&arena, nullptr, 0U, size);
+}
+
+static void release(LuaArena& arena, void* block, size_t size)
+{
+    CHECK(nullptr == lua_arena_alloc(&arena, block, size, 0U));
+}
+
+static void test_small_reuse()
+{
+    LuaArena arena = {};
+    lua_arena_init(arena, &arena_buffer[0], sizeof(arena_buffer));
+
+    void* first = alloc(arena, 24U);
+    release(arena, first, 24U);
+
+    // Same size class, same block.
+    CHECK(alloc(arena, 20U) == first);
+    CHECK(lua_arena_get_stats(arena).in_use_bytes == 24U);
+}
+
+static void test_high_water()
+{
+    LuaArena arena = {};
+    lua_arena_init(arena, &arena_buffer[0], sizeof(arena_buffer));
+
+    void* low = alloc(arena, 512U);
+    void* high = alloc(arena, 1024U);
+    CHECK((low != nullptr) && (high != nullptr));
+    CHECK(lua_arena_get_stats(arena).high_water_bytes == 1536U);
+
+    // Both blocks go back to the top of the arena, the high-water mark stays.
+    release(arena, high, 1024U);
+    release(arena, low, 512U);
+
+    LuaArenaStats stats = lua_arena_get_stats(arena);
+    CHECK(stats.in_use_bytes == 0U);
+    CHECK(stats.peak_in_use_bytes == 1536U);
+    CHECK(stats.high_water_bytes == 1536U);
+    CHECK(stats.free_bytes == kArenaSizeBytes);
+    CHECK(stats.fragmentation_permille == 0U);
+
+    // Growing in place at the top raises it further.
+    void* block = alloc(arena, 256U);
+    CHECK(lua_arena_alloc(&arena, block, 256U, 2048U) == block);
+    CHECK(lua_arena_get_stats(arena).high_water_bytes == 2048U);
+}
+
+static void test_exhaustion()
+{
+    LuaArena arena = {};
+    lua_arena_init(arena, &arena_buffer[0], sizeof(arena_buffer));
+
+    void* block = alloc(arena, kArenaSizeBytes);
+    CHECK(block != nullptr);
+    CHECK(alloc(arena, 8U) == nullptr);
+
+    // A failed reallocation leaves the block to Lua.
+    void* small = lua_arena_alloc(&arena, block, kArenaSizeBytes, 1024U);
+    CHECK(small == block);
+    CHECK(lua_arena_alloc(&arena, small, 1024U, kArenaSizeBytes + 8U) == nullptr);
+
+    const LuaArenaStats stats = lua_arena_get_stats(arena);
+    CHECK(stats.failed_allocations == 2U);
+    CHECK(stats.in_use_bytes == 1024U);
+    CHECK(stats.high_water_bytes == kArenaSizeBytes);
+}
+
+int main()
+{
+    test_small_reuse();
+    test_high_water();
+    test_exhaustion();
+
+    return host_test_result("lua_arena_test");
+}
@@ -0,0 +1,208 @@
+/**
+ * Coroutine runtime of the firmware on the host, over a tick count driven by the test: sleep() and the timeouts of
+ * wait_for() expire on their tick, durations up to kLuaMaxWaitMs do not wrap around and longer ones are refused, and a
+ * wait_for() refusing its timeout leaves no reference to its predicate behind.
+ *
+ *     lua_async_test
+ */
+
+#include "host_test.h"
+#include "lua_async.h"
+#include "lua_signals.h"
+#include "signal_db.h"
+
+#include "task.h"
+
+extern "C"
+{
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+#include <string>
+
+static lua_State* L = nullptr;
+static LuaScriptId script = 0U;
+static SignalSlot engine_speed = kInvalidSignalSlot;
+
+static void run(const std::string& code)
+{
+    CHECK(LUA_OK == luaL_loadstring(L, code.c_str()));
+    CHECK(lua_watchdog_pcall(L, script, 0, UINT32_MAX, 0));
+}
+
+/**
+ * Move the tick count on by ticks and dispatch, ticks only ever move forward.
+ */
+static void dispatch_after(TickType_t ticks)
+{
+    host_tick_count += ticks;
+    lua_async_dispatch(L, host_tick_count);
+}
+
+static lua_Integer global_integer(const char* name)
+{
+    lua_getglobal(L, name);
+    const lua_Integer value = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+
+    return value;
+}
+
+static bool global_is_nil(const char* name)
+{
+    const bool nil = (LUA_TNIL == lua_getglobal(L, name));
+    lua_pop(L, 1);
+
+    return nil;
+}
+
+static uint32_t script_errors()
+{
+    LuaScriptStats stats[kMaxLuaScripts] = {};
+    lua_watchdog_get_stats(stats, kMaxLuaScripts);
+
+    return stats[script].errors;
+}
+
+/**
+ * Stop every coroutine left, so the next test starts from none.
+ */
+static void kill_all()
+{
+    lua_async_kill_before(L, script, lua_async_serial());
+}
+
+/**
+ * Spawn the coroutine and start it on the next tick.
+ */
+static void spawn(const std::string& code)
+{
+    run("spawn(function() " + code + " end)");
+    dispatch_after(1U);
+}
+
+static void test_sleep()
+{
+    run("step = 0");
+    spawn("step = 1; sleep(5); step = 2; sleep(0); step = 3");
+    CHECK(global_integer("step") == 1);
+    CHECK(lua_async_next_release(host_tick_count, 1000U) == (host_tick_count + 5U));
+
+    dispatch_after(4U);
+    CHECK(global_integer("step") == 1);
+    dispatch_after(1U);
+    CHECK(global_integer("step") == 2);
+
+    // At least one tick.
+    dispatch_after(1U);
+    CHECK(global_integer("step") == 3);
+}
+
+static void test_long_sleep()
+{
+    // 2^32 / 1000 ms and a bit, which wrapped around to a single tick with a 32-bit pdMS_TO_TICKS().
+    constexpr TickType_t kWrappingMs = 4294968U;
+
+    run("step = 0");
+    spawn("step = 1; sleep(" + std::to_string(kWrappingMs) + "); step = 2");
+
+    for (TickType_t i = 0U; i < 2000U; i++)
+    {
+        dispatch_after(1U);
+    }
+    CHECK(global_integer("step") == 1);
+    CHECK(lua_async_next_release(host_tick_count, 1000U) == (host_tick_count + 1000U));
+
+    dispatch_after(kWrappingMs - 2000U - 1U);
+    CHECK(global_integer("step") == 1);
+    dispatch_after(1U);
+    CHECK(global_integer("step") == 2);
+
+    // The longest sleep.
+    spawn("step = 1; sleep(" + std::to_string(kLuaMaxWaitMs) + "); step = 2");
+    dispatch_after(kLuaMaxWaitMs - 1U);
+    CHECK(global_integer("step") == 1);
+    dispatch_after(1U);
+    CHECK(global_integer("step") == 2);
+}
+
+static void test_out_of_range()
+{
+    const uint32_t errors = script_errors();
+
+    run("step = 0");
+    spawn("step = 1; sleep(" + std::to_string(kLuaMaxWaitMs + 1U) + "); step = 2");
+    spawn("sleep(-1)");
+    spawn("wait_for('engine_speed_rpm', nil, " + std::to_string(kLuaMaxWaitMs + 1U) + ")");
+
+    CHECK(global_integer("step") == 1);
+    CHECK(script_errors() == (errors + 3U));
+    kill_all();
+}
+
+static void test_refused_timeout_leaks_nothing()
+{
+    signal_db_values()[engine_speed] = 0.0f;
+
+    // References given back are reused, one that leaked grows the registry.
+    size_t registry_size = 0U;
+    for (size_t i = 0U; i < 10U; i++)
+    {
+        spawn("wait_for('engine_speed_rpm', function(rpm) return rpm > 100 end, -1)");
+
+        const size_t size = lua_rawlen(L, LUA_REGISTRYINDEX);
+        CHECK((i == 0U) || (size == registry_size));
+        registry_size = size;
+    }
+}
+
+static void test_wait_for()
+{
+    signal_db_values()[engine_speed] = 0.0f;
+
+    run("result = nil");
+    spawn("result = wait_for('engine_speed_rpm', function(rpm) return rpm > 100 end, 1000)");
+
+    signal_db_values()[engine_speed] = 50.0f;
+    dispatch_after(20U);
+    CHECK(global_is_nil("result"));
+
+    signal_db_values()[engine_speed] = 150.0f;
+    dispatch_after(20U);
+    CHECK(global_integer("result") == 150);
+
+    // Timed out, nil.
+    run("result = 0");
+    spawn("result = on_signal('engine_speed_rpm', 100)");
+    dispatch_after(99U);
+    CHECK(false == global_is_nil("result"));
+    dispatch_after(1U);
+    CHECK(global_is_nil("result"));
+}
+
+int main()
+{
+    host_tick_count = 1000U;
+
+    L = luaL_newstate();
+    luaL_openlibs(L);
+    lua_watchdog_init(L);
+    lua_open_signals(L);
+    lua_open_async(L);
+
+    engine_speed = signal_db_add("engine_speed_rpm");
+    script = lua_watchdog_add_script("test");
+
+    test_sleep();
+    test_long_sleep();
+    test_out_of_range();
+    test_refused_timeout_leaks_nothing();
+    test_wait_for();
+
+    kill_all();
+    lua_close(L);
+
+    return host_test_result("lua_async_test");
+}
@@ -0,0 +1,298 @@
+/**
+ * Rule engine and signal database of the firmware on the host: expressions are compiled and evaluated against a
+ * reference evaluation in C++, including randomly generated ones, constants are folded, and rules that do not compile
+ * leave the engine untouched.
+ *
+ *     rule_engine_test
+ */
+
+#include "conf_logic.h"
+#include "host_test.h"
+#include "rule_engine.h"
+#include "signal_db.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+
+constexpr size_t kRandomExpressions = 2000U;
+constexpr size_t kRandomDepth = 4U;
+
+constexpr std::array<const char*, 4U> kTestSignals = {{"a", "b", "c", "d"}};
+constexpr std::array<float, 5U> kLiterals = {{0.0f, 1.0f, 2.5f, 70.0f, 0.125f}};
+
+static RuleEngine engine = {};
+static SignalSlot output = kInvalidSignalSlot;
+
+/**
+ * Compile the expression alone into the engine and evaluate it once.
+ */
+static float evaluate(const char* expression)
+{
+    rule_engine_clear(engine);
+
+    RuleCompileError error = {};
+    const bool compiled = rule_engine_add(engine, expression, output, &error);
+    CHECK(compiled);
+    if (!compiled)
+    {
+        printf("  %s: %s at %zu\n", expression, error.message, error.position);
+        return NAN;
+    }
+
+    signal_db_values()[output] = NAN;
+    rule_engine_evaluate(engine, signal_db_values());
+
+    return signal_db_values()[output];
+}
+
+static bool same(float a, float b)
+{
+    return (a == b) || (std::isnan(a) && std::isnan(b));
+}
+
+static void set_signals(float a, float b, float c, float d)
+{
+    float* values = signal_db_values();
+    values[signal_db_find("a")] = a;
+    values[signal_db_find("b")] = b;
+    values[signal_db_find("c")] = c;
+    values[signal_db_find("d")] = d;
+}
+
+static void test_operators()
+{
+    set_signals(3.0f, -2.0f, 0.0f, 0.5f);
+
+    CHECK(evaluate("1 + 2 * 3") == 7.0f);
+    CHECK(evaluate("(1 + 2) * 3") == 9.0f);
+    CHECK(evaluate("10 - 4 - 3") == 3.0f);
+    CHECK(evaluate("8 / 4 / 2") == 1.0f);
+    CHECK(evaluate("-a * b") == 6.0f);
+    CHECK(evaluate("--a") == 3.0f);
+    CHECK(evaluate("!c") == 1.0f);
+    CHECK(evaluate("!!a") == 1.0f);
+    CHECK(evaluate("a > b && b < c") == 1.0f);
+    CHECK(evaluate("a < b || c") == 0.0f);
+    CHECK(evaluate("a >= 3.0f && a <= 3.0F") == 1.0f);
+    CHECK(evaluate("a == 3 != 0") == 1.0f);
+    CHECK(evaluate("1 || 0 && 0") == 1.0f);
+    CHECK(evaluate("true + true") == 2.0f);
+    CHECK(evaluate("false") == 0.0f);
+    CHECK(evaluate(".5 == d") == 1.0f);
+    CHECK(evaluate("  a\t*\nd  ") == 1.5f);
+    CHECK(std::isinf(evaluate("a / c")));
+}
+
+static void test_conf_rules()
+{
+    // The rules the firmware loads at boot.
+    RuleEngine rules = {};
+    for (const auto& rule : logic::kRules)
+    {
+        CHECK(rule_engine_add(rules, rule.expression, signal_db_find(rule.output), nullptr));
+    }
+    CHECK(rules.rules == logic::kRules.size());
+
+    float* values = signal_db_values();
+    const SignalSlot temperature = signal_db_find("engine_temp_c");
+    const SignalSlot speed = signal_db_find("vehicle_speed_mps");
+    const SignalSlot fan = signal_db_find("cooling_fan_request");
+
+    values[temperature] = 75.0f;
+    values[speed] = 2.0f;
+    rule_engine_evaluate(rules, values);
+    CHECK(values[fan] == 1.0f);
+
+    values[speed] = 20.0f;
+    rule_engine_evaluate(rules, values);
+    CHECK(values[fan] == 0.0f);
+}
+
+static void test_constant_folding()
+{
+    rule_engine_clear(engine);
+    CHECK(rule_engine_add(engine, "-(2 * 3) + 1 < a", output, nullptr));
+
+    // One constant, the load, the comparison and the store.
+    CHECK(engine.length == 4U);
+    CHECK((engine.code[0].op == RuleOp::kConst) && (engine.code[0].value == -5.0f));
+}
+
+static void test_compile_errors()
+{
+    const struct
+    {
+        const char* expression;
+        size_t position;
+    } errors[] = {
+        {"a +", 3U},
+        {"(a > b", 6U},
+        {"a > unknown_signal", 4U},
+        {"a b", 2U},
+        {"a $ b", 2U},
+        {"", 0U},
+    };
+
+    rule_engine_clear(engine);
+    CHECK(rule_engine_add(engine, "a > b", output, nullptr));
+    const size_t length = engine.length;
+
+    for (const auto& expected : errors)
+    {
+        RuleCompileError error = {};
+        CHECK(false == rule_engine_add(engine, expected.expression, output, &error));
+        CHECK((error.message != nullptr) && (error.position == expected.position));
+        CHECK((engine.length == length) && (engine.rules == 1U));
+    }
+
+    CHECK(false == rule_engine_add(engine, "a > b", kInvalidSignalSlot, nullptr));
+    CHECK(engine.length == length);
+}
+
+static void test_full()
+{
+    rule_engine_clear(engine);
+
+    // Load, load, comparison and store each.
+    size_t added = 0U;
+    while (rule_engine_add(engine, "a > b", output, nullptr))
+    {
+        added++;
+    }
+
+    CHECK(added == (kMaxRuleInstructions / 4U));
+    CHECK(engine.rules == added);
+    CHECK(engine.length == (added * 4U));
+
+    // An expression that no longer fits is dropped whole.
+    RuleCompileError error = {};
+    CHECK(false == rule_engine_add(engine, "1", output, &error));
+    CHECK((error.message != nullptr) && (engine.length == (added * 4U)));
+}
+
+/**
+ * Random expression with its value, evaluated as the engine does with floats throughout.
+ */
+static float random_expression(std::mt19937& random, size_t depth, std::string& text)
+{
+    const float* values = signal_db_values();
+    const unsigned choice = random() % ((depth == 0U) ? 2U : 16U);
+
+    if (choice == 0U)
+    {
+        const float value = kLiterals[random() % kLiterals.size()];
+        char literal[16] = {};
+        snprintf(literal, sizeof(literal), "%gf", static_cast<double>(value));
+        text += literal;
+        return value;
+    }
+
+    if (choice == 1U)
+    {
+        const char* name = kTestSignals[random() % kTestSignals.size()];
+        text += name;
+        return values[signal_db_find(name)];
+    }
+
+    if (choice < 4U)
+    {
+        const bool negate = (choice == 2U);
+        text += negate ? "-(" : "!(";
+        const float a = random_expression(random, depth - 1U, text);
+        text += ")";
+        return negate ? -a : ((a == 0.0f) ? 1.0f : 0.0f);
+    }
+
+    const char* const operators[] = {"+", "-", "*", "/", "<", "<=", ">", ">=", "==", "!=", "&&", "||"};
+    const unsigned op = choice - 4U;
+
+    text += "(";
+    const float a = random_expression(random, depth - 1U, text);
+    text += ") ";
+    text += operators[op];
+    text += " (";
+    const float b = random_expression(random, depth - 1U, text);
+    text += ")";
+
+    switch (op)
+    {
+        case 0U:    return a + b;
+        case 1U:    return a - b;
+        case 2U:    return a * b;
+        case 3U:    return a / b;
+        case 4U:    return (a < b) ? 1.0f : 0.0f;
+        case 5U:    return (a <= b) ? 1.0f : 0.0f;
+        case 6U:    return (a > b) ? 1.0f : 0.0f;
+        case 7U:    return (a >= b) ? 1.0f : 0.0f;
+        case 8U:    return (a == b) ? 1.0f : 0.0f;
+        case 9U:    return (a != b) ? 1.0f : 0.0f;
+        case 10U:   return ((a != 0.0f) && (b != 0.0f)) ? 1.0f : 0.0f;
+        default:    return ((a != 0.0f) || (b != 0.0f)) ? 1.0f : 0.0f;
+    }
+}
+
+static void test_random()
+{
+    std::mt19937 random(1U);
+
+    for (size_t i = 0U; i < kRandomExpressions; i++)
+    {
+        set_signals(static_cast<float>(random() % 5U), -1.5f, 0.0f, static_cast<float>(random() % 100U) / 8.0f);
+
+        std::string text;
+        const float expected = random_expression(random, kRandomDepth, text);
+        const float value = evaluate(text.c_str());
+
+        CHECK(same(value, expected));
+        if (!same(value, expected))
+        {
+            printf("  %s = %g, expected %g\n", text.c_str(), static_cast<double>(value),
+                static_cast<double>(expected));
+        }
+    }
+}
+
+static void test_signal_db()
+{
+    const size_t count = signal_db_count();
+
+    // Adding an existing name returns its slot and keeps its value.
+    const SignalSlot a = signal_db_find("a");
+    signal_db_values()[a] = 42.0f;
+    CHECK(signal_db_add("a", 1.0f) == a);
+    CHECK(signal_db_values()[a] == 42.0f);
+    CHECK(signal_db_count() == count);
+
+    // Names are matched whole.
+    CHECK(signal_db_find("engine_temp_c", 6U) == kInvalidSignalSlot);
+    CHECK(signal_db_find("engine_temp_c_x", 13U) == signal_db_find("engine_temp_c"));
+    CHECK(signal_db_find("missing") == kInvalidSignalSlot);
+    CHECK(signal_db_name(a) != nullptr);
+    CHECK(signal_db_name(static_cast<SignalSlot>(count)) == nullptr);
+}
+
+int main()
+{
+    for (const char* name : logic::kSignals)
+    {
+        signal_db_add(name);
+    }
+
+    for (const char* name : kTestSignals)
+    {
+        signal_db_add(name);
+    }
+
+    output = signal_db_add("output");
+
+    test_operators();
+    test_conf_rules();
+    test_constant_folding();
+    test_compile_errors();
+    test_full();
+    test_random();
+    test_signal_db();
+
+    return host_test_result("rule_engine_test");
+}
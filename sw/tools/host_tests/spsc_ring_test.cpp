@@ -0,0 +1,105 @@
+/**
+ * Lock-free ring of the firmware on the host: full and empty rings are refused without being touched, the free running
+ * indices wrap around 2^32, and items pushed from one thread come out of another in order, none lost or repeated.
+ *
+ *     spsc_ring_test
+ */
+
+#include "host_test.h"
+#include "spsc_ring.h"
+
+#include <thread>
+
+constexpr uint32_t kThreadedItems = 2000000U;
+
+static void test_full_and_empty()
+{
+    SpscRing<uint32_t, 4U> ring = {};
+    uint32_t item = 0U;
+
+    CHECK(false == ring.pop(item));
+
+    for (uint32_t i = 0U; i < 4U; i++)
+    {
+        CHECK(ring.push(i));
+    }
+
+    CHECK(ring.size() == 4U);
+    CHECK(false == ring.push(99U));
+    CHECK(ring.size() == 4U);
+
+    for (uint32_t i = 0U; i < 4U; i++)
+    {
+        CHECK(ring.pop(item) && (item == i));
+    }
+
+    CHECK(false == ring.pop(item));
+    CHECK(ring.size() == 0U);
+}
+
+static void test_index_wrap()
+{
+    SpscRing<uint32_t, 8U> ring = {};
+    ring.head = UINT32_MAX - 2U;
+    ring.tail = UINT32_MAX - 2U;
+
+    uint32_t item = 0U;
+    for (uint32_t i = 0U; i < 20U; i++)
+    {
+        CHECK(ring.push(i));
+        CHECK(ring.push(i + 100U));
+        CHECK(ring.size() == 2U);
+        CHECK(ring.pop(item) && (item == i));
+        CHECK(ring.pop(item) && (item == (i + 100U)));
+    }
+
+    // Full across the wrap.
+    for (uint32_t i = 0U; i < 8U; i++)
+    {
+        CHECK(ring.push(i));
+    }
+    CHECK(false == ring.push(8U));
+    CHECK(ring.size() == 8U);
+}
+
+static void test_threaded_order()
+{
+    // A small ring, so both sides keep finding it full and empty.
+    static SpscRing<uint32_t, 16U> ring = {};
+    uint32_t out_of_order = 0U;
+
+    std::thread consumer([&]()
+    {
+        uint32_t item = 0U;
+        for (uint32_t i = 0U; i < kThreadedItems; i++)
+        {
+            while (false == ring.pop(item))
+            {
+                std::this_thread::yield();
+            }
+            out_of_order += (item != i) ? 1U : 0U;
+        }
+    });
+
+    for (uint32_t i = 0U; i < kThreadedItems; i++)
+    {
+        while (false == ring.push(i))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    consumer.join();
+
+    CHECK(out_of_order == 0U);
+    CHECK(ring.size() == 0U);
+}
+
+int main()
+{
+    test_full_and_empty();
+    test_index_wrap();
+    test_threaded_order();
+
+    return host_test_result("spsc_ring_test");
+}
@@ -0,0 +1,24 @@
+#ifndef FREERTOS_H_
+#define FREERTOS_H_
+
+#include <cstdint>
+
+/**
+ * Just enough of FreeRTOS for the firmware modules tested on the host: a 1 kHz tick driven by the test, and no
+ * interrupts to mask.
+ */
+
+using TickType_t = uint32_t;
+
+#define configTICK_RATE_HZ 1000U
+#define configCPU_CLOCK_HZ 300000000UL
+
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>((static_cast<TickType_t>(ms) * configTICK_RATE_HZ) / 1000U))
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+// Tick count returned by xTaskGetTickCount(), set by the test.
+inline TickType_t host_tick_count = 0U;
+
+#endif  // FREERTOS_H_
@@ -0,0 +1,38 @@
+#ifndef CYCLE_TIMER_H_
+#define CYCLE_TIMER_H_
+
+#include "FreeRTOS.h"
+
+#include <cstdint>
+
+/**
+ * Cycle counter of the firmware on the host, standing still unless the test moves it: nothing ever runs over its
+ * budget unless the test says so.
+ */
+
+constexpr uint32_t kCyclesPerMicrosecond = configCPU_CLOCK_HZ / 1000000UL;
+constexpr uint32_t kCyclesPerTick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+
+inline uint32_t host_cycle_count = 0U;
+
+inline uint32_t cycle_timer_now()
+{
+    return host_cycle_count;
+}
+
+inline uint32_t cycle_timer_elapsed(uint32_t since)
+{
+    return host_cycle_count - since;
+}
+
+constexpr uint32_t cycles_to_us(uint32_t cycles)
+{
+    return cycles / kCyclesPerMicrosecond;
+}
+
+constexpr uint32_t us_to_cycles(uint32_t us)
+{
+    return us * kCyclesPerMicrosecond;
+}
+
+#endif  // CYCLE_TIMER_H_
@@ -0,0 +1,11 @@
+#ifndef TASK_H_
+#define TASK_H_
+
+#include "FreeRTOS.h"
+
+inline TickType_t xTaskGetTickCount()
+{
+    return host_tick_count;
+}
+
+#endif  // TASK_H_
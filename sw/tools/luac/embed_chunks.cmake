@@ -0,0 +1,36 @@
+# Turn precompiled Lua chunks into a C++ source holding them as aligned constant arrays, so they stay in flash and the
+# loader can map their code in place.
+#
+#   cmake -DOUTPUT=<file.cpp> -DCHUNKS=<a.luac;b.luac> -P embed_chunks.cmake
+#
+# The script name is the file name without its extension.
+
+set(content "// Generated by embed_chunks.cmake, do not edit.\n\n#include \"lua_scripts.h\"\n")
+set(table "")
+
+foreach(chunk ${CHUNKS})
+    get_filename_component(name ${chunk} NAME_WE)
+
+    file(READ ${chunk} hex HEX)
+    string(LENGTH "${hex}" hex_length)
+
+    # 16 bytes per line.
+    set(bytes "")
+    set(offset 0)
+    while(offset LESS hex_length)
+        string(SUBSTRING "${hex}" ${offset} 32 line)
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " line "${line}")
+        string(STRIP "${line}" line)
+        string(APPEND bytes "    ${line}\n")
+        math(EXPR offset "${offset} + 32")
+    endwhile()
+
+    string(APPEND content "\nalignas(4) static const uint8_t chunk_${name}[] = {\n${bytes}};\n")
+    string(APPEND table "    {\"${name}\", &chunk_${name}[0], sizeof(chunk_${name})},\n")
+endforeach()
+
+list(LENGTH CHUNKS count)
+string(APPEND content "\nconst LuaEmbeddedScript kLuaEmbeddedScripts[] = {\n${table}};\n")
+string(APPEND content "\nconst size_t kLuaEmbeddedScriptCount = ${count}U;\n")
+
+file(WRITE ${OUTPUT} "${content}")
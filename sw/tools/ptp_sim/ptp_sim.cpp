@@ -0,0 +1,501 @@
+/**
+ * Synchronize a simulated slave to a stand-in master with the gPTP engine of the firmware, on the host, and measure how
+ * fast the offset converges and how much it jitters once it has.
+ *
+ *     ptp_sim [--duration 120] [--drift-ppm 25] [--initial-offset-ms 3] [--link-delay-ns 500]
+ *             [--timestamp-jitter-ns 4] [--seed 1] [--trace]
+ *
+ * Both ends run ptp.h, the master in ptp::Role::kMaster and the slave in ptp::Role::kSlave, as the PTP task does:
+ * every kSlewIntervalMs, and on every frame received or timestamp latched.  Messages are encoded and decoded as on
+ * the wire.
+ *
+ * Each end has a TSU as on the SAMV71, a counter advancing by an increment in 2^-16 ns every cycle of a 150 MHz
+ * peripheral clock.  The master runs from an ideal oscillator, the slave from one off by --drift-ppm, and both apply
+ * their frequency through the increment and the phase slews of PtpRate.  Timestamps are the TSU value at the last
+ * cycle before the frame crossed the MAC, plus gaussian noise of --timestamp-jitter-ns standard deviation for the PHY.
+ * Frames take --link-delay-ns on the wire in either direction, and up to a ms between the tasks and the wire.
+ *
+ * The true offset of the slave from the master is sampled every kSlewIntervalMs.  Reported are the times after which
+ * it stays within 1 us and within 100 ns, and its mean, RMS, 99th percentile and largest magnitude over the second half
+ * of the run, with the link delay the slave measured.  --trace prints every Sync of the slave.
+ */
+
+#include "conf_ptp.h"
+#include "ptp.h"
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <vector>
+
+constexpr double kDefaultDurationS = 120.0;
+constexpr double kDefaultDriftPpm = 25.0;
+constexpr double kDefaultInitialOffsetMs = 3.0;
+constexpr int64_t kDefaultLinkDelayNs = 500;
+constexpr double kDefaultTimestampJitterNs = 4.0;
+constexpr uint64_t kDefaultSeed = 1U;
+
+constexpr double kTsuClockHz = 150e6;
+
+constexpr int64_t kNsPerMs = 1000000;
+constexpr int64_t kTickNs = ptp::kSlewIntervalMs * kNsPerMs;
+
+// Between the PTP task and the wire, either way, and until the task polls the transmit timestamp.
+constexpr int64_t kMaxStackLatencyNs = kNsPerMs;
+constexpr int64_t kTimestampPollNs = kNsPerMs;
+
+// Master time when the simulation starts.
+constexpr int64_t kMasterEpochNs = 1000 * 1000 * kNsPerMs;
+
+constexpr std::array<double, 2U> kSettleThresholdsNs = {{1000.0, 100.0}};
+
+/**
+ * TSU of the GMAC: value advances by increment / 2^16 ns on every cycle of its input clock, read in whole ns.
+ */
+struct SimClock
+{
+    double tick_hz;         // Of its oscillator, drift included.
+    PtpRate rate;
+    int64_t base_t_ns;      // True time of a cycle of the input clock.
+    double base_ns;         // Value of the TSU at it, in ns with the sub-ns part.
+};
+
+enum class SimNode : uint8_t
+{
+    kMaster,
+    kSlave,
+};
+
+enum class SimEventKind : uint8_t
+{
+    kTick,
+    kReceive,
+    kTransmitted,
+};
+
+struct SimEvent
+{
+    int64_t t_ns;           // True time.
+    uint64_t order;         // Ties broken in the order of scheduling.
+    SimEventKind kind;
+    SimNode node;
+
+    // kReceive: the frame, and its receive timestamp for an event message.  kTransmitted: the event message sent.
+    std::array<uint8_t, kPtpMaxMessageBytes> frame;
+    size_t length;
+    PtpMessageType type;
+    uint16_t sequence_id;
+    int64_t timestamp_ns;
+};
+
+struct SimEventLater
+{
+    bool operator()(const SimEvent& a, const SimEvent& b) const
+    {
+        return (a.t_ns != b.t_ns) ? (a.t_ns > b.t_ns) : (a.order > b.order);
+    }
+};
+
+struct SimOptions
+{
+    double duration_s;
+    double drift_ppm;
+    double initial_offset_ms;
+    int64_t link_delay_ns;
+    double timestamp_jitter_ns;
+    uint64_t seed;
+    bool trace;
+};
+
+struct SimStats
+{
+    std::vector<int64_t> t_ns;
+    std::vector<double> offset_ns;
+};
+
+static std::priority_queue<SimEvent, std::vector<SimEvent>, SimEventLater> sim_events = {};
+static uint64_t sim_order = 0U;
+
+static std::array<SimClock, 2U> sim_clocks = {};
+static std::array<PtpPort, 2U> sim_ports = {};
+
+static std::mt19937_64 sim_random = {};
+
+static SimOptions sim_options = {};
+
+static SimClock& clock_of(SimNode node)
+{
+    return sim_clocks[static_cast<size_t>(node)];
+}
+
+static PtpPort& port_of(SimNode node)
+{
+    return sim_ports[static_cast<size_t>(node)];
+}
+
+static SimNode peer_of(SimNode node)
+{
+    return (node == SimNode::kMaster) ? SimNode::kSlave : SimNode::kMaster;
+}
+
+static void clock_init(SimClock& clock, double drift_ppm, double value_ns)
+{
+    clock.tick_hz = kTsuClockHz * (1.0 + (drift_ppm * 1e-6));
+    ptp_rate_init(clock.rate, static_cast<uint32_t>(kTsuClockHz));
+    clock.base_t_ns = 0;
+    clock.base_ns = value_ns;
+}
+
+// Whole cycles of the input clock since the base.
+static double clock_ticks(const SimClock& clock, int64_t t_ns)
+{
+    return std::floor(static_cast<double>(t_ns - clock.base_t_ns) * clock.tick_hz * 1e-9);
+}
+
+static double clock_value(const SimClock& clock, int64_t t_ns)
+{
+    return clock.base_ns + (clock_ticks(clock, t_ns) * static_cast<double>(clock.rate.increment) / 65536.0);
+}
+
+/**
+ * \return the TSU as read or latched at true time t_ns.
+ */
+static int64_t clock_read(const SimClock& clock, int64_t t_ns)
+{
+    return static_cast<int64_t>(std::floor(clock_value(clock, t_ns)));
+}
+
+/**
+ * \return the value of the TSU without its quantization, to measure the true offset.
+ */
+static double clock_exact(const SimClock& clock, int64_t t_ns)
+{
+    return clock.base_ns + (static_cast<double>(t_ns - clock.base_t_ns) * clock.tick_hz * 1e-9 *
+        static_cast<double>(clock.rate.increment) / 65536.0);
+}
+
+// Rebase on the last cycle, so that the increment changes from there on.
+static void clock_rebase(SimClock& clock, int64_t t_ns)
+{
+    const double ticks = clock_ticks(clock, t_ns);
+
+    clock.base_ns += ticks * static_cast<double>(clock.rate.increment) / 65536.0;
+    clock.base_t_ns += static_cast<int64_t>(std::llround(ticks * 1e9 / clock.tick_hz));
+}
+
+static int64_t jitter_ns()
+{
+    if (sim_options.timestamp_jitter_ns <= 0.0)
+    {
+        return 0;
+    }
+
+    std::normal_distribution<double> noise(0.0, sim_options.timestamp_jitter_ns);
+    return std::llround(noise(sim_random));
+}
+
+static int64_t stack_latency_ns()
+{
+    std::uniform_int_distribution<int64_t> latency(kMaxStackLatencyNs / 20, kMaxStackLatencyNs);
+    return latency(sim_random);
+}
+
+static void schedule(SimEvent event)
+{
+    event.order = sim_order++;
+    sim_events.push(event);
+}
+
+static bool is_event_message(PtpMessageType type)
+{
+    return (type == PtpMessageType::kSync) || (type == PtpMessageType::kPdelayReq) ||
+        (type == PtpMessageType::kPdelayResp);
+}
+
+static void send(SimNode node, const PtpMessage& message, int64_t t_ns)
+{
+    SimEvent receive = {};
+    receive.kind = SimEventKind::kReceive;
+    receive.node = peer_of(node);
+    receive.length = ptp_encode(message, ptp::kDomain, receive.frame.data(), receive.frame.size());
+    receive.timestamp_ns = kPtpNoTimestamp;
+
+    const int64_t wire_t_ns = t_ns + stack_latency_ns();
+    const int64_t arrival_t_ns = wire_t_ns + sim_options.link_delay_ns;
+
+    if (is_event_message(message.type))
+    {
+        SimEvent transmitted = {};
+        transmitted.kind = SimEventKind::kTransmitted;
+        transmitted.node = node;
+        transmitted.t_ns = wire_t_ns + kTimestampPollNs;
+        transmitted.type = message.type;
+        transmitted.sequence_id = message.sequence_id;
+        transmitted.timestamp_ns = clock_read(clock_of(node), wire_t_ns) + jitter_ns();
+        schedule(transmitted);
+
+        receive.timestamp_ns = clock_read(clock_of(receive.node), arrival_t_ns) + jitter_ns();
+    }
+
+    receive.t_ns = arrival_t_ns + stack_latency_ns();
+    schedule(receive);
+}
+
+static void apply(SimNode node, const PtpOutput& output, int64_t t_ns)
+{
+    SimClock& clock = clock_of(node);
+
+    if (output.step)
+    {
+        clock.base_ns += static_cast<double>(output.step_ns);
+        ptp_rate_clear_phase(clock.rate);
+    }
+
+    if (output.set_frequency)
+    {
+        clock_rebase(clock, t_ns);
+        ptp_rate_set(clock.rate, output.frequency_ppb);
+    }
+
+    for (size_t i = 0U; i < output.message_count; i++)
+    {
+        send(node, output.messages[i], t_ns);
+    }
+}
+
+static void trace_sync(int64_t t_ns, double true_offset_ns)
+{
+    const PtpStats& stats = port_of(SimNode::kSlave).stats;
+
+    printf("%10.3f s  offset %10" PRId64 " ns measured %10.1f ns true  delay %6" PRId64 " ns  freq %10.1f ppb  %s\n",
+        static_cast<double>(t_ns) / 1e9, stats.offset_ns, true_offset_ns, stats.mean_link_delay_ns,
+        stats.frequency_ppb, (stats.servo_state == PtpServoState::kLocked) ? "locked" : "unlocked");
+}
+
+static void run(SimStats& stats)
+{
+    const int64_t duration_ns = static_cast<int64_t>(sim_options.duration_s * 1e9);
+
+    clock_init(clock_of(SimNode::kMaster), 0.0, static_cast<double>(kMasterEpochNs));
+    clock_init(clock_of(SimNode::kSlave), sim_options.drift_ppm,
+        static_cast<double>(kMasterEpochNs) - (sim_options.initial_offset_ms * 1e6));
+
+    ptp_port_init(port_of(SimNode::kMaster), ptp::Role::kMaster, 0x0200000000000001U,
+        clock_read(clock_of(SimNode::kMaster), 0));
+    ptp_port_init(port_of(SimNode::kSlave), ptp::Role::kSlave, 0x0200000000000002U,
+        clock_read(clock_of(SimNode::kSlave), 0));
+
+    // The tasks of both ends wake up out of phase.
+    for (SimNode node : {SimNode::kMaster, SimNode::kSlave})
+    {
+        SimEvent tick = {};
+        tick.kind = SimEventKind::kTick;
+        tick.node = node;
+        tick.t_ns = (node == SimNode::kMaster) ? 0 : (kTickNs / 3);
+        schedule(tick);
+    }
+
+    while (false == sim_events.empty())
+    {
+        SimEvent event = sim_events.top();
+        sim_events.pop();
+
+        if (event.t_ns > duration_ns)
+        {
+            break;
+        }
+
+        PtpPort& port = port_of(event.node);
+        SimClock& clock = clock_of(event.node);
+        PtpOutput output = {};
+
+        switch (event.kind)
+        {
+            case SimEventKind::kTick:
+            {
+                ptp_port_tick(port, clock_read(clock, event.t_ns), output);
+                apply(event.node, output, event.t_ns);
+
+                clock.base_ns += ptp_rate_slew(clock.rate, kTickNs);
+
+                if (event.node == SimNode::kSlave)
+                {
+                    stats.t_ns.push_back(event.t_ns);
+                    stats.offset_ns.push_back(clock_exact(clock, event.t_ns) -
+                        clock_exact(clock_of(SimNode::kMaster), event.t_ns));
+                }
+
+                event.t_ns += kTickNs;
+                schedule(event);
+                break;
+            }
+
+            case SimEventKind::kReceive:
+            {
+                PtpMessage message = {};
+                if (false == ptp_decode(event.frame.data(), event.length, ptp::kDomain, message))
+                {
+                    printf("Undecodable message\n");
+                    exit(1);
+                }
+
+                const uint32_t syncs = port.stats.syncs;
+
+                ptp_port_receive(port, message, event.timestamp_ns, output);
+                apply(event.node, output, event.t_ns);
+
+                if (sim_options.trace && (event.node == SimNode::kSlave) && (port.stats.syncs != syncs))
+                {
+                    trace_sync(event.t_ns, clock_exact(clock, event.t_ns) -
+                        clock_exact(clock_of(SimNode::kMaster), event.t_ns));
+                }
+                break;
+            }
+
+            case SimEventKind::kTransmitted:
+                ptp_port_transmitted(port, event.type, event.sequence_id, event.timestamp_ns, output);
+                apply(event.node, output, event.t_ns);
+                break;
+        }
+    }
+}
+
+/**
+ * \return the time after which the offset stays within the threshold, negative if it never settles.
+ */
+static double settle_time_s(const SimStats& stats, double threshold_ns)
+{
+    for (size_t i = stats.offset_ns.size(); i > 0U; i--)
+    {
+        if (std::fabs(stats.offset_ns[i - 1U]) > threshold_ns)
+        {
+            return (i < stats.offset_ns.size()) ? (static_cast<double>(stats.t_ns[i]) / 1e9) : -1.0;
+        }
+    }
+
+    return 0.0;
+}
+
+static void usage()
+{
+    printf("Usage: ptp_sim [--duration s] [--drift-ppm ppm] [--initial-offset-ms ms] [--link-delay-ns ns]\n"
+           "               [--timestamp-jitter-ns ns] [--seed n] [--trace]\n");
+}
+
+int main(int argc, char** argv)
+{
+    sim_options = {kDefaultDurationS, kDefaultDriftPpm, kDefaultInitialOffsetMs, kDefaultLinkDelayNs,
+        kDefaultTimestampJitterNs, kDefaultSeed, false};
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+        const bool has_value = (i + 1) < argc;
+
+        if ((strcmp(argument, "--duration") == 0) && has_value)
+        {
+            sim_options.duration_s = strtod(argv[++i], nullptr);
+        }
+        else if ((strcmp(argument, "--drift-ppm") == 0) && has_value)
+        {
+            sim_options.drift_ppm = strtod(argv[++i], nullptr);
+        }
+        else if ((strcmp(argument, "--initial-offset-ms") == 0) && has_value)
+        {
+            sim_options.initial_offset_ms = strtod(argv[++i], nullptr);
+        }
+        else if ((strcmp(argument, "--link-delay-ns") == 0) && has_value)
+        {
+            sim_options.link_delay_ns = strtoll(argv[++i], nullptr, 10);
+        }
+        else if ((strcmp(argument, "--timestamp-jitter-ns") == 0) && has_value)
+        {
+            sim_options.timestamp_jitter_ns = strtod(argv[++i], nullptr);
+        }
+        else if ((strcmp(argument, "--seed") == 0) && has_value)
+        {
+            sim_options.seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argument, "--trace") == 0)
+        {
+            sim_options.trace = true;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if ((sim_options.duration_s <= 0.0) || (sim_options.link_delay_ns < 0))
+    {
+        usage();
+        return 1;
+    }
+
+    sim_random.seed(sim_options.seed);
+
+    SimStats stats = {};
+    run(stats);
+
+    const PtpStats& slave = port_of(SimNode::kSlave).stats;
+
+    printf("Drift %.1f ppm, initial offset %.3f ms, link delay %" PRId64 " ns, timestamp jitter %.1f ns, %.0f s\n",
+        sim_options.drift_ppm, sim_options.initial_offset_ms, sim_options.link_delay_ns,
+        sim_options.timestamp_jitter_ns, sim_options.duration_s);
+    printf("Slave: %" PRIu32 " syncs, %" PRIu32 " steps, %" PRIu32 " link delays, %" PRIu32 " lost, %s, "
+        "frequency %.1f ppb\n", slave.syncs, slave.steps, slave.pdelay_exchanges, slave.pdelay_lost,
+        (slave.servo_state == PtpServoState::kLocked) ? "locked" : "unlocked", slave.frequency_ppb);
+    printf("Link delay measured %" PRId64 " ns, neighbour rate ratio %+.3f ppm\n", slave.mean_link_delay_ns,
+        (slave.neighbor_rate_ratio - 1.0) * 1e6);
+
+    for (double threshold_ns : kSettleThresholdsNs)
+    {
+        const double settle_s = settle_time_s(stats, threshold_ns);
+
+        if (settle_s < 0.0)
+        {
+            printf("Never settled within %.0f ns\n", threshold_ns);
+        }
+        else
+        {
+            printf("Settled within %.0f ns after %.3f s\n", threshold_ns, settle_s);
+        }
+    }
+
+    // Steady state, the second half of the run.
+    std::vector<double> steady(stats.offset_ns.begin() + static_cast<ptrdiff_t>(stats.offset_ns.size() / 2U),
+        stats.offset_ns.end());
+
+    if (steady.empty())
+    {
+        return 1;
+    }
+
+    double sum = 0.0;
+    double sum_squares = 0.0;
+
+    for (double offset : steady)
+    {
+        sum += offset;
+        sum_squares += offset * offset;
+    }
+
+    std::vector<double> magnitudes(steady.size());
+    std::transform(steady.begin(), steady.end(), magnitudes.begin(), [](double offset) { return std::fabs(offset); });
+    std::sort(magnitudes.begin(), magnitudes.end());
+
+    const size_t p99 = std::min(magnitudes.size() - 1U, (magnitudes.size() * 99U) / 100U);
+
+    printf("Offset over the second half, %zu samples: mean %.1f ns, RMS %.1f ns, p99 |offset| %.1f ns, "
+        "max |offset| %.1f ns\n", steady.size(), sum / static_cast<double>(steady.size()),
+        std::sqrt(sum_squares / static_cast<double>(steady.size())), magnitudes[p99], magnitudes.back());
+
+    return 0;
+}
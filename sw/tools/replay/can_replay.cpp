@@ -0,0 +1,841 @@
+/**
+ * Replay CAN logs through the decode and rule pipeline of the firmware, on the host, as fast as possible.
+ *
+ *     can_replay [--repeat 10] [--rule-period-ms 10] [--channel can0=0] [--signals] log...
+ *
+ * Logs are candump files, either `candump -L` ("(1436509052.249713) can0 100#11223344") or the default candump output
+ * ("can0  100   [4]  11 22 33 44"), or Vector ASC files, classic and CAN-FD.  Interfaces map to CAN0 and CAN1 in the
+ * order they first appear, or as given by --channel.
+ *
+ * The signal database is set up as on the target: the signals of conf_logic.h, those of the DBC, then the rules.  Every
+ * frame is decoded with can_dbc::decode(), and the rules are evaluated every --rule-period-ms of log time, 0 for after
+ * every frame, as the Lua task does every kRuleRateTicks.
+ *
+ * The whole log is loaded first, then replayed twice: once untimed for the throughput, once timing every stage call
+ * for its latency, less the cost of reading the clock.  Heap allocations are counted over each phase, the pipeline
+ * should never make any.
+ */
+
+#include "can_dbc.h"
+#include "can_frame.h"
+#include "rule_engine.h"
+#include "signal_db.h"
+
+#include "conf_logic.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+constexpr uint32_t kDefaultRulePeriodMs = 10U;
+constexpr uint32_t kDefaultRepeat = 10U;
+
+// Latency histogram, 1 ns buckets up to kLatencyBuckets ns, the rest is counted in the last one.
+constexpr size_t kLatencyBuckets = 4096U;
+
+struct LogFrame
+{
+    uint64_t time_us;
+    CanFrame frame;
+};
+
+struct Interface
+{
+    std::string name;
+    CanChannel channel;
+};
+
+struct StageStats
+{
+    const char* name;
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t allocations;
+    std::array<uint64_t, kLatencyBuckets> histogram;
+};
+
+static std::vector<Interface> replay_interfaces = {};
+
+static RuleEngine replay_rules = {};
+static can_dbc::SlotTable replay_slots = {};
+
+// Heap allocations made so far, by operator new and, on glibc, by malloc.
+static std::atomic<uint64_t> replay_allocations = 0U;
+
+void* operator new(size_t size)
+{
+    replay_allocations.fetch_add(1U, std::memory_order_relaxed);
+
+    void* pointer = malloc((size > 0U) ? size : 1U);
+    if (pointer == nullptr)
+    {
+        abort();
+    }
+
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t /*size*/) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t /*size*/) noexcept
+{
+    free(pointer);
+}
+
+#if defined(__GLIBC__)
+extern "C"
+{
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+
+void* malloc(size_t size)
+{
+    replay_allocations.fetch_add(1U, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    replay_allocations.fetch_add(1U, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size)
+{
+    replay_allocations.fetch_add(1U, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+}  // extern "C"
+#endif
+
+static uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static bool channel_of(const char* name, size_t length, CanChannel& channel)
+{
+    for (const auto& interface : replay_interfaces)
+    {
+        if ((interface.name.size() == length) && (strncmp(interface.name.c_str(), name, length) == 0))
+        {
+            channel = interface.channel;
+            return true;
+        }
+    }
+
+    // New interfaces take the next free channel.
+    if (replay_interfaces.size() >= kCanChannels)
+    {
+        return false;
+    }
+
+    channel = static_cast<CanChannel>(replay_interfaces.size());
+    replay_interfaces.push_back({std::string(name, length), channel});
+
+    return true;
+}
+
+static int hex_digit(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+static const char* skip_spaces(const char* cursor)
+{
+    while ((*cursor == ' ') || (*cursor == '\t'))
+    {
+        cursor++;
+    }
+
+    return cursor;
+}
+
+static const char* token_end(const char* cursor)
+{
+    while ((*cursor != '\0') && (*cursor != ' ') && (*cursor != '\t') && (*cursor != '\r') && (*cursor != '\n'))
+    {
+        cursor++;
+    }
+
+    return cursor;
+}
+
+/**
+ * Parse hex digits up to the end of the token or the first non hex character.
+ */
+static const char* parse_hex(const char* cursor, uint32_t& value)
+{
+    value = 0U;
+
+    for (int digit = hex_digit(*cursor); digit >= 0; digit = hex_digit(*++cursor))
+    {
+        value = (value << 4U) | static_cast<uint32_t>(digit);
+    }
+
+    return cursor;
+}
+
+static void set_id(CanFrame& frame, uint32_t id, bool extended)
+{
+    frame.id = id & (extended ? 0x1FFFFFFFU : 0x7FFU);
+    frame.flags |= extended ? can_flags::kExtended : 0U;
+}
+
+/**
+ * "(1436509052.249713) can0 100#11223344", "... 18FF0000#R" or "... 500##1112233..." for CAN-FD.
+ */
+static bool parse_candump_log(const char* line, LogFrame& entry)
+{
+    char* end = nullptr;
+    const double seconds = strtod(line + 1, &end);
+    if ((end == nullptr) || (*end != ')'))
+    {
+        return false;
+    }
+
+    entry.time_us = static_cast<uint64_t>(seconds * 1e6);
+
+    const char* name = skip_spaces(end + 1);
+    const char* cursor = token_end(name);
+    if (false == channel_of(name, static_cast<size_t>(cursor - name), entry.frame.channel))
+    {
+        return false;
+    }
+
+    cursor = skip_spaces(cursor);
+    const char* id_start = cursor;
+
+    uint32_t id = 0U;
+    cursor = parse_hex(cursor, id);
+    if (*cursor != '#')
+    {
+        return false;
+    }
+
+    set_id(entry.frame, id, (cursor - id_start) > 3);
+    cursor++;
+
+    if (*cursor == '#')
+    {
+        // CAN-FD flags nibble, bit rate switch in bit 0.
+        entry.frame.flags |= can_flags::kFd;
+        if ((hex_digit(cursor[1]) & 0x1) != 0)
+        {
+            entry.frame.flags |= can_flags::kBitRateSwitch;
+        }
+        cursor += 2;
+    }
+    else if ((*cursor == 'R') || (*cursor == 'r'))
+    {
+        entry.frame.flags |= can_flags::kRemote;
+        return true;
+    }
+
+    size_t length = 0U;
+    while ((hex_digit(cursor[0]) >= 0) && (hex_digit(cursor[1]) >= 0) && (length < kCanMaxDataBytes))
+    {
+        entry.frame.data[length++] = static_cast<uint8_t>((hex_digit(cursor[0]) << 4) | hex_digit(cursor[1]));
+        cursor += 2;
+
+        // Some tools separate the bytes with dots.
+        if (*cursor == '.')
+        {
+            cursor++;
+        }
+    }
+
+    entry.frame.length = static_cast<uint8_t>(length);
+
+    return true;
+}
+
+/**
+ * Parse up to count space separated hex bytes into the frame.
+ */
+static bool parse_bytes(const char* cursor, size_t count, CanFrame& frame)
+{
+    if (count > kCanMaxDataBytes)
+    {
+        return false;
+    }
+
+    for (size_t i = 0U; i < count; i++)
+    {
+        cursor = skip_spaces(cursor);
+
+        uint32_t value = 0U;
+        const char* end = parse_hex(cursor, value);
+        if ((end == cursor) || (value > 0xFFU))
+        {
+            return false;
+        }
+
+        frame.data[i] = static_cast<uint8_t>(value);
+        cursor = end;
+    }
+
+    frame.length = static_cast<uint8_t>(count);
+
+    return true;
+}
+
+/**
+ * "  can0  100   [4]  11 22 33 44", without timestamps: frames are spaced by their line number in microseconds.
+ */
+static bool parse_candump(const char* line, size_t line_number, LogFrame& entry)
+{
+    const char* name = skip_spaces(line);
+    const char* cursor = token_end(name);
+    if ((cursor == name) || (false == channel_of(name, static_cast<size_t>(cursor - name), entry.frame.channel)))
+    {
+        return false;
+    }
+
+    cursor = skip_spaces(cursor);
+    const char* id_start = cursor;
+
+    uint32_t id = 0U;
+    cursor = parse_hex(cursor, id);
+    if ((cursor == id_start) || (*cursor != ' '))
+    {
+        return false;
+    }
+
+    set_id(entry.frame, id, (cursor - id_start) > 3);
+
+    cursor = skip_spaces(cursor);
+    if (*cursor != '[')
+    {
+        return false;
+    }
+
+    const size_t length = strtoul(cursor + 1, nullptr, 10);
+    const bool fd = (cursor[1] == '0') && (length > 8U);
+    entry.frame.flags |= fd ? can_flags::kFd : 0U;
+
+    cursor = strchr(cursor, ']');
+    if (cursor == nullptr)
+    {
+        return false;
+    }
+
+    entry.time_us = line_number;
+
+    if (strstr(cursor, "remote request") != nullptr)
+    {
+        entry.frame.flags |= can_flags::kRemote;
+        entry.frame.length = static_cast<uint8_t>(length);
+        return true;
+    }
+
+    return parse_bytes(cursor + 1, length, entry.frame);
+}
+
+/**
+ * "   0.012345 1  100             Rx   d 8 11 22 33 44 55 66 77 88" with an x after extended identifiers, or
+ * "   0.012345 CANFD   1 Rx        500  Name   1 0 d 32 11 22 ..." with an optional symbolic name.
+ */
+static bool parse_asc(const char* line, bool decimal_ids, LogFrame& entry)
+{
+    char* end = nullptr;
+    const double seconds = strtod(line, &end);
+    if ((end == line) || (*end != ' '))
+    {
+        return false;
+    }
+
+    entry.time_us = static_cast<uint64_t>(seconds * 1e6);
+
+    const char* cursor = skip_spaces(end);
+    const bool fd = (strncmp(cursor, "CANFD", 5U) == 0);
+    if (fd)
+    {
+        cursor = skip_spaces(cursor + 5);
+        entry.frame.flags |= can_flags::kFd;
+    }
+
+    // Channels are numbered from 1 and always map in order.
+    const auto channel = strtoul(cursor, &end, 10);
+    if ((end == cursor) || (channel == 0U) || (channel > kCanChannels))
+    {
+        return false;
+    }
+
+    entry.frame.channel = static_cast<CanChannel>(channel - 1U);
+    cursor = skip_spaces(end);
+
+    if (fd)
+    {
+        // Direction before the identifier.
+        cursor = skip_spaces(token_end(cursor));
+    }
+
+    uint32_t id = 0U;
+    const char* id_start = cursor;
+    if (decimal_ids)
+    {
+        id = static_cast<uint32_t>(strtoul(cursor, &end, 10));
+        cursor = end;
+    }
+    else
+    {
+        cursor = parse_hex(cursor, id);
+    }
+
+    if (cursor == id_start)
+    {
+        return false;
+    }
+
+    set_id(entry.frame, id, (*cursor == 'x'));
+    cursor = skip_spaces(token_end(cursor));
+
+    if (fd)
+    {
+        // Optional symbolic name, then the bit rate switch and error state indicator flags.
+        if ((cursor[0] != '0') && (cursor[0] != '1'))
+        {
+            cursor = skip_spaces(token_end(cursor));
+        }
+
+        if (cursor[0] == '1')
+        {
+            entry.frame.flags |= can_flags::kBitRateSwitch;
+        }
+
+        // BRS, ESI and the DLC.
+        for (int i = 0; i < 3; i++)
+        {
+            cursor = skip_spaces(token_end(cursor));
+        }
+
+        const auto length = strtoul(cursor, &end, 10);
+        return (end != cursor) && parse_bytes(end, length, entry.frame);
+    }
+
+    // Direction, then d for data or r for remote frames.
+    cursor = skip_spaces(token_end(cursor));
+
+    if (*cursor == 'r')
+    {
+        entry.frame.flags |= can_flags::kRemote;
+        return true;
+    }
+
+    if (*cursor != 'd')
+    {
+        return false;
+    }
+
+    cursor = skip_spaces(cursor + 1);
+    const auto length = strtoul(cursor, &end, 16);
+
+    return (end != cursor) && parse_bytes(end, length, entry.frame);
+}
+
+/**
+ * Append the frames of the log, skipping the lines that are not frames (headers, comments, error frames, events).
+ */
+static bool load_log(const char* path, std::vector<LogFrame>& frames, size_t& skipped)
+{
+    FILE* file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        printf("Cannot open %s\n", path);
+        return false;
+    }
+
+    const size_t first = frames.size();
+    const char* extension = strrchr(path, '.');
+    const bool asc = (extension != nullptr) && (strcmp(extension, ".asc") == 0);
+    bool decimal_ids = false;
+    size_t line_number = 0U;
+
+    std::array<char, 1024U> line = {};
+
+    while (fgets(line.data(), static_cast<int>(line.size()), file) != nullptr)
+    {
+        line_number++;
+
+        LogFrame entry = {};
+        bool parsed = false;
+
+        if (asc)
+        {
+            if (strncmp(line.data(), "base ", 5U) == 0)
+            {
+                decimal_ids = (strncmp(line.data(), "base dec", 8U) == 0);
+                continue;
+            }
+
+            parsed = parse_asc(line.data(), decimal_ids, entry);
+        }
+        else if (line[0] == '(')
+        {
+            parsed = parse_candump_log(line.data(), entry);
+        }
+        else
+        {
+            parsed = parse_candump(line.data(), line_number, entry);
+        }
+
+        if (parsed)
+        {
+            frames.push_back(entry);
+        }
+        else
+        {
+            skipped++;
+        }
+    }
+
+    fclose(file);
+
+    // Logs start at their first frame, each following the last one.
+    if (frames.size() > first)
+    {
+        const uint64_t offset = (first > 0U) ? frames[first - 1U].time_us : 0U;
+        const uint64_t start = frames[first].time_us;
+
+        for (size_t i = first; i < frames.size(); i++)
+        {
+            frames[i].time_us = frames[i].time_us - start + offset;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Set up the signal database and rules as the firmware does at boot.
+ */
+static bool load_pipeline()
+{
+    for (const char* name : logic::kSignals)
+    {
+        signal_db_add(name);
+    }
+
+    if (false == can_dbc::resolve_slots(replay_slots))
+    {
+        printf("Too many CAN signals for the signal database.\n");
+        return false;
+    }
+
+    rule_engine_clear(replay_rules);
+
+    for (const auto& rule : logic::kRules)
+    {
+        RuleCompileError error = {};
+        if (false == rule_engine_add(replay_rules, rule.expression, signal_db_find(rule.output), &error))
+        {
+            printf("Rule for %s: %s at %zu\n", rule.output, error.message, error.position);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct ReplayCounts
+{
+    uint64_t frames;
+    uint64_t decoded;
+    uint64_t rule_passes;
+};
+
+/**
+ * Run the frames through the pipeline, timing every stage call into the stats when given.
+ */
+static ReplayCounts replay(const std::vector<LogFrame>& frames, uint32_t repeat, uint64_t rule_period_us,
+    StageStats* decode_stats, StageStats* rule_stats, uint64_t clock_ns)
+{
+    ReplayCounts counts = {};
+    float* values = signal_db_values();
+
+    auto record = [clock_ns](StageStats& stats, uint64_t start, uint64_t allocations)
+    {
+        const uint64_t elapsed = now_ns() - start;
+        const uint64_t ns = (elapsed > clock_ns) ? (elapsed - clock_ns) : 0U;
+
+        stats.calls++;
+        stats.total_ns += ns;
+        stats.max_ns = std::max(stats.max_ns, ns);
+        stats.histogram[std::min<uint64_t>(ns, kLatencyBuckets - 1U)]++;
+        stats.allocations += replay_allocations.load(std::memory_order_relaxed) - allocations;
+    };
+
+    for (uint32_t pass = 0U; pass < repeat; pass++)
+    {
+        uint64_t next_rules_us = rule_period_us;
+
+        for (const LogFrame& entry : frames)
+        {
+            if (decode_stats != nullptr)
+            {
+                const uint64_t allocations = replay_allocations.load(std::memory_order_relaxed);
+                const uint64_t start = now_ns();
+                counts.decoded += can_dbc::decode(entry.frame, values, replay_slots) ? 1U : 0U;
+                record(*decode_stats, start, allocations);
+            }
+            else
+            {
+                counts.decoded += can_dbc::decode(entry.frame, values, replay_slots) ? 1U : 0U;
+            }
+
+            counts.frames++;
+
+            // Rules run at their own rate on the target, catching up on the periods the log skipped.
+            if ((rule_period_us > 0U) && (entry.time_us < next_rules_us))
+            {
+                continue;
+            }
+
+            next_rules_us = entry.time_us + rule_period_us;
+
+            if (rule_stats != nullptr)
+            {
+                const uint64_t allocations = replay_allocations.load(std::memory_order_relaxed);
+                const uint64_t start = now_ns();
+                rule_engine_evaluate(replay_rules, values);
+                record(*rule_stats, start, allocations);
+            }
+            else
+            {
+                rule_engine_evaluate(replay_rules, values);
+            }
+
+            counts.rule_passes++;
+        }
+    }
+
+    return counts;
+}
+
+static uint64_t percentile(const StageStats& stats, double fraction)
+{
+    const auto target = static_cast<uint64_t>(static_cast<double>(stats.calls) * fraction);
+    uint64_t seen = 0U;
+
+    for (size_t ns = 0U; ns < kLatencyBuckets; ns++)
+    {
+        seen += stats.histogram[ns];
+        if (seen > target)
+        {
+            return ns;
+        }
+    }
+
+    return kLatencyBuckets - 1U;
+}
+
+static void print_stage(const StageStats& stats)
+{
+    const double mean = (stats.calls > 0U) ? (static_cast<double>(stats.total_ns) / static_cast<double>(stats.calls))
+        : 0.0;
+
+    printf("%-8s %12" PRIu64 " %9.1f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %12" PRIu64 "\n",
+        stats.name, stats.calls, mean, percentile(stats, 0.5), percentile(stats, 0.99), percentile(stats, 0.999),
+        stats.max_ns, stats.allocations);
+}
+
+/**
+ * Cost of reading the clock once, subtracted from every stage call timed.
+ */
+static uint64_t calibrate_clock()
+{
+    constexpr size_t kSamples = 100000U;
+
+    // The fastest read, the others were interrupted.
+    uint64_t best = UINT64_MAX;
+    for (size_t i = 0U; i < kSamples; i++)
+    {
+        const uint64_t start = now_ns();
+        best = std::min(best, now_ns() - start);
+    }
+
+    return best;
+}
+
+static void usage()
+{
+    printf("usage: can_replay [--repeat N] [--rule-period-ms N] [--channel NAME=0|1]... [--signals] log...\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t repeat = kDefaultRepeat;
+    uint64_t rule_period_us = kDefaultRulePeriodMs * 1000U;
+    bool print_signals = false;
+    std::vector<const char*> paths = {};
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* argument = argv[i];
+        const bool has_value = (i + 1) < argc;
+
+        if ((strcmp(argument, "--repeat") == 0) && has_value)
+        {
+            repeat = static_cast<uint32_t>(std::max(1L, strtol(argv[++i], nullptr, 10)));
+        }
+        else if ((strcmp(argument, "--rule-period-ms") == 0) && has_value)
+        {
+            rule_period_us = strtoul(argv[++i], nullptr, 10) * 1000U;
+        }
+        else if ((strcmp(argument, "--channel") == 0) && has_value)
+        {
+            const char* mapping = argv[++i];
+            const char* equals = strchr(mapping, '=');
+            const unsigned long channel = (equals != nullptr) ? strtoul(equals + 1, nullptr, 10) : kCanChannels;
+            if (channel >= kCanChannels)
+            {
+                usage();
+                return 1;
+            }
+
+            replay_interfaces.push_back({std::string(mapping, static_cast<size_t>(equals - mapping)),
+                static_cast<CanChannel>(channel)});
+        }
+        else if (strcmp(argument, "--signals") == 0)
+        {
+            print_signals = true;
+        }
+        else if (argument[0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else
+        {
+            paths.push_back(argument);
+        }
+    }
+
+    if (paths.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    std::vector<LogFrame> frames = {};
+    size_t skipped = 0U;
+
+    const uint64_t load_allocations = replay_allocations.load();
+    const uint64_t load_start = now_ns();
+
+    for (const char* path : paths)
+    {
+        if (false == load_log(path, frames, skipped))
+        {
+            return 1;
+        }
+    }
+
+    const uint64_t load_ns = now_ns() - load_start;
+
+    if (frames.empty())
+    {
+        printf("No frames in the logs.\n");
+        return 1;
+    }
+
+    printf("Loaded %zu frames, %zu other lines skipped, %.3f s of log, in %.1f ms with %" PRIu64 " allocations\n",
+        frames.size(), skipped, static_cast<double>(frames.back().time_us) / 1e6, static_cast<double>(load_ns) / 1e6,
+        replay_allocations.load() - load_allocations);
+
+    if (false == load_pipeline())
+    {
+        return 1;
+    }
+
+    printf("%zu signals, %zu rules in %zu instructions\n", signal_db_count(), replay_rules.rules, replay_rules.length);
+
+    // Throughput, untimed stages.
+    const uint64_t replay_allocations_before = replay_allocations.load();
+    const uint64_t replay_start = now_ns();
+    const ReplayCounts counts = replay(frames, repeat, rule_period_us, nullptr, nullptr, 0U);
+    const uint64_t replay_ns = std::max<uint64_t>(now_ns() - replay_start, 1U);
+    const uint64_t replay_allocations_made = replay_allocations.load() - replay_allocations_before;
+
+    printf("Replayed %" PRIu64 " frames (%" PRIu64 " decoded) and %" PRIu64 " rule passes in %.1f ms: "
+        "%.2f M frames/s, %.1f ns per frame, %" PRIu64 " allocations\n",
+        counts.frames, counts.decoded, counts.rule_passes, static_cast<double>(replay_ns) / 1e6,
+        static_cast<double>(counts.frames) * 1e3 / static_cast<double>(replay_ns),
+        static_cast<double>(replay_ns) / static_cast<double>(counts.frames), replay_allocations_made);
+
+    // Latency, every stage call timed.
+    const uint64_t clock_ns = calibrate_clock();
+
+    static StageStats decode_stats = {};
+    static StageStats rule_stats = {};
+    decode_stats.name = "decode";
+    rule_stats.name = "rules";
+
+    (void)replay(frames, repeat, rule_period_us, &decode_stats, &rule_stats, clock_ns);
+
+    printf("\nStage latency in ns, %" PRIu64 " ns of clock read subtracted:\n", clock_ns);
+    printf("%-8s %12s %9s %8s %8s %8s %8s %12s\n", "stage", "calls", "mean", "p50", "p99", "p99.9", "max",
+        "allocations");
+    print_stage(decode_stats);
+    print_stage(rule_stats);
+
+    if (print_signals)
+    {
+        printf("\nSignals at the end of the log:\n");
+
+        for (size_t slot = 0U; slot < signal_db_count(); slot++)
+        {
+            printf("%-28s %g\n", signal_db_name(static_cast<SignalSlot>(slot)), signal_db_values()[slot]);
+        }
+    }
+
+    return ((replay_allocations_made == 0U) && (decode_stats.allocations == 0U) && (rule_stats.allocations == 0U))
+        ? 0 : 2;
+}
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Receive the telemetry of the VCM, check it and report its rate and its cost on the VCM.
+
+    telemetry_listen.py [192.168.0.100] [--group 239.255.0.1] [--port 5004] [--duration 10] [--diag-port 5002]
+
+Joins the multicast group the VCM publishes to, telemetry::kDestination, or with --group '' listens for unicast
+datagrams sent to this host.  Every second and at the end the samples per second of every group, the signals and
+datagrams per second, the samples per datagram, the samples lost (gaps in the sequence numbers of a group) and the
+latency from the time of a sample to its reception are printed.  The latency is only meaningful with the host clock
+synchronized to the PTP time of the VCM, e.g. by ptp4l and phc2sys.
+
+At the end the 'telemetry' statistics of the diagnostics service are read and the cost of publishing on the VCM
+printed: CPU cycles and microseconds per thousand signals, and the share of the CPU at the configured rate.
+"""
+
+import argparse
+import select
+import socket
+import struct
+import sys
+import time
+
+VERSION = 1
+
+HEADER = struct.Struct('<BBH')
+SAMPLE_HEADER = struct.Struct('<BBHQ')
+
+# Names of the groups of telemetry::kGroups, in order.
+GROUPS = ('currents', 'dynamics', 'temperatures', 'state')
+
+COST_FIELDS = ('signals/s', 'cycles/1k', 'us/1k', 'max_us', 'cpu_%')
+
+
+def decode(datagram):
+    """Return the sequence number and the (group, sequence, time_ns, values) samples of a datagram, raise ValueError
+    if it is malformed."""
+    if len(datagram) < HEADER.size:
+        raise ValueError('datagram shorter than its header')
+
+    version, count, sequence = HEADER.unpack_from(datagram)
+    if version != VERSION:
+        raise ValueError('version %u' % version)
+
+    samples = []
+    offset = HEADER.size
+
+    for _ in range(count):
+        group, signals, group_sequence, time_ns = SAMPLE_HEADER.unpack_from(datagram, offset)
+        offset += SAMPLE_HEADER.size
+
+        if offset + (4 * signals) > len(datagram):
+            raise ValueError('sample past the end of the datagram')
+
+        values = struct.unpack_from('<%uf' % signals, datagram, offset)
+        offset += 4 * signals
+
+        samples.append((group, group_sequence, time_ns, values))
+
+    return sequence, samples
+
+
+def group_name(index):
+    return GROUPS[index] if index < len(GROUPS) else 'group %u' % index
+
+
+class Listener:
+    def __init__(self, group, port):
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.socket.bind(('', port))
+        self.socket.setblocking(False)
+
+        if group:
+            membership = struct.pack('4s4s', socket.inet_aton(group), socket.inet_aton('0.0.0.0'))
+            self.socket.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+
+        self.expected_sequence = None
+        self.expected_group_sequence = {}
+        self.reset()
+        self.total_signals = 0
+        self.total_datagrams = 0
+        self.total_lost = 0
+
+    def reset(self):
+        self.samples = {}
+        self.signals = 0
+        self.datagrams = 0
+        self.datagrams_lost = 0
+        self.lost = 0
+        self.malformed = 0
+        self.max_samples = 0
+        self.max_latency_us = None
+
+    def receive(self):
+        while True:
+            try:
+                datagram = self.socket.recv(65536)
+            except BlockingIOError:
+                return
+
+            received_ns = time.time_ns()
+
+            try:
+                sequence, samples = decode(datagram)
+            except (ValueError, struct.error):
+                self.malformed += 1
+                continue
+
+            if self.expected_sequence is not None:
+                self.datagrams_lost += (sequence - self.expected_sequence) & 0xFFFF
+            self.expected_sequence = (sequence + 1) & 0xFFFF
+
+            self.datagrams += 1
+            self.total_datagrams += 1
+            self.max_samples = max(self.max_samples, len(samples))
+
+            for group, group_sequence, time_ns, values in samples:
+                expected = self.expected_group_sequence.get(group)
+                if expected is not None:
+                    lost = (group_sequence - expected) & 0xFFFF
+                    self.lost += lost
+                    self.total_lost += lost
+                self.expected_group_sequence[group] = (group_sequence + 1) & 0xFFFF
+
+                self.samples[group] = self.samples.get(group, 0) + 1
+                self.signals += len(values)
+                self.total_signals += len(values)
+
+                latency_us = (received_ns - time_ns) // 1000
+                if self.max_latency_us is None or latency_us > self.max_latency_us:
+                    self.max_latency_us = latency_us
+
+
+def report(listener, seconds):
+    rates = ', '.join('%s %.0f/s' % (group_name(group), count / seconds)
+                      for group, count in sorted(listener.samples.items()))
+    samples = sum(listener.samples.values())
+    samples_per_datagram = samples / listener.datagrams if listener.datagrams else 0.0
+    latency = 'n/a' if listener.max_latency_us is None else '%d us' % listener.max_latency_us
+
+    print('%7.0f signals/s %5.0f datagrams/s %5.1f samples/datagram (max %u), %u lost, %u datagrams lost, '
+          '%u malformed, max latency %s' % (listener.signals / seconds, listener.datagrams / seconds,
+                                            samples_per_datagram, listener.max_samples, listener.lost,
+                                            listener.datagrams_lost, listener.malformed, latency))
+    if rates:
+        print('    ' + rates)
+    listener.reset()
+
+
+def request(host, port, timeout=1.0):
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.settimeout(timeout)
+        sock.sendto(b'telemetry', (host, port))
+        reply, _ = sock.recvfrom(2048)
+    return reply
+
+
+def decode_cost(reply):
+    """Return a dict of the cost figures, raise ValueError if the reply is not the 'telemetry' report."""
+    lines = reply.decode('ascii', 'replace').split('\n')
+    if len(lines) < 4 or tuple(lines[2].split()) != COST_FIELDS:
+        raise ValueError('not a telemetry report: %r' % reply[:64])
+
+    values = lines[3].split()
+    if len(values) != len(COST_FIELDS):
+        raise ValueError('%u values for %u fields' % (len(values), len(COST_FIELDS)))
+
+    return {name: float(value) for name, value in zip(COST_FIELDS, values)}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', nargs='?', default='192.168.0.100', help='address of the VCM')
+    parser.add_argument('--group', default='239.255.0.1', help="multicast group to join, '' for unicast")
+    parser.add_argument('--port', type=int, default=5004, help='port of the telemetry')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds to listen for')
+    parser.add_argument('--diag-port', type=int, default=5002, help='port of the diagnostics service')
+    args = parser.parse_args()
+
+    listener = Listener(args.group, args.port)
+
+    start = time.monotonic()
+    last_report = start
+
+    while True:
+        now = time.monotonic()
+        if now - start >= args.duration:
+            break
+
+        ready, _, _ = select.select([listener.socket], [], [], 0.1)
+        if ready:
+            listener.receive()
+
+        if now - last_report >= 1.0:
+            report(listener, now - last_report)
+            last_report = now
+
+    report(listener, time.monotonic() - last_report)
+
+    elapsed = time.monotonic() - start
+    print('total: %u signals in %u datagrams (%.0f signals/s), %u samples lost' % (
+        listener.total_signals, listener.total_datagrams, listener.total_signals / elapsed, listener.total_lost))
+
+    try:
+        cost = decode_cost(request(args.host, args.diag_port))
+    except (OSError, ValueError) as error:
+        print('no telemetry statistics: %s' % error)
+        return 1
+
+    print('VCM: %.0f signals/s configured, %.0f cycles (%.1f us) per 1000 signals, longest tick %.0f us, '
+          '%.1f %% of the CPU' % (cost['signals/s'], cost['cycles/1k'], cost['us/1k'], cost['max_us'], cost['cpu_%']))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Flood the VCM with small UDP datagrams and report how its GMAC receive path batched them.
+
+    udp_flood.py [192.168.0.100] [--port 9] [--size 18] [--duration 10] [--rate full] [--diag-port 5002]
+
+The datagrams go to a port nothing listens on, so the IP task drops them right after parsing and the figures are those
+of the driver and the IP task alone.  The 'gmac' statistics of the diagnostics service are read before and after, and
+the difference printed: frames received per second, RX interrupts per second, frames per interrupt and per event sent
+to the IP task, and frames dropped for the lack of a network buffer or room in the IP task queue.
+
+With the default size of 18 bytes every datagram fills a minimum size Ethernet frame of 64 bytes, 148809 frames/s at
+100 Mbit/s.  Only use this on a bench: the rest of the network sees the flood as well.
+"""
+
+import argparse
+import socket
+import sys
+import time
+
+FIELDS = ('rx_ring', 'tx_ring', 'batch', 'interrupts', 'frames', 'batches', 'mean', 'largest', 'dropped')
+
+
+def request(host, port, timeout=1.0):
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.settimeout(timeout)
+        sock.sendto(b'gmac', (host, port))
+        reply, _ = sock.recvfrom(2048)
+    return reply
+
+
+def decode(reply):
+    """Return a dict of the statistics, raise ValueError if the reply is not the 'gmac' report."""
+    lines = reply.decode('ascii', 'replace').split('\n')
+    if len(lines) < 2 or tuple(lines[0].split()) != FIELDS:
+        raise ValueError('not a gmac report: %r' % reply[:64])
+
+    values = lines[1].split()
+    if len(values) != len(FIELDS):
+        raise ValueError('%u values for %u fields' % (len(values), len(FIELDS)))
+
+    return {name: (float(value) if name == 'mean' else int(value)) for name, value in zip(FIELDS, values)}
+
+
+def flood(host, port, size, duration, rate):
+    """Send for the duration, at most rate datagrams per second if given, and return the number sent."""
+    payload = bytes(size)
+    sent = 0
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        start = time.monotonic()
+        end = start + duration
+
+        while True:
+            now = time.monotonic()
+            if now >= end:
+                break
+            if rate is not None and sent >= (now - start) * rate:
+                continue
+
+            try:
+                sock.sendto(payload, (host, port))
+                sent += 1
+            except (BlockingIOError, ConnectionRefusedError):
+                pass
+
+    return sent
+
+
+def report(before, after, sent, duration):
+    delta = {name: (after[name] - before[name]) & 0xFFFFFFFF for name in ('interrupts', 'frames', 'batches', 'dropped')}
+
+    print('rings RX %u TX %u, batch %u' % (after['rx_ring'], after['tx_ring'], after['batch']))
+    print('sent %u datagrams, %.0f/s' % (sent, sent / duration))
+    print('received %u frames, %.0f/s, dropped %u' % (delta['frames'], delta['frames'] / duration, delta['dropped']))
+    print('%u interrupts, %.0f/s, %.2f frames per interrupt' % (
+        delta['interrupts'], delta['interrupts'] / duration, delta['frames'] / max(delta['interrupts'], 1)))
+    print('%u events to the IP task, %.2f frames per event, largest %u' % (
+        delta['batches'], delta['frames'] / max(delta['batches'], 1), after['largest']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', nargs='?', default='192.168.0.100', help='address of the VCM')
+    parser.add_argument('--port', type=int, default=9, help='destination port of the flood')
+    parser.add_argument('--size', type=int, default=18, help='UDP payload bytes')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds to flood for')
+    parser.add_argument('--rate', default='full', help="datagrams per second, or 'full' to send as fast as possible")
+    parser.add_argument('--diag-port', type=int, default=5002, help='port of the diagnostics service')
+    args = parser.parse_args()
+
+    rate = None if args.rate == 'full' else float(args.rate)
+
+    try:
+        before = decode(request(args.host, args.diag_port))
+        sent = flood(args.host, args.port, args.size, args.duration, rate)
+        # Leave the VCM time to drain its ring before reading the counters.
+        time.sleep(0.5)
+        after = decode(request(args.host, args.diag_port))
+    except (socket.timeout, ValueError) as error:
+        print('no statistics: %s' % error, file=sys.stderr)
+        return 1
+
+    report(before, after, sent, args.duration)
+    return 0
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main())
+    except KeyboardInterrupt:
+        sys.exit(0)